@@ -327,6 +327,14 @@ SOURCE=..\..\..\etk\support\StreamIO.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\etk\support\BufferedIO.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\etk\support\Arena.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\etk\support\List.cpp
 # End Source File
 # Begin Source File
@@ -347,6 +355,10 @@ SOURCE=..\..\..\etk\support\StringArray.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\etk\support\TextBuffer.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\etk\support\Flattenable.cpp
 # End Source File
 # End Group
@@ -615,6 +627,14 @@ SOURCE=..\..\..\etk\support\StreamIO.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\etk\support\BufferedIO.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\..\etk\support\Arena.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\etk\support\Errors.h
 # End Source File
 # Begin Source File
@@ -623,6 +643,10 @@ SOURCE=..\..\..\etk\support\List.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\etk\support\Vector.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\etk\support\Locker.h
 # End Source File
 # Begin Source File
@@ -639,6 +663,10 @@ SOURCE=..\..\..\etk\support\StringArray.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\etk\support\TextBuffer.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\etk\support\Flattenable.h
 # End Source File
 # Begin Source File
@@ -37,8 +37,12 @@
 #include <etk/support/Locker.h>
 #include <etk/support/String.h>
 #include <etk/support/List.h>
+#include <etk/support/Vector.h>
 #include <etk/support/StringArray.h>
+#include <etk/support/TextBuffer.h>
 #include <etk/support/DataIO.h>
 #include <etk/support/StreamIO.h>
+#include <etk/support/BufferedIO.h>
+#include <etk/support/Arena.h>
 #include <etk/support/Flattenable.h>
 
@@ -27,6 +27,7 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef __BEOS__
@@ -100,6 +101,24 @@ _IMPEXP_ETK bool etk_font_add(const char *family, const char *style, EFontEngine
 }
 
 
+void*
+EFontEngine::operator new(size_t size)
+{
+	void *ptr = malloc(size);
+	if(ptr != NULL) etk_memory_account_alloc(E_MEMORY_FONTS, size);
+	return ptr;
+}
+
+
+void
+EFontEngine::operator delete(void *ptr, size_t size)
+{
+	if(ptr == NULL) return;
+	etk_memory_account_free(E_MEMORY_FONTS, size);
+	free(ptr);
+}
+
+
 EFontEngine::EFontEngine()
 	: fFamily(NULL), fStyle(NULL), fFixedSize(NULL), nFixedSize(0), fRenderMode(E_FONT_RENDER_UNKNOWN), fServing(NULL)
 {
@@ -166,9 +185,9 @@ EFontEngine::~EFontEngine()
 	}
 	fAttached.MakeEmpty();
 
-	if(fFamily) delete[] fFamily;
-	if(fStyle) delete[] fStyle;
-	if(fFixedSize) delete[] fFixedSize;
+	SetFamily(NULL);
+	SetStyle(NULL);
+	SetFixedSize(NULL, 0);
 }
 
 
@@ -291,18 +310,26 @@ EFontEngine::GetFixedSize(float *size, eint32 index) const
 void
 EFontEngine::SetFamily(const char *family)
 {
-	if(fFamily) delete[] fFamily;
+	if(fFamily)
+	{
+		etk_memory_account_free(E_MEMORY_FONTS, strlen(fFamily) + 1);
+		delete[] fFamily;
+	}
 	fFamily = NULL;
-	if(family) fFamily = EStrdup(family);
+	if(family && (fFamily = EStrdup(family)) != NULL) etk_memory_account_alloc(E_MEMORY_FONTS, strlen(fFamily) + 1);
 }
 
 
 void
 EFontEngine::SetStyle(const char *style)
 {
-	if(fStyle) delete[] fStyle;
+	if(fStyle)
+	{
+		etk_memory_account_free(E_MEMORY_FONTS, strlen(fStyle) + 1);
+		delete[] fStyle;
+	}
 	fStyle = NULL;
-	if(style) fStyle = EStrdup(style);
+	if(style && (fStyle = EStrdup(style)) != NULL) etk_memory_account_alloc(E_MEMORY_FONTS, strlen(fStyle) + 1);
 }
 
 
@@ -311,6 +338,7 @@ EFontEngine::SetFixedSize(float *sizes, eint32 count)
 {
 	if(fFixedSize)
 	{
+		etk_memory_account_free(E_MEMORY_FONTS, sizeof(float) * (size_t)nFixedSize);
 		delete[] fFixedSize;
 		fFixedSize = NULL;
 	}
@@ -322,6 +350,7 @@ EFontEngine::SetFixedSize(float *sizes, eint32 count)
 		fFixedSize = new float[count];
 		memcpy(fFixedSize, sizes, sizeof(float) * (size_t)count);
 		nFixedSize = count;
+		etk_memory_account_alloc(E_MEMORY_FONTS, sizeof(float) * (size_t)count);
 	}
 }
 
@@ -102,6 +102,10 @@ public:
 	bool Lock();
 	void Unlock();
 
+	// the engines, the names and the fixed sizes are counted as E_MEMORY_FONTS
+	void *operator new(size_t size);
+	void operator delete(void *ptr, size_t size);
+
 protected:
 	void SetFamily(const char *family);
 	void SetStyle(const char *style);
@@ -34,6 +34,7 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
+#include FT_MODULE_H
 
 #include <etk/config.h>
 #include <etk/add-ons/font/FontEngine.h>
@@ -53,18 +54,74 @@ static FT_Library _etk_ft2_library_;
 static bool _etk_ft2_initialized_ = false;
 static ELocker etk_ft2_font_locker;
 
+
+// The faces and the glyphs cached by FreeType are counted as E_MEMORY_FONTS,
+// the size of each block is kept before it since FreeType frees it without the size.
+typedef union etk_ft2_block {
+	size_t size;
+	double align;
+	void *ptr;
+} etk_ft2_block;
+
+
+static void* etk_ft2_alloc(FT_Memory memory, long size)
+{
+	if(size <= 0) return NULL;
+
+	etk_ft2_block *block = (etk_ft2_block*)malloc(sizeof(etk_ft2_block) + (size_t)size);
+	if(block == NULL) return NULL;
+
+	block->size = (size_t)size;
+	etk_memory_account_alloc(E_MEMORY_FONTS, block->size);
+
+	return((void*)(block + 1));
+}
+
+
+static void etk_ft2_free(FT_Memory memory, void *ptr)
+{
+	if(ptr == NULL) return;
+
+	etk_ft2_block *block = (etk_ft2_block*)ptr - 1;
+	etk_memory_account_free(E_MEMORY_FONTS, block->size);
+	free(block);
+}
+
+
+static void* etk_ft2_realloc(FT_Memory memory, long cur_size, long new_size, void *ptr)
+{
+	if(ptr == NULL) return etk_ft2_alloc(memory, new_size);
+	if(new_size <= 0) {etk_ft2_free(memory, ptr); return NULL;}
+
+	etk_ft2_block *block = (etk_ft2_block*)ptr - 1;
+	size_t oldSize = block->size;
+
+	if((block = (etk_ft2_block*)realloc(block, sizeof(etk_ft2_block) + (size_t)new_size)) == NULL) return NULL;
+
+	block->size = (size_t)new_size;
+	etk_memory_account_free(E_MEMORY_FONTS, oldSize);
+	etk_memory_account_alloc(E_MEMORY_FONTS, block->size);
+
+	return((void*)(block + 1));
+}
+
+
+static struct FT_MemoryRec_ etk_ft2_memory = {NULL, etk_ft2_alloc, etk_ft2_free, etk_ft2_realloc};
+
+
 _IMPEXP_ETK bool etk_font_freetype2_init(void)
 {
 	EAutolock <ELocker> autolock(&etk_ft2_font_locker);
 
 	if(!_etk_ft2_initialized_)
 	{
-		FT_Error error = FT_Init_FreeType(&_etk_ft2_library_);
+		FT_Error error = FT_New_Library(&etk_ft2_memory, &_etk_ft2_library_);
 		if(error)
 		{
 			ETK_WARNING("[FONT]: %s --- CAN NOT initialize freetype engine %d\n", __PRETTY_FUNCTION__, error);
 			return false;
 		}
+		FT_Add_Default_Modules(_etk_ft2_library_);
 		_etk_ft2_initialized_ = true;
 	}
 
@@ -86,7 +143,7 @@ _IMPEXP_ETK void etk_font_freetype2_cancel(void)
 
 	if(_etk_ft2_initialized_)
 	{
-		FT_Done_FreeType(_etk_ft2_library_);
+		FT_Done_Library(_etk_ft2_library_);
 		_etk_ft2_initialized_ = false;
 	}
 }
@@ -324,38 +381,48 @@ EFontFT2::StringWidth(const char *string, float size, float spacing, float shear
 		     FT_Set_Char_Size(fFace, 0, (FT_F26Dot6)(size * 64.f), 0, 0)) return 0;
 //	if(FT_Set_Pixel_Sizes(fFace, 0, (FT_UInt)size)) return 0;
 
-	eunichar *unicode = e_utf8_convert_to_unicode(string, length);
-	if(!unicode) return 0;
+	if(string == NULL || *string == 0 || length == 0) return 0;
 
 	float width = 0;
 
 	int minx = 0, maxx = 0;
 
-	const eunichar *ch;
 	int x = 0;
 	int fontSpacing = (int)ceil((double)(spacing * size)) * 64;
-	for(ch = unicode; !(ch == NULL || *ch == 0); ch = e_unicode_next(ch, NULL))
+
+	// convert piece by piece without allocating
+	eunichar32 unicode[128];
+	if(length < 0) length = (eint32)strlen(string);
+	while(length > 0)
 	{
-		FT_UInt glyph_index = FT_Get_Char_Index(fFace, *ch);
-		if(FT_Load_Glyph(fFace, glyph_index, FT_LOAD_DEFAULT))
+		eint32 nBytes = length;
+		eint32 nChars = e_utf8_convert_to_utf32_etc(string, &nBytes, unicode, 128);
+		if(nBytes <= 0) break;
+
+		string += nBytes;
+		length -= nBytes;
+
+		for(eint32 i = 0; i < nChars; i++)
 		{
-			ETK_DEBUG("[FONT]: %s --- FT_Load_Glyph failed.", __PRETTY_FUNCTION__);
-			continue;
-		}
+			FT_UInt glyph_index = FT_Get_Char_Index(fFace, unicode[i]);
+			if(FT_Load_Glyph(fFace, glyph_index, FT_LOAD_DEFAULT))
+			{
+				ETK_DEBUG("[FONT]: %s --- FT_Load_Glyph failed.", __PRETTY_FUNCTION__);
+				continue;
+			}
 
-		FT_Glyph_Metrics *metrics = &(fFace->glyph->metrics);
+			FT_Glyph_Metrics *metrics = &(fFace->glyph->metrics);
 
-		minx = min_c(minx, x + metrics->horiBearingX);
-		maxx = max_c(maxx, x + max_c(metrics->horiAdvance, metrics->horiBearingX + metrics->width));
+			minx = min_c(minx, x + metrics->horiBearingX);
+			maxx = max_c(maxx, x + max_c(metrics->horiAdvance, metrics->horiBearingX + metrics->width));
 
-		x += metrics->horiAdvance + fontSpacing;
+			x += metrics->horiAdvance + fontSpacing;
+		}
 	}
 	if(x > fontSpacing) x -= fontSpacing;
 
 	width = (float)(maxx - minx) / 64.f;
 
-	free(unicode);
-
 	return width;
 }
 
@@ -428,70 +495,74 @@ EFontFT2::RenderString(const char *string, eint32 *width, eint32 *height, bool *
 	}
 	bzero(bitmap, sizeof(euint8) * (size_t)(w * h));
 
-	eunichar *unicode = e_utf8_convert_to_unicode(string, length);
-	if(!unicode)
-	{
-		delete[] bitmap;
-		return NULL;
-	}
-
-	const eunichar *ch;
 	euint32 x = 0;
 	euint32 y = (euint32)ceil(fontHeight.ascent);
 	bool do_mono = fForceFontAliasing;
-	for(ch = unicode; !(ch == NULL || *ch == 0); ch = e_unicode_next(ch, NULL))
-	{
-		if(FT_Load_Char(fFace, *ch, (do_mono ? (FT_LOAD_RENDER | FT_LOAD_MONOCHROME) : FT_LOAD_RENDER)))
-		{
-			ETK_DEBUG("[FONT]: %s --- FT_Load_Char failed.", __PRETTY_FUNCTION__);
-			continue;
-		}
 
-		FT_Bitmap *ftbitmap = &(fFace->glyph->bitmap);
+	// convert piece by piece without allocating, the same as StringWidth()
+	eunichar32 unicode[128];
+	if(length < 0) length = (eint32)strlen(string);
+	while(length > 0)
+	{
+		eint32 nBytes = length;
+		eint32 nChars = e_utf8_convert_to_utf32_etc(string, &nBytes, unicode, 128);
+		if(nBytes <= 0) break;
 
-		eint32 xx = x + (eint32)(fFace->glyph->bitmap_left);
-		eint32 yy = y - (eint32)(fFace->glyph->bitmap_top);
-		eint32 bitmapWidth = (eint32)(ftbitmap->width);
-		eint32 bitmapHeight = (eint32)(ftbitmap->rows);
-		eint32 lineBytes = (eint32)(ftbitmap->pitch > 0 ? ftbitmap->pitch : -(ftbitmap->pitch));
-		eint32 maxxx = min_c(w, xx + bitmapWidth);
-		eint32 maxyy = min_c(h, yy + bitmapHeight);
+		string += nBytes;
+		length -= nBytes;
 
-		for(eint32 i = yy, p = 0; i < maxyy; i++, p++)
+		for(eint32 n = 0; n < nChars; n++)
 		{
-			euint8* dest = bitmap;
-			dest += i * w + xx;
-			unsigned char* src = ftbitmap->buffer;
-			src += p * lineBytes;
+			if(FT_Load_Char(fFace, unicode[n], (do_mono ? (FT_LOAD_RENDER | FT_LOAD_MONOCHROME) : FT_LOAD_RENDER)))
+			{
+				ETK_DEBUG("[FONT]: %s --- FT_Load_Char failed.", __PRETTY_FUNCTION__);
+				continue;
+			}
 
-			switch(ftbitmap->pixel_mode)
+			FT_Bitmap *ftbitmap = &(fFace->glyph->bitmap);
+
+			eint32 xx = x + (eint32)(fFace->glyph->bitmap_left);
+			eint32 yy = y - (eint32)(fFace->glyph->bitmap_top);
+			eint32 bitmapWidth = (eint32)(ftbitmap->width);
+			eint32 bitmapHeight = (eint32)(ftbitmap->rows);
+			eint32 lineBytes = (eint32)(ftbitmap->pitch > 0 ? ftbitmap->pitch : -(ftbitmap->pitch));
+			eint32 maxxx = min_c(w, xx + bitmapWidth);
+			eint32 maxyy = min_c(h, yy + bitmapHeight);
+
+			for(eint32 i = yy, p = 0; i < maxyy; i++, p++)
 			{
-				case FT_PIXEL_MODE_GRAY:
-					for(eint32 j = xx; j < maxxx; j++) *dest++ = (euint8)(*src++);
-					break;
+				euint8* dest = bitmap;
+				dest += i * w + xx;
+				unsigned char* src = ftbitmap->buffer;
+				src += p * lineBytes;
 
-				case FT_PIXEL_MODE_MONO:
-					for(eint32 j = xx; j < maxxx; )
-					{
-						euint8 val = (euint8)(*src++);
-						eint32 left = maxxx - j >= 8 ? 8 : maxxx - j;
-						euint8 left_offset = 7;
+				switch(ftbitmap->pixel_mode)
+				{
+					case FT_PIXEL_MODE_GRAY:
+						for(eint32 j = xx; j < maxxx; j++) *dest++ = (euint8)(*src++);
+						break;
 
-						for(eint32 k = 0; k < left; k++, left_offset--, j++)
-							*dest++ = (val & (1 << left_offset)) ? 255 : 0;
-					}
-					break;
+					case FT_PIXEL_MODE_MONO:
+						for(eint32 j = xx; j < maxxx; )
+						{
+							euint8 val = (euint8)(*src++);
+							eint32 left = maxxx - j >= 8 ? 8 : maxxx - j;
+							euint8 left_offset = 7;
+
+							for(eint32 k = 0; k < left; k++, left_offset--, j++)
+								*dest++ = (val & (1 << left_offset)) ? 255 : 0;
+						}
+						break;
 
-				default:
-					ETK_DEBUG("[FONT]: %s --- The mode of freetype bitmap not supported.", __PRETTY_FUNCTION__);
+					default:
+						ETK_DEBUG("[FONT]: %s --- The mode of freetype bitmap not supported.", __PRETTY_FUNCTION__);
+				}
 			}
-		}
 
-		x += (euint32)((float)(fFace->glyph->metrics.horiAdvance) / 64.f) + (euint32)ceil((double)(spacing * size)); // next x
+			x += (euint32)((float)(fFace->glyph->metrics.horiAdvance) / 64.f) + (euint32)ceil((double)(spacing * size)); // next x
+		}
 	}
 
-	free(unicode);
-
 	*width = w;
 	*height = h;
 	*is_mono = do_mono;
@@ -191,6 +191,8 @@ EApplication::Run()
 
 	hLocker->Unlock();
 
+	_SetThreadLooper(this);
+
 	Lock();
 
 	ReadyToRun();
@@ -212,6 +214,8 @@ EApplication::Run()
 
 	Unlock();
 
+	_SetThreadLooper(NULL);
+
 	return NULL;
 }
 
@@ -42,6 +42,10 @@
 #include "MessageFilter.h"
 
 
+class EWatchingInfo;
+class EObserverIndex;
+
+
 class _LOCAL EObserverList {
 public:
 	EObserverList();
@@ -50,11 +54,28 @@ public:
 	e_status_t	AddWatching(EMessenger msgr, euint32 what);
 	e_status_t	RemoveWatching(EMessenger msgr, euint32 what);
 	bool		IsWatched(euint32 what) const;
-	EList		*GetObserverList(euint32 what) const;
+
+	// ObserversOf(): return the messengers to notify, it's valid until the list changed.
+	const EList	*ObserversOf(euint32 what) const;
 
 private:
 	EList fListWatching;
 	EList fListWatchingAll;
+
+	// messengers of all the observers, and of the observers watching all
+	EList fObservers;
+	EList fObserversOfAll;
+
+	// hash table of EObserverIndex, indexed by the "what" which someone watches or excludes
+	EList *fTable;
+	eint32 fTableSize;
+	eint32 fIndexCount;
+
+	EObserverIndex *_FindIndex(euint32 what) const;
+	void _RemoveIndex(EObserverIndex *index);
+	void _Resize(eint32 tableSize);
+	void _UpdateIndex(euint32 what);
+	void _Update(euint32 what);
 };
 
 
@@ -91,7 +112,7 @@ public:
 	bool AddWhat(euint32 what)
 	{
 		if(what == E_OBSERVER_OBSERVE_ALL) return false;
-		return fWhats.AddItem(reinterpret_cast<void*>(what));
+		return fWhats.AddItem((void*)(size_t)what);
 	}
 
 	bool RemoveWhat(euint32 what)
@@ -102,7 +123,7 @@ public:
 
 		for(eint32 i = 0; i < fWhats.CountItems(); i++)
 		{
-			if(reinterpret_cast<euint32>(fWhats.ItemAt(i)) == what)
+			if((euint32)(size_t)(fWhats.ItemAt(i)) == what)
 			{
 				fWhats.RemoveItem(i);
 				break;
@@ -118,11 +139,16 @@ public:
 
 		for(eint32 i = 0; i < fWhats.CountItems(); i++)
 		{
-			if(reinterpret_cast<euint32>(fWhats.ItemAt(i)) == what) return true;
+			if((euint32)(size_t)(fWhats.ItemAt(i)) == what) return true;
 		}
 		return false;
 	}
 
+	euint32 WhatAt(eint32 index) const
+	{
+		return (euint32)(size_t)(fWhats.ItemAt(index));
+	}
+
 	eint32 CountWhats() const
 	{
 		return fWhats.CountItems();
@@ -135,7 +161,28 @@ public:
 };
 
 
+class _LOCAL EObserverIndex {
+public:
+	euint32 what;
+
+	// messengers watching "what": the ones watching it exactly first,
+	// then the ones watching all except whom excluding "what".
+	EList observers;
+};
+
+
+static inline eint32 etk_observer_hash(euint32 what, eint32 tableSize)
+{
+	// "what" is mostly four characters, mix the bytes before masking
+	what ^= (what >> 16);
+	what *= 0x45d9f3b;
+	what ^= (what >> 16);
+	return (eint32)(what & (euint32)(tableSize - 1));
+}
+
+
 EObserverList::EObserverList()
+	: fTable(NULL), fTableSize(0), fIndexCount(0)
 {
 }
 
@@ -151,6 +198,147 @@ EObserverList::~EObserverList()
 	{
 		delete (EWatchingInfo*)fListWatchingAll.ItemAt(i);
 	}
+
+	for(eint32 i = 0; i < fTableSize; i++)
+	{
+		for(eint32 k = 0; k < fTable[i].CountItems(); k++) delete (EObserverIndex*)fTable[i].ItemAt(k);
+	}
+	if(fTable != NULL) delete[] fTable;
+}
+
+
+EObserverIndex*
+EObserverList::_FindIndex(euint32 what) const
+{
+	if(fTableSize == 0) return NULL;
+
+	const EList &bucket = fTable[etk_observer_hash(what, fTableSize)];
+	for(eint32 i = 0; i < bucket.CountItems(); i++)
+	{
+		EObserverIndex *index = (EObserverIndex*)bucket.ItemAt(i);
+		if(index->what == what) return index;
+	}
+
+	return NULL;
+}
+
+
+void
+EObserverList::_RemoveIndex(EObserverIndex *index)
+{
+	if(fTable[etk_observer_hash(index->what, fTableSize)].RemoveItem(index) == false) return;
+	delete index;
+	fIndexCount--;
+}
+
+
+void
+EObserverList::_Resize(eint32 tableSize)
+{
+	EList *table = new EList[tableSize];
+
+	for(eint32 i = 0; i < fTableSize; i++)
+	{
+		for(eint32 k = 0; k < fTable[i].CountItems(); k++)
+		{
+			EObserverIndex *index = (EObserverIndex*)fTable[i].ItemAt(k);
+			table[etk_observer_hash(index->what, tableSize)].AddItem(index);
+		}
+	}
+
+	if(fTable != NULL) delete[] fTable;
+	fTable = table;
+	fTableSize = tableSize;
+}
+
+
+void
+EObserverList::_UpdateIndex(euint32 what)
+{
+	EObserverIndex *index = _FindIndex(what);
+	bool referenced = false;
+
+	for(eint32 i = 0; !referenced && i < fListWatching.CountItems(); i++)
+		referenced = ((EWatchingInfo*)fListWatching.ItemAt(i))->HasWhat(what);
+	for(eint32 i = 0; !referenced && i < fListWatchingAll.CountItems(); i++)
+		referenced = ((EWatchingInfo*)fListWatchingAll.ItemAt(i))->HasWhat(what);
+
+	if(referenced == false)
+	{
+		// nobody watches or excludes it, fObserversOfAll is what to notify
+		if(index != NULL) _RemoveIndex(index);
+		return;
+	}
+
+	if(index == NULL)
+	{
+		if(fIndexCount >= fTableSize * 2) _Resize(fTableSize == 0 ? 8 : fTableSize * 2);
+
+		index = new EObserverIndex();
+		index->what = what;
+		fTable[etk_observer_hash(what, fTableSize)].AddItem(index);
+		fIndexCount++;
+	}
+	else
+	{
+		index->observers.MakeEmpty();
+	}
+
+	for(eint32 i = 0; i < fListWatching.CountItems(); i++)
+	{
+		EWatchingInfo *aInfo = (EWatchingInfo*)fListWatching.ItemAt(i);
+		if(aInfo->HasWhat(what)) index->observers.AddItem(aInfo->Messenger());
+	}
+
+	for(eint32 i = 0; i < fListWatchingAll.CountItems(); i++)
+	{
+		EWatchingInfo *aInfo = (EWatchingInfo*)fListWatchingAll.ItemAt(i);
+		if(aInfo->HasWhat(what) == false) index->observers.AddItem(aInfo->Messenger());
+	}
+}
+
+
+// _Update(): called after the observers changed, pass E_OBSERVER_OBSERVE_ALL
+// when the change affects every "what".
+void
+EObserverList::_Update(euint32 what)
+{
+	fObservers.MakeEmpty();
+	fObserversOfAll.MakeEmpty();
+
+	for(eint32 i = 0; i < fListWatchingAll.CountItems(); i++)
+	{
+		EMessenger *aMsgr = ((EWatchingInfo*)fListWatchingAll.ItemAt(i))->Messenger();
+		fObservers.AddItem(aMsgr);
+		fObserversOfAll.AddItem(aMsgr);
+	}
+
+	for(eint32 i = 0; i < fListWatching.CountItems(); i++)
+		fObservers.AddItem(((EWatchingInfo*)fListWatching.ItemAt(i))->Messenger());
+
+	if(what != E_OBSERVER_OBSERVE_ALL)
+	{
+		_UpdateIndex(what);
+		return;
+	}
+
+	for(eint32 i = 0; i < fTableSize; i++)
+	{
+		for(eint32 k = 0; k < fTable[i].CountItems(); k++) delete (EObserverIndex*)fTable[i].ItemAt(k);
+		fTable[i].MakeEmpty();
+	}
+	fIndexCount = 0;
+
+	for(eint32 i = 0; i < fListWatching.CountItems() + fListWatchingAll.CountItems(); i++)
+	{
+		EWatchingInfo *aInfo = (EWatchingInfo*)(i < fListWatching.CountItems() ?
+							fListWatching.ItemAt(i) :
+							fListWatchingAll.ItemAt(i - fListWatching.CountItems()));
+		for(eint32 k = 0; k < aInfo->CountWhats(); k++)
+		{
+			if(_FindIndex(aInfo->WhatAt(k)) == NULL) _UpdateIndex(aInfo->WhatAt(k));
+		}
+	}
 }
 
 
@@ -197,11 +385,13 @@ EObserverList::AddWatching(EMessenger msgr, euint32 what)
 		if(index_single >= 0)
 			delete (EWatchingInfo*)fListWatching.RemoveItem(index_single);
 
+		_Update(E_OBSERVER_OBSERVE_ALL);
 		return E_OK;
 	}
 	else if(index_all >= 0)
 	{
 		((EWatchingInfo*)fListWatchingAll.ItemAt(index_all))->RemoveWhat(what);
+		_Update(what);
 		return E_OK;
 	}
 
@@ -212,12 +402,20 @@ EObserverList::AddWatching(EMessenger msgr, euint32 what)
 			delete info;
 			return E_ERROR;
 		}
-		return E_OK;
 	}
-	else
+
+	if(!(info->HasWhat(what) || info->AddWhat(what)))
 	{
-		return((info->HasWhat(what) || info->AddWhat(what)) ? E_OK : E_ERROR);
+		if(info->CountWhats() <= 0)
+		{
+			fListWatching.RemoveItem(info);
+			delete info;
+		}
+		return E_ERROR;
 	}
+
+	_Update(what);
+	return E_OK;
 }
 
 
@@ -266,64 +464,26 @@ EObserverList::RemoveWatching(EMessenger msgr, euint32 what)
 		}
 	}
 
+	if(index_single >= 0 || index_all >= 0) _Update(what);
+
 	return E_OK;
 }
 
 
-EList*
-EObserverList::GetObserverList(euint32 what) const
+const EList*
+EObserverList::ObserversOf(euint32 what) const
 {
-	EList *list = new EList();
-
-	if(what == E_OBSERVER_OBSERVE_ALL)
-	{
-		for(eint32 i = 0; i < fListWatchingAll.CountItems(); i++)
-			list->AddItem(((EWatchingInfo*)fListWatchingAll.ItemAt(i))->Messenger());
-
-		for(eint32 i = 0; i < fListWatching.CountItems(); i++)
-			list->AddItem(((EWatchingInfo*)fListWatching.ItemAt(i))->Messenger());
-	}
-	else
-	{
-		for(eint32 i = 0; i < fListWatching.CountItems(); i++)
-		{
-			EWatchingInfo *aInfo = (EWatchingInfo*)fListWatching.ItemAt(i);
-			if(aInfo->HasWhat(what)) list->AddItem(aInfo->Messenger());
-		}
-
-		for(eint32 i = 0; i < fListWatchingAll.CountItems(); i++)
-		{
-			EWatchingInfo *aInfo = (EWatchingInfo*)fListWatchingAll.ItemAt(i);
-			if(aInfo->HasWhat(what) == false) list->AddItem(aInfo->Messenger());
-		}
-	}
-
-	if(list->IsEmpty())
-	{
-		delete list;
-		list = NULL;
-	}
+	if(what == E_OBSERVER_OBSERVE_ALL) return &fObservers;
 
-	return list;
+	EObserverIndex *index = _FindIndex(what);
+	return(index != NULL ? &(index->observers) : &fObserversOfAll);
 }
 
 
 bool
 EObserverList::IsWatched(euint32 what) const
 {
-	if(what == E_OBSERVER_OBSERVE_ALL) return(fListWatching.IsEmpty() == false || fListWatchingAll.IsEmpty() == false);
-
-	for(eint32 i = 0; i < fListWatching.CountItems(); i++)
-	{
-		if(((EWatchingInfo*)fListWatching.ItemAt(i))->HasWhat(what)) return true;
-	}
-
-	eint32 exclude_times = 0;
-	for(eint32 i = 0; i < fListWatchingAll.CountItems(); i++)
-	{
-		if(((EWatchingInfo*)fListWatchingAll.ItemAt(i))->HasWhat(what)) exclude_times++;
-	}
-	return(exclude_times != fListWatchingAll.CountItems());
+	return(ObserversOf(what)->IsEmpty() == false);
 }
 
 
@@ -585,8 +745,8 @@ EHandler::SendNotices(euint32 what, const EMessage *message)
 {
 	if(fObserverList == NULL) return;
 
-	EList *msgrsList = reinterpret_cast<EObserverList*>(fObserverList)->GetObserverList(what);
-	if(msgrsList == NULL) return;
+	const EList *msgrsList = reinterpret_cast<EObserverList*>(fObserverList)->ObserversOf(what);
+	if(msgrsList->IsEmpty()) return;
 
 	EMessage msg(E_OBSERVER_NOTICE_CHANGE);
 	if(message != NULL)
@@ -597,6 +757,9 @@ EHandler::SendNotices(euint32 what, const EMessage *message)
 	}
 	msg.AddInt32(E_OBSERVE_WHAT_CHANGE, what);
 
+	// the list belongs to the observers, so the dead ones are removed after notifying
+	EList *deadList = NULL;
+
 	for(eint32 i = 0; i < msgrsList->CountItems(); i++)
 	{
 		EMessenger *aMsgr = (EMessenger*)msgrsList->ItemAt(i);
@@ -607,7 +770,11 @@ EHandler::SendNotices(euint32 what, const EMessage *message)
 			{
 				ELooper *looper = NULL;
 				aMsgr->Target(&looper);
-				if(looper == NULL) StopWatchingAll(*aMsgr);
+				if(looper == NULL)
+				{
+					if(deadList == NULL) deadList = new EList();
+					deadList->AddItem(new EMessenger(*aMsgr));
+				}
 			}
 			else
 			{
@@ -616,7 +783,15 @@ EHandler::SendNotices(euint32 what, const EMessage *message)
 		}
 	}
 
-	delete msgrsList;
+	if(deadList == NULL) return;
+
+	for(eint32 i = 0; i < deadList->CountItems(); i++)
+	{
+		EMessenger *aMsgr = (EMessenger*)deadList->ItemAt(i);
+		StopWatchingAll(*aMsgr);
+		delete aMsgr;
+	}
+	delete deadList;
 }
 
 
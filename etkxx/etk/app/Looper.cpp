@@ -29,6 +29,7 @@
 
 #include <stdlib.h>
 
+#include <etk/config.h>
 #include <etk/kernel/Kernel.h>
 #include <etk/support/Locker.h>
 #include <etk/support/Autolock.h>
@@ -42,12 +43,149 @@
 #include "Messenger.h"
 #include "Looper.h"
 
+#if !defined(_WIN32) && defined(HAVE_POLL_H)
+#define ETK_LOOPER_DESCRIPTORS
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+#endif
+
 
 EList ELooper::sLooperList;
 
 
+// The top-level looper running on the current thread, maintained by the task of looper
+// so that Thread()/CurrentMessage()/LooperForThread() don't need the handler locker.
+#if defined(_MSC_VER)
+#define ETK_LOOPER_THREAD_LOCAL	__declspec(thread)
+#elif defined(__GNUC__) && !(defined(ETK_OS_BEOS) || defined(ETK_OS_DARWIN))
+#define ETK_LOOPER_THREAD_LOCAL	__thread
+#endif
+
+#ifdef ETK_LOOPER_THREAD_LOCAL
+static ETK_LOOPER_THREAD_LOCAL ELooper *etk_thread_looper = NULL;
+static ETK_LOOPER_THREAD_LOCAL e_thread_id etk_thread_looper_tid = 0;
+#endif
+
+
+typedef struct etk_looper_task {
+	ELooper		*owner;
+	e_bigtime_t	when;
+	e_task_func	func;
+	void		*user_data;
+} etk_looper_task;
+
+
+#ifdef ETK_LOOPER_DESCRIPTORS
+typedef struct etk_looper_descriptor {
+	ELooper			*owner;
+	int			fd;
+	euint32			events;
+	e_descriptor_func	callback;
+	void			*user_data;
+	EMessage		*message;
+	euint64			target;
+} etk_looper_descriptor;
+
+
+// The descriptors of the proxy and all its clients are held by the proxy,
+// "wakeup" is the eventfd (or pipe) to interrupt poll() when message posted.
+typedef struct etk_looper_io {
+	int	wakeup[2];
+	EList	descriptors;
+} etk_looper_io;
+
+
+static etk_looper_io* etk_looper_io_new()
+{
+	etk_looper_io *io = new etk_looper_io;
+	if(io == NULL) return NULL;
+
+#ifdef HAVE_SYS_EVENTFD_H
+	if((io->wakeup[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) >= 0)
+	{
+		io->wakeup[1] = io->wakeup[0];
+		return io;
+	}
+#endif
+
+	if(pipe(io->wakeup) != 0)
+	{
+		delete io;
+		return NULL;
+	}
+
+	for(int i = 0; i < 2; i++)
+	{
+		fcntl(io->wakeup[i], F_SETFL, fcntl(io->wakeup[i], F_GETFL) | O_NONBLOCK);
+		fcntl(io->wakeup[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	return io;
+}
+
+
+static void etk_looper_io_delete(etk_looper_io *io)
+{
+	if(io == NULL) return;
+
+	for(eint32 i = 0; i < io->descriptors.CountItems(); i++)
+	{
+		etk_looper_descriptor *desc = (etk_looper_descriptor*)io->descriptors.ItemAt(i);
+		if(desc->message) delete desc->message;
+		delete desc;
+	}
+
+	close(io->wakeup[0]);
+	if(io->wakeup[1] != io->wakeup[0]) close(io->wakeup[1]);
+
+	delete io;
+}
+
+
+static void etk_looper_io_wakeup(etk_looper_io *io)
+{
+	if(io == NULL) return;
+
+	ssize_t len;
+	if(io->wakeup[1] == io->wakeup[0])
+	{
+		euint64 value = E_INT64_CONSTANT(1);
+		len = write(io->wakeup[1], &value, sizeof(value));
+	}
+	else
+	{
+		char value = 0;
+		len = write(io->wakeup[1], &value, 1);
+	}
+	(void)len; // EAGAIN means that it's readable already
+}
+
+
+static void etk_looper_io_drain(etk_looper_io *io)
+{
+	char buf[64];
+	while(read(io->wakeup[0], buf, sizeof(buf)) > 0);
+}
+
+
+static eint32 etk_looper_io_find(etk_looper_io *io, int fd)
+{
+	for(eint32 i = 0; i < io->descriptors.CountItems(); i++)
+	{
+		if(((etk_looper_descriptor*)io->descriptors.ItemAt(i))->fd == fd) return i;
+	}
+	return -1;
+}
+#endif // ETK_LOOPER_DESCRIPTORS
+
+
 ELooper::ELooper(const char *name, eint32 priority)
-	: EHandler(name), fDeconstructing(false), fProxy(NULL), fHandlersCount(1), fPreferredHandler(NULL), fLocker(NULL), fLocksCount(E_INT64_CONSTANT(0)), fThread(NULL), fSem(NULL), fMessageQueue(NULL), fCurrentMessage(NULL), fThreadExited(NULL)
+	: EHandler(name), fDeconstructing(false), fProxy(NULL), fHandlersCount(1), fPreferredHandler(NULL), fLocker(NULL), fLocksCount(E_INT64_CONSTANT(0)), fThread(NULL), fSem(NULL), fMessageQueue(NULL), fCurrentMessage(NULL), fIsReady(false), fDescriptors(NULL), fThreadExited(NULL), fScratchArena(NULL)
 {
 	ELocker *hLocker = etk_get_handler_operator_locker();
 	EAutolock <ELocker>autolock(hLocker);
@@ -97,6 +235,19 @@ ELooper::~ELooper()
 
 	sLooperList.RemoveItem(this);
 
+#ifdef ETK_LOOPER_THREAD_LOCAL
+	if(etk_thread_looper == this) etk_thread_looper = NULL;
+#endif
+
+	for(eint32 i = 0; i < fIdleTasks.CountItems(); i++) delete (etk_looper_task*)fIdleTasks.ItemAt(i);
+	for(eint32 i = 0; i < fTimedTasks.CountItems(); i++) delete (etk_looper_task*)fTimedTasks.ItemAt(i);
+
+#ifdef ETK_LOOPER_DESCRIPTORS
+	etk_looper_io_delete((etk_looper_io*)fDescriptors);
+#endif
+
+	if(fScratchArena) delete fScratchArena;
+
 	if(EHandler::fToken != NULL) EHandler::fToken->MakeEmpty();
 
 	if(fLocker)
@@ -108,7 +259,7 @@ ELooper::~ELooper()
 
 
 ELooper::ELooper(const EMessage *from)
-	: EHandler(from), fDeconstructing(false), fProxy(NULL), fThreadPriority(E_NORMAL_PRIORITY), fHandlersCount(1), fPreferredHandler(NULL), fLocker(NULL), fLocksCount(E_INT64_CONSTANT(0)), fThread(NULL), fSem(NULL), fMessageQueue(NULL), fCurrentMessage(NULL), fThreadExited(NULL)
+	: EHandler(from), fDeconstructing(false), fProxy(NULL), fThreadPriority(E_NORMAL_PRIORITY), fHandlersCount(1), fPreferredHandler(NULL), fLocker(NULL), fLocksCount(E_INT64_CONSTANT(0)), fThread(NULL), fSem(NULL), fMessageQueue(NULL), fCurrentMessage(NULL), fIsReady(false), fDescriptors(NULL), fThreadExited(NULL), fScratchArena(NULL)
 {
 	ELocker *hLocker = etk_get_handler_operator_locker();
 	EAutolock <ELocker>autolock(hLocker);
@@ -380,7 +531,15 @@ ELooper::_PostMessage(const EMessage *_message, euint64 handlerToken, euint64 re
 			}
 		}
 
+		// mark ready before releasing the semaphore, so the proxy always find it when woken up
+		ELocker *hLocker = etk_get_handler_operator_locker();
+		hLocker->Lock();
+		if(fMessageQueue->IsEmpty() == false) _MarkReady();
 		etk_release_sem(fSem);
+#ifdef ETK_LOOPER_DESCRIPTORS
+		etk_looper_io_wakeup((etk_looper_io*)_Proxy()->fDescriptors);
+#endif
+		hLocker->Unlock();
 	}
 
 	fMessageQueue->Unlock();
@@ -588,29 +747,30 @@ ELooper::_task(void *arg)
 }
 
 
+// _MarkReady(), _NextReadyLooper(): called with the handler locker held,
+// the proxy only visits the loopers in its ready list instead of all the clients.
+void
+ELooper::_MarkReady()
+{
+	if(fIsReady) return;
+
+	ELooper *proxy = _Proxy();
+	if(proxy->fReadyLoopers.AddItem(this)) fIsReady = true;
+}
+
+
 ELooper*
-ELooper::_GetNextClient(ELooper *client) const
+ELooper::_NextReadyLooper()
 {
-	if(client == NULL || _Proxy() != client->_Proxy()) return NULL;
-	if(client->fClients.CountItems() > 0) return (ELooper*)client->fClients.FirstItem();
-	if(client->fProxy)
+	ELooper *looper;
+	while((looper = (ELooper*)fReadyLoopers.RemoveItem((eint32)0)) != NULL)
 	{
-		if(client->fProxy->fClients.LastItem() == (void*)client)
-		{
-			ELooper *retVal = NULL;
-			while(true)
-			{
-				client = client->fProxy;
-				if(client == NULL || client->fProxy == NULL) break;
-				retVal = (ELooper*)client->fProxy->fClients.ItemAt(client->fProxy->fClients.IndexOf(client) + 1);
-				if(retVal != NULL) break;
-			}
-			return retVal;
-		}
-		return((ELooper*)client->fProxy->fClients.ItemAt(client->fProxy->fClients.IndexOf(client) + 1));
+		looper->fIsReady = false;
+		if(looper->_Proxy() == this) break;
+		looper->_MarkReady();
 	}
 
-	return NULL;
+	return looper;
 }
 
 
@@ -629,18 +789,24 @@ ELooper::_taskLooper(ELooper *self, void *sem)
 
 	hLocker->Unlock();
 
+	_SetThreadLooper(self);
+
 	euint8 flags = 0; // 0 --- normal, 1 --- continue, >= 2 --- break
 	ELooper *looper = NULL;
 	EMessageQueue *queue = NULL;
 	while(flags < 2)
 	{
-		looper = self;
-
 		self->Lock();
-		queue = self->fMessageQueue;
-		while(looper != NULL && queue != NULL)
+		while(true)
 		{
+			hLocker->Lock();
+			looper = self->_NextReadyLooper();
+			hLocker->Unlock();
+
+			if(looper == NULL || (queue = looper->fMessageQueue) == NULL) break;
+
 			EMessage *aMsg = NULL;
+			bool hasMore = false;
 
 			queue->Lock();
 			if(queue->IsEmpty() == false)
@@ -662,9 +828,17 @@ ELooper::_taskLooper(ELooper *self, void *sem)
 					break;
 				}
 				aMsg = queue->NextMessage();
+				hasMore = !queue->IsEmpty();
 			}
 			queue->Unlock();
 
+			if(hasMore)
+			{
+				hLocker->Lock();
+				looper->_MarkReady();
+				hLocker->Unlock();
+			}
+
 			if(aMsg)
 			{
 				bool preferred = false;
@@ -680,18 +854,19 @@ ELooper::_taskLooper(ELooper *self, void *sem)
 				bool isClient = (looper->Proxy() == self ? true : false);
 				looper->Unlock();
 
+				if(self->fTimedTasks.IsEmpty() == false) self->_RunTasks(false);
+
 				if(isClient) continue;
 
 				flags = 1;
 				break;
 			}
-
-			looper = self->_GetNextClient(looper);
-			queue = (looper == NULL ? NULL : looper->fMessageQueue);
 		}
 
 		if(flags >= 2) break;
 
+		e_bigtime_t waitTime = (flags == 0 ? self->_RunTasks(true) : E_INFINITE_TIMEOUT);
+
 		self->Unlock();
 		if(flags > 0)
 		{
@@ -700,11 +875,14 @@ ELooper::_taskLooper(ELooper *self, void *sem)
 		}
 
 		etk_sem_info sem_info;
-		if(etk_acquire_sem(sem) != E_OK || etk_get_sem_info(sem, &sem_info) != E_OK) sem_info.closed = true;
+		e_status_t status = self->_WaitForEvents(sem, waitTime);
+		if(!(status == E_OK || status == E_TIMED_OUT) || etk_get_sem_info(sem, &sem_info) != E_OK) sem_info.closed = true;
 
 		if(sem_info.closed) break;
 	}
 
+	_SetThreadLooper(NULL);
+
 	return E_OK;
 }
 
@@ -733,18 +911,23 @@ ELooper::NextLooperMessage(e_bigtime_t timeout)
 	ELooper *looper = NULL;
 	EMessageQueue *queue = NULL;
 	EMessage *retVal = NULL;
+	EList skippedLoopers;
 
 	while(true)
 	{
-		looper = proxy;
-
 		proxy->Lock();
-		queue = proxy->fMessageQueue;
-		while(looper != NULL && queue != NULL)
+		while(true)
 		{
 			if(proxy == etk_app) EApplication::etk_dispatch_message_runners();
 
+			hLocker->Lock();
+			looper = proxy->_NextReadyLooper();
+			hLocker->Unlock();
+
+			if(looper == NULL || (queue = looper->fMessageQueue) == NULL) break;
+
 			EMessage *aMsg = NULL;
+			bool hasMore = false;
 
 			queue->Lock();
 			if(queue->IsEmpty() == false)
@@ -769,19 +952,35 @@ ELooper::NextLooperMessage(e_bigtime_t timeout)
 						}
 						else
 						{
+							// retry it at next time
 							looper->Unlock();
-							looper = proxy->_GetNextClient(looper);
-							queue = (looper == NULL ? NULL : looper->fMessageQueue);
+							skippedLoopers.AddItem(looper);
+							flags = 0;
 							continue;
 						}
 					}
+					else
+					{
+						// "_QUIT_" stays in the queue for the caller
+						hLocker->Lock();
+						looper->_MarkReady();
+						hLocker->Unlock();
+					}
 
 					break;
 				}
 				aMsg = queue->NextMessage();
+				hasMore = !queue->IsEmpty();
 			}
 			queue->Unlock();
 
+			if(hasMore)
+			{
+				hLocker->Lock();
+				looper->_MarkReady();
+				hLocker->Unlock();
+			}
+
 			if(aMsg)
 			{
 				bool preferred = false;
@@ -804,15 +1003,28 @@ ELooper::NextLooperMessage(e_bigtime_t timeout)
 				bool isClient = (looper->Proxy() == proxy ? true : false);
 				looper->Unlock();
 
+				if(proxy->fTimedTasks.IsEmpty() == false) proxy->_RunTasks(false);
+
 				if(isClient && Proxy() == proxy) continue;
 
 				flags = 1;
 				break;
 			}
+		}
 
-			looper = proxy->_GetNextClient(looper);
-			queue = (looper == NULL ? NULL : looper->fMessageQueue);
+		if(skippedLoopers.IsEmpty() == false)
+		{
+			hLocker->Lock();
+			for(eint32 i = 0; i < skippedLoopers.CountItems(); i++)
+			{
+				looper = (ELooper*)skippedLoopers.ItemAt(i);
+				if(looper->_Proxy() == proxy) looper->_MarkReady();
+			}
+			hLocker->Unlock();
+			skippedLoopers.MakeEmpty();
 		}
+
+		e_bigtime_t taskWaitTime = (flags == 0 ? proxy->_RunTasks(true) : E_INFINITE_TIMEOUT);
 		proxy->Unlock();
 
 		if(flags >= 2) break;
@@ -841,7 +1053,8 @@ ELooper::NextLooperMessage(e_bigtime_t timeout)
 				hLocker->Unlock();
 			}
 
-			status = etk_acquire_sem_etc(sem, E_INT64_CONSTANT(1), E_TIMEOUT, waitTime);
+			waitTime = min_c(waitTime, taskWaitTime);
+			status = proxy->_WaitForEvents(sem, waitTime);
 		}
 		if(etk_get_sem_info(sem, &sem_info) != E_OK) sem_info.closed = true;
 
@@ -867,7 +1080,7 @@ ELooper::DispatchLooperMessage(EMessage *msg)
 
 	if(!IsLockedByCurrentThread())
 		ETK_ERROR("[APP]: %s --- Looper must LOCKED before this call!", __PRETTY_FUNCTION__);
-	if(Thread() != etk_get_current_thread_id())
+	if(!_IsThreadLooper())
 		ETK_ERROR("[APP]: %s --- Looper must call this within the task of looper!", __PRETTY_FUNCTION__);
 
 	bool preferred = false;
@@ -915,11 +1128,20 @@ ELooper::_FilterAndDispatchMessage(EMessage *msg, EHandler *_target)
 		}
 	}
 
+	// the temporaries of dispatching go away together with the message
+	ELooper *proxy = _Proxy();
+	size_t mark = (proxy->fScratchArena != NULL ? proxy->fScratchArena->Mark() : 0);
+
 	EMessage *oldMsg = fCurrentMessage;
 	fCurrentMessage = msg;
 	DispatchMessage(msg, handler);
 	if(fCurrentMessage != NULL) delete fCurrentMessage;
 	fCurrentMessage = oldMsg;
+
+	// the proxy might be changed by DispatchMessage()
+	if(_Proxy() != proxy || proxy->fScratchArena == NULL) return;
+	if(mark == 0) proxy->fScratchArena->Reset();
+	else proxy->fScratchArena->Release(mark);
 }
 
 
@@ -927,7 +1149,7 @@ EMessage*
 ELooper::CurrentMessage() const
 {
 	if(!fCurrentMessage || !fMessageQueue) return NULL;
-	if(Thread() != etk_get_current_thread_id()) return NULL;
+	if(!_IsThreadLooper()) return NULL;
 
 	return fCurrentMessage;
 }
@@ -937,7 +1159,7 @@ EMessage*
 ELooper::DetachCurrentMessage()
 {
 	if(!fCurrentMessage || !fMessageQueue) return NULL;
-	if(Thread() != etk_get_current_thread_id()) return NULL;
+	if(!_IsThreadLooper()) return NULL;
 
 	EMessage *msg = fCurrentMessage;
 	fCurrentMessage = NULL;
@@ -956,10 +1178,35 @@ ELooper::MessageQueue() const
 eint64
 ELooper::Thread() const
 {
+#ifdef ETK_LOOPER_THREAD_LOCAL
+	if(etk_thread_looper != NULL && _IsThreadLooper()) return etk_thread_looper_tid;
+#endif
 	return etk_get_thread_id(Proxy()->fThread);
 }
 
 
+void
+ELooper::_SetThreadLooper(ELooper *looper)
+{
+#ifdef ETK_LOOPER_THREAD_LOCAL
+	etk_thread_looper = looper;
+	etk_thread_looper_tid = (looper == NULL ? 0 : etk_get_current_thread_id());
+#endif
+}
+
+
+// _IsThreadLooper(): whether the looper is dispatched by the current thread,
+// the proxy of a looper running on the current thread must be the looper of thread.
+bool
+ELooper::_IsThreadLooper() const
+{
+#ifdef ETK_LOOPER_THREAD_LOCAL
+	if(etk_thread_looper != NULL) return(etk_thread_looper == this || (fProxy != NULL && _Proxy() == etk_thread_looper));
+#endif
+	return(etk_get_thread_id(Proxy()->fThread) == etk_get_current_thread_id());
+}
+
+
 ELooper*
 ELooper::_Proxy() const
 {
@@ -1020,7 +1267,12 @@ ELooper::ProxyBy(ELooper *proxy)
 		ETK_ERROR("[APP]: %s --- Proxy must LOCKED before this call!", __PRETTY_FUNCTION__);
 	}
 
-	return _ProxyBy(proxy);
+	ELooper *oldProxy = _Proxy();
+	if(_ProxyBy(proxy) == false) return false;
+
+	_MigrateClientData(oldProxy);
+
+	return true;
 }
 
 
@@ -1092,9 +1344,24 @@ ELooper::_ProxyBy(ELooper *proxy)
 }
 
 
+EArena*
+ELooper::ScratchArena()
+{
+	if(_IsThreadLooper() == false) return NULL;
+
+	ELooper *proxy = _Proxy();
+	if(proxy->fScratchArena == NULL) proxy->fScratchArena = new EArena();
+	return proxy->fScratchArena;
+}
+
+
 ELooper*
 ELooper::LooperForThread(e_thread_id tid)
 {
+#ifdef ETK_LOOPER_THREAD_LOCAL
+	if(etk_thread_looper != NULL && tid == etk_thread_looper_tid) return etk_thread_looper;
+#endif
+
 	void *thread = etk_open_thread(tid);
 	if(thread == NULL) return NULL; // invalid id
 
@@ -1157,6 +1424,483 @@ ELooper::SetCommonFilterList(const EList *filterList)
 }
 
 
+e_status_t
+ELooper::RunWhenIdle(e_task_func func, void *user_data)
+{
+	return _AddTask(E_INT64_CONSTANT(-1), func, user_data);
+}
+
+
+e_status_t
+ELooper::RunAfter(e_bigtime_t delay, e_task_func func, void *user_data)
+{
+	if(delay < E_INT64_CONSTANT(0)) return E_BAD_VALUE;
+	return _AddTask(delay, func, user_data);
+}
+
+
+bool
+ELooper::CancelTask(e_task_func func, void *user_data)
+{
+	ELocker *hLocker = etk_get_handler_operator_locker();
+	EAutolock <ELocker>autolock(hLocker);
+
+	ELooper *proxy = _Proxy();
+	bool retVal = false;
+
+	EList *lists[2] = {&proxy->fIdleTasks, &proxy->fTimedTasks};
+	for(eint32 k = 0; k < 2; k++)
+	{
+		for(eint32 i = 0; i < lists[k]->CountItems(); i++)
+		{
+			etk_looper_task *task = (etk_looper_task*)lists[k]->ItemAt(i);
+			if(task->owner != this || task->func != func || task->user_data != user_data) continue;
+
+			lists[k]->RemoveItem(i--);
+			delete task;
+			retVal = true;
+		}
+	}
+
+	return retVal;
+}
+
+
+e_status_t
+ELooper::_AddTask(e_bigtime_t delay, e_task_func func, void *user_data)
+{
+	if(func == NULL) return E_BAD_VALUE;
+
+	ELocker *hLocker = etk_get_handler_operator_locker();
+	EAutolock <ELocker>autolock(hLocker);
+
+	ELooper *proxy = _Proxy();
+	EList *tasks = (delay < E_INT64_CONSTANT(0) ? &proxy->fIdleTasks : &proxy->fTimedTasks);
+
+	// merge with the pending one
+	for(eint32 i = 0; i < tasks->CountItems(); i++)
+	{
+		etk_looper_task *task = (etk_looper_task*)tasks->ItemAt(i);
+		if(task->owner == this && task->func == func && task->user_data == user_data) return E_OK;
+	}
+
+	etk_looper_task *task = new etk_looper_task;
+	if(task == NULL) return E_NO_MEMORY;
+
+	task->owner = this;
+	task->when = (delay < E_INT64_CONSTANT(0) ? E_INT64_CONSTANT(0) : etk_system_time() + delay);
+	task->func = func;
+	task->user_data = user_data;
+
+	if((delay < E_INT64_CONSTANT(0) ? tasks->AddItem(task) : proxy->_AddTimedTask(task)) == false)
+	{
+		delete task;
+		return E_NO_MEMORY;
+	}
+
+	// wake up the task of looper to take care of it
+	etk_release_sem(proxy->fSem);
+#ifdef ETK_LOOPER_DESCRIPTORS
+	etk_looper_io_wakeup((etk_looper_io*)proxy->fDescriptors);
+#endif
+
+	return E_OK;
+}
+
+
+bool
+ELooper::_AddTimedTask(void *data)
+{
+	etk_looper_task *task = (etk_looper_task*)data;
+
+	eint32 index = fTimedTasks.CountItems();
+	while(index > 0 && ((etk_looper_task*)fTimedTasks.ItemAt(index - 1))->when > task->when) index--;
+
+	return fTimedTasks.AddItem(task, index);
+}
+
+
+// _RunTasks(): called from the task of proxy with the looper locked,
+// it runs the expired tasks (and the idle tasks when "idle" is true and
+// no message is pending), then returns the time to wait for the next task.
+e_bigtime_t
+ELooper::_RunTasks(bool idle)
+{
+	ELocker *hLocker = etk_get_handler_operator_locker();
+	etk_looper_task *task;
+
+	while(true)
+	{
+		hLocker->Lock();
+		task = (etk_looper_task*)fTimedTasks.FirstItem();
+		if(task == NULL || task->when > etk_system_time())
+		{
+			hLocker->Unlock();
+			break;
+		}
+		fTimedTasks.RemoveItem((eint32)0);
+		hLocker->Unlock();
+
+		task->owner->Lock();
+		task->func(task->user_data);
+		task->owner->Unlock();
+		delete task;
+	}
+
+	if(idle)
+	{
+		// the tasks added by the idle tasks run at next time
+		hLocker->Lock();
+		eint32 count = fIdleTasks.CountItems();
+		hLocker->Unlock();
+
+		while(count-- > 0)
+		{
+			hLocker->Lock();
+			if(fReadyLoopers.IsEmpty() == false || (task = (etk_looper_task*)fIdleTasks.RemoveItem((eint32)0)) == NULL)
+			{
+				hLocker->Unlock();
+				break;
+			}
+			hLocker->Unlock();
+
+			task->owner->Lock();
+			task->func(task->user_data);
+			task->owner->Unlock();
+			delete task;
+		}
+	}
+
+	e_bigtime_t retVal = E_INFINITE_TIMEOUT;
+
+	hLocker->Lock();
+	if((task = (etk_looper_task*)fTimedTasks.FirstItem()) != NULL)
+		retVal = max_c(task->when - etk_system_time(), E_INT64_CONSTANT(0));
+	hLocker->Unlock();
+
+	return retVal;
+}
+
+
+e_status_t
+ELooper::AddDescriptor(int fd, euint32 events, e_descriptor_func callback, void *user_data)
+{
+	if(callback == NULL) return E_BAD_VALUE;
+	return _AddDescriptor(fd, events, callback, user_data, NULL, E_MAXUINT64);
+}
+
+
+e_status_t
+ELooper::AddDescriptor(int fd, euint32 events, const EMessage *message, EHandler *target)
+{
+	if(message == NULL) return E_BAD_VALUE;
+	if(target == NULL) target = this;
+	else if(target->Looper() != this) return E_BAD_HANDLER;
+
+	EMessage *msg = new EMessage(*message);
+	if(msg == NULL) return E_NO_MEMORY;
+
+	e_status_t retVal = _AddDescriptor(fd, events, NULL, NULL, msg, etk_get_handler_token(target));
+	if(retVal != E_OK) delete msg;
+
+	return retVal;
+}
+
+
+e_status_t
+ELooper::_AddDescriptor(int fd, euint32 events, e_descriptor_func callback, void *user_data, EMessage *message, euint64 target)
+{
+#ifdef ETK_LOOPER_DESCRIPTORS
+	if(fd < 0 || (events & (E_DESCRIPTOR_READ | E_DESCRIPTOR_WRITE | E_DESCRIPTOR_ERROR)) == 0) return E_BAD_VALUE;
+
+	if(!IsLockedByCurrentThread())
+		ETK_ERROR("[APP]: %s --- Looper must LOCKED before this call!", __PRETTY_FUNCTION__);
+
+	ELocker *hLocker = etk_get_handler_operator_locker();
+	EAutolock <ELocker>autolock(hLocker);
+
+	ELooper *proxy = _Proxy();
+	if(proxy->fDescriptors == NULL && (proxy->fDescriptors = (void*)etk_looper_io_new()) == NULL) return E_ERROR;
+
+	etk_looper_io *io = (etk_looper_io*)proxy->fDescriptors;
+	if(etk_looper_io_find(io, fd) >= 0) return E_NAME_IN_USE;
+
+	etk_looper_descriptor *desc = new etk_looper_descriptor;
+	if(desc == NULL) return E_NO_MEMORY;
+
+	desc->owner = this;
+	desc->fd = fd;
+	desc->events = events;
+	desc->callback = callback;
+	desc->user_data = user_data;
+	desc->message = message;
+	desc->target = target;
+
+	if(io->descriptors.AddItem(desc) == false)
+	{
+		delete desc;
+		return E_NO_MEMORY;
+	}
+
+	etk_looper_io_wakeup(io);
+
+	return E_OK;
+#else
+	ETK_WARNING("[APP]: %s --- Not supported on this platform.", __PRETTY_FUNCTION__);
+	return E_ERROR;
+#endif
+}
+
+
+e_status_t
+ELooper::RemoveDescriptor(int fd)
+{
+#ifdef ETK_LOOPER_DESCRIPTORS
+	if(!IsLockedByCurrentThread())
+		ETK_ERROR("[APP]: %s --- Looper must LOCKED before this call!", __PRETTY_FUNCTION__);
+
+	ELocker *hLocker = etk_get_handler_operator_locker();
+	EAutolock <ELocker>autolock(hLocker);
+
+	etk_looper_io *io = (etk_looper_io*)_Proxy()->fDescriptors;
+	eint32 index = (io == NULL ? -1 : etk_looper_io_find(io, fd));
+	etk_looper_descriptor *desc = (etk_looper_descriptor*)(index < 0 ? NULL : io->descriptors.ItemAt(index));
+	if(desc == NULL || desc->owner != this) return E_BAD_VALUE;
+
+	io->descriptors.RemoveItem(index);
+	if(desc->message) delete desc->message;
+	delete desc;
+
+	etk_looper_io_wakeup(io);
+
+	return E_OK;
+#else
+	return E_ERROR;
+#endif
+}
+
+
+// _MigrateClientData(): called with the handler locker held after the proxy of looper changed,
+// it moves the data held by "oldProxy" for this looper and its clients into the new proxy.
+void
+ELooper::_MigrateClientData(ELooper *oldProxy)
+{
+	if(oldProxy == NULL || oldProxy == _Proxy()) return;
+
+	for(eint32 i = 0; i < oldProxy->fReadyLoopers.CountItems(); i++)
+	{
+		ELooper *looper = (ELooper*)oldProxy->fReadyLoopers.ItemAt(i);
+
+		ELooper *proxy = looper->_Proxy();
+		if(proxy == oldProxy) continue;
+
+		oldProxy->fReadyLoopers.RemoveItem(i--);
+		if(proxy->fReadyLoopers.AddItem(looper) == false) looper->fIsReady = false;
+#ifdef ETK_LOOPER_DESCRIPTORS
+		etk_looper_io_wakeup((etk_looper_io*)proxy->fDescriptors);
+#endif
+	}
+
+	bool moved = false;
+	for(eint32 i = 0; i < oldProxy->fIdleTasks.CountItems(); i++)
+	{
+		etk_looper_task *task = (etk_looper_task*)oldProxy->fIdleTasks.ItemAt(i);
+
+		ELooper *proxy = task->owner->_Proxy();
+		if(proxy == oldProxy) continue;
+
+		oldProxy->fIdleTasks.RemoveItem(i--);
+		if(proxy->fIdleTasks.AddItem(task) == false) delete task;
+		else moved = true;
+	}
+	for(eint32 i = 0; i < oldProxy->fTimedTasks.CountItems(); i++)
+	{
+		etk_looper_task *task = (etk_looper_task*)oldProxy->fTimedTasks.ItemAt(i);
+
+		ELooper *proxy = task->owner->_Proxy();
+		if(proxy == oldProxy) continue;
+
+		oldProxy->fTimedTasks.RemoveItem(i--);
+		if(proxy->_AddTimedTask(task) == false) delete task;
+		else moved = true;
+	}
+	if(moved) etk_release_sem(_Proxy()->fSem);
+
+#ifdef ETK_LOOPER_DESCRIPTORS
+	etk_looper_io *io = (etk_looper_io*)oldProxy->fDescriptors;
+	for(eint32 i = 0; io != NULL && i < io->descriptors.CountItems(); i++)
+	{
+		etk_looper_descriptor *desc = (etk_looper_descriptor*)io->descriptors.ItemAt(i);
+
+		ELooper *proxy = desc->owner->_Proxy();
+		if(proxy == oldProxy) continue;
+
+		if(proxy->fDescriptors == NULL && (proxy->fDescriptors = (void*)etk_looper_io_new()) == NULL)
+		{
+			ETK_WARNING("[APP]: %s --- Unable to move the descriptor %d, removed.", __PRETTY_FUNCTION__, desc->fd);
+		}
+		else if(((etk_looper_io*)proxy->fDescriptors)->descriptors.AddItem(desc))
+		{
+			etk_looper_io_wakeup((etk_looper_io*)proxy->fDescriptors);
+			io->descriptors.RemoveItem(i--);
+			continue;
+		}
+
+		io->descriptors.RemoveItem(i--);
+		if(desc->message) delete desc->message;
+		delete desc;
+	}
+#endif
+}
+
+
+// _WaitForEvents(): called from the task of proxy instead of acquiring the semaphore directly,
+// it services the descriptors of the proxy and its clients while waiting.
+e_status_t
+ELooper::_WaitForEvents(void *sem, e_bigtime_t timeout)
+{
+#ifdef ETK_LOOPER_DESCRIPTORS
+	ELocker *hLocker = etk_get_handler_operator_locker();
+
+	e_bigtime_t startTime = etk_real_time_clock_usecs();
+	struct pollfd *fds = NULL;
+	eint32 fdsCount = 0;
+	e_status_t retVal = E_WOULD_BLOCK;
+
+	while(true)
+	{
+		e_bigtime_t waitTime = E_INFINITE_TIMEOUT;
+		if(timeout != E_INFINITE_TIMEOUT)
+		{
+			waitTime = timeout - (etk_real_time_clock_usecs() - startTime);
+			if(waitTime < E_INT64_CONSTANT(0)) waitTime = E_INT64_CONSTANT(0);
+		}
+
+		hLocker->Lock();
+		etk_looper_io *io = (etk_looper_io*)fDescriptors;
+		if(io == NULL || io->descriptors.IsEmpty())
+		{
+			hLocker->Unlock();
+			retVal = etk_acquire_sem_etc(sem, E_INT64_CONSTANT(1), E_TIMEOUT, waitTime);
+			break;
+		}
+
+		eint32 count = io->descriptors.CountItems() + 1;
+		if(count > fdsCount)
+		{
+			struct pollfd *newFds = (struct pollfd*)realloc(fds, sizeof(struct pollfd) * (size_t)count);
+			if(newFds == NULL)
+			{
+				hLocker->Unlock();
+				retVal = E_NO_MEMORY;
+				break;
+			}
+			fds = newFds;
+			fdsCount = count;
+		}
+
+		fds[0].fd = io->wakeup[0];
+		fds[0].events = POLLIN;
+		for(eint32 i = 1; i < count; i++)
+		{
+			etk_looper_descriptor *desc = (etk_looper_descriptor*)io->descriptors.ItemAt(i - 1);
+			fds[i].fd = desc->fd;
+			fds[i].events = 0;
+			if(desc->events & E_DESCRIPTOR_READ) fds[i].events |= POLLIN;
+			if(desc->events & E_DESCRIPTOR_WRITE) fds[i].events |= POLLOUT;
+		}
+		hLocker->Unlock();
+
+		// the semaphore released before waking up, so check it after the descriptors collected
+		if((retVal = etk_acquire_sem_etc(sem, E_INT64_CONSTANT(1), E_TIMEOUT, E_INT64_CONSTANT(0))) != E_WOULD_BLOCK) break;
+		if(waitTime == E_INT64_CONSTANT(0))
+		{
+			retVal = E_TIMED_OUT;
+			break;
+		}
+
+		int msecs = -1;
+		if(waitTime != E_INFINITE_TIMEOUT)
+			msecs = (int)min_c((waitTime + E_INT64_CONSTANT(999)) / E_INT64_CONSTANT(1000), E_INT64_CONSTANT(0x7fffffff));
+
+		int nReady = poll(fds, (nfds_t)count, msecs);
+		if(nReady < 0 && errno != EINTR)
+		{
+			retVal = E_ERROR;
+			break;
+		}
+		if(nReady <= 0) continue;
+
+		if(fds[0].revents != 0) etk_looper_io_drain(io);
+
+		for(eint32 i = 1; i < count; i++)
+		{
+			if(fds[i].revents == 0) continue;
+
+			euint32 events = 0;
+			if(fds[i].revents & (POLLIN | POLLPRI)) events |= E_DESCRIPTOR_READ;
+			if(fds[i].revents & POLLOUT) events |= E_DESCRIPTOR_WRITE;
+			if(fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) events |= E_DESCRIPTOR_ERROR;
+
+			// the looper might be torn down while polling
+			if(Lock() == false)
+			{
+				if(fds) free(fds);
+				return E_ERROR;
+			}
+
+			// the descriptor might be removed while polling
+			hLocker->Lock();
+			etk_looper_io *curIO = (etk_looper_io*)fDescriptors;
+			eint32 index = (curIO == NULL ? -1 : etk_looper_io_find(curIO, fds[i].fd));
+			etk_looper_descriptor *desc = (etk_looper_descriptor*)(index < 0 ? NULL : curIO->descriptors.ItemAt(index));
+			ELooper *owner = NULL;
+			e_descriptor_func callback = NULL;
+			void *user_data = NULL;
+			EMessage *message = NULL;
+			euint64 target = E_MAXUINT64;
+			if(desc != NULL && (events &= (desc->events | E_DESCRIPTOR_ERROR)) != 0)
+			{
+				owner = desc->owner;
+				callback = desc->callback;
+				user_data = desc->user_data;
+				message = (desc->message == NULL ? NULL : new EMessage(*(desc->message)));
+				target = desc->target;
+			}
+			hLocker->Unlock();
+
+			if(owner != NULL && owner->Lock() == false)
+			{
+				if(message) delete message;
+				Unlock();
+				continue;
+			}
+			if(callback != NULL)
+			{
+				callback(fds[i].fd, events, user_data);
+			}
+			else if(message != NULL)
+			{
+				message->AddInt32("etk:descriptor", fds[i].fd);
+				message->AddInt32("etk:events", (eint32)events);
+				owner->_PostMessage(message, target, E_MAXUINT64, E_INFINITE_TIMEOUT);
+				delete message;
+			}
+			if(owner != NULL) owner->Unlock();
+
+			Unlock();
+		}
+	}
+
+	if(fds) free(fds);
+
+	return retVal;
+#else
+	return etk_acquire_sem_etc(sem, E_INT64_CONSTANT(1), E_TIMEOUT, timeout);
+#endif
+}
+
+
 bool
 ELooper::IsDependsOnOthersWhenQuitRequested() const
 {
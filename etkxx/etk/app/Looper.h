@@ -32,6 +32,7 @@
 #define __ETK_LOOPER_H__
 
 #include <etk/support/List.h>
+#include <etk/support/Arena.h>
 #include <etk/kernel/OS.h>
 #include <etk/app/AppDefs.h>
 #include <etk/app/Handler.h>
@@ -43,6 +44,16 @@
 class EApplication;
 class EMessenger;
 
+/* events for ELooper::AddDescriptor() */
+enum {
+	E_DESCRIPTOR_READ	= 1,
+	E_DESCRIPTOR_WRITE	= 1 << 1,
+	E_DESCRIPTOR_ERROR	= 1 << 2
+};
+
+typedef void (*e_descriptor_func)(int fd, euint32 events, void *user_data);
+typedef void (*e_task_func)(void *user_data);
+
 class _IMPEXP_ETK ELooper : public EHandler {
 public:
 	ELooper(const char *name = NULL,
@@ -103,6 +114,33 @@ public:
 	virtual bool	SetCommonFilterList(const EList *filterList);
 	const EList	*CommonFilterList() const;
 
+	// RunWhenIdle(),RunAfter(),CancelTask():
+	//	Call "func" within the task of looper with the looper locked, without allocating message.
+	//	RunWhenIdle() runs it once the pending messages were handled, RunAfter() runs it
+	//	when "delay" microseconds passed. Requesting the same "func" and "user_data" again
+	//	while it's pending has no effect, so the repeated requests are merged into one call.
+	e_status_t	RunWhenIdle(e_task_func func, void *user_data = NULL);
+	e_status_t	RunAfter(e_bigtime_t delay, e_task_func func, void *user_data = NULL);
+	bool		CancelTask(e_task_func func, void *user_data = NULL);
+
+	// AddDescriptor(),RemoveDescriptor():
+	//	Watch the file descriptor within the task of looper, so that one thread services
+	//	both the message queue and the I/O. The looper must be LOCKED before these calls.
+	//	When "fd" is ready for "events", "callback" is called with the looper locked,
+	//	or a copy of "message" with "etk:descriptor" and "etk:events" (int32) added
+	//	is posted to "target" (NULL means the looper itself).
+	//	The descriptor is never closed by the looper, remove it before closing.
+	//	Return E_ERROR when the platform doesn't support it.
+	e_status_t	AddDescriptor(int fd, euint32 events, e_descriptor_func callback, void *user_data = NULL);
+	e_status_t	AddDescriptor(int fd, euint32 events, const EMessage *message, EHandler *target = NULL);
+	e_status_t	RemoveDescriptor(int fd);
+
+	// ScratchArena():
+	//	The arena for the temporary allocations of the thread of looper, shared by the
+	//	looper and its clients. All that's allocated while dispatching a message is freed
+	//	once DispatchMessage() returns. Return NULL when called outside the thread of looper.
+	EArena		*ScratchArena();
+
 	static ELooper	*LooperForThread(e_thread_id tid);
 
 protected:
@@ -162,10 +200,31 @@ private:
 
 	ELooper *_Proxy() const;
 	bool _ProxyBy(ELooper *proxy);
-	ELooper *_GetNextClient(ELooper *client) const;
+
+	static void _SetThreadLooper(ELooper *looper);
+	bool _IsThreadLooper() const;
+
+	EList fReadyLoopers;
+	bool fIsReady;
+	void _MarkReady();
+	ELooper *_NextReadyLooper();
+
+	EList fIdleTasks;
+	EList fTimedTasks;
+	e_status_t _AddTask(e_bigtime_t delay, e_task_func func, void *user_data);
+	bool _AddTimedTask(void *task);
+	e_bigtime_t _RunTasks(bool idle);
+
+	void *fDescriptors;
+	e_status_t _AddDescriptor(int fd, euint32 events, e_descriptor_func callback, void *user_data,
+				  EMessage *message, euint64 target);
+	e_status_t _WaitForEvents(void *sem, e_bigtime_t timeout);
+	void _MigrateClientData(ELooper *oldProxy);
 
 	bool *fThreadExited;
 
+	EArena *fScratchArena;
+
 	EList fCommonFilters;
 	void _FilterAndDispatchMessage(EMessage *msg, EHandler *target);
 
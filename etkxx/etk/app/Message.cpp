@@ -32,12 +32,77 @@
 #include <string.h>
 
 #include <etk/private/Token.h>
+#include <etk/private/Memory.h>
 #include <etk/support/StreamIO.h>
+#include <etk/support/ByteOrder.h>
 
 #include "Message.h"
 #include "Messenger.h"
 #include "Handler.h"
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+#include <utility>
+#endif
+
+
+// The nodes and the copied data are counted as E_MEMORY_MESSAGES.
+static void* etk_message_alloc(size_t size)
+{
+	void *ptr = EMemory::Malloc(size);
+	if(ptr != NULL) etk_memory_account_alloc(E_MEMORY_MESSAGES, size);
+	return ptr;
+}
+
+
+static void etk_message_free(void *ptr, size_t size)
+{
+	if(ptr == NULL) return;
+	etk_memory_account_free(E_MEMORY_MESSAGES, size);
+	EMemory::Free(ptr);
+}
+
+
+void*
+EMessage::list_data::operator new(size_t size)
+{
+	return etk_message_alloc(size);
+}
+
+
+void
+EMessage::list_data::operator delete(void *ptr, size_t size)
+{
+	etk_message_free(ptr, size);
+}
+
+
+void*
+EMessage::type_list_data::operator new(size_t size)
+{
+	return etk_message_alloc(size);
+}
+
+
+void
+EMessage::type_list_data::operator delete(void *ptr, size_t size)
+{
+	etk_message_free(ptr, size);
+}
+
+
+void*
+EMessage::_object_t::operator new(size_t size)
+{
+	return etk_message_alloc(size);
+}
+
+
+void
+EMessage::_object_t::operator delete(void *ptr, size_t size)
+{
+	etk_message_free(ptr, size);
+}
+
 
 EMessage::EMessage()
 	: what(0),
@@ -132,6 +197,62 @@ EMessage::operator=(const EMessage &msg)
 }
 
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+void
+EMessage::_Steal(EMessage &msg)
+{
+	what = msg.what;
+	fObjectsList = std::move(msg.fObjectsList);
+
+	fTeam = msg.fTeam;
+	fTargetToken = msg.fTargetToken;
+	fTargetTokenTimestamp = msg.fTargetTokenTimestamp;
+	fReplyToken = msg.fReplyToken;
+	fReplyTokenTimestamp = msg.fReplyTokenTimestamp;
+	fNoticeSource = msg.fNoticeSource;
+	fSource = msg.fSource;
+	fIsReply = msg.fIsReply;
+
+	msg.fTargetToken = E_MAXUINT64;
+	msg.fTargetTokenTimestamp = E_INT64_CONSTANT(0);
+	msg.fReplyToken = E_MAXUINT64;
+	msg.fReplyTokenTimestamp = E_INT64_CONSTANT(0);
+	msg.fNoticeSource = false;
+	msg.fSource = NULL;
+	msg.fIsReply = false;
+}
+
+
+EMessage::EMessage(EMessage &&msg)
+	: what(0), fTeam(E_INT64_CONSTANT(0)),
+	  fTargetToken(E_MAXUINT64), fTargetTokenTimestamp(E_INT64_CONSTANT(0)),
+	  fReplyToken(E_MAXUINT64), fReplyTokenTimestamp(E_INT64_CONSTANT(0)),
+	  fNoticeSource(false), fSource(NULL), fIsReply(false)
+{
+	_Steal(msg);
+}
+
+
+EMessage&
+EMessage::operator=(EMessage &&msg)
+{
+	if(this == &msg) return *this;
+
+	MakeEmpty();
+
+	if(fSource != NULL)
+	{
+		if(fNoticeSource) etk_close_port(fSource);
+		etk_delete_port(fSource);
+	}
+
+	_Steal(msg);
+
+	return *this;
+}
+#endif /* ETK_SUPPORT_RVALUE_REFERENCES */
+
+
 size_t
 EMessage::FlattenedSize() const
 {
@@ -270,6 +391,19 @@ EMessage::Flatten(char *buffer, size_t bufferSize) const
 }
 
 
+// reverses the bytes of a field flattened on the host of the other byte order
+static void etk_message_swap_field(void *field, size_t size)
+{
+	switch(size)
+	{
+		case 2: e_swap_int16_array(field, field, 1); break;
+		case 4: e_swap_int32_array(field, field, 1); break;
+		case 8: e_swap_int64_array(field, field, 1); break;
+		default: break;
+	}
+}
+
+
 bool
 EMessage::Unflatten(const char *buffer, size_t bufferSize)
 {
@@ -283,7 +417,14 @@ EMessage::Unflatten(const char *buffer, size_t bufferSize)
 	size_t _bufferSize = 0;
 
 	memcpy(&_bufferSize, src, sizeof(size_t));
-	if(bufferSize < _bufferSize) return false;
+	bool swapped = false;
+	if(bufferSize < _bufferSize)
+	{
+		// flattened on the host of the other byte order
+		etk_message_swap_field(&_bufferSize, sizeof(size_t));
+		if(bufferSize < _bufferSize) return false;
+		swapped = true;
+	}
 	src += sizeof(size_t); bufferSize -= sizeof(size_t);
 
 	// msg->what
@@ -310,12 +451,25 @@ EMessage::Unflatten(const char *buffer, size_t bufferSize)
 	// recordCount
 	memcpy(&recordCount, src, sizeof(euint64)); src += sizeof(euint64); bufferSize -= sizeof(euint64);
 
+	if(swapped)
+	{
+		etk_message_swap_field(&msg.what, sizeof(euint32));
+		etk_message_swap_field(&msg.fTeam, sizeof(eint64));
+		etk_message_swap_field(&msg.fTargetToken, sizeof(euint64));
+		etk_message_swap_field(&msg.fTargetTokenTimestamp, sizeof(e_bigtime_t));
+		etk_message_swap_field(&msg.fReplyToken, sizeof(euint64));
+		etk_message_swap_field(&msg.fReplyTokenTimestamp, sizeof(e_bigtime_t));
+		etk_message_swap_field(&source_address, sizeof(e_address_t));
+		etk_message_swap_field(&recordCount, sizeof(euint64));
+	}
+
 	for(euint64 i = (euint64)E_INT64_CONSTANT(0); i < recordCount; i++)
 	{
 		// Object->name
 		if(bufferSize < sizeof(size_t)) return false;
 		size_t nameLen;
 		memcpy(&nameLen, src, sizeof(size_t)); src += sizeof(size_t); bufferSize -= sizeof(size_t);
+		if(swapped) etk_message_swap_field(&nameLen, sizeof(size_t));
 
 		char *name = NULL;
 		if(nameLen > 0)
@@ -332,6 +486,7 @@ EMessage::Unflatten(const char *buffer, size_t bufferSize)
 		if(bufferSize < sizeof(e_type_code)) {if(name) free(name); return false;}
 		e_type_code type;
 		memcpy(&type, src, sizeof(e_type_code)); src += sizeof(e_type_code); bufferSize -= sizeof(e_type_code);
+		if(swapped) etk_message_swap_field(&type, sizeof(e_type_code));
 
 		// Object->fixed_size
 		if(bufferSize < sizeof(bool)) {if(name) free(name); return false;}
@@ -342,9 +497,11 @@ EMessage::Unflatten(const char *buffer, size_t bufferSize)
 		if(bufferSize < sizeof(size_t)) {if(name) free(name); return false;}
 		size_t bytes;
 		memcpy(&bytes, src, sizeof(size_t)); src += sizeof(size_t); bufferSize -= sizeof(size_t);
+		if(swapped) etk_message_swap_field(&bytes, sizeof(size_t));
 
 		// Object->data
 		void *data = NULL;
+		void *swappedData = NULL;
 		
 		if(bytes > 0)
 		{
@@ -355,26 +512,33 @@ EMessage::Unflatten(const char *buffer, size_t bufferSize)
 
 				e_address_t address = 0;
 				memcpy(&address, src, dataLen);
+				if(swapped) etk_message_swap_field(&address, dataLen);
 				data = reinterpret_cast<void*>(address);
 			}
+			else if(swapped && e_is_type_swapped(type))
+			{
+				// the arrays are swapped in bulk, AddData() copies it later
+				if(bufferSize < bytes || (swappedData = malloc(bytes)) == NULL) {if(name) free(name); return false;}
+				memcpy(swappedData, src, bytes);
+				e_swap_data(type, swappedData, bytes, E_SWAP_ALWAYS);
+				data = swappedData;
+			}
 			else
 			{
-				data = malloc(bytes);
-				if(!data) {if(name) free(name); return false;}
-				bzero(data, bytes);
-
-				if(bufferSize < bytes) {if(name) free(name); free(data); return false;}
-				memcpy(data, src, bytes);
+				// AddData() copies it from the buffer
+				if(bufferSize < bytes) {if(name) free(name); return false;}
+				data = (void*)src;
 			}
 			
 			src += bytes; bufferSize -= bytes;
 		}
 
 		// add to message
-		if(msg.AddData(name ? name : "", type, data, bytes, fixed_size) == false)
-			{if(name) free(name); if(data && fixed_size) free(data); return false;}
+		bool added = msg.AddData(name ? name : "", type, data, bytes, fixed_size);
+		if(swappedData) free(swappedData);
+		if(added == false) {if(name) free(name); return false;}
 
-		if(name) free(name); if(data && fixed_size) free(data);
+		if(name) free(name);
 	}
 
 	what = msg.what;
@@ -779,7 +943,7 @@ EMessage::MakeEmpty()
 				_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
 				if(!Object) continue;
 
-				if(Object->fixed_size && Object->data) free(Object->data);
+				if(Object->fixed_size && Object->data) etk_message_free(Object->data, Object->bytes);
 				delete Object;
 			}
 
@@ -840,7 +1004,7 @@ EMessage::AddData(const char *name, e_type_code type, const void *data, size_t n
 	Object->data = NULL;
 	if(is_fixed_size && numBytes > 0)
 	{
-		if((Object->data = malloc(numBytes)) == NULL)
+		if((Object->data = etk_message_alloc(numBytes)) == NULL)
 		{
 			delete Object;
 			return false;
@@ -850,7 +1014,7 @@ EMessage::AddData(const char *name, e_type_code type, const void *data, size_t n
 
 		if(memcpy(Object->data, data, numBytes) == NULL)
 		{
-			free(Object->data);
+			etk_message_free(Object->data, Object->bytes);
 			delete Object;
 			return false;
 		}
@@ -874,7 +1038,7 @@ EMessage::AddData(const char *name, e_type_code type, const void *data, size_t n
 							if(fObjectsList.AddItem((void*)ldata)) return true;
 				}
 
-		if(Object->fixed_size && Object->data) free(Object->data);
+		if(Object->fixed_size && Object->data) etk_message_free(Object->data, Object->bytes);
 		delete Object;
 
 		if(tldata) delete tldata;
@@ -891,7 +1055,7 @@ EMessage::AddData(const char *name, e_type_code type, const void *data, size_t n
 
 		if(tldata) if(tldata->list.AddItem((void*)Object)) return true;
 
-		if(Object->fixed_size && Object->data) free(Object->data);
+		if(Object->fixed_size && Object->data) etk_message_free(Object->data, Object->bytes);
 		delete Object;
 	}
 
@@ -1510,7 +1674,7 @@ EMessage::RemoveData(const char *name, e_type_code type, eint32 index)
 	_object_t *Object = (_object_t*)tldata->list.RemoveItem(index);
 	if(!Object) return false;
 
-	if(Object->fixed_size && Object->data) free(Object->data);
+	if(Object->fixed_size && Object->data) etk_message_free(Object->data, Object->bytes);
 	delete Object;
 
 	if(tldata->list.IsEmpty())
@@ -1546,7 +1710,7 @@ EMessage::RemoveData(const char *name, e_type_code type)
 		_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
 		if(!Object) continue;
 
-		if(Object->fixed_size && Object->data) free(Object->data);
+		if(Object->fixed_size && Object->data) etk_message_free(Object->data, Object->bytes);
 		delete Object;
 	}
 
@@ -1582,7 +1746,7 @@ EMessage::RemoveData(const char *name)
 			_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
 			if(!Object) continue;
 
-			if(Object->fixed_size && Object->data) free(Object->data);
+			if(Object->fixed_size && Object->data) etk_message_free(Object->data, Object->bytes);
 			delete Object;
 		}
 
@@ -1709,7 +1873,7 @@ EMessage::ReplaceData(const char *name, e_type_code type, eint32 index, const vo
 	Object->data = NULL;
 	if(is_fixed_size && numBytes > 0)
 	{
-		if((Object->data = malloc(numBytes + 1)) == NULL)
+		if((Object->data = etk_message_alloc(numBytes)) == NULL)
 		{
 			delete Object;
 			return false;
@@ -1719,7 +1883,7 @@ EMessage::ReplaceData(const char *name, e_type_code type, eint32 index, const vo
 
 		if(memcpy(Object->data, data, numBytes) == NULL)
 		{
-			free(Object->data);
+			etk_message_free(Object->data, Object->bytes);
 			delete Object;
 			return false;
 		}
@@ -1732,14 +1896,14 @@ EMessage::ReplaceData(const char *name, e_type_code type, eint32 index, const vo
 	_object_t *oldObject = NULL;
 	if(tldata->list.ReplaceItem(index, (void*)Object, (void**)&oldObject) == false)
 	{
-		if(Object->fixed_size && Object->data) free(Object->data);
+		if(Object->fixed_size && Object->data) etk_message_free(Object->data, Object->bytes);
 		delete Object;
 		return false;
 	}
 
 	if(oldObject)
 	{
-		if(oldObject->fixed_size && oldObject->data) free(oldObject->data);
+		if(oldObject->fixed_size && oldObject->data) etk_message_free(oldObject->data, oldObject->bytes);
 		delete oldObject;
 	}
 
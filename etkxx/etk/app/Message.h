@@ -55,6 +55,13 @@ public:
 
 	EMessage	&operator=(const EMessage &msg);
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	// moving takes the data, the tokens and the source of "msg" without copying,
+	// "msg" becomes empty after that.
+	EMessage(EMessage &&msg);
+	EMessage	&operator=(EMessage &&msg);
+#endif
+
 	eint32		CountTypesByName(const char *name) const;
 	eint32		CountTypesByName(eint32 nameIndex) const;
 	bool		TypeAt(const char *name, eint32 typeIndex, e_type_code *type) const;
@@ -239,20 +246,30 @@ private:
 	friend class ELooper;
 	friend class EMessenger;
 
+	// The nodes come from the size-class pools of EMemory, counted as E_MEMORY_MESSAGES.
 	typedef struct list_data {
 		char 		*name;
 		EList		list;
+
+		void		*operator new(size_t size);
+		void		operator delete(void *ptr, size_t size);
 	} list_data;
 
 	typedef struct type_list_data {
 		e_type_code	type;
 		EList		list;
+
+		void		*operator new(size_t size);
+		void		operator delete(void *ptr, size_t size);
 	} type_list_data;
 
 	typedef struct _object_t {
 		size_t		bytes;
 		bool		fixed_size;
 		void		*data;
+
+		void		*operator new(size_t size);
+		void		operator delete(void *ptr, size_t size);
 	} _object_t;
 
 	EList fObjectsList;
@@ -271,6 +288,10 @@ private:
 	void *fSource;
 
 	bool fIsReply;
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	void _Steal(EMessage &msg);
+#endif
 };
 
 
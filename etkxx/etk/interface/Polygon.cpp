@@ -68,6 +68,38 @@ EPolygon::operator=(const EPolygon &poly)
 }
 
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+EPolygon::EPolygon(EPolygon &&poly)
+	: fFrame(poly.fFrame), fCount(poly.fCount), fPts(poly.fPts), fNeededToUpdateFrame(poly.fNeededToUpdateFrame)
+{
+	poly.fFrame = ERect();
+	poly.fCount = 0;
+	poly.fPts = NULL;
+	poly.fNeededToUpdateFrame = false;
+}
+
+
+EPolygon&
+EPolygon::operator=(EPolygon &&poly)
+{
+	if(this == &poly) return *this;
+
+	if(fPts) free(fPts);
+	fFrame = poly.fFrame;
+	fCount = poly.fCount;
+	fPts = poly.fPts;
+	fNeededToUpdateFrame = poly.fNeededToUpdateFrame;
+
+	poly.fFrame = ERect();
+	poly.fCount = 0;
+	poly.fPts = NULL;
+	poly.fNeededToUpdateFrame = false;
+
+	return *this;
+}
+#endif /* ETK_SUPPORT_RVALUE_REFERENCES */
+
+
 ERect
 EPolygon::Frame() const
 {
@@ -42,6 +42,13 @@ public:
 	virtual ~EPolygon();
 
 	EPolygon	&operator=(const EPolygon &poly);
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	// moving takes the points of "poly" without copying,
+	// "poly" becomes empty after that.
+	EPolygon(EPolygon &&poly);
+	EPolygon	&operator=(EPolygon &&poly);
+#endif
 	ERect		Frame() const;
 
 	bool		AddPoints(const EPoint *pts, eint32 nPts, bool updateFrame = true);
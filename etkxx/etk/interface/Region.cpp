@@ -63,6 +63,9 @@
 
 #include "Region.h"
 
+// the stack buffer for the temporaries of Include() when no arena given
+#define ETK_REGION_ARENA_SIZE	1024
+
 /* --------------------------------------------------------------------------
 <document lang="zh_CN.UTF-8">
 <section id="EREGION_FUNCTION_CONSTRUCT">
@@ -105,6 +108,15 @@ ERegion::~ERegion()
 }
 
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+ERegion::ERegion(ERegion &&region)
+	: fRects(std::move(region.fRects)), fFrame(region.fFrame)
+{
+	region.fFrame = ERect();
+}
+#endif /* ETK_SUPPORT_RVALUE_REFERENCES */
+
+
 /* --------------------------------------------------------------------------
 <document lang="zh_CN.UTF-8">
 <section id="EREGION_FUNCTION_OPERATOR">
@@ -145,17 +157,19 @@ ERegion& ERegion::operator|=(const ERegion &<emphasis>region</emphasis>)
 ERegion&
 ERegion::operator=(const ERegion &from)
 {
+	if(this == &from) return *this;
+
 	MakeEmpty();
 
 	if(from.fRects.CountItems() > 0)
 	{
+		if(fRects.Reserve(from.fRects.CountItems()) == false) return *this;
+
 		for(eint32 i = 0; i < from.fRects.CountItems(); i++)
 		{
-			ERect *r = (ERect*)from.fRects.ItemAt(i);
-			ERect *nr = ((!r || r->IsValid() == false) ? NULL : new ERect(*r));
-			if(!nr || fRects.AddItem(nr) == false)
+			ERect *r = from.fRects.ItemAt(i);
+			if(r->IsValid() == false || fRects.AddItem(*r) == false)
 			{
-				if(nr) delete nr;
 				MakeEmpty();
 				break;
 			}
@@ -170,6 +184,21 @@ ERegion::operator=(const ERegion &from)
 }
 
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+ERegion&
+ERegion::operator=(ERegion &&from)
+{
+	if(this == &from) return *this;
+
+	fRects = std::move(from.fRects);
+	fFrame = from.fFrame;
+	from.fFrame = ERect();
+
+	return *this;
+}
+#endif /* ETK_SUPPORT_RVALUE_REFERENCES */
+
+
 /* --------------------------------------------------------------------------
 <document lang="zh_CN.UTF-8">
 <section id="EREGION_FUNCTION_FRAME">
@@ -207,7 +236,7 @@ ERect ERegion::RectAt(eint32 <emphasis>index</emphasis>) const
 ERect
 ERegion::RectAt(eint32 index) const
 {
-	ERect *r = (ERect*)fRects.ItemAt(index);
+	ERect *r = fRects.ItemAt(index);
 	return(r ? *r : ERect());
 }
 
@@ -298,53 +327,25 @@ ERegion::Set(ERect rect)
 {
 	MakeEmpty();
 
-	if(rect.IsValid())
-	{
-		ERect *r = new ERect(rect);
-
-		if(r)
-		{
-			if(fRects.AddItem(r))
-				fFrame = rect;
-			else
-				delete r;
-		}
-	}
+	if(rect.IsValid() && fRects.AddItem(rect)) fFrame = rect;
 }
 
 
 void
 ERegion::MakeEmpty()
 {
-	for(eint32 i = 0; i < fRects.CountItems(); i++)
-	{
-		ERect *r = (ERect*)fRects.ItemAt(i);
-		if(r) delete r;
-	}
-
 	fRects.MakeEmpty();
 	fFrame = ERect();
 }
 
 
-// return value must free by "delete[]"
-inline ERect* rect_exclude(ERect s, ERect r, eint8 *nRects)
+// "rects" must have room for 4 rectangles, return the count of pieces of "s" outside "r"
+static eint8 rect_exclude(ERect s, ERect r, ERect *rects)
 {
-	if(!r.IsValid() || !s.IsValid() || !nRects) return NULL;
+	if(!r.IsValid() || !s.IsValid()) return 0;
 
 	ERect iR = (s & r);
-	if(!iR.IsValid() || iR == s)
-	{
-		*nRects = 0;
-		return NULL;
-	}
-
-	ERect *rects = new ERect[4];
-	if(!rects)
-	{
-		*nRects = -1;
-		return NULL;
-	}
+	if(!iR.IsValid() || iR == s) return 0;
 
 	rects[0].Set(min_c(s.left, iR.left), min_c(s.top, iR.top), max_c(s.right, iR.right), max_c(s.top, iR.top)); // top
 	rects[1].Set(min_c(s.left, iR.left), min_c(s.bottom, iR.bottom), max_c(s.right, iR.right), max_c(s.bottom, iR.bottom)); // bottom
@@ -361,155 +362,122 @@ inline ERect* rect_exclude(ERect s, ERect r, eint8 *nRects)
 		}
 	}
 
-	*nRects = count;
-
-	if(count > 0) return rects;
-
-	delete[] rects;
-	return NULL;
+	return count;
 }
 
 
 bool
-ERegion::Include(ERect rect)
+ERegion::Include(ERect rect, EArena *arena)
 {
 	if(rect.IsValid() == false) return false;
 
+	if(arena == NULL)
+	{
+		char buffer[ETK_REGION_ARENA_SIZE];
+		EArena localArena(buffer, sizeof(buffer));
+		return Include(rect, &localArena);
+	}
+
+	size_t mark = arena->Mark();
 	ERect *rects = &rect;
 	eint32 nRects = 1;
+	bool covered = false;
+	bool retVal = true;
+
+	// the pieces are cut from "rects" into "newRects" then they're swapped, the one
+	// too small is replaced by the one twice larger, so the arena grows in O(n)
+	ERect *newRects = NULL;
+	eint32 rectsCapacity = 1, newCapacity = 0;
 
 	for(eint32 i = 0; i < fRects.CountItems(); i++)
 	{
-		ERect *r = (ERect*)fRects.ItemAt(i);
-
-		ERect **rs = ((!r || r->IsValid() == false) ? NULL : new ERect*[nRects]);
-		eint8 *nrs = ((!r || r->IsValid() == false) ? NULL : new eint8[nRects]);
-		eint32 nNeeded = 0;
-		bool haveNew = false;
+		ERect *r = fRects.ItemAt(i);
+		if(!r || r->IsValid() == false || nRects > E_MAXINT32 / 8) {retVal = false; break;}
 
-		if(rs && nrs)
+		if(newCapacity < nRects * 4)
 		{
-			for(eint32 j = 0; j < nRects; j++)
-			{
-				if(r->Intersects(rects[j]))
-				{
-					rs[j] = rect_exclude(rects[j], *r, &(nrs[j]));
-					if(nrs[j] < 0 || (rs[j] == NULL && nrs[j] > 0) || nNeeded >= E_MAXINT32 - nrs[j])
-					{
-						nNeeded = -(j + 1);
-						break;
-					}
-					else
-					{
-						haveNew = true;
-						nNeeded += nrs[j];
-					}
-				}
-				else
-				{
-					rs[j] = &(rects[j]);
-					nrs[j] = 1;
-					nNeeded++;
-				}
-			}
+			eint32 capacity = max_c(nRects * 4, newCapacity * 2);
+			if((newRects = (ERect*)arena->Allocate(sizeof(ERect) * (size_t)capacity)) == NULL) {retVal = false; break;}
+			newCapacity = capacity;
 		}
 
-		if(!rs || !nrs || nNeeded < 0)
-		{
-			if(rs && nrs) for(eint32 j = 0; j <= -(nNeeded + 1); j++) if(rs[j] != NULL && rs[j] != &(rects[j])) delete[] rs[j];
-			if(rs) delete[] rs;
-			if(nrs) delete[] nrs;
-
-			if(rects != &rect) delete[] rects;
-			return false;
-		}
-		else if(nNeeded == 0 && haveNew)
-		{
-			for(eint32 j = 0; j < nRects; j++) if(rs[j] != NULL && rs[j] != &(rects[j])) delete[] rs[j];
-			delete[] rs;
-			delete[] nrs;
-
-			if(rects != &rect) delete[] rects;
-			return true;
-		}
+		eint32 nNeeded = 0;
+		bool haveNew = false;
 
-		ERect *newRects = ((nNeeded > 0 && haveNew) ? new ERect[nNeeded] : NULL);
-		ERect *tmp = newRects;
 		for(eint32 j = 0; j < nRects; j++)
 		{
-			if(tmp && nrs[j] > 0)
+			if(r->Intersects(rects[j]))
+			{
+				nNeeded += rect_exclude(rects[j], *r, newRects + nNeeded);
+				haveNew = true;
+			}
+			else
 			{
-				memcpy(tmp, rs[j], sizeof(ERect) * (size_t)nrs[j]);
-				tmp += nrs[j];
+				newRects[nNeeded++] = rects[j];
 			}
-			if(rs[j] != NULL && rs[j] != &(rects[j])) delete[] rs[j];
 		}
 
-		delete[] rs;
-		delete[] nrs;
+		if(nNeeded == 0) {covered = true; break;}
 
-		if(newRects)
+		if(haveNew)
 		{
-			if(rects != &rect) delete[] rects;
+			ERect *tmp = rects;
+			eint32 tmpCapacity = rectsCapacity;
+
 			rects = newRects;
+			rectsCapacity = newCapacity;
 			nRects = nNeeded;
+
+			newRects = tmp;
+			newCapacity = (tmp == &rect ? 0 : tmpCapacity);
 		}
 	}
 
-	eint32 oldLength = fRects.CountItems();
-	ERect oldFrame = fFrame;
-
-	for(eint32 i = 0; i < nRects; i++)
+	if(retVal && !covered)
 	{
-		ERect *r = new ERect(rects[i]);
-		if(!r || r->IsValid() == false || fRects.AddItem(r) == false)
-		{
-			if(r) delete r;
-			if(rects != &rect) delete[] rects;
+		eint32 oldLength = fRects.CountItems();
+		ERect oldFrame = fFrame;
 
-			if(fRects.CountItems() > oldLength)
+		for(eint32 i = 0; i < nRects; i++)
+		{
+			if(rects[i].IsValid() == false || fRects.AddItem(rects[i]) == false)
 			{
-				for(eint32 i = oldLength; i < fRects.CountItems(); i++)
-				{
-					r = (ERect*)fRects.ItemAt(i);
-					if(r) delete r;
-				}
-				fRects.RemoveItems(oldLength, -1);
-			}
-			fFrame = oldFrame;
+				if(fRects.CountItems() > oldLength) fRects.RemoveItems(oldLength, -1);
+				fFrame = oldFrame;
 
-			return false;
+				retVal = false;
+				break;
+			}
+			fFrame = (fFrame.IsValid() ? (fFrame | rects[i]) : rects[i]);
 		}
-		fFrame = (fFrame.IsValid() ? (fFrame | *r) : *r);
 	}
 
-	if(rects != &rect) delete[] rects;
-	return true;
+	arena->Release(mark);
+	return retVal;
 }
 
 
 bool
-ERegion::Include(const ERegion *region)
+ERegion::Include(const ERegion *region, EArena *arena)
 {
 	if(region == NULL || region->CountRects() <= 0) return false;
 
+	if(arena == NULL)
+	{
+		char buffer[ETK_REGION_ARENA_SIZE];
+		EArena localArena(buffer, sizeof(buffer));
+		return Include(region, &localArena);
+	}
+
 	eint32 oldLength = fRects.CountItems();
 	ERect oldFrame = fFrame;
 
 	for(eint32 i = 0; i < region->CountRects(); i++)
 	{
 		ERect r = region->RectAt(i);
-		if(r.IsValid() == false || Include(r) == false)
+		if(r.IsValid() == false || Include(r, arena) == false)
 		{
-			if(fRects.CountItems() > oldLength)
-			{
-				for(eint32 i = oldLength; i < fRects.CountItems(); i++)
-				{
-					ERect *ar = (ERect*)fRects.ItemAt(i);
-					if(ar) delete ar;
-				}
-				fRects.RemoveItems(oldLength, -1);
-			}
+			if(fRects.CountItems() > oldLength) fRects.RemoveItems(oldLength, -1);
 			fFrame = oldFrame;
 			return false;
 		}
@@ -537,28 +505,22 @@ ERegion::Exclude(ERect r)
 		if(rect.IsValid() == false) {retVal = false; break;}
 		if(rect.Intersects(r) == false) {offset++; continue;}
 
-		eint8 nrs = 0;
-		ERect *rs = rect_exclude(rect, r, &nrs);
-		if(nrs < 0 || (rs == NULL && nrs > 0)) {if(rs) delete[] rs; retVal = false; break;}
+		ERect rs[4];
+		eint8 nrs = rect_exclude(rect, r, rs);
 
 		for(eint8 i = 0; i < nrs; i++)
 		{
-			ERect *tr = new ERect(rs[i]);
-			if(!tr || tr->IsValid() == false || aRegion.fRects.AddItem(tr, offset) == false)
+			if(rs[i].IsValid() == false || aRegion.fRects.AddItem(rs[i], offset) == false)
 			{
-				if(tr) delete tr;
 				retVal = false;
 				break;
 			}
 			offset++;
 		}
 
-		if(rs) delete[] rs;
 		if(!retVal) break;
 
-		ERect *ar = (ERect*)aRegion.fRects.RemoveItem(offset);
-		if(!ar) {retVal = false; break;}
-		delete ar;
+		if(aRegion.fRects.RemoveItem(offset) == false) {retVal = false; break;}
 
 		if(nrs == 0) break; // here the "rect == r", so we break
 	}
@@ -566,10 +528,10 @@ ERegion::Exclude(ERect r)
 	if(retVal)
 	{
 		MakeEmpty();
-		if(fRects.AddList(&(aRegion.fRects))) aRegion.fRects.MakeEmpty();
+		fRects.SwapWith(aRegion.fRects);
 		for(eint32 i = 0; i < fRects.CountItems(); i++)
 		{
-			ERect *r = (ERect*)fRects.ItemAt(i);
+			ERect *r = fRects.ItemAt(i);
 			fFrame = (fFrame.IsValid() ? (fFrame | *r) : *r);
 		}
 	}
@@ -597,10 +559,10 @@ ERegion::Exclude(const ERegion *region)
 	if(retVal)
 	{
 		MakeEmpty();
-		if(fRects.AddList(&(aRegion.fRects))) aRegion.fRects.MakeEmpty();
+		fRects.SwapWith(aRegion.fRects);
 		for(eint32 i = 0; i < fRects.CountItems(); i++)
 		{
-			ERect *r = (ERect*)fRects.ItemAt(i);
+			ERect *r = fRects.ItemAt(i);
 			fFrame = (fFrame.IsValid() ? (fFrame | *r) : *r);
 		}
 	}
@@ -616,7 +578,7 @@ ERegion::OffsetBy(float dx, float dy)
 
 	for(eint32 i = 0; i < fRects.CountItems(); i++)
 	{
-		ERect *r = (ERect*)fRects.ItemAt(i);
+		ERect *r = fRects.ItemAt(i);
 		r->OffsetBy(dx, dy);
 	}
 	fFrame.OffsetBy(dx, dy);
@@ -715,7 +677,7 @@ ERegion::Intersects(float l, float t, float r, float b) const
 
 	for(eint32 i = 0; i < fRects.CountItems(); i++)
 	{
-		ERect *rect = (ERect*)fRects.ItemAt(i);
+		ERect *rect = fRects.ItemAt(i);
 		if(!rect || rect->IsValid() == false) return false;
 		if(rect->Intersects(l, t, r, b)) return true;
 	}
@@ -731,12 +693,12 @@ ERegion::Intersects(const ERegion *region) const
 
 	for(eint32 i = 0; i < fRects.CountItems(); i++)
 	{
-		ERect *rect = (ERect*)fRects.ItemAt(i);
+		ERect *rect = fRects.ItemAt(i);
 		if(!rect || rect->IsValid() == false) return false;
 
 		for(eint32 j = 0; j < region->fRects.CountItems(); j++)
 		{
-			ERect *ar = (ERect*)region->fRects.ItemAt(j);
+			ERect *ar = region->fRects.ItemAt(j);
 			if(!ar || ar->IsValid() == false) return false;
 			if(ar->Intersects(*rect)) return true;
 		}
@@ -760,7 +722,7 @@ ERegion::Contains(float x, float y) const
 
 	for(eint32 i = 0; i < fRects.CountItems(); i++)
 	{
-		ERect *r = (ERect*)fRects.ItemAt(i);
+		ERect *r = fRects.ItemAt(i);
 		if(!r || r->IsValid() == false) return false;
 		if(r->Contains(x, y)) return true;
 	}
@@ -805,7 +767,7 @@ ERegion::PrintToStream() const
 	ETK_OUTPUT("\n");
 	for(eint32 i = 0; i < fRects.CountItems(); i++)
 	{
-		ERect *r = (ERect*)fRects.ItemAt(i);
+		ERect *r = fRects.ItemAt(i);
 		if(r) r->PrintToStream();
 		if(i < fRects.CountItems() - 1) ETK_OUTPUT(", ");
 	}
@@ -815,10 +777,18 @@ ERegion::PrintToStream() const
 ERegion
 ERegion::operator&(ERect r) const
 {
-	ERegion aRegion(*this);
-	if(aRegion.CountRects() != CountRects() || aRegion.Frame() != Frame()) aRegion.MakeEmpty();
+	// only the pieces inside "r" are copied
+	ERegion aRegion;
+	if(fFrame.Intersects(r) == false) return aRegion;
 
-	aRegion &= r;
+	for(eint32 i = 0; i < fRects.CountItems(); i++)
+	{
+		ERect rect = *fRects.ItemAt(i) & r;
+		if(rect.IsValid() == false) continue;
+
+		if(aRegion.fRects.AddItem(rect) == false) {aRegion.MakeEmpty(); break;}
+		aRegion.fFrame = (aRegion.fFrame.IsValid() ? (aRegion.fFrame | rect) : rect);
+	}
 
 	return aRegion;
 }
@@ -845,15 +815,13 @@ ERegion::operator&=(ERect r)
 		eint32 offset = 0;
 		while(offset < fRects.CountItems())
 		{
-			ERect *rect = (ERect*)fRects.ItemAt(offset);
+			ERect *rect = fRects.ItemAt(offset);
 			if(!rect || rect->IsValid() == false) {MakeEmpty(); break;}
 
 			*rect &= r;
 			if(rect->IsValid() == false)
 			{
-				rect = (ERect*)fRects.RemoveItem(offset);
-				if(!rect) {MakeEmpty(); break;}
-				delete rect;
+				if(fRects.RemoveItem(offset) == false) {MakeEmpty(); break;}
 				continue;
 			}
 
@@ -864,7 +832,7 @@ ERegion::operator&=(ERect r)
 	fFrame = ERect();
 	for(eint32 i = 0; i < fRects.CountItems(); i++)
 	{
-		ERect *rect = (ERect*)fRects.ItemAt(i);
+		ERect *rect = fRects.ItemAt(i);
 		fFrame = (fFrame.IsValid() ? (fFrame | *rect) : *rect);
 	}
 
@@ -883,10 +851,13 @@ ERegion::operator|=(ERect r)
 ERegion
 ERegion::operator&(const ERegion &region) const
 {
-	ERegion aRegion(*this);
-	if(aRegion.CountRects() != CountRects() || aRegion.Frame() != Frame()) aRegion.MakeEmpty();
-
-	aRegion &= region;
+	ERegion aRegion(operator&(region.fFrame));
+	if(aRegion.fRects.CountItems() > 0 && region.CountRects() > 1)
+	{
+		ERegion tmpRegion(region.fFrame);
+		tmpRegion.Exclude(&region);
+		aRegion.Exclude(&tmpRegion);
+	}
 
 	return aRegion;
 }
@@ -940,7 +911,7 @@ ERegion::Scale(float scaling)
 	{
 		for(eint32 i = 0; i < fRects.CountItems(); i++)
 		{
-			ERect *r = (ERect*)fRects.ItemAt(i);
+			ERect *r = fRects.ItemAt(i);
 			r->left *= scaling;
 			r->top *= scaling;
 			r->right *= scaling;
@@ -31,7 +31,8 @@
 #ifndef __ETK_REGION_H__
 #define __ETK_REGION_H__
 
-#include <etk/support/List.h>
+#include <etk/support/Vector.h>
+#include <etk/support/Arena.h>
 #include <etk/interface/Rect.h>
 
 #ifdef __cplusplus /* Just for C++ */
@@ -45,6 +46,13 @@ public:
 
 	ERegion &operator=(const ERegion &from);
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	// moving takes the rectangles of "region" without copying,
+	// "region" becomes empty after that.
+	ERegion(ERegion &&region);
+	ERegion &operator=(ERegion &&from);
+#endif
+
 	ERegion operator&(ERect r) const;
 	ERegion operator|(ERect r) const;
 
@@ -64,8 +72,10 @@ public:
 	void Set(ERect singleBound);
 	void MakeEmpty();
 
-	bool Include(ERect r);
-	bool Include(const ERegion *region);
+	// Include(): the temporaries are allocated from "arena" and freed before return,
+	// a small buffer on stack is used when "arena" is NULL.
+	bool Include(ERect r, EArena *arena = NULL);
+	bool Include(const ERegion *region, EArena *arena = NULL);
 
 	bool Exclude(ERect r);
 	bool Exclude(const ERegion *region);
@@ -94,7 +104,7 @@ public:
 	void PrintToStream() const;
 
 private:
-	EList fRects;
+	EVector<ERect, 4, E_MEMORY_REGIONS> fRects;
 	ERect fFrame;
 };
 
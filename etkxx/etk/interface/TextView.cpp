@@ -200,7 +200,7 @@ ETextView::ReScanSize(eint32 fromLine, eint32 toLine)
 		line->height = 0;
 		line->max_ascent = 0;
 
-		const char *str = fText.String() + curLineOffset;
+		const char *str = fText.StringAt(curLineOffset, line->length);
 		e_font_height fontHeight;
 
 		if(line->array == NULL || line->array->count <= 0)
@@ -238,7 +238,6 @@ ETextView::ReScanLines()
 {
 	e_text_line *line;
 	eint32 aOffset;
-	eint32 found;
 
 	for(aOffset = 0; !(fRunArray == NULL || aOffset >= fRunArray->count - 1);)
 	{
@@ -267,31 +266,36 @@ ETextView::ReScanLines()
 	if((line = (e_text_line*)malloc(sizeof(e_text_line))) == NULL) return;
 	if(fLines.AddItem(line) == false) {free(line); return;}
 
-	aOffset = 0;
-	while((found = fText.FindFirst("\n", aOffset)) >= 0)
-	{
-		line->length = found - aOffset;
-		line->array = NULL;
-		aOffset = found + 1;
-
-		e_text_line *newLine = (e_text_line*)malloc(sizeof(e_text_line));
-		if(newLine == NULL) break;
-		if(fLines.AddItem(newLine) == false) {free(newLine); break;}
-		line = newLine;
-	}
+	// walk the pieces of text once, every line break ends a line
+	const char *chunk;
+	eint32 chunkLength;
 
-	if(found < 0)
+	aOffset = 0;
+	for(eint32 offset = 0; (chunk = fText.ChunkAt(offset, &chunkLength)) != NULL; offset += chunkLength)
 	{
-		line->length = fText.Length() - aOffset;
-		line->array = NULL;
+		const char *end = chunk + chunkLength;
+		const char *found;
 
-		if(line->length < 0)
+		for(const char *str = chunk; (found = (const char*)memchr(str, '\n', (size_t)(end - str))) != NULL; str = found + 1)
 		{
-			fLines.RemoveItem(line);
-			free(line);
+			e_text_line *newLine = (e_text_line*)malloc(sizeof(e_text_line));
+			if(newLine == NULL || fLines.AddItem(newLine) == false)
+			{
+				if(newLine) free(newLine);
+				offset = fText.Length();
+				break;
+			}
+
+			line->length = offset + (eint32)(found - chunk) - aOffset;
+			line->array = NULL;
+			aOffset += line->length + 1;
+			line = newLine;
 		}
 	}
 
+	line->length = max_c(fText.Length() - aOffset, 0);
+	line->array = NULL;
+
 	ReScanRunArray(0, -1);
 	ReScanSize(0, -1);
 
@@ -350,21 +354,11 @@ eint32
 ETextView::LineAt(eint32 offset, bool utf8) const
 {
 	if(offset < 0 || offset > (utf8 ? fText.CountChars() : fText.Length())) return -1;
-	if(utf8) offset = (offset == fText.CountChars() ? fText.Length() : (fText.CharAt(offset, NULL) - fText.String()));
+	if(utf8) offset = fText.CharOffsetAt(offset);
 
 	if(offset == 0) return 0;
-	if(offset == fText.Length()) return max_c(fLines.CountItems() - 1, 0);
-
-	eint32 nextLineOffset = 0;
-	for(eint32 i = 0; i < fLines.CountItems(); i++)
-	{
-		e_text_line *line = (e_text_line*)fLines.ItemAt(i);
-		nextLineOffset += line->length + 1;
-		if(offset < nextLineOffset) return i;
-	}
 
-	// should not reach here
-	return -1;
+	return min_c(fText.LineAt(offset), max_c(fLines.CountItems() - 1, 0));
 }
 
 
@@ -407,7 +401,7 @@ ETextView::PointAt(eint32 offset, float *height, bool max_height, bool utf8) con
 	if(height) *height = 0;
 
 	if(!rect.IsValid() || offset < 0 || offset > (utf8 ? fText.CountChars() : fText.Length())) return EPoint(-1.f, -1.f);
-	if(utf8) offset = (offset == fText.CountChars() ? fText.Length() : (fText.CharAt(offset, NULL) - fText.String()));
+	if(utf8) offset = fText.CharOffsetAt(offset);
 
 	eint32 nextLineOffset = 0;
 
@@ -428,7 +422,7 @@ ETextView::PointAt(eint32 offset, float *height, bool max_height, bool utf8) con
 
 		if(offset < nextLineOffset)
 		{
-			const char *str = fText.String() + curLineOffset;
+			const char *str = fText.StringAt(curLineOffset, line->length);
 			eint32 __offset = offset - curLineOffset;
 			e_font_height fontHeight;
 			EPoint pt(rect.left, yStart);
@@ -520,7 +514,7 @@ ETextView::OffsetAt(EPoint pt, bool visible, bool utf8) const
 		if(pt.x > start)
 		{
 			euint8 nbytes;
-			const char *str = e_utf8_at(fText.String() + curLineOffset, 0, &nbytes);
+			const char *str = e_utf8_at(fText.StringAt(curLineOffset, line->length), 0, &nbytes);
 			const char *tmp = NULL;
 
 			float xStart, xEnd;
@@ -568,7 +562,7 @@ ETextView::OffsetAt(EPoint pt, bool visible, bool utf8) const
 			retVal += ((tmp == NULL || tmp - str > line->length) ? line->length : tmp - str);
 		}
 
-		return(utf8 ? e_utf8_strlen_etc(fText.String(), retVal) : retVal);
+		return(utf8 ? fText.CharIndexAt(retVal) : retVal);
 	}
 
 	return -1;
@@ -580,14 +574,9 @@ ETextView::OffsetAt(eint32 line, bool utf8) const
 {
 	if(line < 0 || line >= fLines.CountItems()) return -1;
 
-	eint32 lineOffset = 0;
-	for(eint32 i = 0; i < line; i++)
-	{
-		e_text_line *line = (e_text_line*)fLines.ItemAt(i);
-		lineOffset += line->length + 1;
-	}
+	eint32 lineOffset = fText.OffsetAt(line);
 
-	return(utf8 ? e_utf8_strlen_etc(fText.String(), lineOffset) : lineOffset);
+	return(utf8 ? fText.CharIndexAt(lineOffset) : lineOffset);
 }
 
 
@@ -639,8 +628,8 @@ ETextView::GetTextRegion(eint32 startPos, eint32 endPos, ERegion *region, bool u
 	if(endPos < 0 || endPos > (utf8 ? fText.CountChars() : fText.Length())) endPos = (utf8 ? fText.CountChars() : fText.Length());
 	if(utf8 && endPos > startPos)
 	{
-		startPos = fText.CharAt(startPos, NULL) - fText.String();
-		endPos = (endPos == fText.CountChars() ? fText.Length() : (fText.CharAt(endPos, NULL) - fText.String()));
+		startPos = fText.CharOffsetAt(startPos);
+		endPos = fText.CharOffsetAt(endPos);
 	}
 
 	if(endPos <= startPos) return;
@@ -663,7 +652,7 @@ ETextView::GetTextRegion(eint32 startPos, eint32 endPos, ERegion *region, bool u
 		if(startPos >= nextLineOffset) continue;
 		if(endPos <= curLineOffset) break;
 
-		const char *str = fText.String() + curLineOffset;
+		const char *str = fText.StringAt(curLineOffset, line->length);
 		eint32 __offset = max_c(startPos - curLineOffset, 0);
 
 		ERect r;
@@ -735,7 +724,7 @@ ETextView::GetTextRegion(eint32 startPos, eint32 endPos, ERegion *region, bool u
 		}
 
 		r &= rect;
-		region->Include(r);
+		region->Include(r, (Window() != NULL ? Window()->ScratchArena() : NULL));
 	}
 }
 
@@ -830,27 +819,23 @@ ETextView::GetText(eint32 offset, eint32 length, char *buffer) const
 void
 ETextView::GetText(eint32 offset, eint32 length, char *buffer, eint32 buffer_size_in_bytes, bool utf8) const
 {
-	if(buffer_size_in_bytes <= 0 || offset < 0 || length == 0 || fText.String() == NULL) return;
-
-	const char *start = NULL;
+	if(buffer_size_in_bytes <= 0 || offset < 0 || length == 0 || fText.Length() <= 0) return;
 
 	if(length < 0 || utf8 == false)
 	{
 		if(length < 0) length = fText.Length() - offset;
 		else length = min_c(length, fText.Length() - offset);
-
-		if(length > 0) start = fText.String() + offset;
 	}
 	else if((length = min_c(length, fText.CountChars() - offset)) > 0)
 	{
-		start = fText.CharAt(offset, NULL);
-		length = (offset + length < fText.CountChars() ?
-				fText.CharAt(offset + length, NULL) : (fText.String() + fText.Length())) - start;
+		eint32 endOffset = fText.CharOffsetAt(offset + length);
+		offset = fText.CharOffsetAt(offset);
+		length = endOffset - offset;
 	}
 
-	if(start == NULL || length <= 0) return;
+	if(length <= 0) return;
 
-	memcpy(buffer, start, (size_t)min_c(length, buffer_size_in_bytes));
+	fText.CopyInto(buffer, offset, min_c(length, buffer_size_in_bytes));
 }
 
 
@@ -883,18 +868,18 @@ ETextView::SetRunArray(eint32 startPos, eint32 endPos, const e_text_run_array *r
 			endPos = (utf8 ? fText.CountChars() : fText.Length());
 		if(utf8 && endPos > startPos)
 		{
-			startPos = fText.CharAt(startPos, NULL) - fText.String();
-			endPos = (endPos == fText.CountChars() ? fText.Length() : (fText.CharAt(endPos, NULL) - fText.String()));
+			startPos = fText.CharOffsetAt(startPos);
+			endPos = fText.CharOffsetAt(endPos);
 		}
 		if(endPos <= startPos) return;
 
-		const char *start = fText.String() + startPos;
+		eint32 startIndex = (utf8 ? fText.CharIndexAt(startPos) : 0);
 
 		for(eint32 k = 0; !(runs == NULL || k >= runs->count); k++)
 		{
 			const e_text_run *run = &(runs->runs[k]);
 			eint32 aOffset = run->offset;
-			if(aOffset > 0 && utf8) aOffset = e_utf8_at(start, aOffset, NULL) - start;
+			if(aOffset > 0 && utf8) aOffset = fText.CharOffsetAt(startIndex + aOffset) - startPos;
 			if(aOffset < 0 || (aOffset += startPos) >= endPos) continue;
 
 			eint32 requestCount = (fRunArray ? fRunArray->count + 1 : 1);
@@ -943,8 +928,8 @@ ETextView::RunArray(eint32 _startPos, eint32 endPos, eint32 *length, bool utf8)
 	if(endPos < 0 || endPos > (utf8 ? fText.CountChars() : fText.Length())) endPos = (utf8 ? fText.CountChars() : fText.Length());
 	if(utf8 && endPos > startPos)
 	{
-		startPos = fText.CharAt(startPos, NULL) - fText.String();
-		endPos = (endPos == fText.CountChars() ? fText.Length() : (fText.CharAt(endPos, NULL) - fText.String()));
+		startPos = fText.CharOffsetAt(startPos);
+		endPos = fText.CharOffsetAt(endPos);
 	}
 
 	if(fText.Length() <= 0 && startPos == 0 && fRunArray->runs[0].offset == 0)
@@ -977,7 +962,7 @@ ETextView::RunArray(eint32 _startPos, eint32 endPos, eint32 *length, bool utf8)
 
 		e_text_run *destRun = &(retRuns->runs[retRuns->count++]);
 		memcpy(destRun, curRun, sizeof(e_text_run));
-		if(utf8) destRun->offset = e_utf8_strlen_etc(fText.String(), destRun->offset);
+		if(utf8) destRun->offset = fText.CharIndexAt(destRun->offset);
 		destRun->offset = max_c(destRun->offset - _startPos, 0);
 	}
 
@@ -1035,11 +1020,11 @@ ETextView::InsertText(const char *start, eint32 length, eint32 offset, const e_t
 	if(length > 0) end = (utf8 ? e_utf8_at(start, length, NULL) : ((size_t)length >= strlen(start) ? NULL : start + length));
 	length = (end == NULL ? strlen(start) : (end - start));
 
-	if(utf8) offset = (offset < fText.CountChars() ? (fText.CharAt(offset, NULL) - fText.String()) : fText.Length());
+	if(utf8) offset = fText.CharOffsetAt(offset);
 
 	eint32 oldLength = fText.Length();
 	if(oldLength + length > fMaxBytes) length = fMaxBytes - oldLength;
-	if(length > 0) fText.Insert(start, length, offset);
+	if(length > 0) fText.Insert(offset, start, length);
 	if(fText.Length() == oldLength) return;
 
 	if(offset < oldLength)
@@ -1076,8 +1061,8 @@ ETextView::InsertText(const char *start, eint32 length, eint32 offset, const e_t
 	// TODO: not all lines
 	if(runs)
 	{
-		eint32 aOffset = (utf8 ? e_utf8_strlen_etc(fText.String(), offset) : offset);
-		eint32 aLen = (utf8 ? e_utf8_strlen_etc(fText.String() + offset, length) : length);
+		eint32 aOffset = (utf8 ? fText.CharIndexAt(offset) : offset);
+		eint32 aLen = (utf8 ? fText.CharIndexAt(offset + length) - aOffset : length);
 		SetRunArray(aOffset, aOffset + aLen, runs, utf8);
 	}
 	else
@@ -1152,8 +1137,8 @@ ETextView::DeleteText(eint32 startPos, eint32 endPos, bool utf8)
 
 	if(utf8 && endPos > startPos)
 	{
-		startPos = fText.CharAt(startPos, NULL) - fText.String();
-		endPos = (endPos == fText.CountChars() ? fText.Length() : (fText.CharAt(endPos, NULL) - fText.String()));
+		startPos = fText.CharOffsetAt(startPos);
+		endPos = fText.CharOffsetAt(endPos);
 	}
 
 	eint32 length = endPos - startPos;
@@ -1404,8 +1389,8 @@ ETextView::Select(eint32 startPos, eint32 endPos, bool utf8)
 
 	if(utf8 && endPos > startPos && startPos >= 0)
 	{
-		startPos = fText.CharAt(startPos, NULL) - fText.String();
-		endPos = (endPos == fText.CountChars() ? fText.Length() : (fText.CharAt(endPos, NULL) - fText.String()));
+		startPos = fText.CharOffsetAt(startPos);
+		endPos = fText.CharOffsetAt(endPos);
 	}
 
 	if(startPos < 0 || endPos <= startPos)
@@ -1427,8 +1412,8 @@ ETextView::GetSelection(eint32 *startPos, eint32 *endPos, bool utf8) const
 
 	if(isSelected)
 	{
-		if(startPos) *startPos = (utf8 ? e_utf8_strlen_etc(fText.String(), fSelectStart) : fSelectStart);
-		if(endPos) *endPos = (utf8 ? e_utf8_strlen_etc(fText.String(), fSelectEnd) : fSelectEnd);
+		if(startPos) *startPos = (utf8 ? fText.CharIndexAt(fSelectStart) : fSelectStart);
+		if(endPos) *endPos = (utf8 ? fText.CharIndexAt(fSelectEnd) : fSelectEnd);
 	}
 	else
 	{
@@ -1490,8 +1475,6 @@ ETextView::Draw(ERect updateRect)
 		e_text_line *line = (e_text_line*)fLines.ItemAt(i);
 
 		eint32 curLineOffset = nextLineOffset;
-		const char *str = fText.String() + curLineOffset;
-
 		nextLineOffset += line->length + 1;
 
 		if(i > 0) r.top = r.bottom + ETK_TEXT_VIEW_LINE_SPACING + UnitsPerPixel();
@@ -1499,6 +1482,8 @@ ETextView::Draw(ERect updateRect)
 
 		if(!clipping.Intersects(r)) continue;
 
+		const char *str = fText.StringAt(curLineOffset, line->length);
+
 		EPoint penLocation(r.left, r.top + line->max_ascent + 1);
 		eint32 k = 0;
 		eint32 cursorPos = -1;
@@ -1739,10 +1724,10 @@ ETextView::FloorPosition(eint32 *pos)
 		return;
 	}
 
-	const char *tmp = fText.String() + (*pos);
 	while(*pos > 0)
 	{
-		if(e_utf8_is_token(tmp--)) break;
+		char c = fText.ByteAt(*pos);
+		if(e_utf8_is_token(&c)) break;
 		(*pos) -= 1;
 	}
 }
@@ -1760,10 +1745,10 @@ ETextView::CeilPosition(eint32 *pos)
 	}
 
 	if(*pos < 0) *pos = 0;
-	const char *tmp = fText.String() + (*pos);
 	while(*pos < fText.Length())
 	{
-		if(e_utf8_is_token(tmp++)) break;
+		char c = fText.ByteAt(*pos);
+		if(e_utf8_is_token(&c)) break;
 		(*pos) += 1;
 	}
 }
@@ -1796,10 +1781,8 @@ ETextView::SetPosition(eint32 pos, bool response, bool utf8)
 
 			if(!utf8) CeilPosition(&pos);
 
-			// TODO: speed up when utf8 mode
 			if(utf8)
-				currentCursor = fText.CharAt(pos, NULL) -
-						fText.CharAt(e_utf8_strlen_etc(fText.String(), lineOffset), NULL);
+				currentCursor = fText.CharOffsetAt(pos) - lineOffset;
 			else
 				currentCursor = pos - lineOffset;
 		}
@@ -1828,9 +1811,9 @@ ETextView::Position(bool utf8, eint32 *lineOffset) const
 		e_text_line *line = (e_text_line*)fLines.ItemAt(i);
 		if(i == fCurrentLine)
 		{
-			if(lineOffset) *lineOffset = (utf8 ? e_utf8_strlen_etc(fText.String(), pos) : pos);
+			if(lineOffset) *lineOffset = (utf8 ? fText.CharIndexAt(pos) : pos);
 			pos += min_c(line->length, fCursor);
-			return(utf8 ? e_utf8_strlen_etc(fText.String(), pos) : pos);
+			return(utf8 ? fText.CharIndexAt(pos) : pos);
 		}
 		pos += line->length + 1;
 	}
@@ -1973,7 +1956,7 @@ ETextView::Copy(EClipboard *clipboard) const
 		eint32 runsBytes = 0;
 		e_text_run_array *runs = RunArray(fSelectStart, fSelectEnd, &runsBytes, false);
 		clipMsg->AddData("text/plain", E_MIME_TYPE,
-				 fText.String() + fSelectStart, (ssize_t)(fSelectEnd - fSelectStart));
+				 fText.StringAt(fSelectStart, fSelectEnd - fSelectStart), (ssize_t)(fSelectEnd - fSelectStart));
 		if(runs != NULL)
 		{
 			clipMsg->AddData("text/runs", E_MIME_TYPE, runs, (ssize_t)runsBytes);
@@ -2406,8 +2389,8 @@ ETextView::KeyDown(const char *bytes, eint32 numBytes)
 						{
 							for(eint32 i = OffsetAt(fCurrentLine, false); i >= 0 && i < fText.Length(); i++)
 							{
-								if(!(fText[i] == ' ' || fText[i] == '\t')) break;
-								aStr << fText[i];
+								if(!(fText.ByteAt(i) == ' ' || fText.ByteAt(i) == '\t')) break;
+								aStr << fText.ByteAt(i);
 							}
 						}
 
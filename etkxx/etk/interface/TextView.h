@@ -32,6 +32,7 @@
 #define __ETK_TEXT_VIEW_H__
 
 #include <etk/support/String.h>
+#include <etk/support/TextBuffer.h>
 #include <etk/interface/View.h>
 
 
@@ -189,7 +190,7 @@ protected:
 
 private:
 	ERect fMargins;
-	EString fText;
+	ETextBuffer fText;
 	e_text_run_array *fRunArray;
 
 	bool fEditable;
@@ -81,6 +81,38 @@ public:
 };
 
 
+// the coordinates passed to graphics engine, they're taken from the scratch arena
+// within the thread of window, from heap otherwise
+class _LOCAL EViewCoords {
+public:
+	eint32			*Coords;
+
+	inline EViewCoords(EWindow *win, size_t count)
+		: Coords(NULL), fArena(win != NULL ? win->ScratchArena() : NULL), fMark(0)
+	{
+		if(fArena != NULL)
+		{
+			fMark = fArena->Mark();
+			Coords = (eint32*)fArena->Allocate(sizeof(eint32) * count);
+		}
+		else
+		{
+			Coords = (eint32*)malloc(sizeof(eint32) * count);
+		}
+	}
+
+	inline ~EViewCoords()
+	{
+		if(fArena != NULL) fArena->Release(fMark);
+		else if(Coords != NULL) free(Coords);
+	}
+
+private:
+	EArena			*fArena;
+	size_t			fMark;
+};
+
+
 void
 EView::InitSelf(ERect frame, euint32 resizingMode, euint32 flags)
 {
@@ -1382,7 +1414,10 @@ EView::StrokePoints(const EPoint *_pts, eint32 count, const euint8 *alpha, e_pat
 
 	if(IsVisible() == false) return;
 
-	eint32 *pts = new eint32[2 * count];
+	EViewCoords coords(Window(), 2 * (size_t)count);
+	eint32 *pts = coords.Coords;
+	if(pts == NULL) return;
+
 	eint32 *tmp = pts;
 
 	EPoint pmin, pmax;
@@ -1415,8 +1450,6 @@ EView::StrokePoints(const EPoint *_pts, eint32 count, const euint8 *alpha, e_pat
 	if(alpha) status = Window()->fPixmap->StrokePoints_Alphas(fDC, pts, alpha, count);
 	else status = Window()->fPixmap->StrokePoints(fDC, pts, count);
 
-	delete[] pts;
-
 	if(status == E_OK)
 	{
 		ERect updateRect(ERect(pmin, pmax).InsetByCopy(PenSize() / -2.f, PenSize() / -2.f));
@@ -1484,7 +1517,10 @@ EView::StrokePolygon(const EPolygon *aPolygon, bool closed, e_pattern p)
 {
 	if(aPolygon == NULL || aPolygon->CountPoints() <= 0 || IsVisible() == false) return;
 
-	eint32 *pts = new eint32[2 * aPolygon->CountPoints()];
+	EViewCoords coords(Window(), 2 * (size_t)aPolygon->CountPoints());
+	eint32 *pts = coords.Coords;
+	if(pts == NULL) return;
+
 	eint32 *tmp = pts;
 	const EPoint *polyPts = aPolygon->Points();
 
@@ -1505,8 +1541,6 @@ EView::StrokePolygon(const EPolygon *aPolygon, bool closed, e_pattern p)
 		ERect updateRect(r.InsetByCopy(PenSize() / -2.f, PenSize() / -2.f));
 		Window()->_Update(updateRect, false);
 	}
-
-	delete[] pts;
 }
 
 
@@ -1524,7 +1558,10 @@ EView::FillPolygon(const EPolygon *aPolygon, e_pattern p)
 {
 	if(aPolygon == NULL || aPolygon->CountPoints() <= 0 || IsVisible() == false) return;
 
-	eint32 *pts = new eint32[2 * aPolygon->CountPoints()];
+	EViewCoords coords(Window(), 2 * (size_t)aPolygon->CountPoints());
+	eint32 *pts = coords.Coords;
+	if(pts == NULL) return;
+
 	eint32 *tmp = pts;
 	const EPoint *polyPts = aPolygon->Points();
 
@@ -1545,8 +1582,6 @@ EView::FillPolygon(const EPolygon *aPolygon, e_pattern p)
 		ERect updateRect(r.InsetByCopy(PenSize() / -2.f, PenSize() / -2.f));
 		Window()->_Update(updateRect, false);
 	}
-
-	delete[] pts;
 }
 
 
@@ -1580,7 +1615,9 @@ EView::StrokeRects(const ERect *rs, eint32 count, e_pattern p)
 {
 	if(rs == NULL || count <= 0 || IsVisible() == false) return;
 
-	eint32 *rects = new eint32[4 * count];
+	EViewCoords coords(Window(), 4 * (size_t)count);
+	eint32 *rects = coords.Coords;
+	if(rects == NULL) return;
 
 	ERect updateRect;
 	eint32 _count_ = 0;
@@ -1609,8 +1646,6 @@ EView::StrokeRects(const ERect *rs, eint32 count, e_pattern p)
 			Window()->_Update(updateRect, false);
 		}
 	}
-
-	delete[] rects;
 }
 
 
@@ -1638,7 +1673,9 @@ EView::FillRects(const ERect *rs, eint32 count, e_pattern p)
 {
 	if(rs == NULL || count <= 0 || IsVisible() == false) return;
 
-	eint32 *rects = new eint32[4 * count];
+	EViewCoords coords(Window(), 4 * (size_t)count);
+	eint32 *rects = coords.Coords;
+	if(rects == NULL) return;
 
 	ERect updateRect;
 	eint32 _count_ = 0;
@@ -1667,8 +1704,6 @@ EView::FillRects(const ERect *rs, eint32 count, e_pattern p)
 			Window()->_Update(updateRect, false);
 		}
 	}
-
-	delete[] rects;
 }
 
 
@@ -2095,7 +2130,7 @@ EView::DrawString(const char *aString, EPoint location, eint32 length, float tab
 		if(renderMode & E_FONT_RENDER_DIRECTLY)
 			DrawStringInDirectlyMode(aString, location, length);
 		else // E_FONT_RENDER_PIXMAP
-			DrawStringInPixmapMode(aString, location, length);
+			DrawStringInPixmapMode(aString, location, length, Window()->ScratchArena());
 	}
 	else
 	{
@@ -2122,7 +2157,7 @@ EView::DrawString(const char *aString, EPoint location, eint32 length, float tab
 				if(renderMode & E_FONT_RENDER_DIRECTLY)
 					DrawStringInDirectlyMode(aStr.String() + oldOffset, PenLocation(), len);
 				else // E_FONT_RENDER_PIXMAP
-					DrawStringInPixmapMode(aStr.String() + oldOffset, PenLocation(), len);
+					DrawStringInPixmapMode(aStr.String() + oldOffset, PenLocation(), len, Window()->ScratchArena());
 			}
 
 			if(aOffset < 0) break;
@@ -2168,7 +2203,7 @@ EView::DrawStringInDirectlyMode(const char *aString, EPoint location, eint32 len
 
 
 void
-EView::DrawStringInPixmapMode(const char *aString, EPoint location, eint32 length)
+EView::DrawStringInPixmapMode(const char *aString, EPoint location, eint32 length, EArena *arena)
 {
 	ERect rect = VisibleBounds();
 	EFontEngine *engine = ((EViewState*)fStates)->Font.Engine();
@@ -2193,6 +2228,8 @@ EView::DrawStringInPixmapMode(const char *aString, EPoint location, eint32 lengt
 
 	float width = engine->StringWidth(aString, size, spacing, shear, bold, length);
 	euint8 *bitmap = engine->RenderString(aString, &w, &h, &is_mono, size, spacing, shear, bold, length);
+	size_t bitmapBytes = (bitmap ? (size_t)w * (size_t)h : 0);
+	if(bitmap) etk_memory_account_alloc(E_MEMORY_FONTS, bitmapBytes);
 
 	engine->Unlock();
 
@@ -2200,7 +2237,7 @@ EView::DrawStringInPixmapMode(const char *aString, EPoint location, eint32 lengt
 	if(rect.IsValid() == false || startPoint.x > rect.right || startPoint.y > rect.bottom ||
 	   startPoint.x + (float)w < rect.left || startPoint.y + (float)h < rect.top)
 	{
-		if(bitmap) delete[] bitmap;
+		if(bitmap) {etk_memory_account_free(E_MEMORY_FONTS, bitmapBytes); delete[] bitmap;}
 		return;
 	}
 
@@ -2211,14 +2248,27 @@ EView::DrawStringInPixmapMode(const char *aString, EPoint location, eint32 lengt
 
 	if(!bitmap || w <= 0 || h <= 0)
 	{
-		if(bitmap) delete[] bitmap;
+		if(bitmap) {etk_memory_account_free(E_MEMORY_FONTS, bitmapBytes); delete[] bitmap;}
 		return;
 	}
 
-	eint32 *pts = new eint32[2 * w * h];
-	euint8 *alpha = is_mono ? NULL : new euint8[w * h];
+	// the points are dropped once drawn, "arena" is NULL when drawing outside the thread of window
+	EArena localArena((size_t)w * (size_t)h * (2 * sizeof(eint32) + 1) + 64);
+	if(arena == NULL) arena = &localArena;
+	size_t mark = arena->Mark();
+
+	eint32 *pts = (eint32*)arena->Allocate(sizeof(eint32) * 2 * (size_t)w * (size_t)h);
+	euint8 *alpha = is_mono ? NULL : (euint8*)arena->Allocate((size_t)w * (size_t)h);
 	eint32 pointCount = 0;
 
+	if(pts == NULL || (!is_mono && alpha == NULL))
+	{
+		arena->Release(mark);
+		etk_memory_account_free(E_MEMORY_FONTS, bitmapBytes);
+		delete[] bitmap;
+		return;
+	}
+
 	eint32 i_start = max_c((eint32)(ceil(rect.top) - ceil(startPoint.y)), 0);
 	eint32 j_start = max_c((eint32)(ceil(rect.left) - ceil(startPoint.x)), 0);
 
@@ -2299,9 +2349,9 @@ EView::DrawStringInPixmapMode(const char *aString, EPoint location, eint32 lengt
 		}
 	}
 
-	delete[] pts;
-	if(alpha) delete[] alpha;
+	arena->Release(mark);
 
+	etk_memory_account_free(E_MEMORY_FONTS, bitmapBytes);
 	delete[] bitmap;
 
 	if(status == E_OK)
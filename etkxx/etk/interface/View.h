@@ -351,7 +351,7 @@ private:
 	void AttachToWindow();
 	void DetachFromWindow();
 	void DrawStringInDirectlyMode(const char *aString, EPoint location, eint32 length);
-	void DrawStringInPixmapMode(const char *aString, EPoint location, eint32 length);
+	void DrawStringInPixmapMode(const char *aString, EPoint location, eint32 length, EArena *arena);
 
 	e_status_t _SetEventMask(euint32 mask, euint32 options);
 	void _Expose(ERegion region, e_bigtime_t when);
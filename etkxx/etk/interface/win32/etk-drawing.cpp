@@ -36,6 +36,7 @@
 
 #include <etk/support/ClassInfo.h>
 #include <etk/support/Autolock.h>
+#include <etk/support/ByteOrder.h>
 #include <etk/render/Pixmap.h>
 
 
@@ -1331,14 +1332,7 @@ LRESULT _etk_draw_epixmap(EWin32GraphicsEngine *win32Engine, etk_win32_gdi_callb
 		case E_RGB24_BIG:
 			if((bits = malloc((size_t)epixmap->BitsLength())) != NULL)
 			{
-				euint8 *tmp = (euint8*)bits;
-				const euint8 *src = (const euint8*)epixmap->Bits();
-				for(euint32 i = 0; i < epixmap->BitsLength(); i += 3, tmp += 3, src += 3)
-				{
-					tmp[0] = src[2];
-					tmp[1] = src[1];
-					tmp[2] = src[0];
-				}
+				e_swap_rgb24_array(bits, epixmap->Bits(), (size_t)epixmap->BitsLength() / 3);
 				bitsInfo.bmiHeader.biBitCount = 24;
 				bitsInfo.bmiHeader.biSizeImage = (DWORD)epixmap->BitsLength();
 			}
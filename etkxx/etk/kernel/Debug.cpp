@@ -46,6 +46,7 @@
 #include "Kernel.h"
 
 #include <etk/support/String.h>
+#include <etk/support/StreamIO.h>
 
 #ifndef HAVE_VA_COPY
 	#ifdef HAVE___VA_COPY
@@ -131,6 +132,8 @@ _IMPEXP_ETK void etk_debug_log(etk_debug_level level, const char *format, va_lis
 			free(buffer);
 			buffer = NULL;
 		}
+		EOut.Flush();
+		EErr.Flush();
 		abort();
 	}
 #ifdef ETK_ENABLE_DEBUG
@@ -239,6 +242,169 @@ _IMPEXP_ETK void ETK_ERROR(const char *format, ...)
 
 } // extern "C"
 
+
+#if defined(__GNUC__)
+#define etk_memory_atomic_add(ptr, value)		__sync_add_and_fetch(ptr, value)
+#define etk_memory_atomic_cas(ptr, oldValue, newValue)	__sync_bool_compare_and_swap(ptr, oldValue, newValue)
+#elif defined(_MSC_VER)
+#define etk_memory_atomic_add(ptr, value)		(InterlockedExchangeAdd64((volatile LONGLONG*)(ptr), value) + (value))
+#define etk_memory_atomic_cas(ptr, oldValue, newValue)	\
+	(InterlockedCompareExchange64((volatile LONGLONG*)(ptr), newValue, oldValue) == (oldValue))
+#endif
+
+typedef struct etk_memory_counter {
+	volatile eint64 live_bytes;
+	volatile eint64 peak_bytes;
+	volatile eint64 allocations;
+	volatile eint64 frees;
+} etk_memory_counter;
+
+static etk_memory_counter __etk_memory_counters[E_MEMORY_SUBSYSTEMS];
+// -1 until the first call of accounting, it's decided only once so that every block freed
+// with the accounting on was allocated with it on as well
+static volatile eint64 __etk_memory_accounting = E_INT64_CONSTANT(-1);
+static e_bigtime_t __etk_memory_accounting_since = E_INT64_CONSTANT(0);
+
+static const char *__etk_memory_subsystem_names[E_MEMORY_SUBSYSTEMS] = {
+	"messages", "regions", "pixmaps", "fonts", "strings", "others"
+};
+
+
+static void etk_memory_counter_add(etk_memory_counter *counter, eint64 bytes, bool alloc)
+{
+#ifdef etk_memory_atomic_add
+	eint64 live = etk_memory_atomic_add(&counter->live_bytes, bytes);
+	etk_memory_atomic_add(alloc ? &counter->allocations : &counter->frees, 1);
+
+	eint64 peak;
+	while(live > (peak = counter->peak_bytes) && !etk_memory_atomic_cas(&counter->peak_bytes, peak, live));
+#else
+	if(etk_memory_tracing_lock() == false) return;
+	counter->live_bytes += bytes;
+	if(alloc) counter->allocations++;
+	else counter->frees++;
+	if(counter->live_bytes > counter->peak_bytes) counter->peak_bytes = counter->live_bytes;
+	etk_memory_tracing_unlock();
+#endif
+}
+
+
+static inline bool etk_memory_accounting_decide(void)
+{
+	eint64 state = __etk_memory_accounting;
+	if(state >= E_INT64_CONSTANT(0)) return(state != E_INT64_CONSTANT(0));
+
+	state = (getenv("ETK_MEMORY_ACCOUNTING") != NULL ? E_INT64_CONSTANT(1) : E_INT64_CONSTANT(0));
+
+	// the threads racing here decide the same, only one of them reports at exit
+#ifdef etk_memory_atomic_cas
+	if(etk_memory_atomic_cas(&__etk_memory_accounting, E_INT64_CONSTANT(-1), state) == false)
+		return(__etk_memory_accounting != E_INT64_CONSTANT(0));
+#else
+	__etk_memory_accounting = state;
+#endif
+
+	if(state != E_INT64_CONSTANT(0))
+	{
+		__etk_memory_accounting_since = etk_system_time();
+		atexit(etk_memory_accounting_report);
+	}
+
+	return(state != E_INT64_CONSTANT(0));
+}
+
+
+extern "C" {
+
+_IMPEXP_ETK bool etk_memory_accounting_is_enabled(void)
+{
+	return etk_memory_accounting_decide();
+}
+
+
+_IMPEXP_ETK void etk_memory_account_alloc(e_memory_subsystem subsystem, size_t size)
+{
+	if(etk_memory_accounting_decide() == false || subsystem < 0 || subsystem >= E_MEMORY_SUBSYSTEMS) return;
+	etk_memory_counter_add(&__etk_memory_counters[subsystem], (eint64)size, true);
+}
+
+
+_IMPEXP_ETK void etk_memory_account_free(e_memory_subsystem subsystem, size_t size)
+{
+	if(etk_memory_accounting_decide() == false || subsystem < 0 || subsystem >= E_MEMORY_SUBSYSTEMS) return;
+	etk_memory_counter_add(&__etk_memory_counters[subsystem], -(eint64)size, false);
+}
+
+
+_IMPEXP_ETK bool etk_memory_accounting_get_stat(e_memory_subsystem subsystem, e_memory_stat *stat)
+{
+	if(subsystem < 0 || subsystem >= E_MEMORY_SUBSYSTEMS || stat == NULL) return false;
+
+	etk_memory_counter *counter = &__etk_memory_counters[subsystem];
+	stat->live_bytes = counter->live_bytes;
+	stat->peak_bytes = counter->peak_bytes;
+	stat->allocations = counter->allocations;
+	stat->frees = counter->frees;
+	stat->elapsed = (etk_memory_accounting_decide() ? etk_system_time() - __etk_memory_accounting_since : E_INT64_CONSTANT(0));
+
+	return true;
+}
+
+
+_IMPEXP_ETK const char* etk_memory_subsystem_name(e_memory_subsystem subsystem)
+{
+	if(subsystem < 0 || subsystem >= E_MEMORY_SUBSYSTEMS) return NULL;
+	return __etk_memory_subsystem_names[subsystem];
+}
+
+
+_IMPEXP_ETK void etk_memory_accounting_report(void)
+{
+	e_memory_stat stats[E_MEMORY_SUBSYSTEMS];
+	eint32 order[E_MEMORY_SUBSYSTEMS];
+
+	for(eint32 i = 0; i < E_MEMORY_SUBSYSTEMS; i++)
+	{
+		etk_memory_accounting_get_stat((e_memory_subsystem)i, &stats[i]);
+
+		eint32 k = i;
+		for(; k > 0 && stats[order[k - 1]].live_bytes < stats[i].live_bytes; k--) order[k] = order[k - 1];
+		order[k] = i;
+	}
+
+	// not through EOut, it might be gone when called at exit
+	char *line = e_strdup_printf("[KERNEL]: memory accounting, %s\n",
+				     etk_memory_accounting_decide() ? "sorted by live bytes" : "disabled");
+	if(line) {fputs(line, stdout); free(line);}
+
+	for(eint32 i = 0; i < E_MEMORY_SUBSYSTEMS; i++)
+	{
+		const e_memory_stat *stat = &stats[order[i]];
+		e_bigtime_t elapsed = max_c(stat->elapsed, E_INT64_CONSTANT(1));
+
+		line = e_strdup_printf("\t%s: live %I64i bytes, peak %I64i bytes, %I64i allocations (%I64i/s), %I64i frees\n",
+				       __etk_memory_subsystem_names[order[i]],
+				       stat->live_bytes, stat->peak_bytes, stat->allocations,
+				       stat->allocations * E_INT64_CONSTANT(1000000) / elapsed, stat->frees);
+		if(line) {fputs(line, stdout); free(line);}
+	}
+
+	fflush(stdout);
+}
+
+} // extern "C"
+
+
+// decided at start-up at the latest
+class __etk_memory_accounting_init {
+public:
+	inline __etk_memory_accounting_init()
+	{
+		etk_memory_accounting_decide();
+	}
+};
+static __etk_memory_accounting_init ___etk_memory_accounting_init;
+
 #ifdef ETK_BUILD_WITH_MEMORY_TRACING
 
 #define ETK_MEMORY_MANAGER_FILENAME_LENGTH 256
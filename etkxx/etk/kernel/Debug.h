@@ -106,6 +106,40 @@ _IMPEXP_ETK void ETK_WARNING(const char *format, ...);
 
 _IMPEXP_ETK void ETK_ERROR(const char *format, ...);
 
+/* etk_memory_accounting_*:
+ * 	Counters of the memory held by the subsystems of the toolkit, it costs nothing
+ * 	until enabled, and then a few atomic operations for each allocation.
+ * 	It's enabled and reported at exit when the environment variable "ETK_MEMORY_ACCOUNTING"
+ * 	is set at start-up. The variable is read only once, by the first allocation counted or
+ * 	the start-up at the latest, so every block freed was counted when allocated.
+ */
+typedef enum e_memory_subsystem {
+	E_MEMORY_UNTRACKED = -1,
+	E_MEMORY_MESSAGES = 0,
+	E_MEMORY_REGIONS,
+	E_MEMORY_PIXMAPS,
+	E_MEMORY_FONTS,
+	E_MEMORY_STRINGS,
+	E_MEMORY_OTHERS,
+	E_MEMORY_SUBSYSTEMS
+} e_memory_subsystem;
+
+typedef struct e_memory_stat {
+	eint64		live_bytes;
+	eint64		peak_bytes;
+	eint64		allocations;
+	eint64		frees;
+	e_bigtime_t	elapsed; /* since enabled */
+} e_memory_stat;
+
+_IMPEXP_ETK bool etk_memory_accounting_is_enabled(void);
+_IMPEXP_ETK void etk_memory_account_alloc(e_memory_subsystem subsystem, size_t size);
+_IMPEXP_ETK void etk_memory_account_free(e_memory_subsystem subsystem, size_t size);
+_IMPEXP_ETK bool etk_memory_accounting_get_stat(e_memory_subsystem subsystem, e_memory_stat *stat);
+_IMPEXP_ETK const char* etk_memory_subsystem_name(e_memory_subsystem subsystem);
+/* etk_memory_accounting_report(): print the subsystems to stdout sorted by the live bytes */
+_IMPEXP_ETK void etk_memory_accounting_report(void);
+
 #ifdef ETK_BUILD_WITH_MEMORY_TRACING
 _IMPEXP_ETK void* etk_calloc(size_t nmemb, size_t size, const char *file, int line, const char *method);
 _IMPEXP_ETK void* etk_malloc(size_t size, const char *file, int line, const char *method);
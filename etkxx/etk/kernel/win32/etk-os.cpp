@@ -33,6 +33,7 @@
 #include <etk/support/String.h>
 
 #include <etk/private/PrivateApplication.h>
+#include <etk/private/Memory.h>
 
 
 HINSTANCE etk_dll_hinstance = NULL;
@@ -73,6 +74,7 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 		case DLL_THREAD_DETACH:
 		/* Thread exits with cleanup */
 		{
+			EMemory::ReleaseCache();
 			break;
 		}
 	}
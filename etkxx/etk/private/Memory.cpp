@@ -27,27 +27,331 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <stdlib.h>
+
+#include <etk/kernel/Kernel.h>
+#include <etk/kernel/Debug.h>
+
 #include "Memory.h"
 
+#if defined(_MSC_VER)
+#include <windows.h>
+#define ETK_MEMORY_THREAD_LOCAL			__declspec(thread)
+#define etk_memory_cas(ptr, oldValue, newValue)	\
+	(InterlockedCompareExchangePointer((PVOID volatile*)(ptr), (PVOID)(newValue), (PVOID)(oldValue)) == (PVOID)(oldValue))
+#elif defined(__GNUC__) && !(defined(ETK_OS_BEOS) || defined(ETK_OS_DARWIN))
+#define ETK_MEMORY_THREAD_LOCAL			__thread
+#define etk_memory_cas(ptr, oldValue, newValue)	__sync_bool_compare_and_swap(ptr, oldValue, newValue)
+#endif
+
+
+struct etk_mem_slab;
 
+// "slab" is NULL when the block comes from malloc() directly,
+// "next" links the free blocks of the pools.
 struct _LOCAL etk_mem {
-	void (*destroy_func)(void*);
-	void *data;
+	union {
+		void (*destroy_func)(void*);
+		struct etk_mem *next;
+	};
+	struct etk_mem_slab *slab;
+};
+
+
+#ifdef ETK_MEMORY_THREAD_LOCAL
+
+#ifdef ETK_THREAD_IMPL_POSIX
+#include <pthread.h>
+#endif
+
+#define ETK_MEMORY_CLASSES	16
+#define ETK_MEMORY_SLAB_SIZE	8192
+#define ETK_MEMORY_EMPTY_SLABS	2
+
+static const size_t etk_memory_class_sizes[ETK_MEMORY_CLASSES] = {
+	16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+};
+
+// size class of the blocks in 16-byte steps: etk_memory_classes[(size + 15) / 16]
+static const euint8 etk_memory_classes[E_MEMORY_MAX_POOLED_SIZE / 16 + 1] = {
+	0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+	12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15
+};
+
+
+// "free_list" is touched only by the thread owning the cache, "used" counts the blocks
+// taken from the slab, the slabs having free blocks are linked by "prev" and "next".
+struct _LOCAL etk_mem_slab {
+	struct etk_mem_bin	*bin;
+	struct etk_mem_slab	*prev;
+	struct etk_mem_slab	*next;
+	etk_mem			*free_list;
+	size_t			used;
+	size_t			count;
 };
 
 
+// the other threads push the blocks they free to "remote_list",
+// at most ETK_MEMORY_EMPTY_SLABS slabs without any block in use are kept.
+struct _LOCAL etk_mem_bin {
+	struct etk_mem_cache	*cache;
+	size_t			size;
+	etk_mem_slab		*slabs;
+	size_t			empty_slabs;
+	etk_mem * volatile	remote_list;
+};
+
+
+// The caches are never freed: a block may still be in use by other threads
+// when its thread exits, so the cache is kept for the next thread.
+struct _LOCAL etk_mem_cache {
+	etk_mem_bin		bins[ETK_MEMORY_CLASSES];
+	struct etk_mem_cache	*next;
+};
+
+
+static ETK_MEMORY_THREAD_LOCAL etk_mem_cache *etk_memory_cache = NULL;
+static ETK_MEMORY_THREAD_LOCAL bool etk_memory_thread_exited = false;
+
+static etk_mem_cache *etk_memory_spare_caches = NULL;
+static void * volatile etk_memory_spare_caches_locker = NULL;
+
+#ifdef ETK_THREAD_IMPL_POSIX
+static pthread_key_t etk_memory_key;
+static pthread_once_t etk_memory_key_once = PTHREAD_ONCE_INIT;
+#endif
+
+
+static void etk_memory_lock_spare_caches()
+{
+	while(!etk_memory_cas(&etk_memory_spare_caches_locker, NULL, (void*)1)) etk_snooze(1);
+}
+
+
+static void etk_memory_unlock_spare_caches()
+{
+	etk_memory_cas(&etk_memory_spare_caches_locker, (void*)1, NULL);
+}
+
+
+static void etk_memory_slab_unlink(etk_mem_bin *bin, etk_mem_slab *slab)
+{
+	if(slab->prev != NULL) slab->prev->next = slab->next;
+	else bin->slabs = slab->next;
+	if(slab->next != NULL) slab->next->prev = slab->prev;
+	slab->prev = slab->next = NULL;
+}
+
+
+// etk_memory_slab_put(): give the block back to its slab, the slab is freed when
+// it's empty and the bin has enough empty slabs already, or "keep_empty" is false.
+static void etk_memory_slab_put(etk_mem *mem, bool keep_empty)
+{
+	etk_mem_slab *slab = mem->slab;
+	etk_mem_bin *bin = slab->bin;
+
+	if(slab->free_list == NULL)
+	{
+		slab->next = bin->slabs;
+		if(bin->slabs != NULL) bin->slabs->prev = slab;
+		bin->slabs = slab;
+	}
+
+	mem->next = slab->free_list;
+	slab->free_list = mem;
+
+	if(--slab->used > 0) return;
+
+	if(keep_empty && bin->empty_slabs < ETK_MEMORY_EMPTY_SLABS)
+	{
+		bin->empty_slabs++;
+		return;
+	}
+
+	etk_memory_slab_unlink(bin, slab);
+	free(slab);
+}
+
+
+// etk_memory_bin_reclaim(): take all the blocks freed by the other threads at once
+static void etk_memory_bin_reclaim(etk_mem_bin *bin, bool keep_empty)
+{
+	etk_mem *remote;
+	do {
+		remote = bin->remote_list;
+	} while(remote != NULL && !etk_memory_cas(&bin->remote_list, remote, NULL));
+
+	while(remote != NULL)
+	{
+		etk_mem *mem = remote;
+		remote = remote->next;
+		etk_memory_slab_put(mem, keep_empty);
+	}
+}
+
+
+static void etk_memory_release_cache(etk_mem_cache *cache)
+{
+	// the empty slabs aren't needed any more until the next thread takes the cache
+	for(eint32 i = 0; i < ETK_MEMORY_CLASSES; i++)
+	{
+		etk_mem_bin *bin = &cache->bins[i];
+		etk_memory_bin_reclaim(bin, false);
+
+		for(etk_mem_slab *slab = bin->slabs; slab != NULL;)
+		{
+			etk_mem_slab *next = slab->next;
+			if(slab->used == 0)
+			{
+				etk_memory_slab_unlink(bin, slab);
+				free(slab);
+			}
+			slab = next;
+		}
+		bin->empty_slabs = 0;
+	}
+
+	etk_memory_lock_spare_caches();
+	cache->next = etk_memory_spare_caches;
+	etk_memory_spare_caches = cache;
+	etk_memory_unlock_spare_caches();
+}
+
+
+#ifdef ETK_THREAD_IMPL_POSIX
+static void etk_memory_key_destroy(void *cache)
+{
+	if(cache == etk_memory_cache) EMemory::ReleaseCache();
+}
+
+
+static void etk_memory_key_init()
+{
+	if(pthread_key_create(&etk_memory_key, etk_memory_key_destroy) != 0)
+		ETK_WARNING("[PRIVATE]: %s --- Unable to create the key of thread caches.", __PRETTY_FUNCTION__);
+}
+#endif
+
+
+static etk_mem_cache* etk_memory_get_cache()
+{
+	if(etk_memory_cache != NULL || etk_memory_thread_exited) return etk_memory_cache;
+
+#ifdef ETK_THREAD_IMPL_POSIX
+	// the key destructor hands the cache back when any thread exits
+	pthread_once(&etk_memory_key_once, etk_memory_key_init);
+#endif
+
+	etk_memory_lock_spare_caches();
+	etk_mem_cache *cache = etk_memory_spare_caches;
+	if(cache != NULL) etk_memory_spare_caches = cache->next;
+	etk_memory_unlock_spare_caches();
+
+	if(cache == NULL)
+	{
+		if((cache = (etk_mem_cache*)calloc(1, sizeof(etk_mem_cache))) == NULL) return NULL;
+		for(eint32 i = 0; i < ETK_MEMORY_CLASSES; i++)
+		{
+			cache->bins[i].cache = cache;
+			cache->bins[i].size = etk_memory_class_sizes[i];
+		}
+	}
+
+	cache->next = NULL;
+	etk_memory_cache = cache;
+
+#ifdef ETK_THREAD_IMPL_POSIX
+	pthread_setspecific(etk_memory_key, cache);
+#endif
+
+	return cache;
+}
+
+
+static etk_mem* etk_memory_bin_alloc(etk_mem_bin *bin)
+{
+	if(bin->slabs == NULL) etk_memory_bin_reclaim(bin, true);
+
+	if(bin->slabs == NULL)
+	{
+		size_t slotSize = sizeof(etk_mem) + bin->size;
+		size_t count = max_c((ETK_MEMORY_SLAB_SIZE - sizeof(etk_mem_slab)) / slotSize, 8);
+
+		etk_mem_slab *slab = (etk_mem_slab*)malloc(sizeof(etk_mem_slab) + slotSize * count);
+		if(slab == NULL) return NULL;
+
+		slab->bin = bin;
+		slab->prev = slab->next = NULL;
+		slab->free_list = NULL;
+		slab->used = 0;
+		slab->count = count;
+
+		unsigned char *slots = (unsigned char*)slab + sizeof(etk_mem_slab);
+		for(size_t i = count; i > 0; i--)
+		{
+			etk_mem *mem = (etk_mem*)(slots + slotSize * (i - 1));
+			mem->slab = slab;
+			mem->next = slab->free_list;
+			slab->free_list = mem;
+		}
+
+		bin->slabs = slab;
+		bin->empty_slabs++;
+	}
+
+	etk_mem_slab *slab = bin->slabs;
+	etk_mem *mem = slab->free_list;
+
+	if((slab->free_list = mem->next) == NULL) etk_memory_slab_unlink(bin, slab);
+	if(slab->used++ == 0) bin->empty_slabs--;
+
+	return mem;
+}
+
+
+static void etk_memory_bin_free(etk_mem *mem)
+{
+	etk_mem_bin *bin = mem->slab->bin;
+
+	if(bin->cache == etk_memory_cache)
+	{
+		etk_memory_slab_put(mem, true);
+		return;
+	}
+
+	etk_mem *remote;
+	do {
+		remote = bin->remote_list;
+		mem->next = remote;
+	} while(!etk_memory_cas(&bin->remote_list, remote, mem));
+}
+
+#endif /* ETK_MEMORY_THREAD_LOCAL */
+
+
 void*
 EMemory::Malloc(size_t size, void (*destroy_func)(void*))
 {
 	etk_mem *mem = NULL;
 
-	if(~((size_t)0) - sizeof(etk_mem) < size ||
-	   (mem = (etk_mem*)malloc(sizeof(etk_mem) + size)) == NULL) return NULL;
+#ifdef ETK_MEMORY_THREAD_LOCAL
+	etk_mem_cache *cache;
+
+	if(size <= E_MEMORY_MAX_POOLED_SIZE && (cache = etk_memory_get_cache()) != NULL)
+	{
+		if((mem = etk_memory_bin_alloc(&cache->bins[etk_memory_classes[(size + 15) >> 4]])) == NULL) return NULL;
+	}
+	else
+#endif
+	{
+		if(~((size_t)0) - sizeof(etk_mem) < size ||
+		   (mem = (etk_mem*)malloc(sizeof(etk_mem) + size)) == NULL) return NULL;
+		mem->slab = NULL;
+	}
 
 	mem->destroy_func = destroy_func;
-	mem->data = (unsigned char*)mem + sizeof(etk_mem);
 
-	return(mem->data);
+	return((unsigned char*)mem + sizeof(etk_mem));
 }
 
 
@@ -59,8 +363,29 @@ EMemory::Free(void *data)
 	if(data == NULL) return;
 
 	mem = (etk_mem*)((unsigned char*)data - sizeof(etk_mem));
-	if(mem->data != data) ETK_ERROR("[PRIVATE]: %s --- Invalid pointer.", __PRETTY_FUNCTION__);
-	if(mem->destroy_func != NULL) mem->destroy_func(mem->data);
+	if(mem->destroy_func != NULL) mem->destroy_func(data);
+
+#ifdef ETK_MEMORY_THREAD_LOCAL
+	if(mem->slab != NULL)
+	{
+		etk_memory_bin_free(mem);
+		return;
+	}
+#endif
+
 	free(mem);
 }
 
+
+void
+EMemory::ReleaseCache()
+{
+#ifdef ETK_MEMORY_THREAD_LOCAL
+	etk_mem_cache *cache = etk_memory_cache;
+
+	etk_memory_cache = NULL;
+	etk_memory_thread_exited = true;
+
+	if(cache != NULL) etk_memory_release_cache(cache);
+#endif
+}
@@ -34,11 +34,24 @@
 
 #ifdef __cplusplus /* Just for C++ */
 
+// EMemory serves the small blocks (up to E_MEMORY_MAX_POOLED_SIZE bytes) from size-class
+// pools held by a cache of the calling thread, so the loopers don't contend on malloc().
+// A block freed by another thread is handed back to the cache it came from without lock,
+// the cache reclaims it on its next allocation of that size class. The cache of any thread
+// is recycled when the thread exits, and a slab whose blocks are all free goes back to
+// malloc() when its size class has enough of them; the larger blocks, or all blocks when
+// the platform lacks thread-local storage, go to malloc() directly.
+#define E_MEMORY_MAX_POOLED_SIZE	512
+
 class _LOCAL EMemory
 {
 public:
 	static void	*Malloc(size_t size, void (*destroy_func)(void*) = NULL);
 	static void	Free(void *data);
+
+	// ReleaseCache(): hand the cache of the calling thread over to the next threads,
+	// it's called when the thread exits.
+	static void	ReleaseCache();
 };
 
 #endif /* __cplusplus */
@@ -35,6 +35,7 @@
 	#include <io.h>
 	#define read(fd, buf, count)	((ssize_t)_read(fd, buf, count))
 	#define write(fd, buf, count)	((ssize_t)_write(fd, buf, count))
+	#define isatty(fd)		_isatty(fd)
 #endif // !_WIN32
 
 #include "StandardIO.h"
@@ -43,24 +44,38 @@
 EStandardIO::EStandardIO(int fd)
 	: EStreamIO(), fFD(fd)
 {
+	// like stdio: the standard output is line buffered on terminal, fully buffered otherwise,
+	// the standard error is line buffered so that the messages come out in time
+	if(fFD == 1) SetBuffering(isatty(fFD) ? E_STREAM_LINE_BUFFERED : E_STREAM_FULLY_BUFFERED);
+	else if(fFD == 2) SetBuffering(E_STREAM_LINE_BUFFERED);
 }
 
 
 EStandardIO::~EStandardIO()
 {
+	Flush();
 }
 
 
 ssize_t
 EStandardIO::Read(void *buffer, size_t size)
 {
+	// the prompt must be visible before waiting for the input
+	if(fFD == 0)
+	{
+		EOut.Flush();
+		EErr.Flush();
+	}
+
 	return read(fFD, buffer, size);
 }
 
 
 ssize_t
-EStandardIO::Write(const void *buffer, size_t size)
+EStandardIO::DeviceWrite(const void *buffer, size_t size)
 {
+	// keep the order of what goes to the standard output and error
+	if(fFD == 2) EOut.Flush();
+
 	return write(fFD, buffer, size);
 }
-
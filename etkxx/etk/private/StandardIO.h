@@ -40,7 +40,9 @@ public:
 	virtual ~EStandardIO();
 
 	virtual ssize_t		Read(void *buffer, size_t size);
-	virtual ssize_t		Write(const void *buffer, size_t size);
+
+protected:
+	virtual ssize_t		DeviceWrite(const void *buffer, size_t size);
 
 private:
 	int fFD;
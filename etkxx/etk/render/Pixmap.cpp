@@ -31,6 +31,7 @@
 #include <stdlib.h>
 
 #include <etk/support/StringArray.h>
+#include <etk/support/ByteOrder.h>
 
 #include "Pixmap.h"
 
@@ -57,14 +58,17 @@ EPixmap::EPixmap(ERect bounds, e_color_space space)
 
 EPixmap::~EPixmap()
 {
-	if(fPtr) FreeData(fPtr);
+	MakeEmpty();
 }
 
 
 void
 EPixmap::MakeEmpty()
 {
-	if(fPtr) FreeData(fPtr);
+	if(fPtr == NULL) return;
+
+	etk_memory_account_free(E_MEMORY_PIXMAPS, (size_t)BitsLength());
+	FreeData(fPtr);
 	fPtr = NULL;
 }
 
@@ -153,8 +157,9 @@ EPixmap::ResizeTo(euint32 width, euint32 height, e_color_space space)
 
 	void *newPtr = AllocData(allocSize);
 	if(!newPtr) return false;
+	etk_memory_account_alloc(E_MEMORY_PIXMAPS, allocSize);
 
-	if(fPtr) FreeData(fPtr);
+	MakeEmpty();
 	fPtr = newPtr;
 	bzero(fPtr, allocSize);
 
@@ -342,21 +347,110 @@ EPixmap::PutRect(eint32 x, eint32 y, euint32 width, euint32 height, e_rgb_color
 }
 
 
+static euint32 etk_color_space_bytes(e_color_space space)
+{
+	switch(space)
+	{
+		case E_CMAP8: return 1;
+		case E_RGB24: case E_RGB24_BIG: return 3;
+		case E_RGB32: case E_RGBA32: return 4;
+		default: return 0;
+	}
+}
+
+
+// the 32-bit pixels lie as B-G-R-A in memory on both byte orders, see PutPixel()
+static e_rgb_color etk_color_from_bits(const euint8 *bits, e_color_space space)
+{
+	e_rgb_color color;
+
+	switch(space)
+	{
+		case E_RGB32:
+		case E_RGBA32:
+			color.set_to(bits[2], bits[1], bits[0], space == E_RGBA32 ? bits[3] : 0xff);
+			break;
+
+		case E_RGB24:
+			color.set_to(bits[2], bits[1], bits[0], 0xff);
+			break;
+
+		case E_RGB24_BIG:
+			color.set_to(bits[0], bits[1], bits[2], 0xff);
+			break;
+
+		default:
+			color = etk_find_color_for_index(*bits);
+	}
+
+	return color;
+}
+
+
 void
 EPixmap::SetBits(const void *data, eint32 length, eint32 offset, e_color_space space)
 {
 	if(data == NULL || length <= 0 || offset < 0 || !IsValid()) return;
-	if(BitsLength() - (euint32)length < (euint32)offset) length = BitsLength() - (euint32)offset;
-	if(length <= 0) return;
+	if((euint32)offset >= BitsLength()) return;
 
 	if(fColorSpace == space)
 	{
+		if((euint32)length > BitsLength() - (euint32)offset) length = BitsLength() - (euint32)offset;
 		memcpy((euint8*)fPtr + offset, data, (size_t)length);
+		return;
+	}
+
+	// "offset" is counted in the pixmap, "length" is counted in "data"
+	euint32 srcBytes = etk_color_space_bytes(space);
+	euint32 dstBytes = etk_color_space_bytes(fColorSpace);
+	if(srcBytes == 0 || (euint32)offset % dstBytes != 0)
+	{
+		ETK_WARNING("[RENDER]: %s --- color space(%d) not supported, or offset not at a pixel.", __PRETTY_FUNCTION__, space);
+		return;
+	}
+
+	size_t count = (size_t)min_c((euint32)length / srcBytes, (BitsLength() - (euint32)offset) / dstBytes);
+	const euint8 *src = (const euint8*)data;
+	euint8 *dst = (euint8*)fPtr + offset;
+
+	if(dstBytes == 3 && srcBytes == 3)
+	{
+		// BGR <-> RGB
+		e_swap_rgb24_array(dst, src, count);
+	}
+	else if(dstBytes == 4 && srcBytes == 4)
+	{
+		// same order, the alpha of E_RGB32 is 0xff as PutPixel() does
+		memcpy(dst, src, count * 4);
+		for(; count > 0; count--, dst += 4) dst[3] = 0xff;
+	}
+	else if(dstBytes == 3 && srcBytes == 4)
+	{
+		bool reverse = (fColorSpace == E_RGB24_BIG);
+		for(; count > 0; count--, src += 4, dst += 3)
+		{
+			dst[0] = src[reverse ? 2 : 0];
+			dst[1] = src[1];
+			dst[2] = src[reverse ? 0 : 2];
+		}
+	}
+	else if(dstBytes == 4 && srcBytes == 3)
+	{
+		bool reverse = (space == E_RGB24_BIG);
+		for(; count > 0; count--, src += 3, dst += 4)
+		{
+			dst[0] = src[reverse ? 2 : 0];
+			dst[1] = src[1];
+			dst[2] = src[reverse ? 0 : 2];
+			dst[3] = 0xff;
+		}
 	}
 	else
 	{
-		// TODO
-		ETK_WARNING("[RENDER]: %s --- color space must same as the pixmap.", __PRETTY_FUNCTION__);
+		// through the palette
+		euint32 index = (euint32)offset / dstBytes;
+		for(; count > 0; count--, src += srcBytes, index++)
+			PutPixel((eint32)(index % fColumns), (eint32)(index / fColumns), etk_color_from_bits(src, space));
 	}
 }
 
@@ -36,6 +36,7 @@
 #endif // M_PI
 
 #include <etk/support/List.h>
+#include <etk/support/Vector.h>
 
 #include "LineGenerator.h"
 #include "ArcGenerator.h"
@@ -192,6 +193,7 @@ private:
 	eint32 fX2;
 	eint32 fY1;
 	eint32 fY2;
+	eint32 fPixels2;
 
 	bool fValid;
 };
@@ -202,9 +204,9 @@ ERenderLine2::ERenderLine2(EPoint pt0, EPoint pt1, EPoint pt2)
 {
 	if(pt0.y > pt1.y || pt1.y > pt2.y) return;
 
-	eint32 tmp, pixels1, pixels2;
+	eint32 tmp, pixels1;
 
-	if(fLine1.Start(fX1, fY1, tmp, pixels1, false, 1) && fLine2.Start(fX2, fY2, tmp, pixels2, false, 1))
+	if(fLine1.Start(fX1, fY1, tmp, pixels1, false, 1) && fLine2.Start(fX2, fY2, tmp, fPixels2, false, 1))
 	{
 		fValid = true;
 
@@ -213,8 +215,8 @@ ERenderLine2::ERenderLine2(EPoint pt0, EPoint pt1, EPoint pt2)
 
 		if(fY2 == fY1)
 		{
-			fMinX = min_c(fMinX, min_c(fX2, fX2 + pixels2));
-			fMaxX = max_c(fMaxX, max_c(fX2, fX2 + pixels2));
+			fMinX = min_c(fMinX, min_c(fX2, fX2 + fPixels2));
+			fMaxX = max_c(fMaxX, max_c(fX2, fX2 + fPixels2));
 		}
 	}
 }
@@ -245,12 +247,12 @@ ERenderLine2::Next()
 {
 	if(fValid == false) return false;
 
-	eint32 pixels1, pixels2;
+	eint32 pixels1;
 	bool line1_has_next = false;
 
 	fY1++;
 	if(fY1 <= fY2) if((line1_has_next = fLine1.Next(fX1, pixels1)) == false) fValid = (fY1 == fY2);
-	if(fY1 > fY2) if(fLine2.Next(fX2, pixels2) == false) fValid = false;
+	if(fY1 > fY2) if(fLine2.Next(fX2, fPixels2) == false) fValid = false;
 	if(fValid == false) return false;
 
 	if(line1_has_next)
@@ -260,14 +262,14 @@ ERenderLine2::Next()
 
 		if(fY1 > fY2)
 		{
-			fMinX = min_c(fMinX, min_c(fX2, fX2 + pixels2));
-			fMaxX = max_c(fMaxX, max_c(fX2, fX2 + pixels2));
+			fMinX = min_c(fMinX, min_c(fX2, fX2 + fPixels2));
+			fMaxX = max_c(fMaxX, max_c(fX2, fX2 + fPixels2));
 		}
 	}
 	else
 	{
-		fMinX = min_c(fX2, fX2 + pixels2);
-		fMaxX = max_c(fX2, fX2 + pixels2);
+		fMinX = min_c(fX2, fX2 + fPixels2);
+		fMaxX = max_c(fX2, fX2 + fPixels2);
 	}
 
 	return true;
@@ -1228,6 +1230,39 @@ ERender::StrokePolygon(const EPolygon *aPolygon, bool closed, e_pattern pattern)
 }
 
 
+// The render objects are placed in an EArena, they're destroyed but never deleted.
+typedef EVector<ERenderObject*, 64> ERenderObjects;
+
+// the stack buffer for the render objects when no arena given
+#define ETK_RENDER_ARENA_SIZE	4096
+
+typedef struct etk_render_polygon {
+	EPoint	*pts;
+	eint32	count;
+} etk_render_polygon;
+
+
+static ERenderObject* etk_new_render_line(EArena *arena, EPoint pt0, EPoint pt1)
+{
+	void *ptr = arena->Allocate(sizeof(ERenderLine));
+	return(ptr == NULL ? NULL : new (ptr) ERenderLine(pt0, pt1));
+}
+
+
+static ERenderObject* etk_new_render_triangle(EArena *arena, EPoint pt0, EPoint pt1, EPoint pt2)
+{
+	void *ptr = arena->Allocate(sizeof(ERenderTriangle));
+	return(ptr == NULL ? NULL : new (ptr) ERenderTriangle(pt0, pt1, pt2, false));
+}
+
+
+static void etk_destroy_render_objects(ERenderObjects *objects)
+{
+	for(eint32 i = 0; i < objects->CountItems(); i++) (*(objects->ItemAt(i)))->~ERenderObject();
+	objects->MakeEmpty();
+}
+
+
 #define INTERSECTS(v, s1, e1, s2, e2)		\
 	(max_c(s1, s2) <= min_c(e1, e2) ? ((v = (((eint64)min_c(s1, s2)) << 32) | (eint64)max_c(e1, e2)), true) : false)
 static void include_region(eint64 *region, eint32 *count, eint32 minX, eint32 maxX)
@@ -1253,31 +1288,27 @@ static void include_region(eint64 *region, eint32 *count, eint32 minX, eint32 ma
 #undef INTERSECTS
 
 
-static void etk_stroke_objects(ERender *render, EList *objects, e_pattern pattern)
+static void etk_stroke_objects(ERender *render, ERenderObjects *objects, e_pattern pattern, EArena *arena)
 {
 	if(objects->CountItems() <= 0) return;
 
 	ERenderObject *aObject;
 
-	objects->SortItems(ERenderObject::cmp);
+	qsort((void*)objects->Items(), (size_t)objects->CountItems(), sizeof(ERenderObject*), ERenderObject::cmp);
 
-	eint64 *region = (eint64*)malloc(sizeof(eint64) * objects->CountItems());
-	if(region == NULL)
-	{
-		while((aObject = (ERenderObject*)objects->RemoveItem((eint32)0)) != NULL) delete aObject;
-		return;
-	}
+	eint64 *region = (eint64*)arena->Allocate(sizeof(eint64) * (size_t)objects->CountItems());
+	if(region == NULL) return;
 
 	while(objects->CountItems() > 0)
 	{
 		eint32 curY, tmpY, minX, maxX;
 		eint32 count = 0;
 
-		aObject = (ERenderObject*)objects->FirstItem();
+		aObject = *(objects->FirstItem());
 		if(aObject->Get(&curY, &minX, &maxX) == false)
 		{
-			objects->RemoveItem((eint32)0);
-			delete aObject;
+			objects->RemoveItem(0);
+			aObject->~ERenderObject();
 			continue;
 		}
 
@@ -1285,12 +1316,12 @@ static void etk_stroke_objects(ERender *render, EList *objects, e_pattern patter
 
 		for(eint32 i = 1; i < objects->CountItems(); i++)
 		{
-			aObject = (ERenderObject*)objects->ItemAt(i);
+			aObject = *(objects->ItemAt(i));
 
 			if(aObject->Get(&tmpY, &minX, &maxX) == false)
 			{
 				objects->RemoveItem(i);
-				delete aObject;
+				aObject->~ERenderObject();
 				i--;
 				continue;
 			}
@@ -1301,7 +1332,7 @@ static void etk_stroke_objects(ERender *render, EList *objects, e_pattern patter
 			include_region(region, &count, minX, maxX);
 		}
 
-		((ERenderObject*)objects->FirstItem())->Next();
+		(*(objects->FirstItem()))->Next();
 
 		for(eint32 i = 0; i < count; i++)
 		{
@@ -1312,8 +1343,6 @@ static void etk_stroke_objects(ERender *render, EList *objects, e_pattern patter
 			render->FillRect(minX, curY, maxX - minX + 1, 1, pattern);
 		}
 	}
-
-	free(region);
 }
 
 
@@ -1338,7 +1367,9 @@ ERender::StrokePolygon(const EPoint *ptArray, eint32 numPts, bool closed, e_patt
 	}
 	else
 	{
-		EList lines;
+		char buffer[ETK_RENDER_ARENA_SIZE];
+		EArena arena(buffer, sizeof(buffer));
+		ERenderObjects lines;
 		EPoint pt0, pt1;
 
 		for(eint32 k = 0; k < numPts; k++)
@@ -1349,21 +1380,23 @@ ERender::StrokePolygon(const EPoint *ptArray, eint32 numPts, bool closed, e_patt
 			pt1 = *(ptArray + (k < numPts - 1 ? k + 1 : 0));
 
 			if(pt0.y > pt1.y) SWAP(EPoint, pt0, pt1);
-			ERenderLine *aLine = new ERenderLine(pt0, pt1);
+			ERenderObject *aLine = etk_new_render_line(&arena, pt0, pt1);
+			if(aLine == NULL) break;
 
-			if(lines.AddItem(aLine) == false) {delete aLine; break;}
+			if(lines.AddItem(aLine) == false) {aLine->~ERenderObject(); break;}
 		}
 
-		etk_stroke_objects(this, &lines, pattern);
+		etk_stroke_objects(this, &lines, pattern, &arena);
+		etk_destroy_render_objects(&lines);
 	}
 }
 
 
 void
-ERender::FillPolygon(const EPolygon *aPolygon, bool stroke_edge, e_pattern pattern)
+ERender::FillPolygon(const EPolygon *aPolygon, bool stroke_edge, e_pattern pattern, EArena *arena)
 {
 	if(!IsValid() || aPolygon == NULL) return;
-	FillPolygon(aPolygon->Points(), aPolygon->CountPoints(), stroke_edge, pattern);
+	FillPolygon(aPolygon->Points(), aPolygon->CountPoints(), stroke_edge, pattern, arena);
 }
 
 
@@ -1391,11 +1424,8 @@ static bool etk_triangle_contains(EPoint pt0, EPoint pt1, EPoint pt2, EPoint aPt
 
 
 void
-ERender::FillPolygon(const EPoint *ptArray, eint32 numPts, bool stroke_edge, e_pattern pattern)
+ERender::FillPolygon(const EPoint *ptArray, eint32 numPts, bool stroke_edge, e_pattern pattern, EArena *arena)
 {
-	EPoint *aPt = NULL;
-	EPolygon *aPolygon = NULL;
-
 	if(!IsValid() || ptArray == NULL || numPts <= 0) return;
 
 	while(numPts > 3)
@@ -1413,56 +1443,70 @@ ERender::FillPolygon(const EPoint *ptArray, eint32 numPts, bool stroke_edge, e_p
 		return;
 	}
 
-	EList pts(numPts);
-	bool readyForDraw = true;
-
-	for(eint32 i = 0; i < numPts; i++)
+	if(arena == NULL)
 	{
-		if(!(i == 0 || ptArray[i] != ptArray[i - 1])) continue;
+		char buffer[ETK_RENDER_ARENA_SIZE];
+		EArena localArena(buffer, sizeof(buffer));
+		FillPolygon(ptArray, numPts, stroke_edge, pattern, &localArena);
+		return;
+	}
 
-		aPt = new EPoint(ptArray[i]);
-		if(pts.AddItem(aPt)) continue;
+	size_t mark = arena->Mark();
 
-		delete aPt;
-		readyForDraw = false;
-		break;
+	etk_render_polygon polygon;
+	polygon.pts = (EPoint*)arena->Allocate(sizeof(EPoint) * (size_t)numPts);
+	polygon.count = 0;
+
+	bool readyForDraw = (polygon.pts != NULL);
+
+	for(eint32 i = 0; readyForDraw && i < numPts; i++)
+	{
+		if(!(i == 0 || ptArray[i] != ptArray[i - 1])) continue;
+		polygon.pts[polygon.count++] = ptArray[i];
 	}
 
+	EPoint *pts = polygon.pts;
 	EPoint psPt, pePt, sPt, ePt, iPt;
-	EList polygons;
-	EPolygon tmp;
+	EVector<etk_render_polygon, 8> polygons;
 
-	for(eint32 i = 2; readyForDraw && i <= pts.CountItems(); i++) // split to polygons
+	for(eint32 i = 2; readyForDraw && i <= polygon.count; i++) // split to polygons
 	{
 		if(i < 2) continue;
 
-		sPt = *((EPoint*)pts.ItemAt(i - 1));
-		ePt = (i < pts.CountItems() ? *((EPoint*)pts.ItemAt(i)) : *((EPoint*)pts.FirstItem()));
+		sPt = pts[i - 1];
+		ePt = (i < polygon.count ? pts[i] : pts[0]);
 
 		for(eint32 k = i; readyForDraw && k >= 2; k--)
 		{
-			psPt = *((EPoint*)pts.ItemAt(k - 2));
-			pePt = *((EPoint*)pts.ItemAt(k - 1));
+			psPt = pts[k - 2];
+			pePt = pts[k - 1];
 
 			if(etk_get_line_intersection(psPt, pePt, sPt, ePt, &iPt) == false ||
-			   iPt == sPt || (iPt == ePt && i == pts.CountItems())) continue;
+			   iPt == sPt || (iPt == ePt && i == polygon.count)) continue;
 
-			aPolygon = new EPolygon(&iPt, 1);
+			etk_render_polygon aPolygon;
+			aPolygon.pts = (EPoint*)arena->Allocate(sizeof(EPoint) * (size_t)(i - k + 2));
+			aPolygon.count = 0;
+
+			if(aPolygon.pts == NULL) {readyForDraw = false; break;}
+
+			aPolygon.pts[aPolygon.count++] = iPt;
 			for(eint32 m = k - 1; m < i; m++)
 			{
-				aPt = (EPoint*)pts.ItemAt(k - 1);
-				if(aPt == NULL || aPolygon->AddPoints(aPt, 1, false) == false) break;
+				aPolygon.pts[aPolygon.count++] = pts[k - 1];
 
-				if(m == i - 1) *aPt = iPt;
-				else {pts.RemoveItem(k - 1); delete aPt;}
+				if(m == i - 1)
+				{
+					pts[k - 1] = iPt;
+				}
+				else
+				{
+					for(eint32 n = k - 1; n < polygon.count - 1; n++) pts[n] = pts[n + 1];
+					polygon.count--;
+				}
 			}
 
-			if(aPolygon->CountPoints() != (i - k + 2) || polygons.AddItem(aPolygon) == false)
-			{
-				delete aPolygon;
-				readyForDraw = false;
-				break;
-			}
+			if(polygons.AddItem(aPolygon) == false) {readyForDraw = false; break;}
 
 			i = k - 1;
 
@@ -1470,36 +1514,32 @@ ERender::FillPolygon(const EPoint *ptArray, eint32 numPts, bool stroke_edge, e_p
 		}
 	}
 
-	while((aPt = (EPoint*)pts.RemoveItem((eint32)0)) != NULL)
-	{
-		if(readyForDraw) readyForDraw = tmp.AddPoints(aPt, 1, false);
-		delete aPt;
-	}
-
-	aPolygon = &tmp;
-	EList objects;
+	etk_render_polygon *aPolygon = &polygon;
+	ERenderObjects objects;
+	eint32 nextPolygon = 0;
 
 	do {
-		if(stroke_edge) for(eint32 i = 0; readyForDraw && i < aPolygon->CountPoints(); i++)
+		if(stroke_edge) for(eint32 i = 0; readyForDraw && i < aPolygon->count; i++)
 		{
-			sPt = (*aPolygon)[i];
-			ePt = (*aPolygon)[(i < aPolygon->CountPoints() - 1) ? i + 1 : 0];
+			sPt = aPolygon->pts[i];
+			ePt = aPolygon->pts[(i < aPolygon->count - 1) ? i + 1 : 0];
 
 			if(sPt.y > ePt.y) SWAP(EPoint, sPt, ePt);
-			ERenderLine *aLine = new ERenderLine(sPt, ePt);
-			if(objects.AddItem(aLine) == false) {delete aLine; readyForDraw = false; break;}
+			ERenderObject *aLine = etk_new_render_line(arena, sPt, ePt);
+			if(aLine == NULL) {readyForDraw = false; break;}
+			if(objects.AddItem(aLine) == false) {aLine->~ERenderObject(); readyForDraw = false; break;}
 		}
 
-		while(readyForDraw && aPolygon->CountPoints() > 0)
+		while(readyForDraw && aPolygon->count > 0)
 		{
-			EPolygon drawingPolygon;
+			etk_render_polygon drawingPolygon;
 
 			eint32 flags[2] = {0, 0};
-			for(eint32 i = 0; i < aPolygon->CountPoints(); i++)
+			for(eint32 i = 0; i < aPolygon->count; i++)
 			{
-				sPt = (*aPolygon)[i == 0 ? aPolygon->CountPoints() - 1: i - 1];
-				iPt = (*aPolygon)[i];
-				ePt = (*aPolygon)[(i < aPolygon->CountPoints() - 1) ? i + 1 : 0];
+				sPt = aPolygon->pts[i == 0 ? aPolygon->count - 1: i - 1];
+				iPt = aPolygon->pts[i];
+				ePt = aPolygon->pts[(i < aPolygon->count - 1) ? i + 1 : 0];
 
 				psPt = sPt - iPt;
 				pePt = ePt - iPt;
@@ -1513,8 +1553,7 @@ ERender::FillPolygon(const EPoint *ptArray, eint32 numPts, bool stroke_edge, e_p
 			if(flags[0] == 0 || flags[1] == 0)
 			{
 				drawingPolygon = *aPolygon;
-				if(drawingPolygon.CountPoints() != aPolygon->CountPoints()) {readyForDraw = false; break;}
-				aPolygon->RemovePoints(0, aPolygon->CountPoints() - 1, false);
+				aPolygon->count = 0;
 			}
 			else
 			{
@@ -1525,38 +1564,33 @@ ERender::FillPolygon(const EPoint *ptArray, eint32 numPts, bool stroke_edge, e_p
 
 			while(readyForDraw)
 			{
-				EPoint pt0 = drawingPolygon[0];
-				EPoint pt1 = drawingPolygon[max_c(0, drawingPolygon.CountPoints() - 2)];
-				EPoint pt2 = drawingPolygon[drawingPolygon.CountPoints() - 1];
+				EPoint pt0 = drawingPolygon.pts[0];
+				EPoint pt1 = drawingPolygon.pts[max_c(0, drawingPolygon.count - 2)];
+				EPoint pt2 = drawingPolygon.pts[drawingPolygon.count - 1];
 
 				if(pt0.y > pt1.y) SWAP(EPoint, pt0, pt1);
-				if(drawingPolygon.CountPoints() > 3)
+				if(drawingPolygon.count > 3)
 				{
-					ERenderLine *aLine = new ERenderLine(pt0, pt1);
-					if(objects.AddItem(aLine) == false) {delete aLine; readyForDraw = false; break;}
+					ERenderObject *aLine = etk_new_render_line(arena, pt0, pt1);
+					if(aLine == NULL) {readyForDraw = false; break;}
+					if(objects.AddItem(aLine) == false) {aLine->~ERenderObject(); readyForDraw = false; break;}
 				}
 
 				if(pt0.y > pt2.y) SWAP(EPoint, pt0, pt2);
 				if(pt1.y > pt2.y) SWAP(EPoint, pt1, pt2);
-				ERenderTriangle *aTriangle = new ERenderTriangle(pt0, pt1, pt2, false);
-				if(objects.AddItem(aTriangle) == false) {delete aTriangle; readyForDraw = false; break;}
+				ERenderObject *aTriangle = etk_new_render_triangle(arena, pt0, pt1, pt2);
+				if(aTriangle == NULL) {readyForDraw = false; break;}
+				if(objects.AddItem(aTriangle) == false) {aTriangle->~ERenderObject(); readyForDraw = false; break;}
 
-				if(drawingPolygon.CountPoints() <= 3) break;
-				drawingPolygon.RemovePoint(drawingPolygon.CountPoints() - 1, false);
+				if(drawingPolygon.count <= 3) break;
+				drawingPolygon.count--;
 			}
 		}
+	} while(nextPolygon < polygons.CountItems() && (aPolygon = polygons.ItemAt(nextPolygon++)) != NULL);
 
-		if(aPolygon != (&tmp)) delete aPolygon;
-	} while((aPolygon = (EPolygon*)polygons.RemoveItem((eint32)0)) != NULL);
+	if(readyForDraw) etk_stroke_objects(this, &objects, pattern, arena);
+	etk_destroy_render_objects(&objects);
 
-	if(readyForDraw)
-	{
-		etk_stroke_objects(this, &objects, pattern);
-	}
-	else
-	{
-		ERenderObject *aObject;
-		while((aObject = (ERenderObject*)objects.RemoveItem((eint32)0)) != NULL) delete aObject;
-	}
+	arena->Release(mark);
 }
 
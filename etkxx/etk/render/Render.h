@@ -33,6 +33,7 @@
 #include <etk/interface/GraphicsDefs.h>
 #include <etk/interface/Rect.h>
 #include <etk/interface/Polygon.h>
+#include <etk/support/Arena.h>
 
 #ifdef __cplusplus /* Just for C++ */
 
@@ -79,8 +80,12 @@ public:
 
 	void		StrokePolygon(const EPolygon *aPolygon, bool closed = true, e_pattern pattern = E_SOLID_HIGH);
 	void		StrokePolygon(const EPoint *ptArray, eint32 numPts, bool closed = true, e_pattern pattern = E_SOLID_HIGH);
-	void		FillPolygon(const EPolygon *aPolygon, bool stroke_edge = true, e_pattern pattern = E_SOLID_HIGH);
-	void		FillPolygon(const EPoint *ptArray, eint32 numPts, bool stroke_edge = true, e_pattern pattern = E_SOLID_HIGH);
+	// FillPolygon(): the temporaries are allocated from "arena" and freed before return,
+	// a small buffer on stack is used when "arena" is NULL.
+	void		FillPolygon(const EPolygon *aPolygon, bool stroke_edge = true, e_pattern pattern = E_SOLID_HIGH,
+				    EArena *arena = NULL);
+	void		FillPolygon(const EPoint *ptArray, eint32 numPts, bool stroke_edge = true, e_pattern pattern = E_SOLID_HIGH,
+				    EArena *arena = NULL);
 
 	void		StrokeEllipse(eint32 x, eint32 y, euint32 width, euint32 height,
 				      e_pattern pattern = E_SOLID_HIGH);
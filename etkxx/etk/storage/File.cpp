@@ -32,17 +32,24 @@
 #define __USE_FILE_OFFSET64
 #endif
 
+#include <etk/config.h>
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <string.h>
 
 #ifndef _WIN32
 #include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif // HAVE_MMAP
 #else
 #include <windows.h>
 #endif // _WIN32
 
 #include <etk/support/String.h>
+#include <etk/kernel/Kernel.h>
 
 #ifdef _WIN32
 extern "C" char* etk_win32_convert_utf8_to_active(const char *str, eint32 length);
@@ -53,6 +60,11 @@ extern "C" char* etk_win32_convert_utf8_to_active(const char *str, eint32 length
 
 extern e_status_t etk_path_expound(EString &path, const char *dir, const char *leaf, bool *normalize);
 
+// ReadAt()/WriteAt() move the position and restore it without pread()/pwrite(), so the locker serializes them
+#if defined(_WIN32) || !defined(HAVE_PREAD) || !defined(HAVE_PWRITE)
+#define ETK_FILE_POSITION_LOCKER
+#endif
+
 #ifndef _WIN32
 inline int etk_file_openmode_to_flags(euint32 open_mode)
 {
@@ -115,35 +127,60 @@ inline mode_t etk_file_access_mode_to_mode_t(euint32 access_mode)
 #endif
 
 
+// the object returned by EFile::Map()
+class _LOCAL EFileMapping : public EMemoryIO {
+public:
+	EFileMapping(const void *addr, size_t length)
+		: EMemoryIO(addr, length), fAddr(addr), fLength(length)
+	{
+	}
+
+	virtual ~EFileMapping()
+	{
+#ifndef _WIN32
+#ifdef HAVE_MMAP
+		munmap((void*)fAddr, fLength);
+#endif
+#else
+		UnmapViewOfFile(fAddr);
+#endif
+	}
+
+private:
+	const void *fAddr;
+	size_t fLength;
+};
+
+
 EFile::EFile()
-	: fFD(NULL), fMode(0)
+	: fFD(NULL), fMode(0), fLocker(NULL)
 {
 }
 
 
 EFile::EFile(const char *path, euint32 open_mode, euint32 access_mode)
-	: fFD(NULL), fMode(0)
+	: fFD(NULL), fMode(0), fLocker(NULL)
 {
 	SetTo(path, open_mode, access_mode);
 }
 
 
 EFile::EFile(const EEntry *entry, euint32 open_mode, euint32 access_mode)
-	: fFD(NULL), fMode(0)
+	: fFD(NULL), fMode(0), fLocker(NULL)
 {
 	SetTo(entry, open_mode, access_mode);
 }
 
 
 EFile::EFile(const EDirectory *dir, const char *leaf, euint32 open_mode, euint32 access_mode)
-	: fFD(NULL), fMode(0)
+	: fFD(NULL), fMode(0), fLocker(NULL)
 {
 	SetTo(dir, leaf, open_mode, access_mode);
 }
 
 
 EFile::EFile(const EFile &from)
-	: fFD(NULL), fMode(0)
+	: fFD(NULL), fMode(0), fLocker(NULL)
 {
 	operator=(from);
 }
@@ -160,6 +197,8 @@ EFile::~EFile()
 		CloseHandle((HANDLE)fFD);
 #endif
 	}
+
+	if(fLocker != NULL) etk_delete_simple_locker(fLocker);
 }
 
 
@@ -179,6 +218,10 @@ EFile::SetTo(const char *path, euint32 open_mode, euint32 access_mode)
 	etk_path_expound(strPath, path, NULL, NULL);
 	if(strPath.Length() <= 0) return E_BAD_VALUE;
 
+#ifdef ETK_FILE_POSITION_LOCKER
+	if(fLocker == NULL && (fLocker = etk_create_simple_locker()) == NULL) return E_NO_MEMORY;
+#endif
+
 #ifndef _WIN32
 	int newFD = open(strPath.String(), etk_file_openmode_to_flags(open_mode), etk_file_access_mode_to_mode_t(access_mode));
 	if(newFD == -1) return E_FILE_ERROR;
@@ -298,12 +341,43 @@ EFile::Read(void *buffer, size_t size)
 ssize_t
 EFile::ReadAt(eint64 pos, void *buffer, size_t size)
 {
-	if(!IsReadable() || buffer == NULL) return -1;
+	if(!IsReadable() || buffer == NULL || pos < E_INT64_CONSTANT(0)) return -1;
+#if !defined(_WIN32) && defined(HAVE_PREAD)
+	if(!(sizeof(off_t) > 4 || pos < (eint64)E_MAXINT32)) return -1;
+	return pread(*((int*)fFD), buffer, size, (off_t)pos);
+#elif defined(_WIN32)
+	if(fLocker == NULL) return -1;
+
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.Offset = (DWORD)(pos & E_INT64_CONSTANT(0xffffffff));
+	overlapped.OffsetHigh = (DWORD)(pos >> 32);
+
+	// ReadFile() moves the pointer of the synchronous handle even with the offset given
+	etk_lock_simple_locker(fLocker);
 	eint64 savePosition = Position();
-	if(Seek(pos, E_SEEK_SET) < E_INT64_CONSTANT(0)) return -1;
-	ssize_t retVal = Read(buffer, size);
+	DWORD nRead = (DWORD)size;
+	BOOL status = ReadFile((HANDLE)fFD, buffer, nRead, &nRead, &overlapped);
 	Seek(savePosition, E_SEEK_SET);
+	etk_unlock_simple_locker(fLocker);
+
+	if(status == 0) return(GetLastError() == ERROR_HANDLE_EOF ? 0 : -1);
+	return((ssize_t)nRead);
+#else
+	if(fLocker == NULL) return -1;
+
+	etk_lock_simple_locker(fLocker);
+	eint64 savePosition = Position();
+	ssize_t retVal = -1;
+	if(Seek(pos, E_SEEK_SET) >= E_INT64_CONSTANT(0))
+	{
+		retVal = Read(buffer, size);
+		Seek(savePosition, E_SEEK_SET);
+	}
+	etk_unlock_simple_locker(fLocker);
+
 	return retVal;
+#endif
 }
 
 
@@ -324,12 +398,43 @@ EFile::Write(const void *buffer, size_t size)
 ssize_t
 EFile::WriteAt(eint64 pos, const void *buffer, size_t size)
 {
-	if(!IsWritable() || buffer == NULL) return -1;
+	if(!IsWritable() || buffer == NULL || pos < E_INT64_CONSTANT(0)) return -1;
+#if !defined(_WIN32) && defined(HAVE_PWRITE)
+	if(!(sizeof(off_t) > 4 || pos < (eint64)E_MAXINT32)) return -1;
+	return pwrite(*((int*)fFD), buffer, size, (off_t)pos);
+#elif defined(_WIN32)
+	if(fLocker == NULL) return -1;
+
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.Offset = (DWORD)(pos & E_INT64_CONSTANT(0xffffffff));
+	overlapped.OffsetHigh = (DWORD)(pos >> 32);
+
+	// WriteFile() moves the pointer of the synchronous handle even with the offset given
+	etk_lock_simple_locker(fLocker);
 	eint64 savePosition = Position();
-	if(Seek(pos, E_SEEK_SET) < E_INT64_CONSTANT(0)) return -1;
-	ssize_t retVal = Write(buffer, size);
+	DWORD nWrote = (DWORD)size;
+	BOOL status = WriteFile((HANDLE)fFD, buffer, nWrote, &nWrote, &overlapped);
 	Seek(savePosition, E_SEEK_SET);
+	etk_unlock_simple_locker(fLocker);
+
+	if(status == 0) return -1;
+	return((ssize_t)nWrote);
+#else
+	if(fLocker == NULL) return -1;
+
+	etk_lock_simple_locker(fLocker);
+	eint64 savePosition = Position();
+	ssize_t retVal = -1;
+	if(Seek(pos, E_SEEK_SET) >= E_INT64_CONSTANT(0))
+	{
+		retVal = Write(buffer, size);
+		Seek(savePosition, E_SEEK_SET);
+	}
+	etk_unlock_simple_locker(fLocker);
+
 	return retVal;
+#endif
 }
 
 
@@ -405,9 +510,56 @@ EFile::SetSize(eint64 size)
 }
 
 
+EMemoryIO*
+EFile::Map() const
+{
+	if(fFD == NULL) return NULL;
+
+#ifndef _WIN32
+#ifdef HAVE_MMAP
+	struct stat st;
+	if(fstat(*((int*)fFD), &st) != 0 || !S_ISREG(st.st_mode)) return NULL;
+	if((euint64)st.st_size > (euint64)(~((size_t)0) >> 1)) return NULL;
+
+	size_t length = (size_t)st.st_size;
+	if(length == 0) return new EMemoryIO((const void*)NULL, 0);
+
+	void *addr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, *((int*)fFD), 0);
+	if(addr == MAP_FAILED) return NULL;
+
+	return new EFileMapping(addr, length);
+#else
+	return NULL;
+#endif
+#else
+	DWORD sizeHigh = 0;
+	DWORD sizeLow = GetFileSize((HANDLE)fFD, &sizeHigh);
+	if(sizeLow == (DWORD)-1/*INVALID_FILE_SIZE*/ && GetLastError() != NO_ERROR) return NULL;
+	if(sizeHigh != 0 && sizeof(size_t) <= 4) return NULL;
+
+	size_t length = (size_t)(((euint64)sizeHigh << 32) | (euint64)sizeLow);
+	if(length == 0) return new EMemoryIO((const void*)NULL, 0);
+
+	HANDLE mapping = CreateFileMapping((HANDLE)fFD, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mapping == NULL) return NULL;
+
+	// the view keeps the mapping
+	void *addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if(addr == NULL) return NULL;
+
+	return new EFileMapping(addr, length);
+#endif
+}
+
+
 EFile&
 EFile::operator=(const EFile &from)
 {
+#ifdef ETK_FILE_POSITION_LOCKER
+	if(fLocker == NULL) fLocker = etk_create_simple_locker();
+#endif
+
 #ifndef _WIN32
 	int newFD = (from.fFD == NULL ? -1 : dup(*((int*)from.fFD)));
 	if(newFD == -1)
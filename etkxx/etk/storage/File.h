@@ -30,12 +30,13 @@
 #ifndef __ETK_FILE_H__
 #define __ETK_FILE_H__ 
 
+#include <etk/support/DataIO.h>
 #include <etk/storage/StorageDefs.h>
 #include <etk/storage/Directory.h>
 
 #ifdef __cplusplus /* Just for C++ */
 
-class _IMPEXP_ETK EFile {
+class _IMPEXP_ETK EFile : public EPositionIO {
 public:
 	EFile();
 	EFile(const char *path, euint32 open_mode, euint32 access_mode = E_USER_READ | E_USER_WRITE);
@@ -53,20 +54,32 @@ public:
 	bool		IsReadable() const;
 	bool		IsWritable() const;
 
-	ssize_t		Read(void *buffer, size_t size);
-	ssize_t		ReadAt(eint64 pos, void *buffer, size_t size);
-	ssize_t		Write(const void *buffer, size_t size);
-	ssize_t		WriteAt(eint64 pos, const void *buffer, size_t size);
+	virtual ssize_t		Read(void *buffer, size_t size);
+	virtual ssize_t		Write(const void *buffer, size_t size);
 
-	eint64		Seek(eint64 position, euint32 seek_mode);
-	eint64		Position() const;
-	e_status_t	SetSize(eint64 size);
+	// ReadAt(),WriteAt(): the position of file WOULD NOT be changed,
+	// and it's safe to call them from several threads at the same time.
+	// Without pread()/pwrite() (Windows for instance), they're serialized by a locker
+	// and the position is moved then restored, so Read()/Write()/Seek() called by another
+	// thread meanwhile might see the position moved.
+	// WriteAt() appends the data instead when opened with E_OPEN_AT_END on some systems.
+	virtual ssize_t		ReadAt(eint64 pos, void *buffer, size_t size);
+	virtual ssize_t		WriteAt(eint64 pos, const void *buffer, size_t size);
+
+	virtual eint64		Seek(eint64 position, euint32 seek_mode);
+	virtual eint64		Position() const;
+	virtual e_status_t	SetSize(eint64 size);
+
+	// Map(): map the whole file into memory read-only, NULL when failed.
+	// The mapping lasts until the returned object deleted, it doesn't depend on the EFile.
+	EMemoryIO		*Map() const;
 
 	EFile&		operator=(const EFile &from);
 
 private:
 	void *fFD;
 	euint32 fMode;
+	void *fLocker;
 };
 
 #endif /* __cplusplus */
@@ -0,0 +1,205 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2006, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: Arena.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include "Arena.h"
+
+#define E_ARENA_ALIGNMENT	16
+#define E_ARENA_ALIGN(size)	(((size) + E_ARENA_ALIGNMENT - 1) & ~((size_t)E_ARENA_ALIGNMENT - 1))
+
+
+typedef struct e_arena_block {
+	struct e_arena_block *prev;
+	struct e_arena_block *next;
+	char *data;
+	size_t size;
+	size_t base; // the mark of data[0]
+	bool owned;
+} e_arena_block;
+
+#define E_ARENA_BLOCK_HEADER	E_ARENA_ALIGN(sizeof(e_arena_block))
+
+
+EArena::EArena(size_t blockSize)
+	: fFirst(NULL), fCurrent(NULL), fUsed(0), fBlockSize(blockSize > 0 ? blockSize : E_ARENA_DEFAULT_BLOCK_SIZE), fReserved(0)
+{
+}
+
+
+EArena::EArena(void *buffer, size_t bufferSize, size_t blockSize)
+	: fFirst(NULL), fCurrent(NULL), fUsed(0), fBlockSize(blockSize > 0 ? blockSize : E_ARENA_DEFAULT_BLOCK_SIZE), fReserved(0)
+{
+	size_t skip = (E_ARENA_ALIGNMENT - ((size_t)buffer & (E_ARENA_ALIGNMENT - 1))) & (E_ARENA_ALIGNMENT - 1);
+	if(buffer == NULL || bufferSize <= skip + E_ARENA_BLOCK_HEADER) return;
+
+	e_arena_block *block = (e_arena_block*)((char*)buffer + skip);
+	block->prev = block->next = NULL;
+	block->data = (char*)block + E_ARENA_BLOCK_HEADER;
+	block->size = bufferSize - skip - E_ARENA_BLOCK_HEADER;
+	block->base = 0;
+	block->owned = false;
+
+	fFirst = fCurrent = (void*)block;
+}
+
+
+EArena::~EArena()
+{
+	_FreeBlocks(fFirst);
+}
+
+
+void
+EArena::_FreeBlocks(void *first)
+{
+	e_arena_block *block = (e_arena_block*)first;
+	if(block == NULL) return;
+
+	if(block->prev != NULL) block->prev->next = NULL;
+	if(fFirst == first) fFirst = NULL;
+
+	while(block != NULL)
+	{
+		e_arena_block *next = block->next;
+		if(block->owned)
+		{
+			fReserved -= block->size;
+			free(block);
+		}
+		block = next;
+	}
+}
+
+
+void*
+EArena::Allocate(size_t size)
+{
+	if(size > ~((size_t)0) - E_ARENA_BLOCK_HEADER - E_ARENA_ALIGNMENT) return NULL;
+	size = E_ARENA_ALIGN(max_c(size, (size_t)1));
+
+	e_arena_block *block = (e_arena_block*)fCurrent;
+	if(block != NULL && block->size - fUsed >= size)
+	{
+		void *ptr = (void*)(block->data + fUsed);
+		fUsed += size;
+		return ptr;
+	}
+
+	// the block kept by Release()
+	e_arena_block *next = (block != NULL ? block->next : NULL);
+	if(next != NULL && next->size >= size)
+	{
+		fCurrent = (void*)next;
+		fUsed = size;
+		return (void*)next->data;
+	}
+	if(next != NULL) _FreeBlocks((void*)next);
+
+	size_t blockSize = max_c(fBlockSize, size);
+	if(blockSize > ~((size_t)0) - E_ARENA_BLOCK_HEADER) return NULL;
+
+	if((next = (e_arena_block*)malloc(E_ARENA_BLOCK_HEADER + blockSize)) == NULL) return NULL;
+	next->prev = block;
+	next->next = NULL;
+	next->data = (char*)next + E_ARENA_BLOCK_HEADER;
+	next->size = blockSize;
+	next->base = (block != NULL ? block->base + block->size : 0);
+	next->owned = true;
+
+	if(block != NULL) block->next = next;
+	else fFirst = (void*)next;
+
+	fReserved += blockSize;
+	fCurrent = (void*)next;
+	fUsed = size;
+
+	return (void*)next->data;
+}
+
+
+size_t
+EArena::Mark() const
+{
+	const e_arena_block *block = (const e_arena_block*)fCurrent;
+	return(block != NULL ? block->base + fUsed : 0);
+}
+
+
+void
+EArena::Release(size_t mark)
+{
+	e_arena_block *block = (e_arena_block*)fCurrent;
+	if(block == NULL) return;
+
+	while(block->base > mark && block->prev != NULL) block = block->prev;
+
+	fCurrent = (void*)block;
+	fUsed = (mark > block->base ? min_c(mark - block->base, block->size) : 0);
+}
+
+
+void
+EArena::Reset()
+{
+	e_arena_block *block = (e_arena_block*)fFirst;
+	if(block == NULL) return;
+
+	// keep the largest one of the other blocks, so the arena reset after every
+	// message doesn't go to heap again for the same large requests
+	e_arena_block *warm = NULL;
+	for(e_arena_block *b = block->next; b != NULL; b = b->next)
+		if(warm == NULL || b->size > warm->size) warm = b;
+
+	if(warm != NULL)
+	{
+		warm->prev->next = warm->next;
+		if(warm->next != NULL) warm->next->prev = warm->prev;
+	}
+
+	_FreeBlocks((void*)block->next);
+
+	if(warm != NULL)
+	{
+		warm->prev = block;
+		warm->next = NULL;
+		warm->base = block->base + block->size;
+		block->next = warm;
+	}
+
+	fCurrent = fFirst;
+	fUsed = 0;
+}
+
+
+size_t
+EArena::BytesReserved() const
+{
+	return fReserved;
+}
@@ -0,0 +1,82 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2006, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: Arena.h
+ * Description: EArena --- bump allocator for short-lived objects
+ *
+ * --------------------------------------------------------------------------*/
+
+#ifndef __ETK_ARENA_H__
+#define __ETK_ARENA_H__
+
+#include <etk/support/SupportDefs.h>
+
+#ifdef __cplusplus /* Just for C++ */
+
+#define E_ARENA_DEFAULT_BLOCK_SIZE	8192
+
+class _IMPEXP_ETK EArena {
+public:
+	// The memory is taken from blocks of "blockSize" bytes (or larger for the large request),
+	// it's never freed one by one but all together by Release() or Reset().
+	// "buffer" (usually on stack) is used before any block allocated, it must outlive the arena.
+	// EArena isn't thread-safe.
+	EArena(size_t blockSize = E_ARENA_DEFAULT_BLOCK_SIZE);
+	EArena(void *buffer, size_t bufferSize, size_t blockSize = E_ARENA_DEFAULT_BLOCK_SIZE);
+	~EArena();
+
+	// Allocate(): the memory returned is aligned for any type, the destructor of object
+	// placed in it must be called explicitly before Release().
+	void		*Allocate(size_t size);
+
+	// Mark(),Release(): free all the memory allocated after Mark() returned "mark",
+	// the blocks are kept for the next allocations.
+	size_t		Mark() const;
+	void		Release(size_t mark);
+
+	// Reset(): free all the memory allocated, keep the first block and the largest one of
+	// the others for the next allocations.
+	void		Reset();
+
+	// BytesReserved(): the bytes of blocks allocated from heap.
+	size_t		BytesReserved() const;
+
+private:
+	void *fFirst;
+	void *fCurrent;
+	size_t fUsed;
+	size_t fBlockSize;
+	size_t fReserved;
+
+	EArena(const EArena&);
+	EArena &operator=(const EArena&);
+
+	void _FreeBlocks(void *first);
+};
+
+#endif /* __cplusplus */
+
+#endif /* __ETK_ARENA_H__ */
+
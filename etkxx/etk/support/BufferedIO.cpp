@@ -0,0 +1,320 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2006, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: BufferedIO.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "BufferedIO.h"
+
+
+EBufferedIO::EBufferedIO(EPositionIO *stream, size_t bufferSize, bool ownsStream)
+	: EPositionIO(),
+	  fStream(stream), fOwnsStream(ownsStream),
+	  fBuffer(NULL), fBufferSize(bufferSize > 0 ? bufferSize : E_BUFFERED_IO_DEFAULT_BUFFER_SIZE),
+	  fBufferStart(E_INT64_CONSTANT(0)), fBufferLength(0), fDirtyStart(0), fDirtyEnd(0),
+	  fPosition(E_INT64_CONSTANT(0))
+{
+	if(fStream != NULL) fPosition = max_c(fStream->Position(), E_INT64_CONSTANT(0));
+}
+
+
+EBufferedIO::~EBufferedIO()
+{
+	Flush();
+
+	if(fBuffer != NULL) free(fBuffer);
+	if(fOwnsStream && fStream != NULL) delete fStream;
+}
+
+
+ssize_t
+EBufferedIO::_StreamReadAt(eint64 pos, void *buffer, size_t size)
+{
+	size_t nRead = 0;
+	ssize_t n = 0;
+
+	while(nRead < size)
+	{
+		if((n = fStream->ReadAt(pos + (eint64)nRead, (char*)buffer + nRead, size - nRead)) <= 0) break;
+		nRead += (size_t)n;
+	}
+
+	return((nRead > 0 || n >= 0) ? (ssize_t)nRead : n);
+}
+
+
+ssize_t
+EBufferedIO::_StreamWriteAt(eint64 pos, const void *buffer, size_t size)
+{
+	size_t nWritten = 0;
+	ssize_t n = 0;
+
+	while(nWritten < size)
+	{
+		if((n = fStream->WriteAt(pos + (eint64)nWritten, (const char*)buffer + nWritten, size - nWritten)) <= 0) break;
+		nWritten += (size_t)n;
+	}
+
+	return((nWritten > 0 || n >= 0) ? (ssize_t)nWritten : n);
+}
+
+
+e_status_t
+EBufferedIO::Flush()
+{
+	if(fStream == NULL) return E_NO_INIT;
+	if(fDirtyEnd <= fDirtyStart) return E_OK;
+
+	ssize_t n = _StreamWriteAt(fBufferStart + (eint64)fDirtyStart, fBuffer + fDirtyStart, fDirtyEnd - fDirtyStart);
+	if(n < (ssize_t)(fDirtyEnd - fDirtyStart))
+	{
+		if(n > 0) fDirtyStart += (size_t)n;
+		return E_ERROR;
+	}
+
+	fDirtyStart = fDirtyEnd = 0;
+	return E_OK;
+}
+
+
+ssize_t
+EBufferedIO::ReadAt(eint64 pos, void *buffer, size_t size)
+{
+	if(fStream == NULL) return E_NO_INIT;
+	if(buffer == NULL || pos < E_INT64_CONSTANT(0)) return E_BAD_VALUE;
+
+	size_t nRead = 0;
+
+	while(nRead < size)
+	{
+		eint64 curPos = pos + (eint64)nRead;
+
+		if(curPos >= fBufferStart && curPos < fBufferStart + (eint64)fBufferLength)
+		{
+			size_t offset = (size_t)(curPos - fBufferStart);
+			size_t n = min_c(size - nRead, fBufferLength - offset);
+			memcpy((char*)buffer + nRead, fBuffer + offset, n);
+			nRead += n;
+			continue;
+		}
+
+		// the stream must have the pending data before reading
+		if(Flush() != E_OK) break;
+
+		if(size - nRead >= fBufferSize)
+		{
+			// too large to be cached
+			ssize_t n = _StreamReadAt(curPos, (char*)buffer + nRead, size - nRead);
+			if(n < 0 && nRead == 0) return n;
+			if(n > 0) nRead += (size_t)n;
+			break;
+		}
+
+		if(fBuffer == NULL && (fBuffer = (char*)malloc(fBufferSize)) == NULL) return(nRead > 0 ? (ssize_t)nRead : E_NO_MEMORY);
+
+		// read ahead
+		ssize_t n = _StreamReadAt(curPos, fBuffer, fBufferSize);
+		fBufferStart = curPos;
+		fBufferLength = (n > 0 ? (size_t)n : 0);
+		if(n < 0 && nRead == 0) return n;
+		if(n <= 0) break;
+	}
+
+	return (ssize_t)nRead;
+}
+
+
+ssize_t
+EBufferedIO::WriteAt(eint64 pos, const void *buffer, size_t size)
+{
+	if(fStream == NULL) return E_NO_INIT;
+	if(buffer == NULL || pos < E_INT64_CONSTANT(0)) return E_BAD_VALUE;
+	if(size == 0) return 0;
+
+	if(size >= fBufferSize)
+	{
+		// too large to be buffered
+		if(Flush() != E_OK) return E_ERROR;
+		if(pos < fBufferStart + (eint64)fBufferLength && pos + (eint64)size > fBufferStart) fBufferLength = 0;
+		return _StreamWriteAt(pos, buffer, size);
+	}
+
+	bool inBuffer = (fBuffer != NULL &&
+			 pos >= fBufferStart && pos <= fBufferStart + (eint64)fBufferLength &&
+			 pos + (eint64)size <= fBufferStart + (eint64)fBufferSize);
+
+	// keep the dirty range contiguous
+	if(inBuffer && fDirtyEnd > fDirtyStart &&
+	   (pos > fBufferStart + (eint64)fDirtyEnd || pos + (eint64)size < fBufferStart + (eint64)fDirtyStart)) inBuffer = false;
+
+	if(!inBuffer)
+	{
+		if(Flush() != E_OK) return E_ERROR;
+		if(fBuffer == NULL && (fBuffer = (char*)malloc(fBufferSize)) == NULL) return _StreamWriteAt(pos, buffer, size);
+
+		fBufferStart = pos;
+		fBufferLength = 0;
+	}
+
+	size_t offset = (size_t)(pos - fBufferStart);
+	memcpy(fBuffer + offset, buffer, size);
+
+	if(fDirtyEnd <= fDirtyStart)
+	{
+		fDirtyStart = offset;
+		fDirtyEnd = offset + size;
+	}
+	else
+	{
+		fDirtyStart = min_c(fDirtyStart, offset);
+		fDirtyEnd = max_c(fDirtyEnd, offset + size);
+	}
+	if(fBufferLength < offset + size) fBufferLength = offset + size;
+
+	return (ssize_t)size;
+}
+
+
+ssize_t
+EBufferedIO::Read(void *buffer, size_t size)
+{
+	ssize_t retVal = ReadAt(fPosition, buffer, size);
+	if(retVal > 0) fPosition += (eint64)retVal;
+	return retVal;
+}
+
+
+ssize_t
+EBufferedIO::Write(const void *buffer, size_t size)
+{
+	ssize_t retVal = WriteAt(fPosition, buffer, size);
+	if(retVal > 0) fPosition += (eint64)retVal;
+	return retVal;
+}
+
+
+eint64
+EBufferedIO::Seek(eint64 position, euint32 seek_mode)
+{
+	if(fStream == NULL) return E_INT64_CONSTANT(-1);
+
+	eint64 newPos = E_INT64_CONSTANT(-1);
+
+	switch(seek_mode)
+	{
+		case E_SEEK_SET:
+			newPos = position;
+			break;
+
+		case E_SEEK_CUR:
+			newPos = fPosition + position;
+			break;
+
+		case E_SEEK_END:
+			{
+				// the size of stream includes the pending data
+				if(Flush() != E_OK) break;
+				eint64 savePosition = fStream->Position();
+				eint64 end = fStream->Seek(E_INT64_CONSTANT(0), E_SEEK_END);
+				if(savePosition >= E_INT64_CONSTANT(0)) fStream->Seek(savePosition, E_SEEK_SET);
+				if(end >= E_INT64_CONSTANT(0)) newPos = end + position;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	if(newPos < E_INT64_CONSTANT(0)) return E_INT64_CONSTANT(-1);
+
+	fPosition = newPos;
+	return fPosition;
+}
+
+
+eint64
+EBufferedIO::Position() const
+{
+	return fPosition;
+}
+
+
+e_status_t
+EBufferedIO::SetSize(eint64 size)
+{
+	if(fStream == NULL) return E_NO_INIT;
+	if(Flush() != E_OK) return E_ERROR;
+
+	fBufferLength = 0;
+	return fStream->SetSize(size);
+}
+
+
+e_status_t
+EBufferedIO::SetBufferSize(size_t bufferSize)
+{
+	if(bufferSize == 0) return E_BAD_VALUE;
+	if(bufferSize == fBufferSize) return E_OK;
+	if(fStream != NULL && Flush() != E_OK) return E_ERROR;
+
+	if(fBuffer != NULL) free(fBuffer);
+	fBuffer = NULL;
+	fBufferLength = 0;
+	fBufferSize = bufferSize;
+
+	return E_OK;
+}
+
+
+size_t
+EBufferedIO::BufferSize() const
+{
+	return fBufferSize;
+}
+
+
+EPositionIO*
+EBufferedIO::Stream() const
+{
+	return fStream;
+}
+
+
+bool
+EBufferedIO::OwnsStream() const
+{
+	return fOwnsStream;
+}
+
+
+void
+EBufferedIO::SetOwnsStream(bool ownsStream)
+{
+	fOwnsStream = ownsStream;
+}
@@ -0,0 +1,91 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2006, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: BufferedIO.h
+ * Description: EBufferedIO --- buffering for any EPositionIO
+ *
+ * --------------------------------------------------------------------------*/
+
+#ifndef __ETK_BUFFERED_IO_H__
+#define __ETK_BUFFERED_IO_H__
+
+#include <etk/support/DataIO.h>
+
+#ifdef __cplusplus /* Just for C++ */
+
+#define E_BUFFERED_IO_DEFAULT_BUFFER_SIZE	65536
+
+class _IMPEXP_ETK EBufferedIO : public EPositionIO {
+public:
+	// The data of "stream" is cached in one buffer: reading fills the buffer from the position
+	// given (read-ahead), writing goes to the buffer until it's flushed (write-behind).
+	// "stream" is reached by ReadAt()/WriteAt() only, so its position isn't changed,
+	// it's deleted together when "ownsStream" is true.
+	// EBufferedIO isn't thread-safe, don't use "stream" directly until the EBufferedIO deleted.
+	EBufferedIO(EPositionIO *stream, size_t bufferSize = E_BUFFERED_IO_DEFAULT_BUFFER_SIZE, bool ownsStream = false);
+	virtual ~EBufferedIO();
+
+	virtual ssize_t		Read(void *buffer, size_t size);
+	virtual ssize_t		Write(const void *buffer, size_t size);
+
+	// ReadAt(),WriteAt(): the position WOULD NOT be changed.
+	virtual ssize_t		ReadAt(eint64 pos, void *buffer, size_t size);
+	virtual ssize_t		WriteAt(eint64 pos, const void *buffer, size_t size);
+
+	virtual eint64		Seek(eint64 position, euint32 seek_mode);
+	virtual eint64		Position() const;
+	virtual e_status_t	SetSize(eint64 size);
+
+	// Flush(): write the pending data to the stream, the data read stays cached.
+	e_status_t		Flush();
+
+	// SetBufferSize(): flush and drop the cached data first.
+	e_status_t		SetBufferSize(size_t bufferSize);
+	size_t			BufferSize() const;
+
+	EPositionIO		*Stream() const;
+	bool			OwnsStream() const;
+	void			SetOwnsStream(bool ownsStream);
+
+private:
+	EPositionIO *fStream;
+	bool fOwnsStream;
+
+	char *fBuffer;
+	size_t fBufferSize;
+	eint64 fBufferStart; // position in stream of fBuffer[0]
+	size_t fBufferLength; // the valid bytes of fBuffer
+	size_t fDirtyStart; // the range of fBuffer to be written
+	size_t fDirtyEnd;
+	eint64 fPosition;
+
+	ssize_t			_StreamReadAt(eint64 pos, void *buffer, size_t size);
+	ssize_t			_StreamWriteAt(eint64 pos, const void *buffer, size_t size);
+};
+
+#endif /* __cplusplus */
+
+#endif /* __ETK_BUFFERED_IO_H__ */
+
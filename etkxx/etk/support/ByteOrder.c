@@ -27,10 +27,184 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <string.h>
+
 #include <etk/config.h>
 
 #include "ByteOrder.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define ETK_BYTE_ORDER_SSE2
+	#include <emmintrin.h>
+#endif
+
+#ifdef __SSSE3__
+	#define ETK_BYTE_ORDER_SSSE3
+	#include <tmmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define ETK_BYTE_ORDER_NEON
+	#include <arm_neon.h>
+#endif
+
+
+/*
+ * The blocks of 16 bytes go through the SIMD registers when possible,
+ * the rest are swapped one by one.
+ */
+_IMPEXP_ETK void e_swap_int16_array(void *dest, const void *src, size_t count)
+{
+	euint8 *d = (euint8*)dest;
+	const euint8 *s = (const euint8*)src;
+	euint16 v;
+
+#if defined(ETK_BYTE_ORDER_SSSE3)
+	const __m128i mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	for(; count >= 8; count -= 8, s += 16, d += 16)
+		_mm_storeu_si128((__m128i*)d, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask));
+#elif defined(ETK_BYTE_ORDER_SSE2)
+	for(; count >= 8; count -= 8, s += 16, d += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)s);
+		_mm_storeu_si128((__m128i*)d, _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)));
+	}
+#elif defined(ETK_BYTE_ORDER_NEON)
+	for(; count >= 8; count -= 8, s += 16, d += 16) vst1q_u8(d, vrev16q_u8(vld1q_u8(s)));
+#endif
+
+	for(; count > 0; count--, s += 2, d += 2)
+	{
+		memcpy(&v, s, 2);
+		v = E_SWAP_INT16(v);
+		memcpy(d, &v, 2);
+	}
+}
+
+
+_IMPEXP_ETK void e_swap_int32_array(void *dest, const void *src, size_t count)
+{
+	euint8 *d = (euint8*)dest;
+	const euint8 *s = (const euint8*)src;
+	euint32 v;
+
+#if defined(ETK_BYTE_ORDER_SSSE3)
+	const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	for(; count >= 4; count -= 4, s += 16, d += 16)
+		_mm_storeu_si128((__m128i*)d, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask));
+#elif defined(ETK_BYTE_ORDER_SSE2)
+	for(; count >= 4; count -= 4, s += 16, d += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)s);
+		x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+		x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_si128((__m128i*)d, _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)));
+	}
+#elif defined(ETK_BYTE_ORDER_NEON)
+	for(; count >= 4; count -= 4, s += 16, d += 16) vst1q_u8(d, vrev32q_u8(vld1q_u8(s)));
+#endif
+
+	for(; count > 0; count--, s += 4, d += 4)
+	{
+		memcpy(&v, s, 4);
+		v = E_SWAP_INT32(v);
+		memcpy(d, &v, 4);
+	}
+}
+
+
+_IMPEXP_ETK void e_swap_int64_array(void *dest, const void *src, size_t count)
+{
+	euint8 *d = (euint8*)dest;
+	const euint8 *s = (const euint8*)src;
+	euint64 v;
+
+#if defined(ETK_BYTE_ORDER_SSSE3)
+	const __m128i mask = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	for(; count >= 2; count -= 2, s += 16, d += 16)
+		_mm_storeu_si128((__m128i*)d, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask));
+#elif defined(ETK_BYTE_ORDER_SSE2)
+	for(; count >= 2; count -= 2, s += 16, d += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)s);
+		x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+		x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+		_mm_storeu_si128((__m128i*)d, _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)));
+	}
+#elif defined(ETK_BYTE_ORDER_NEON)
+	for(; count >= 2; count -= 2, s += 16, d += 16) vst1q_u8(d, vrev64q_u8(vld1q_u8(s)));
+#endif
+
+	for(; count > 0; count--, s += 8, d += 8)
+	{
+		memcpy(&v, s, 8);
+		v = E_SWAP_INT64(v);
+		memcpy(d, &v, 8);
+	}
+}
+
+
+#if defined(ETK_BYTE_ORDER_SSSE3) || defined(ETK_BYTE_ORDER_SSE2)
+/* reverses 5 pixels, the 16th byte belongs to the next pixel and stays as it was */
+static __m128i etk_swap_rgb24_block(__m128i x)
+{
+#ifdef ETK_BYTE_ORDER_SSSE3
+	return _mm_shuffle_epi8(x, _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15));
+#else
+	/* the first and the last channels shift 2 bytes to each other */
+	const __m128i first = _mm_setr_epi8(-1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, 0);
+	const __m128i last = _mm_slli_si128(first, 2);
+	const __m128i middle = _mm_xor_si128(_mm_or_si128(first, last), _mm_set1_epi8(-1));
+	__m128i y = _mm_or_si128(_mm_slli_si128(_mm_and_si128(x, first), 2), _mm_srli_si128(_mm_and_si128(x, last), 2));
+	return _mm_or_si128(y, _mm_and_si128(x, middle));
+#endif
+}
+#endif
+
+
+_IMPEXP_ETK void e_swap_rgb24_array(void *dest, const void *src, size_t count)
+{
+	euint8 *d = (euint8*)dest;
+	const euint8 *s = (const euint8*)src;
+	euint8 c;
+
+#if defined(ETK_BYTE_ORDER_SSSE3) || defined(ETK_BYTE_ORDER_SSE2)
+	if(count > 5)
+	{
+		/*
+		 * The blocks overlap by one byte, the next one is loaded before storing
+		 * the current one, so that swapping in place doesn't wait for the store.
+		 */
+		__m128i x = _mm_loadu_si128((const __m128i*)s);
+		for(; count > 10; count -= 5, s += 15, d += 15)
+		{
+			__m128i next = _mm_loadu_si128((const __m128i*)(s + 15));
+			_mm_storeu_si128((__m128i*)d, etk_swap_rgb24_block(x));
+			x = next;
+		}
+		_mm_storeu_si128((__m128i*)d, etk_swap_rgb24_block(x));
+		count -= 5; s += 15; d += 15;
+	}
+#elif defined(ETK_BYTE_ORDER_NEON)
+	for(; count >= 16; count -= 16, s += 48, d += 48)
+	{
+		uint8x16x3_t x = vld3q_u8(s);
+		uint8x16_t t = x.val[0];
+		x.val[0] = x.val[2];
+		x.val[2] = t;
+		vst3q_u8(d, x);
+	}
+#endif
+
+	for(; count > 0; count--, s += 3, d += 3)
+	{
+		c = s[0];
+		d[0] = s[2];
+		d[1] = s[1];
+		d[2] = c;
+	}
+}
+
 
 _IMPEXP_ETK e_status_t e_swap_data(e_type_code type, void *_data, size_t len, e_swap_action action)
 {
@@ -68,8 +242,7 @@ _IMPEXP_ETK e_status_t e_swap_data(e_type_code type, void *_data, size_t len, e_
 		case E_UINT16_TYPE:
 			if(len % 2 == 0)
 			{
-				euint16 *data = (euint16*)_data;
-				for(len = len / 2; len > 0; len--, data++) *data = E_SWAP_INT16(*data);
+				e_swap_int16_array(_data, _data, len / 2);
 				retVal = E_OK;
 			}
 			break;
@@ -78,8 +251,7 @@ _IMPEXP_ETK e_status_t e_swap_data(e_type_code type, void *_data, size_t len, e_
 		case E_UINT32_TYPE:
 			if(len % 4 == 0)
 			{
-				euint32 *data = (euint32*)_data;
-				for(len = len / 4; len > 0; len--, data++) *data = E_SWAP_INT32(*data);
+				e_swap_int32_array(_data, _data, len / 4);
 				retVal = E_OK;
 			}
 			break;
@@ -88,8 +260,7 @@ _IMPEXP_ETK e_status_t e_swap_data(e_type_code type, void *_data, size_t len, e_
 		case E_UINT64_TYPE:
 			if(len % 8 == 0)
 			{
-				euint64 *data = (euint64*)_data;
-				for(len = len / 8; len > 0; len--, data++) *data = E_SWAP_INT64(*data);
+				e_swap_int64_array(_data, _data, len / 8);
 				retVal = E_OK;
 			}
 			break;
@@ -100,8 +271,7 @@ _IMPEXP_ETK e_status_t e_swap_data(e_type_code type, void *_data, size_t len, e_
 		case E_POINT_TYPE:
 			if(len % 4 == 0)
 			{
-				float *data = (float*)_data;
-				for(len = len / 4; len > 0; len--, data++) *data = E_SWAP_FLOAT(*data);
+				e_swap_int32_array(_data, _data, len / 4);
 				retVal = E_OK;
 			}
 			break;
@@ -111,8 +281,7 @@ _IMPEXP_ETK e_status_t e_swap_data(e_type_code type, void *_data, size_t len, e_
 		case E_DOUBLE_TYPE:
 			if(len % 8 == 0)
 			{
-				double *data = (double*)_data;
-				for(len = len / 8; len > 0; len--, data++) *data = E_SWAP_DOUBLE(*data);
+				e_swap_int64_array(_data, _data, len / 8);
 				retVal = E_OK;
 			}
 			break;
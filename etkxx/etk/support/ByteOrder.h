@@ -50,6 +50,18 @@ _IMPEXP_ETK bool			e_is_type_swapped(e_type_code type);
 _IMPEXP_ETK float			e_swap_float(float value);
 _IMPEXP_ETK double			e_swap_double(double value);
 
+// e_swap_int16_array(),e_swap_int32_array(),e_swap_int64_array():
+// 	Swap the byte order of "count" items from "src" to "dest", neither needs to be aligned.
+// 	"dest" could be the same as "src" to swap in place, otherwise they must not overlap.
+// 	e_swap_int32_array() reorders the channels of 32-bit pixels as well, such as ARGB <-> BGRA.
+_IMPEXP_ETK void			e_swap_int16_array(void *dest, const void *src, size_t count);
+_IMPEXP_ETK void			e_swap_int32_array(void *dest, const void *src, size_t count);
+_IMPEXP_ETK void			e_swap_int64_array(void *dest, const void *src, size_t count);
+
+// e_swap_rgb24_array():
+// 	Reverses the channels of "count" 24-bit pixels from "src" to "dest", BGR <-> RGB.
+_IMPEXP_ETK void			e_swap_rgb24_array(void *dest, const void *src, size_t count);
+
 #define E_SWAP_INT16(v)			((((v) & 0xff) << 8) | (((v) >> 8) & 0xff))
 #define E_SWAP_INT32(v)			((E_SWAP_INT16((v) & 0xffff) << 16) | E_SWAP_INT16(((v) >> 16) & 0xffff))
 #define E_SWAP_INT64(v)			((E_SWAP_INT32((v) & 0xffffffff) << 32) | E_SWAP_INT32(((v) >> 32) & 0xffffffff))
@@ -65,8 +65,19 @@ EPositionIO::Write(const void *buffer, size_t size)
 }
 
 
-EMallocIO::EMallocIO()
-	: EPositionIO(), fData(NULL), fBlockSize(256), fMallocSize(0), fLength(0), fPosition(0)
+// the chunks of EMallocIO in chunked mode grow geometrically up to this size
+#define E_MALLOC_IO_MAX_CHUNK_SIZE	(16 * 1024 * 1024)
+
+typedef struct e_malloc_io_chunk {
+	char *data;
+	size_t offset;
+	size_t size;
+} e_malloc_io_chunk;
+
+
+EMallocIO::EMallocIO(bool chunked)
+	: EPositionIO(), fData(NULL), fBlockSize(256), fMallocSize(0), fLength(0), fPosition(0),
+	  fChunked(chunked), fChunks(NULL), fCountChunks(0)
 {
 }
 
@@ -74,6 +85,129 @@ EMallocIO::EMallocIO()
 EMallocIO::~EMallocIO()
 {
 	if(fData != NULL) free(fData);
+	_FreeChunks();
+}
+
+
+void
+EMallocIO::_FreeChunks()
+{
+	e_malloc_io_chunk *chunks = (e_malloc_io_chunk*)fChunks;
+	for(eint32 i = 0; i < fCountChunks; i++) free(chunks[i].data);
+	if(chunks != NULL) free(chunks);
+
+	fChunks = NULL;
+	fCountChunks = 0;
+}
+
+
+eint32
+EMallocIO::_FindChunk(size_t pos) const
+{
+	const e_malloc_io_chunk *chunks = (const e_malloc_io_chunk*)fChunks;
+	eint32 low = 0, high = fCountChunks - 1;
+
+	while(low < high)
+	{
+		eint32 mid = (low + high + 1) / 2;
+		if(chunks[mid].offset <= pos) low = mid;
+		else high = mid - 1;
+	}
+
+	return low;
+}
+
+
+void
+EMallocIO::_CopyChunks(size_t pos, void *buffer, size_t size, bool toChunks)
+{
+	e_malloc_io_chunk *chunks = (e_malloc_io_chunk*)fChunks;
+
+	for(eint32 i = _FindChunk(pos); size > 0; i++)
+	{
+		size_t offset = pos - chunks[i].offset;
+		size_t n = min_c(size, chunks[i].size - offset);
+
+		if(toChunks) memcpy(chunks[i].data + offset, buffer, n);
+		else memcpy(buffer, chunks[i].data + offset, n);
+
+		buffer = (char*)buffer + n;
+		pos += n;
+		size -= n;
+	}
+}
+
+
+e_status_t
+EMallocIO::_ResizeChunks(size_t size)
+{
+	e_malloc_io_chunk *chunks = (e_malloc_io_chunk*)fChunks;
+
+	while(fMallocSize < size)
+	{
+		if(fCountChunks % 16 == 0)
+		{
+			chunks = (e_malloc_io_chunk*)realloc(fChunks, sizeof(e_malloc_io_chunk) * (size_t)(fCountChunks + 16));
+			if(chunks == NULL) return E_NO_MEMORY;
+			fChunks = (void*)chunks;
+		}
+
+		// every new chunk is as large as all the chunks before
+		size_t chunkSize = max_c(fBlockSize, min_c(fMallocSize, (size_t)E_MALLOC_IO_MAX_CHUNK_SIZE));
+		if(chunkSize > ~((size_t)0) - fMallocSize) chunkSize = ~((size_t)0) - fMallocSize;
+
+		char *data = (char*)malloc(chunkSize);
+		if(data == NULL) return E_NO_MEMORY;
+
+		chunks[fCountChunks].data = data;
+		chunks[fCountChunks].offset = fMallocSize;
+		chunks[fCountChunks].size = chunkSize;
+		fCountChunks++;
+		fMallocSize += chunkSize;
+	}
+
+	// release the chunks beyond the data
+	while(fCountChunks > 1 && chunks[fCountChunks - 1].offset >= size)
+	{
+		fCountChunks--;
+		fMallocSize -= chunks[fCountChunks].size;
+		free(chunks[fCountChunks].data);
+	}
+
+	fLength = size;
+
+	return E_OK;
+}
+
+
+bool
+EMallocIO::_Coalesce()
+{
+	if(fCountChunks <= 1) return true;
+
+	size_t alloc_size = fLength;
+	if(alloc_size <= ~((size_t)0) - fBlockSize) alloc_size = (alloc_size + fBlockSize - 1) & ~(fBlockSize - 1);
+
+	char *data = (char*)malloc(alloc_size);
+	e_malloc_io_chunk *chunks = (e_malloc_io_chunk*)malloc(sizeof(e_malloc_io_chunk) * 16);
+	if(data == NULL || chunks == NULL)
+	{
+		if(data != NULL) free(data);
+		if(chunks != NULL) free(chunks);
+		return false;
+	}
+
+	_CopyChunks(0, data, fLength, false);
+	_FreeChunks();
+
+	chunks[0].data = data;
+	chunks[0].offset = 0;
+	chunks[0].size = alloc_size;
+	fChunks = (void*)chunks;
+	fCountChunks = 1;
+	fMallocSize = alloc_size;
+
+	return true;
 }
 
 
@@ -86,7 +220,8 @@ EMallocIO::ReadAt(eint64 pos, void *buffer, size_t size)
 	if(fPosition >= fLength) return 0;
 
 	size = min_c(size, fLength - fPosition);
-	if(memcpy(buffer, fData + fPosition, size) == NULL) return E_ERROR;
+	if(fChunked) _CopyChunks(fPosition, buffer, size, false);
+	else if(memcpy(buffer, fData + fPosition, size) == NULL) return E_ERROR;
 
 	fPosition += size;
 	return size;
@@ -104,7 +239,8 @@ EMallocIO::WriteAt(eint64 pos, const void *buffer, size_t size)
 	   EMallocIO::SetSize((eint64)(fPosition + size)) == E_OK ||
 	   (fMallocSize >= fPosition ? (size = min_c(size, fMallocSize - fPosition)) > 0 : false))
 	{
-		if(memcpy(fData + fPosition, buffer, size) == NULL) return E_ERROR;
+		if(fChunked) _CopyChunks(fPosition, (void*)buffer, size, true);
+		else if(memcpy(fData + fPosition, buffer, size) == NULL) return E_ERROR;
 		fPosition += size;
 		if(fLength < fPosition) fLength = fPosition;
 		return size;
@@ -121,12 +257,12 @@ EMallocIO::Seek(eint64 position, euint32 seek_mode)
 	switch(seek_mode)
 	{
 		case E_SEEK_SET:
-			if(!(position < 0 || position > (eint64)~((size_t)0)))
+			if(!(position < 0 || (euint64)position > (euint64)~((size_t)0)))
 				fPosition = (size_t)(retVal = position);
 			break;
 
 		case E_SEEK_CUR:
-			if(position < 0 ? (eint64)fPosition >= -position : position <= (eint64)(~((size_t)0) - fPosition))
+			if(position < 0 ? (eint64)fPosition >= -position : (euint64)position <= (euint64)(~((size_t)0) - fPosition))
 			{
 				if(position < 0) fPosition -= (size_t)(-position);
 				else fPosition += (size_t)position;
@@ -135,7 +271,7 @@ EMallocIO::Seek(eint64 position, euint32 seek_mode)
 			break;
 
 		case E_SEEK_END:
-			if(position < 0 ? (eint64)fLength >= -position : position <= (eint64)(~((size_t)0) - fLength))
+			if(position < 0 ? (eint64)fLength >= -position : (euint64)position <= (euint64)(~((size_t)0) - fLength))
 			{
 				if(position < 0) fPosition = fLength - (size_t)(-position);
 				else fPosition = fLength + (size_t)position;
@@ -166,17 +302,30 @@ EMallocIO::SetSize(eint64 size)
 	{
 		if(fData) free(fData);
 		fData = NULL;
+		_FreeChunks();
 		fPosition = fLength = fMallocSize = 0;
 		return E_OK;
 	}
 
+	if(fChunked)
+	{
+		if((euint64)size > (euint64)~((size_t)0)) return E_NO_MEMORY;
+		return _ResizeChunks((size_t)size);
+	}
+
 	eint64 alloc_size = size >= E_MAXINT64 - fBlockSize ?
 				E_MAXINT64 : ((size + (eint64)fBlockSize - 1) & ~((eint64)fBlockSize - 1));
 
-	if(alloc_size > (eint64)~((size_t)0)) alloc_size = (eint64)~((size_t)0);
+	// grow geometrically, so that appending costs amortized constant time
+	eint64 grow_size = alloc_size;
+	if(size > (eint64)fMallocSize && (eint64)fMallocSize < E_MAXINT64 / 2) grow_size = max_c(alloc_size, (eint64)fMallocSize * 2);
+
+	if((euint64)alloc_size > (euint64)~((size_t)0)) alloc_size = (eint64)~((size_t)0);
+	if((euint64)grow_size > (euint64)~((size_t)0)) grow_size = (eint64)~((size_t)0);
 	if(alloc_size != (eint64)fMallocSize)
 	{
-		char *data = (char*)realloc(fData, (size_t)alloc_size);
+		char *data = (char*)realloc(fData, (size_t)grow_size);
+		if(data == NULL && grow_size != alloc_size) data = (char*)realloc(fData, (size_t)(grow_size = alloc_size));
 		if(data == NULL)
 		{
 			if(size > (eint64)fMallocSize) return E_NO_MEMORY;
@@ -184,7 +333,7 @@ EMallocIO::SetSize(eint64 size)
 		else
 		{
 			fData = data;
-			fMallocSize = (size_t)alloc_size;
+			fMallocSize = (size_t)grow_size;
 		}
 	}
 
@@ -201,10 +350,21 @@ EMallocIO::SetBlockSize(size_t blocksize)
 }
 
 
+bool
+EMallocIO::IsChunked() const
+{
+	return fChunked;
+}
+
+
 const void*
 EMallocIO::Buffer() const
 {
-	return((const void*)fData);
+	if(!fChunked) return((const void*)fData);
+
+	// the segments are coalesced only once, it doesn't change the content
+	if(const_cast<EMallocIO*>(this)->_Coalesce() == false) return NULL;
+	return(fCountChunks > 0 ? (const void*)((const e_malloc_io_chunk*)fChunks)[0].data : NULL);
 }
 
 
@@ -215,6 +375,59 @@ EMallocIO::BufferLength()
 }
 
 
+eint32
+EMallocIO::CountSegments() const
+{
+	if(fLength == 0) return 0;
+	return(fChunked ? _FindChunk(fLength - 1) + 1 : 1);
+}
+
+
+const void*
+EMallocIO::SegmentAt(eint32 index, size_t *length) const
+{
+	if(index < 0 || index >= CountSegments()) return NULL;
+
+	if(!fChunked)
+	{
+		if(length) *length = fLength;
+		return((const void*)fData);
+	}
+
+	const e_malloc_io_chunk *chunk = (const e_malloc_io_chunk*)fChunks + index;
+	if(length) *length = min_c(chunk->size, fLength - chunk->offset);
+	return((const void*)chunk->data);
+}
+
+
+void*
+EMallocIO::Detach(size_t *length)
+{
+	void *data = NULL;
+
+	if(fChunked)
+	{
+		if(_Coalesce() == false) return NULL;
+		if(fCountChunks > 0)
+		{
+			data = (void*)((e_malloc_io_chunk*)fChunks)[0].data;
+			fCountChunks = 0;
+		}
+		_FreeChunks();
+	}
+	else
+	{
+		data = (void*)fData;
+		fData = NULL;
+	}
+
+	if(length) *length = fLength;
+	fPosition = fLength = fMallocSize = 0;
+
+	return data;
+}
+
+
 EMemoryIO::EMemoryIO(void *ptr, size_t length)
 	: EPositionIO(), fReadOnly(false), fBuffer((char*)ptr), fLen(length), fRealLen(length), fPosition(0)
 {
@@ -323,3 +536,17 @@ EMemoryIO::SetSize(eint64 size)
 	return E_OK;
 }
 
+
+const void*
+EMemoryIO::Buffer() const
+{
+	return((const void*)fBuffer);
+}
+
+
+size_t
+EMemoryIO::BufferLength() const
+{
+	return fLen;
+}
+
@@ -64,7 +64,10 @@ public:
 
 class _IMPEXP_ETK EMallocIO : public EPositionIO {
 public:
-	EMallocIO();
+	// chunked: the data lives in a list of chunks growing geometrically
+	// instead of one block growing by realloc(), so the data written is
+	// never copied on growth.
+	EMallocIO(bool chunked = false);
 	virtual ~EMallocIO();
 
 	virtual ssize_t		ReadAt(eint64 pos, void *buffer, size_t size);
@@ -75,15 +78,39 @@ public:
 	virtual e_status_t	SetSize(eint64 size);
 
 	void			SetBlockSize(size_t blocksize);
+	bool			IsChunked() const;
+
+	// Buffer(): in chunked mode, the chunks are coalesced into one first
 	const void		*Buffer() const;
 	size_t			BufferLength();
 
+	// CountSegments(),SegmentAt(): access the data without coalescing,
+	// the segments are valid until the next call of WriteAt(), SetSize(),
+	// Buffer() or Detach().
+	eint32			CountSegments() const;
+	const void		*SegmentAt(eint32 index, size_t *length) const;
+
+	// Detach(): hand the data over to the caller, who must free() it,
+	// and leave the object empty. It copies only when the data is in
+	// more than one chunk.
+	void			*Detach(size_t *length = NULL);
+
 private:
 	char *fData;
 	size_t fBlockSize;
 	size_t fMallocSize;
 	size_t fLength;
 	size_t fPosition;
+
+	bool fChunked;
+	void *fChunks;
+	eint32 fCountChunks;
+
+	void _FreeChunks();
+	eint32 _FindChunk(size_t pos) const;
+	void _CopyChunks(size_t pos, void *buffer, size_t size, bool toChunks);
+	e_status_t _ResizeChunks(size_t size);
+	bool _Coalesce();
 };
 
 
@@ -100,6 +127,9 @@ public:
 	virtual eint64		Position() const;
 	virtual e_status_t	SetSize(eint64 size);
 
+	const void		*Buffer() const;
+	size_t			BufferLength() const;
+
 private:
 	bool fReadOnly;
 	char *fBuffer;
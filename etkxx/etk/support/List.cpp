@@ -35,30 +35,43 @@
 
 #define MAX_LIST_COUNT	(E_MAXINT32 - 1)
 
+// the memory isn't released by removing items below this count of slots
+#define ETK_LIST_SHRINK_THRESHOLD	32
 
+
+// _Compact(): move the items to the beginning of the memory after removing from the front.
+void
+EList::_Compact()
+{
+	if(fHead == 0) return;
+
+	void **base = fObjects - fHead;
+	if(fItemCount > 0) memmove(base, fObjects, (size_t)fItemCount * sizeof(void*));
+	bzero(base + fItemCount, (size_t)fHead * sizeof(void*));
+
+	fObjects = base;
+	fItemReal += fHead;
+	fHead = 0;
+}
+
+
+// _Resize(): change the count of items, the slots from "fItemCount" to "fItemReal" always be NULL.
+//	The memory grows geometrically so that appending is amortized O(1), and it's released
+//	only when less than a quarter of it was used, so that adding/removing around the
+//	boundary doesn't realloc every time. It's kept when the list becomes empty, so a list
+//	used as a queue doesn't realloc for each item; MakeEmpty()/ShrinkToFit() release it.
+//	"fObjects" begins at "fHead" slots of the memory, RemoveItem(0) just moves it forward.
 bool
 EList::_Resize(eint32 count)
 {
 	if(count <= 0)
 	{
-		if(fMinimumCount > 0)
-		{
-			void **newObjects = (void**)realloc(fObjects, (size_t)(fMinimumCount + 1) * sizeof(void*));
-			if(newObjects != NULL)
-			{
-				fObjects = newObjects;
-				fItemReal = fMinimumCount + 1;
-			}
-		}
-		else
-		{
-			if(fObjects) free(fObjects);
-			fObjects = NULL;
-			fItemReal = 0;
-		}
+		if(fItemCount > 0) bzero(fObjects, (size_t)fItemCount * sizeof(void*));
 
+		fObjects -= fHead;
+		fItemReal += fHead;
+		fHead = 0;
 		fItemCount = 0;
-		if(fObjects) bzero(fObjects, sizeof(void*));
 
 		return true;
 	}
@@ -66,65 +79,89 @@ EList::_Resize(eint32 count)
 	{
 		return false;
 	}
-	else if(count <= fMinimumCount || count + 1 == fItemReal)
+	else if(count < fItemReal)
 	{
+		if(count >= fItemCount)
+		{
+			fItemCount = count;
+			return true;
+		}
+
+		bzero(fObjects + count, (size_t)(fItemCount - count) * sizeof(void*));
 		fItemCount = count;
-		bzero(fObjects + count, sizeof(void*));
+
+		if(fItemReal > ETK_LIST_SHRINK_THRESHOLD && count < (fItemReal >> 2) && fMinimumCount < (fItemReal >> 1) - 1)
+		{
+			_Compact();
+
+			eint32 nReal = max_c(fItemReal >> 1, fMinimumCount + 1);
+			void **newObjects = (void**)realloc(fObjects, (size_t)nReal * sizeof(void*));
+			if(newObjects != NULL)
+			{
+				fObjects = newObjects;
+				fItemReal = nReal;
+			}
+		}
+
 		return true;
 	}
 
-	void **newObjects = (void**)realloc(fObjects, (size_t)(count + 1) * sizeof(void*));
-	if(newObjects == NULL)
+	if(fHead > 0)
 	{
-		if(count + 1 < fItemReal)
+		_Compact();
+
+		// keep half of the memory free at least, so the next _Compact() is far away
+		if(count < (fItemReal >> 1))
 		{
-			bzero(fObjects + count, (size_t)(fItemReal - count) * sizeof(void*));
 			fItemCount = count;
 			return true;
 		}
-		else
-		{
-			return false;
-		}
 	}
 
-	if(fItemReal < count + 1)
-		bzero(newObjects + fItemReal, (size_t)(count + 1 - fItemReal) * sizeof(void*));
-	else
-		bzero(newObjects + count, sizeof(void*));
+	eint32 nReal = max_c(fItemReal, ETK_LIST_SHRINK_THRESHOLD >> 2);
+	while(nReal <= max_c(count, fItemReal) && nReal <= MAX_LIST_COUNT) nReal = (nReal > (MAX_LIST_COUNT >> 1) ? MAX_LIST_COUNT + 1 : (nReal << 1));
+
+	void **newObjects = (void**)realloc(fObjects, (size_t)nReal * sizeof(void*));
+	if(newObjects == NULL && count < fItemReal)
+	{
+		// not enough memory for the spare slots, but it's enough for the items
+		fItemCount = count;
+		return true;
+	}
+	else if(newObjects == NULL && nReal > count + 1)
+	{
+		// not enough memory for the spare slots, try the exact size
+		nReal = count + 1;
+		newObjects = (void**)realloc(fObjects, (size_t)nReal * sizeof(void*));
+	}
+	if(newObjects == NULL) return false;
+
+	bzero(newObjects + fItemReal, (size_t)(nReal - fItemReal) * sizeof(void*));
 
 	fObjects = newObjects;
 	fItemCount = count;
-	fItemReal = count + 1;
+	fItemReal = nReal;
 
 	return true;
 }
 
 
 EList::EList(eint32 initialAllocSize)
-	: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0)
+	: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0), fHead(0)
 {
 	if(initialAllocSize > 0 && initialAllocSize <= MAX_LIST_COUNT)
 	{
-		if(_Resize(initialAllocSize))
-		{
-			fMinimumCount = initialAllocSize;
-			fItemCount = 0;
-		}
+		if(Reserve(initialAllocSize)) fMinimumCount = initialAllocSize;
 	}
 }
 
 
 EList::EList(eint32 initialAllocSize, eint32 nullItems)
-	: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0)
+	: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0), fHead(0)
 {
 	if(initialAllocSize > 0 && initialAllocSize <= MAX_LIST_COUNT)
 	{
-		if(_Resize(initialAllocSize))
-		{
-			fMinimumCount = initialAllocSize;
-			fItemCount = 0;
-		}
+		if(Reserve(initialAllocSize)) fMinimumCount = initialAllocSize;
 	}
 
 	if(nullItems > 0 && nullItems <= MAX_LIST_COUNT) _Resize(nullItems);
@@ -132,7 +169,7 @@ EList::EList(eint32 initialAllocSize, eint32 nullItems)
 
 
 EList::EList(const EList& list)
-	: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0)
+	: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0), fHead(0)
 {
 	EList::operator=(list);
 }
@@ -140,34 +177,68 @@ EList::EList(const EList& list)
 
 EList::~EList()
 {
-	if(fObjects) free(fObjects);
+	if(fObjects) free(fObjects - fHead);
 }
 
 
 EList&
 EList::operator=(const EList &from)
 {
-	if(fObjects) free(fObjects);
+	if(fObjects) free(fObjects - fHead);
 	fObjects = NULL;
 	fItemCount = 0;
 	fItemReal = 0;
 	fMinimumCount = 0;
+	fHead = 0;
 
 	if(from.fMinimumCount > 0 && from.fMinimumCount <= MAX_LIST_COUNT)
 	{
-		if(_Resize(from.fMinimumCount))
-		{
-			fMinimumCount = from.fMinimumCount;
-			fItemCount = 0;
-		}
+		if(Reserve(from.fMinimumCount)) fMinimumCount = from.fMinimumCount;
 	}
 
+	Reserve(from.fItemCount);
 	EList::AddList(&from);
 
 	return *this;
 }
 
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+EList::EList(EList &&list)
+	: fObjects(list.fObjects), fItemCount(list.fItemCount), fItemReal(list.fItemReal),
+	  fMinimumCount(list.fMinimumCount), fHead(list.fHead)
+{
+	list.fObjects = NULL;
+	list.fItemCount = 0;
+	list.fItemReal = 0;
+	list.fMinimumCount = 0;
+	list.fHead = 0;
+}
+
+
+EList&
+EList::operator=(EList &&from)
+{
+	if(this == &from) return *this;
+
+	if(fObjects) free(fObjects - fHead);
+	fObjects = from.fObjects;
+	fItemCount = from.fItemCount;
+	fItemReal = from.fItemReal;
+	fMinimumCount = from.fMinimumCount;
+	fHead = from.fHead;
+
+	from.fObjects = NULL;
+	from.fItemCount = 0;
+	from.fItemReal = 0;
+	from.fMinimumCount = 0;
+	from.fHead = 0;
+
+	return *this;
+}
+#endif /* ETK_SUPPORT_RVALUE_REFERENCES */
+
+
 bool
 EList::AddItem(void *item)
 {
@@ -189,6 +260,16 @@ EList::AddItem(void *item, eint32 atIndex)
 	if(atIndex == fItemCount) return AddItem(item);
 	if(fItemCount >= MAX_LIST_COUNT) return false;
 
+	if(atIndex == 0 && fHead > 0)
+	{
+		fObjects--;
+		fHead--;
+		fItemReal++;
+		fItemCount++;
+		fObjects[0] = item;
+		return true;
+	}
+
 	if(!_Resize(fItemCount + 1)) return false;
 
 	if(memmove(fObjects + atIndex + 1, fObjects + atIndex, (fItemCount - (atIndex + 1)) * sizeof(void*)) == NULL)
@@ -288,6 +369,16 @@ EList::RemoveItem(eint32 index)
 
 	void *data = fObjects[index];
 
+	if(index == 0 && fItemCount > 1)
+	{
+		fObjects[0] = NULL;
+		fObjects++;
+		fHead++;
+		fItemReal--;
+		fItemCount--;
+		return data;
+	}
+
 	if(index < fItemCount - 1)
 	{
 		if(memmove(fObjects + index, fObjects + index + 1, (fItemCount - index - 1) * sizeof(void*)) == NULL) return NULL;
@@ -313,6 +404,16 @@ EList::RemoveItems(eint32 index, eint32 count)
 
 	if(count == 0) return true;
 
+	if(index == 0 && count < fItemCount)
+	{
+		bzero(fObjects, (size_t)count * sizeof(void*));
+		fObjects += count;
+		fHead += count;
+		fItemReal -= count;
+		fItemCount -= count;
+		return true;
+	}
+
 	if(index < (fItemCount - 1) && count != (fItemCount - index))
 	{
 		if(memmove(fObjects + index, fObjects + index + count, (fItemCount - index - count) * sizeof(void*)) == NULL) return false;
@@ -344,6 +445,61 @@ void
 EList::MakeEmpty()
 {
 	_Resize(0);
+	ShrinkToFit();
+}
+
+
+bool
+EList::Reserve(eint32 count)
+{
+	if(count > MAX_LIST_COUNT) return false;
+	if(count < fItemReal) return true;
+
+	_Compact();
+	if(count < fItemReal) return true;
+
+	void **newObjects = (void**)realloc(fObjects, (size_t)(count + 1) * sizeof(void*));
+	if(newObjects == NULL) return false;
+
+	bzero(newObjects + fItemReal, (size_t)(count + 1 - fItemReal) * sizeof(void*));
+
+	fObjects = newObjects;
+	fItemReal = count + 1;
+
+	return true;
+}
+
+
+void
+EList::ShrinkToFit()
+{
+	_Compact();
+
+	eint32 nReal = max_c(fItemCount, fMinimumCount);
+	if(nReal > 0) nReal++;
+
+	if(nReal >= fItemReal) return;
+
+	if(nReal == 0)
+	{
+		free(fObjects);
+		fObjects = NULL;
+		fItemReal = 0;
+		return;
+	}
+
+	void **newObjects = (void**)realloc(fObjects, (size_t)nReal * sizeof(void*));
+	if(newObjects == NULL) return;
+
+	fObjects = newObjects;
+	fItemReal = nReal;
+}
+
+
+eint32
+EList::Capacity() const
+{
+	return(fItemReal > 0 ? fItemReal - 1 : 0);
 }
 
 
@@ -50,6 +50,13 @@ public:
 	EList(const EList &list);
 	EList &operator=(const EList &from);
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	// moving takes the items of "list" without copying,
+	// "list" becomes empty after that.
+	EList(EList &&list);
+	EList &operator=(EList &&from);
+#endif
+
 	virtual ~EList();
 
 	bool	AddItem(void *item);
@@ -58,6 +65,8 @@ public:
 	bool	AddList(const EList *newItems, eint32 atIndex);
 
 	// RemoveItem(),RemoveItems(): the item WOULD NOT be destructed yet.
+	// 	Removing from the front takes O(1) time, so the list works as a FIFO queue,
+	// 	and AddItem(item, 0) reuses the room left by it.
 	bool	RemoveItem(void *item);
 	void	*RemoveItem(eint32 index);
 	bool	RemoveItems(eint32 index, eint32 count);
@@ -65,8 +74,19 @@ public:
 	// ReplaceItem(): the old item WOULD NOT be destructed yet.
 	bool	ReplaceItem(eint32 index, void *newItem, void **oldItem = NULL);
 
+	// MakeEmpty(): remove all the items and release the memory (down to the minimum count),
+	// 	removing the items one by one keeps the memory for the next items.
 	void	MakeEmpty();
 
+	// Reserve(),ShrinkToFit(),Capacity():
+	// 	Reserve() makes room for "count" items at least so that adding them doesn't
+	// 	reallocate; the list grows geometrically by itself, it's only a hint.
+	// 	ShrinkToFit() releases the spare memory down to the count of items
+	// 	(or the minimum count), Capacity() returns the count of items it can hold now.
+	bool	Reserve(eint32 count);
+	void	ShrinkToFit();
+	eint32	Capacity() const;
+
 	bool	SwapItems(eint32 indexA, eint32 indexB);
 	bool	MoveItem(eint32 fromIndex, eint32 toIndex);
 
@@ -93,8 +113,10 @@ private:
 	eint32 fItemCount;
 	eint32 fItemReal;
 	eint32 fMinimumCount;
+	eint32 fHead;
 
 	bool _Resize(eint32 count);
+	void _Compact();
 };
 
 #endif /* __cplusplus */
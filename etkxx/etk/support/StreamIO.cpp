@@ -27,6 +27,8 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <etk/kernel/Kernel.h>
+#include <etk/kernel/Debug.h>
 #include <etk/support/String.h>
 #include <etk/private/StandardIO.h>
 
@@ -46,14 +48,33 @@ _IMPEXP_ETK EStreamIO &EOut = _EOut;
 _IMPEXP_ETK EStreamIO &EErr = _EErr;
 
 
+typedef struct e_stream_buffer {
+	void *locker;
+	eint32 mode;
+	size_t size;
+	size_t length;
+	char *data; // allocated by the first writing
+} e_stream_buffer;
+
+
 EStreamIO::EStreamIO()
-	: EDataIO()
+	: EDataIO(), fBuffer(NULL)
 {
 }
 
 
 EStreamIO::~EStreamIO()
 {
+	e_stream_buffer *sBuffer = (e_stream_buffer*)fBuffer;
+	if(sBuffer == NULL) return;
+
+	if(sBuffer->length > 0)
+		ETK_WARNING("[SUPPORT]: %s --- %lu bytes unflushed.", __PRETTY_FUNCTION__, (unsigned long)sBuffer->length);
+
+	fBuffer = NULL;
+	if(sBuffer->data) free(sBuffer->data);
+	etk_delete_simple_locker(sBuffer->locker);
+	free(sBuffer);
 }
 
 
@@ -65,18 +86,195 @@ EStreamIO::Read(void *buffer, size_t size)
 
 
 ssize_t
-EStreamIO::Write(const void *buffer, size_t size)
+EStreamIO::DeviceWrite(const void *buffer, size_t size)
 {
 	return E_ERROR;
 }
 
 
+ssize_t
+EStreamIO::_DeviceWriteAll(const char *data, size_t size)
+{
+	size_t nWritten = 0;
+
+	while(nWritten < size)
+	{
+		ssize_t n = DeviceWrite(data + nWritten, size - nWritten);
+		if(n <= 0) return(nWritten > 0 ? (ssize_t)nWritten : (n < 0 ? n : E_ERROR));
+		nWritten += (size_t)n;
+	}
+
+	return (ssize_t)nWritten;
+}
+
+
+ssize_t
+EStreamIO::Write(const void *buffer, size_t size)
+{
+	e_stream_buffer *sBuffer = (e_stream_buffer*)fBuffer;
+
+	if(sBuffer == NULL || sBuffer->mode == E_STREAM_UNBUFFERED) return DeviceWrite(buffer, size);
+	if(buffer == NULL || size == 0) return 0;
+
+	etk_lock_simple_locker(sBuffer->locker);
+
+	if(sBuffer->data == NULL)
+	{
+		if((sBuffer->data = (char*)malloc(sBuffer->size)) == NULL)
+		{
+			etk_unlock_simple_locker(sBuffer->locker);
+			return DeviceWrite(buffer, size);
+		}
+	}
+
+	ssize_t retVal = (ssize_t)size;
+
+	if(sBuffer->length + size > sBuffer->size)
+	{
+		ssize_t n = _DeviceWriteAll(sBuffer->data, sBuffer->length);
+		if(n < (ssize_t)sBuffer->length)
+		{
+			// keep what's left, the data given is refused
+			if(n > 0) memmove(sBuffer->data, sBuffer->data + n, sBuffer->length - (size_t)n);
+			if(n > 0) sBuffer->length -= (size_t)n;
+			etk_unlock_simple_locker(sBuffer->locker);
+			return(n < 0 ? n : E_ERROR);
+		}
+		sBuffer->length = 0;
+
+		if(size >= sBuffer->size)
+		{
+			// too large to be buffered
+			retVal = _DeviceWriteAll((const char*)buffer, size);
+			etk_unlock_simple_locker(sBuffer->locker);
+			return retVal;
+		}
+	}
+
+	memcpy(sBuffer->data + sBuffer->length, buffer, size);
+	sBuffer->length += size;
+
+	if(sBuffer->mode == E_STREAM_LINE_BUFFERED && memchr(buffer, '\n', size) != NULL)
+	{
+		ssize_t n = _DeviceWriteAll(sBuffer->data, sBuffer->length);
+		if(n > 0 && (size_t)n < sBuffer->length) memmove(sBuffer->data, sBuffer->data + n, sBuffer->length - (size_t)n);
+		if(n > 0) sBuffer->length -= (size_t)n;
+	}
+
+	etk_unlock_simple_locker(sBuffer->locker);
+
+	return retVal;
+}
+
+
+e_status_t
+EStreamIO::Flush()
+{
+	e_stream_buffer *sBuffer = (e_stream_buffer*)fBuffer;
+	if(sBuffer == NULL) return E_OK;
+
+	e_status_t retVal = E_OK;
+
+	etk_lock_simple_locker(sBuffer->locker);
+	if(sBuffer->length > 0)
+	{
+		ssize_t n = _DeviceWriteAll(sBuffer->data, sBuffer->length);
+		if(n < (ssize_t)sBuffer->length)
+		{
+			if(n > 0) memmove(sBuffer->data, sBuffer->data + n, sBuffer->length - (size_t)n);
+			if(n > 0) sBuffer->length -= (size_t)n;
+			retVal = E_ERROR;
+		}
+		else
+		{
+			sBuffer->length = 0;
+		}
+	}
+	etk_unlock_simple_locker(sBuffer->locker);
+
+	return retVal;
+}
+
+
+e_status_t
+EStreamIO::SetBuffering(eint32 mode, size_t bufferSize)
+{
+	if(mode < E_STREAM_UNBUFFERED || mode > E_STREAM_FULLY_BUFFERED) return E_BAD_VALUE;
+	if(bufferSize == 0) bufferSize = E_STREAM_DEFAULT_BUFFER_SIZE;
+
+	e_stream_buffer *sBuffer = (e_stream_buffer*)fBuffer;
+	if(sBuffer == NULL)
+	{
+		if(mode == E_STREAM_UNBUFFERED) return E_OK;
+
+		if((sBuffer = (e_stream_buffer*)malloc(sizeof(e_stream_buffer))) == NULL) return E_NO_MEMORY;
+		if((sBuffer->locker = etk_create_simple_locker()) == NULL)
+		{
+			free(sBuffer);
+			return E_NO_MEMORY;
+		}
+
+		sBuffer->mode = mode;
+		sBuffer->size = bufferSize;
+		sBuffer->length = 0;
+		sBuffer->data = NULL;
+		fBuffer = (void*)sBuffer;
+
+		return E_OK;
+	}
+
+	if(Flush() != E_OK) return E_ERROR;
+
+	etk_lock_simple_locker(sBuffer->locker);
+	if(sBuffer->size != bufferSize && sBuffer->data != NULL)
+	{
+		free(sBuffer->data);
+		sBuffer->data = NULL;
+	}
+	sBuffer->mode = mode;
+	sBuffer->size = bufferSize;
+	etk_unlock_simple_locker(sBuffer->locker);
+
+	return E_OK;
+}
+
+
+eint32
+EStreamIO::BufferingMode() const
+{
+	const e_stream_buffer *sBuffer = (const e_stream_buffer*)fBuffer;
+	return(sBuffer == NULL ? E_STREAM_UNBUFFERED : sBuffer->mode);
+}
+
+
+size_t
+EStreamIO::BufferSize() const
+{
+	const e_stream_buffer *sBuffer = (const e_stream_buffer*)fBuffer;
+	return(sBuffer == NULL || sBuffer->mode == E_STREAM_UNBUFFERED ? 0 : sBuffer->size);
+}
+
+
+static void etk_stream_write_int(EStreamIO *stream, eint64 value)
+{
+	char buf[E_FORMAT_NUMBER_MAX];
+	eint32 len = e_format_int64(buf, value);
+	stream->Write(buf, (size_t)len);
+}
+
+
+static void etk_stream_write_uint(EStreamIO *stream, euint64 value)
+{
+	char buf[E_FORMAT_NUMBER_MAX];
+	eint32 len = e_format_uint64(buf, value, 10, false);
+	stream->Write(buf, (size_t)len);
+}
+
+
 EStreamIO&
 EStreamIO::operator<<(eint8 value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	etk_stream_write_int(this, value);
 	return *this;
 }
 
@@ -84,9 +282,7 @@ EStreamIO::operator<<(eint8 value)
 EStreamIO&
 EStreamIO::operator<<(euint8 value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	etk_stream_write_uint(this, value);
 	return *this;
 }
 
@@ -94,9 +290,7 @@ EStreamIO::operator<<(euint8 value)
 EStreamIO&
 EStreamIO::operator<<(eint16 value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	etk_stream_write_int(this, value);
 	return *this;
 }
 
@@ -104,9 +298,7 @@ EStreamIO::operator<<(eint16 value)
 EStreamIO&
 EStreamIO::operator<<(euint16 value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	etk_stream_write_uint(this, value);
 	return *this;
 }
 
@@ -114,9 +306,7 @@ EStreamIO::operator<<(euint16 value)
 EStreamIO&
 EStreamIO::operator<<(eint32 value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	etk_stream_write_int(this, value);
 	return *this;
 }
 
@@ -124,9 +314,7 @@ EStreamIO::operator<<(eint32 value)
 EStreamIO&
 EStreamIO::operator<<(euint32 value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	etk_stream_write_uint(this, value);
 	return *this;
 }
 
@@ -134,9 +322,7 @@ EStreamIO::operator<<(euint32 value)
 EStreamIO&
 EStreamIO::operator<<(eint64 value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	etk_stream_write_int(this, value);
 	return *this;
 }
 
@@ -144,9 +330,7 @@ EStreamIO::operator<<(eint64 value)
 EStreamIO&
 EStreamIO::operator<<(euint64 value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	etk_stream_write_uint(this, value);
 	return *this;
 }
 
@@ -154,9 +338,9 @@ EStreamIO::operator<<(euint64 value)
 EStreamIO&
 EStreamIO::operator<<(float value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	char buf[E_FORMAT_NUMBER_MAX];
+	eint32 len = e_format_float(buf, value);
+	Write(buf, (size_t)len);
 	return *this;
 }
 
@@ -164,9 +348,9 @@ EStreamIO::operator<<(float value)
 EStreamIO&
 EStreamIO::operator<<(double value)
 {
-	EString str;
-	str << value;
-	Write(str.String(), str.Length());
+	char buf[E_FORMAT_NUMBER_MAX];
+	eint32 len = e_format_double(buf, value);
+	Write(buf, (size_t)len);
 	return *this;
 }
 
@@ -174,9 +358,9 @@ EStreamIO::operator<<(double value)
 EStreamIO&
 EStreamIO::operator<<(const void *value)
 {
-	EString str;
-	str.AppendFormat("%p", value);
-	Write(str.String(), str.Length());
+	char buf[E_FORMAT_NUMBER_MAX + 2] = "0x";
+	eint32 len = e_format_uint64(buf + 2, (euint64)(size_t)value, 16, false);
+	Write(buf, (size_t)len + 2);
 	return *this;
 }
 
@@ -36,14 +36,38 @@
 
 class EString;
 
+/* modes for EStreamIO::SetBuffering() */
+enum {
+	E_STREAM_UNBUFFERED = 0,
+	E_STREAM_LINE_BUFFERED,
+	E_STREAM_FULLY_BUFFERED
+};
+
+#define E_STREAM_DEFAULT_BUFFER_SIZE	4096
+
 class _IMPEXP_ETK EStreamIO : public EDataIO {
 public:
 	EStreamIO();
 	virtual ~EStreamIO();
 
 	virtual ssize_t		Read(void *buffer, size_t size);
+
+	// Write(): goes to DeviceWrite() directly when unbuffered,
+	// otherwise the data is kept in the buffer until:
+	// 	the buffer is full;
+	// 	a new line written when E_STREAM_LINE_BUFFERED;
+	// 	Flush() called or the stream destructed.
+	// The appending is thread-safe.
 	virtual ssize_t		Write(const void *buffer, size_t size);
 
+	// SetBuffering(): E_STREAM_UNBUFFERED by default, the pending data is flushed first.
+	// "bufferSize" of 0 means E_STREAM_DEFAULT_BUFFER_SIZE.
+	e_status_t		SetBuffering(eint32 mode, size_t bufferSize = 0);
+	eint32			BufferingMode() const;
+	size_t			BufferSize() const;
+
+	e_status_t		Flush();
+
 	EStreamIO 		&operator<<(eint8 value);
 	EStreamIO 		&operator<<(euint8 value);
 	EStreamIO 		&operator<<(eint16 value);
@@ -62,6 +86,17 @@ public:
 	EStreamIO 		&operator<<(EStreamIO &stream);
 
 	// TODO: operator>>()
+
+protected:
+	// DeviceWrite(): write to the device without buffering.
+	// The class overriding it must call Flush() in its destructor, because
+	// the destructor of EStreamIO can't reach the derived one any more.
+	virtual ssize_t		DeviceWrite(const void *buffer, size_t size);
+
+private:
+	void *fBuffer;
+
+	ssize_t			_DeviceWriteAll(const char *data, size_t size);
 };
 
 extern _IMPEXP_ETK EStreamIO& endl;
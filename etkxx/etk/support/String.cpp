@@ -37,9 +37,40 @@
 
 #include <etk/config.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define ETK_STRING_SSE2
+	#include <emmintrin.h>
+#endif
+
 #include "String.h"
 #include "StringArray.h"
 
+// the character index of EString, see EString::CharAt()
+#define ETK_STRING_CHAR_INDEX_STEP	64
+#define ETK_STRING_CHAR_INDEX_MIN	64 // the shorter string is scanned without index
+
+// The index is built at once and never changed after it was published, so the const string
+// could be read by several threads; the changing methods free it.
+typedef struct e_string_char_index {
+	eint32 nbytes;		// the bytes until NUL
+	eint32 nchars;		// the characters within them
+	eint32 count;
+	eint32 offsets[1];	// byte offset of the (i * ETK_STRING_CHAR_INDEX_STEP)th character
+} e_string_char_index;
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#define etk_string_cas_ptr(ptr, oldValue, newValue)	\
+	(InterlockedCompareExchangePointer((PVOID volatile*)(ptr), (PVOID)(newValue), (PVOID)(oldValue)) == (PVOID)(oldValue))
+#define etk_string_load_ptr(ptr)			InterlockedCompareExchangePointer((PVOID volatile*)(ptr), NULL, NULL)
+#elif defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+#define etk_string_cas_ptr(ptr, oldValue, newValue)	__sync_bool_compare_and_swap(ptr, oldValue, newValue)
+#define etk_string_load_ptr(ptr)			__atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#elif defined(__GNUC__)
+#define etk_string_cas_ptr(ptr, oldValue, newValue)	__sync_bool_compare_and_swap(ptr, oldValue, newValue)
+#define etk_string_load_ptr(ptr)			__sync_val_compare_and_swap(ptr, NULL, NULL)
+#endif
+
 #ifndef HAVE_VA_COPY
 	#ifdef HAVE___VA_COPY
 		#define va_copy(a, b)		__va_copy(a, b)
@@ -74,6 +105,10 @@
 	#endif
 #endif
 
+#ifdef _MSC_VER
+	#define snprintf		_snprintf
+#endif
+
 #ifndef HAVE_STRCASECMP
 	#ifdef _MSC_VER
 	#define e_strcasecmp(a, b)	_stricmp(a, b)
@@ -161,136 +196,327 @@ _IMPEXP_ETK char* EStrdup(const char* src, eint32 length)
 }
 
 
-#ifndef HAVE_STRCASESTR
-static char* e_strcasestr(const char *haystack, const char *needle)
+// e_fold_case(): ASCII only as strncasecmp() of "C" locale
+static inline unsigned char e_fold_case(unsigned char c)
 {
-	if(!haystack || !needle) return NULL;
-
-	size_t needle_len = strlen(needle);
-	size_t haystack_len = strlen(haystack);
+	return((c >= 'A' && c <= 'Z') ? (c | 0x20) : c);
+}
 
-	if(needle_len == 0) return (char*)haystack;
-	if(haystack_len < needle_len) return NULL;
 
-	const char *tmp = haystack;
-	const char *end = haystack + haystack_len - needle_len;
+static inline bool e_memcaseeq(const unsigned char *a, const unsigned char *b, size_t n)
+{
+	for(size_t i = 0; i < n; i++) if(e_fold_case(a[i]) != e_fold_case(b[i])) return false;
+	return true;
+}
 
-	while(*tmp && tmp <= end)
-	{
-		if(e_strncasecmp(tmp, needle, needle_len) == 0) return (char*)tmp;
-		tmp++;
-	}
 
-	return NULL;
+#ifdef ETK_STRING_SSE2
+static inline int e_lowest_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+	return __builtin_ctz(mask);
+#else
+	int n = 0;
+	while((mask & 1) == 0) {mask >>= 1; n++;}
+	return n;
+#endif
 }
+
+
+static inline int e_highest_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+	return 31 - __builtin_clz(mask);
 #else
-#define e_strcasestr(a, b)	strcasestr(a, b)
+	int n = 31;
+	while((mask & 0x80000000) == 0) {mask <<= 1; n--;}
+	return n;
+#endif
+}
+
+
+static inline __m128i e_fold_case_epi8(__m128i v)
+{
+	// the bytes >= 0x80 are negative, so they aren't within 'A'~'Z'
+	__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), v));
+	return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
 #endif
 
 
-#ifndef HAVE_STRRSTR
-static char* e_strrstr(const char *haystack, const char *needle)
+// e_memmem(): find the first "needle" within "haystack" which is "haystack_len" bytes.
+//	The first and the last byte of "needle" are compared with 16 positions at once,
+//	the rest of "needle" is compared only at the positions matched.
+static const char* e_memmem(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len, bool ignore_case)
 {
-	if(!haystack || !needle) return NULL;
+	if(needle_len == 0) return haystack;
+	if(haystack == NULL || haystack_len < needle_len) return NULL;
+
+	const unsigned char *h = (const unsigned char*)haystack;
+	const unsigned char *n = (const unsigned char*)needle;
 
-	size_t needle_len = strlen(needle);
-	size_t haystack_len = strlen(haystack);
+	if(needle_len == 1 && !ignore_case) return (const char*)memchr(h, *n, haystack_len);
 
-	if(needle_len == 0) return (char*)haystack;
-	if(haystack_len < needle_len) return NULL;
+	unsigned char first = n[0], last = n[needle_len - 1];
+	if(ignore_case) {first = e_fold_case(first); last = e_fold_case(last);}
+
+	size_t count = haystack_len - needle_len + 1;
+	size_t i = 0;
+
+#ifdef ETK_STRING_SSE2
+	const __m128i vFirst = _mm_set1_epi8((char)first);
+	const __m128i vLast = _mm_set1_epi8((char)last);
+
+	for(; i + 16 <= count; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(h + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(h + i + needle_len - 1));
+		if(ignore_case) {a = e_fold_case_epi8(a); b = e_fold_case_epi8(b);}
 
-	const char *tmp = haystack + haystack_len - needle_len;
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, vFirst), _mm_cmpeq_epi8(b, vLast)));
+		while(mask != 0)
+		{
+			const unsigned char *p = h + i + e_lowest_bit(mask);
+			if(ignore_case ? e_memcaseeq(p + 1, n + 1, needle_len - 1) : memcmp(p + 1, n + 1, needle_len - 1) == 0)
+				return (const char*)p;
+			mask &= mask - 1;
+		}
+	}
+#endif
 
-	while(*tmp && tmp >= haystack)
+	if(!ignore_case)
+	{
+		while(i < count)
+		{
+			const unsigned char *p = (const unsigned char*)memchr(h + i, first, count - i);
+			if(p == NULL) break;
+			if(p[needle_len - 1] == last && memcmp(p + 1, n + 1, needle_len - 1) == 0) return (const char*)p;
+			i = (size_t)(p - h) + 1;
+		}
+	}
+	else
 	{
-		if(strncmp(tmp, needle, needle_len) == 0) return (char*)tmp;
-		tmp--;
+		for(; i < count; i++)
+		{
+			if(e_fold_case(h[i]) != first || e_fold_case(h[i + needle_len - 1]) != last) continue;
+			if(e_memcaseeq(h + i + 1, n + 1, needle_len - 1)) return (const char*)(h + i);
+		}
 	}
 
 	return NULL;
 }
+
+
+// e_memrchr_raw(): find the last "c" within "s" which is "len" bytes
+static inline const char* e_memrchr_raw(const char *s, char c, size_t len)
+{
+#ifdef HAVE_MEMRCHR
+	return (const char*)memrchr(s, c, len);
 #else
-#define e_strrstr(a, b)		strrstr(a, b)
+	const unsigned char *p = (const unsigned char*)s;
+
+#ifdef ETK_STRING_SSE2
+	const __m128i vC = _mm_set1_epi8(c);
+
+	for(; len >= 16; len -= 16)
+	{
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + len - 16)), vC));
+		if(mask != 0) return (const char*)(p + len - 16 + e_highest_bit(mask));
+	}
+#endif
+
+	while(len > 0) if(p[--len] == (unsigned char)c) return (const char*)(p + len);
+	return NULL;
 #endif
+}
 
 
-#ifndef HAVE_STRRCASESTR
-static char* e_strrcasestr(const char *haystack, const char *needle)
+// e_memrmem(): find the last "needle" within "haystack" which is "haystack_len" bytes,
+//	it works like e_memmem() from the end.
+static const char* e_memrmem(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len, bool ignore_case)
 {
-	if(!haystack || !needle) return NULL;
+	if(needle_len == 0) return haystack;
+	if(haystack == NULL || haystack_len < needle_len) return NULL;
+
+	const unsigned char *h = (const unsigned char*)haystack;
+	const unsigned char *n = (const unsigned char*)needle;
+
+	if(needle_len == 1 && !ignore_case) return e_memrchr_raw(haystack, (char)*n, haystack_len);
 
-	size_t needle_len = strlen(needle);
-	size_t haystack_len = strlen(haystack);
+	unsigned char first = n[0], last = n[needle_len - 1];
+	if(ignore_case) {first = e_fold_case(first); last = e_fold_case(last);}
 
-	if(needle_len == 0) return (char*)haystack;
-	if(haystack_len < needle_len) return NULL;
+	// the positions before "i" are left to check
+	size_t i = haystack_len - needle_len + 1;
 
-	const char *tmp = haystack + haystack_len - needle_len;
+#ifdef ETK_STRING_SSE2
+	const __m128i vFirst = _mm_set1_epi8((char)first);
+	const __m128i vLast = _mm_set1_epi8((char)last);
 
-	while(*tmp && tmp >= haystack)
+	for(; i >= 16; i -= 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(h + i - 16));
+		__m128i b = _mm_loadu_si128((const __m128i*)(h + i - 16 + needle_len - 1));
+		if(ignore_case) {a = e_fold_case_epi8(a); b = e_fold_case_epi8(b);}
+
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, vFirst), _mm_cmpeq_epi8(b, vLast)));
+		while(mask != 0)
+		{
+			int k = e_highest_bit(mask);
+			const unsigned char *p = h + i - 16 + k;
+			if(ignore_case ? e_memcaseeq(p + 1, n + 1, needle_len - 1) : memcmp(p + 1, n + 1, needle_len - 1) == 0)
+				return (const char*)p;
+			mask &= ~(1U << k);
+		}
+	}
+#endif
+
+	if(!ignore_case)
+	{
+		while(i > 0)
+		{
+			const unsigned char *p = (const unsigned char*)e_memrchr_raw((const char*)h, (char)first, i);
+			if(p == NULL) break;
+			if(p[needle_len - 1] == last && memcmp(p + 1, n + 1, needle_len - 1) == 0) return (const char*)p;
+			i = (size_t)(p - h);
+		}
+	}
+	else
 	{
-		if(e_strncasecmp(tmp, needle, needle_len) == 0) return (char*)tmp;
-		tmp--;
+		for(; i > 0; i--)
+		{
+			const unsigned char *p = h + i - 1;
+			if(e_fold_case(*p) != first || e_fold_case(p[needle_len - 1]) != last) continue;
+			if(e_memcaseeq(p + 1, n + 1, needle_len - 1)) return (const char*)p;
+		}
 	}
 
 	return NULL;
 }
-#else
-#define e_strrcasestr(a, b)	strrcasestr(a, b)
-#endif
 
 
-#ifndef HAVE_STRCASECHR
-static char* e_strcasechr(const char *s, int c)
+static const char* e_memcasechr(const char *s, size_t len, char c)
 {
-	if(s == NULL || *s == 0 || c == 0) return NULL;
+	if(s == NULL) return NULL;
 
-	const char *tmp = strchr(s, tolower(c));
-	if(tmp == NULL) tmp = strchr(s, toupper(c));
+	char lower = (char)e_fold_case((unsigned char)c);
+	char upper = (char)((lower >= 'a' && lower <= 'z') ? (lower & ~0x20) : lower);
 
-	return (char*)tmp;
+	const char *found = (const char*)memchr(s, lower, len);
+	if(upper == lower) return found;
+
+	// the upper case one before "found"
+	const char *tmp = (const char*)memchr(s, upper, (found == NULL ? len : (size_t)(found - s)));
+	return(tmp != NULL ? tmp : found);
 }
-#else
-#define e_strcasechr(a, b)	strcasechr(a, b)
-#endif
 
 
-#ifndef HAVE_STRRCASECHR
-static char* e_strrcasechr(const char *s, int c)
+static const char* e_memrchr(const char *s, size_t len, char c, bool ignore_case)
 {
-	if(s == NULL || *s == 0 || c == 0) return NULL;
+	if(s == NULL) return NULL;
+	if(!ignore_case) return e_memrchr_raw(s, c, len);
+
+	char lower = (char)e_fold_case((unsigned char)c);
+	char upper = (char)((lower >= 'a' && lower <= 'z') ? (lower & ~0x20) : lower);
 
-	const char *tmp = strrchr(s, tolower(c));
-	if(tmp == NULL) tmp = strrchr(s, toupper(c));
+	const char *found = e_memrchr_raw(s, lower, len);
+	if(upper == lower) return found;
 
-	return (char*)tmp;
+	// the upper case one after "found"
+	const char *from = (found == NULL ? s : found + 1);
+	const char *tmp = e_memrchr_raw(from, upper, len - (size_t)(from - s));
+	return(tmp != NULL ? tmp : found);
 }
-#else
-#define e_strrcasechr(a, b)	strrcasechr(a, b)
-#endif
 
 
 #define MAX_STRING_LENGTH	(E_MAXINT32 - 1)
 
 
+// the header in front of the buffer on the heap, it holds what only the long string needs
+typedef struct e_string_heap {
+	void * volatile charIndex;	// e_string_char_index, published by CharAt()/CountChars()
+	eint32 minBufferSize;
+} e_string_heap;
+
+#define ETK_STRING_HEAP(buffer)		((e_string_heap*)((buffer) - sizeof(e_string_heap)))
+
+// the last byte of "fInline" is the length of the short string, or one of the marks
+#define ETK_STRING_MARK			(sizeof(fInline) - 1)
+#define ETK_STRING_INLINE_SIZE		((eint32)ETK_STRING_MARK) // the size of inline buffer
+#define ETK_STRING_LONG			0xff
+#define ETK_STRING_NO_BUFFER		0xfe
+
+
+inline char*
+EString::_Buffer() const
+{
+	euint8 mark = (euint8)fInline[ETK_STRING_MARK];
+	if(mark == ETK_STRING_LONG) return fLong.fHeap;
+	return(mark != ETK_STRING_NO_BUFFER ? (char*)fInline : NULL);
+}
+
+
+inline void*
+EString::_Heap() const
+{
+	return((euint8)fInline[ETK_STRING_MARK] == ETK_STRING_LONG ? ETK_STRING_HEAP(fLong.fHeap) : NULL);
+}
+
+
+inline eint32
+EString::_Length() const
+{
+	euint8 mark = (euint8)fInline[ETK_STRING_MARK];
+	if(mark == ETK_STRING_LONG) return fLong.fLen;
+	return(mark != ETK_STRING_NO_BUFFER ? (eint32)mark : 0);
+}
+
+
+// _BufferSize(): the size of buffer, 0 means no buffer.
+inline eint32
+EString::_BufferSize() const
+{
+	euint8 mark = (euint8)fInline[ETK_STRING_MARK];
+	if(mark == ETK_STRING_LONG) return fLong.fLenReal;
+	return(mark != ETK_STRING_NO_BUFFER ? ETK_STRING_INLINE_SIZE : 0);
+}
+
+
+// _SetLength(): the length must be less than the size of buffer.
+inline void
+EString::_SetLength(eint32 length)
+{
+	euint8 mark = (euint8)fInline[ETK_STRING_MARK];
+	if(mark == ETK_STRING_LONG) fLong.fLen = length;
+	else if(mark != ETK_STRING_NO_BUFFER) fInline[ETK_STRING_MARK] = (char)length;
+}
+
+
+inline void
+EString::_SetNoBuffer()
+{
+	fInline[ETK_STRING_MARK] = (char)ETK_STRING_NO_BUFFER;
+}
+
+
 bool
 EString::SetMinimumBufferSize(eint32 length)
 {
 	if(length > MAX_STRING_LENGTH + 1) return false;
 
-	if(length <= 0 || length <= fLenReal)
+	e_string_heap *heap = (e_string_heap*)_Heap();
+
+	// the inline buffer is always there, so the minimum within it isn't remembered
+	if(length <= ETK_STRING_INLINE_SIZE || length <= _BufferSize())
 	{
-		fMinBufferSize = length;
+		if(heap != NULL) heap->minBufferSize = max_c(length, 0);
 		return true;
 	}
 
-	char *newData = (char*)realloc(fBuffer, length);
-	if(!newData) return false;
+	if(!_Realloc(length)) return false;
 
-	fMinBufferSize = length;
-	fBuffer = newData;
-	fBuffer[max_c(fLen, 0)] = 0;
-	fLenReal = length;
+	((e_string_heap*)_Heap())->minBufferSize = length;
+	_Buffer()[_Length()] = 0;
 
 	return true;
 }
@@ -299,131 +525,219 @@ EString::SetMinimumBufferSize(eint32 length)
 eint32
 EString::MinimumBufferSize() const
 {
-	return fMinBufferSize;
+	e_string_heap *heap = (e_string_heap*)_Heap();
+	return(heap != NULL ? heap->minBufferSize : 0);
+}
+
+
+// _Realloc(): change the size of buffer, the buffer is "fInline" when it's small enough.
+bool
+EString::_Realloc(eint32 length_to_alloc)
+{
+	eint32 length = _Length();
+	eint32 oldSize = _BufferSize();
+	e_string_heap *heap = (e_string_heap*)_Heap();
+
+	if(length_to_alloc <= ETK_STRING_INLINE_SIZE)
+	{
+		length = min_c(length, ETK_STRING_INLINE_SIZE - 1);
+
+		if(heap != NULL)
+		{
+			// "fInline" overlays "fLong"
+			memcpy(fInline, fLong.fHeap, (size_t)length);
+			if(heap->charIndex != NULL) free(heap->charIndex);
+			etk_memory_account_free(E_MEMORY_STRINGS, sizeof(e_string_heap) + (size_t)oldSize);
+			free(heap);
+		}
+
+		fInline[length] = 0;
+		fInline[ETK_STRING_MARK] = (char)length;
+
+		return true;
+	}
+
+	if(heap == NULL)
+	{
+		if((heap = (e_string_heap*)malloc(sizeof(e_string_heap) + (size_t)length_to_alloc)) == NULL) return false;
+		if(oldSize > 0) memcpy((char*)heap + sizeof(e_string_heap), fInline, (size_t)length + 1);
+		heap->charIndex = NULL;
+		heap->minBufferSize = 0;
+	}
+	else
+	{
+		if((heap = (e_string_heap*)realloc(heap, sizeof(e_string_heap) + (size_t)length_to_alloc)) == NULL) return false;
+		etk_memory_account_free(E_MEMORY_STRINGS, sizeof(e_string_heap) + (size_t)oldSize);
+	}
+	etk_memory_account_alloc(E_MEMORY_STRINGS, sizeof(e_string_heap) + (size_t)length_to_alloc);
+
+	fLong.fHeap = (char*)heap + sizeof(e_string_heap);
+	fLong.fLen = length;
+	fLong.fLenReal = length_to_alloc;
+	fInline[ETK_STRING_MARK] = (char)ETK_STRING_LONG;
+
+	return true;
+}
+
+
+// _FreeBuffer(): release the buffer on the heap, there's no buffer then.
+void
+EString::_FreeBuffer()
+{
+	e_string_heap *heap = (e_string_heap*)_Heap();
+	if(heap != NULL)
+	{
+		if(heap->charIndex != NULL) free(heap->charIndex);
+		etk_memory_account_free(E_MEMORY_STRINGS, sizeof(e_string_heap) + (size_t)fLong.fLenReal);
+		free(heap);
+	}
+	_SetNoBuffer();
 }
 
 
+// _Resize(): change the length of string.
+//	The buffer grows geometrically so that appending piece by piece is amortized O(1),
+//	and it's released only when less than a quarter of it was used.
 bool
 EString::_Resize(eint32 length)
 {
+	_InvalidateCharIndex();
+
+	e_string_heap *heap = (e_string_heap*)_Heap();
+
+	eint32 minBufferSize = (heap != NULL ? heap->minBufferSize : 0);
+	eint32 bufferSize = _BufferSize();
+
 	if(length <= 0)
 	{
-		if(fMinBufferSize > 0)
+		if(minBufferSize > 0)
 		{
-			if(fLenReal != fMinBufferSize)
-			{
-				char *newData = (char*)realloc(fBuffer, fMinBufferSize);
-				if(newData)
-				{
-					fBuffer = newData;
-					fLenReal = fMinBufferSize;
-				}
-			}
+			if(bufferSize != minBufferSize) _Realloc(minBufferSize);
 
-			fLen = 0;
-			if(fBuffer) fBuffer[0] = 0;
-			else fLenReal = 0;
+			_SetLength(0);
+			if(_BufferSize() > 0) _Buffer()[0] = 0;
 		}
 		else
 		{
-			if(fBuffer) free(fBuffer);
-			fBuffer = NULL;
-			fLen = 0;
-			fLenReal = 0;
+			_FreeBuffer();
 		}
 		return true;
 	}
-	else if(length == fLenReal - 1)
-	{
-		fLen = length;
-		return true;
-	}
 	else if(length > MAX_STRING_LENGTH)
 	{
 		return false;
 	}
-	else if(length < fMinBufferSize && fMinBufferSize == fLenReal)
+	else if(length < bufferSize)
 	{
-		fLen = length;
-		fBuffer[fLen] = 0;
+		_SetLength(length);
+		_Buffer()[length] = 0;
+
+		if(heap != NULL && bufferSize > 64 && length < (bufferSize >> 2) && minBufferSize < (bufferSize >> 1))
+		{
+			_Realloc(max_c(bufferSize >> 1, minBufferSize));
+			_Buffer()[length] = 0;
+		}
+
 		return true;
 	}
 
-	eint32 length_to_alloc = max_c(length + 1, fMinBufferSize);
-	char *newData = (char*)realloc(fBuffer, length_to_alloc);
-	if(!newData && length + 1 < fMinBufferSize)
-	{
-		length_to_alloc = length + 1;
-		newData = (char*)realloc(fBuffer, length_to_alloc);
-	}
+	eint32 length_to_alloc = max_c(length + 1, minBufferSize);
+	if(bufferSize > 0 && length_to_alloc > ETK_STRING_INLINE_SIZE)
+		length_to_alloc = max_c(length_to_alloc, (bufferSize > (MAX_STRING_LENGTH >> 1) ? MAX_STRING_LENGTH + 1 : bufferSize << 1));
 
-	if(!newData)
+	if(!_Realloc(length_to_alloc))
 	{
-		if(length < fLenReal)
-		{
-			fLen = length;
-			fBuffer[fLen] = 0;
-			return true;
-		}
-		else
-		{
-			return false;
-		}
+		// try the exact size
+		if(length_to_alloc == length + 1 || !_Realloc(length + 1)) return false;
 	}
 
-	newData[length] = 0;
-	fBuffer = newData;
-	fLen = length;
-	fLenReal = length_to_alloc;
+	_SetLength(length);
+	_Buffer()[length] = 0;
 
 	return true;
 }
 
 
+// _Steal(): take the buffer of "from" instead of the one of this,
+//	the minimum buffer size of this is kept.
+void
+EString::_Steal(EString &from)
+{
+	eint32 minBufferSize = MinimumBufferSize();
+
+	_FreeBuffer();
+
+	// all of the short string, or the long one with its length and size
+	memcpy(fInline, from.fInline, sizeof(fInline));
+	from._SetNoBuffer();
+
+	e_string_heap *heap = (e_string_heap*)_Heap();
+	if(heap != NULL) heap->minBufferSize = 0;
+	if(minBufferSize > 0) SetMinimumBufferSize(minBufferSize);
+}
+
+
 EString::EString()
-	: fLen(0), fLenReal(0), fMinBufferSize(0), fBuffer(NULL)
 {
+	_SetNoBuffer();
 }
 
 
 EString::EString(const char *str)
-	: fLen(0), fLenReal(0), fMinBufferSize(0), fBuffer(NULL)
 {
+	_SetNoBuffer();
 	Append(str);
 }
 
 
 EString::EString(const EString &str)
-	: fLen(0), fLenReal(0), fMinBufferSize(0), fBuffer(NULL)
 {
+	_SetNoBuffer();
 	Append(str);
 }
 
 
 EString::EString(const char *str, eint32 maxLength)
-	: fLen(0), fLenReal(0), fMinBufferSize(0), fBuffer(NULL)
 {
+	_SetNoBuffer();
 	Append(str, maxLength);
 }
 
 
 EString::~EString()
 {
-	if(fBuffer) free(fBuffer);
+	_FreeBuffer();
+}
+
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+EString::EString(EString &&str)
+{
+	_SetNoBuffer();
+	_Steal(str);
+}
+
+
+EString&
+EString::operator=(EString &&str)
+{
+	if(this != &str) _Steal(str);
+	return *this;
 }
+#endif /* ETK_SUPPORT_RVALUE_REFERENCES */
 
 
 const char*
 EString::String() const
 {
-	return fBuffer;
+	return _Buffer();
 }
 
 
 eint32
 EString::Length() const
 {
-	return fLen;
+	return _Length();
 }
 
 
@@ -494,7 +808,15 @@ EString::SetTo(char c, eint32 count)
 EString&
 EString::Adopt(EString &from)
 {
-	Append(from);
+	if(this != &from && _Length() <= 0 && MinimumBufferSize() <= from._BufferSize())
+	{
+		// take the buffer instead of copying
+		_Steal(from);
+	}
+	else
+	{
+		Append(from);
+	}
 	from.MakeEmpty();
 
 	return *this;
@@ -519,10 +841,10 @@ EString::CopyInto(EString &into, eint32 fromOffset, eint32 length) const
 		EString str = *this;
 		if(str == *this) str.CopyInto(into, fromOffset, length);
 	}
-	else if(fromOffset >= 0 && fromOffset < fLen)
+	else if(fromOffset >= 0 && fromOffset < _Length())
 	{
 		into.MakeEmpty();
-		into.Append(fBuffer + fromOffset, length);
+		into.Append(_Buffer() + fromOffset, length);
 	}
 
 	return into;
@@ -533,11 +855,11 @@ void
 EString::CopyInto(char *into, size_t into_size, eint32 fromOffset, eint32 length) const
 {
 	if(!into || into_size <= 0) return;
-	if(fromOffset < 0 || fromOffset >= fLen) return;
-	if(length < 0 || length > fLen - fromOffset) length = fLen - fromOffset;
+	if(fromOffset < 0 || fromOffset >= _Length()) return;
+	if(length < 0 || length > _Length() - fromOffset) length = _Length() - fromOffset;
 
-	if(fBuffer && fromOffset >= 0 && fromOffset < fLen && length > 0)
-		strncpy(into, fBuffer + fromOffset, min_c(into_size, (size_t)length));
+	if(_Buffer() && fromOffset >= 0 && fromOffset < _Length() && length > 0)
+		strncpy(into, _Buffer() + fromOffset, min_c(into_size, (size_t)length));
 	else
 		into[0] = '\0';
 }
@@ -551,10 +873,10 @@ EString::MoveInto(EString &into, eint32 from, eint32 length)
 		EString str = *this;
 		if(str == *this) str.MoveInto(into, from, length);
 	}
-	else if(from >= 0 && from < fLen)
+	else if(from >= 0 && from < _Length())
 	{
 		into.MakeEmpty();
-		into.Append(fBuffer + from, length);
+		into.Append(_Buffer() + from, length);
 
 		Remove(from, length);
 	}
@@ -567,12 +889,12 @@ void
 EString::MoveInto(char *into, size_t into_size, eint32 from, eint32 length)
 {
 	if(!into || into_size <= 0) return;
-	if(from < 0 || from >= fLen) return;
-	if(length < 0 || length > fLen - from) length = fLen - from;
+	if(from < 0 || from >= _Length()) return;
+	if(length < 0 || length > _Length() - from) length = _Length() - from;
 
-	if(fBuffer && from >= 0 && from < fLen)
+	if(_Buffer() && from >= 0 && from < _Length())
 	{
-		strncpy(into, fBuffer + from, min_c(into_size, (size_t)length));
+		strncpy(into, _Buffer() + from, min_c(into_size, (size_t)length));
 		Remove(from, length);
 	}
 	else
@@ -644,13 +966,13 @@ EString::Append(const char *str, eint32 length)
 	eint32 strLen = (eint32)strlen(str);
 
 	if(length < 0 || length > strLen) length = strLen;
-	if(MAX_STRING_LENGTH - fLen < length) return *this;
+	if(MAX_STRING_LENGTH - _Length() < length) return *this;
 
-	if(_Resize(fLen + length))
+	if(_Resize(_Length() + length))
 	{
-		if(memcpy(fBuffer + fLen - length, str, length) == NULL)
+		if(memcpy(_Buffer() + _Length() - length, str, length) == NULL)
 		{
-			fLen -= length;
+			_SetLength(_Length() - length);
 		}
 	}
 
@@ -661,13 +983,13 @@ EString::Append(const char *str, eint32 length)
 EString&
 EString::Append(char c, eint32 count)
 {
-	if(c == 0 || MAX_STRING_LENGTH - fLen < count || count <= 0) return *this;
+	if(c == 0 || MAX_STRING_LENGTH - _Length() < count || count <= 0) return *this;
 
-	if(_Resize(fLen + count))
+	if(_Resize(_Length() + count))
 	{
-		if(memset(fBuffer + fLen - count, (int)c, count) == NULL)
+		if(memset(_Buffer() + _Length() - count, (int)c, count) == NULL)
 		{
-			fLen -= count;
+			_SetLength(_Length() - count);
 		}
 	}
 
@@ -759,23 +1081,23 @@ EString::Insert(const char *str, eint32 fromOffset, eint32 length, eint32 pos)
 	eint32 strLen = (eint32)strlen(str);
 	if(fromOffset >= strLen) return *this;
 
-	if((pos == 0 && fLen <= 0) || (pos > 0 && pos == fLen)) return Append(str + fromOffset, length);
-	if(pos < 0 || pos >= fLen) return *this;
+	if((pos == 0 && _Length() <= 0) || (pos > 0 && pos == _Length())) return Append(str + fromOffset, length);
+	if(pos < 0 || pos >= _Length()) return *this;
 
 	if(length < 0 || length > strLen - fromOffset) length = strLen - fromOffset;
 
-	if(MAX_STRING_LENGTH - fLen < length) return *this;
+	if(MAX_STRING_LENGTH - _Length() < length) return *this;
 
-	if(!_Resize(fLen + length)) return *this;
+	if(!_Resize(_Length() + length)) return *this;
 
-	if(memmove(fBuffer + pos + length, fBuffer + pos, fLen - length - pos) == NULL)
+	if(memmove(_Buffer() + pos + length, _Buffer() + pos, _Length() - length - pos) == NULL)
 	{
-		fLen -= length;
+		_SetLength(_Length() - length);
 		return *this;
 	}
-	else if(memcpy(fBuffer + pos, str + fromOffset, length) == NULL)
+	else if(memcpy(_Buffer() + pos, str + fromOffset, length) == NULL)
 	{
-		fLen -= length;
+		_SetLength(_Length() - length);
 	}
 
 	return *this;
@@ -785,21 +1107,21 @@ EString::Insert(const char *str, eint32 fromOffset, eint32 length, eint32 pos)
 EString&
 EString::Insert(char c, eint32 count, eint32 pos)
 {
-	if((pos == 0 && fLen <= 0) || (pos > 0 && pos == fLen)) return Append(c, count);
+	if((pos == 0 && _Length() <= 0) || (pos > 0 && pos == _Length())) return Append(c, count);
 
-	if(pos < 0 || pos >= fLen) return *this;
-	if(c == 0 || MAX_STRING_LENGTH - fLen < count || count <= 0) return *this;
+	if(pos < 0 || pos >= _Length()) return *this;
+	if(c == 0 || MAX_STRING_LENGTH - _Length() < count || count <= 0) return *this;
 
-	if(!_Resize(fLen + count)) return *this;
+	if(!_Resize(_Length() + count)) return *this;
 
-	if(memmove(fBuffer + pos + count, fBuffer + pos, fLen - count - pos) == NULL)
+	if(memmove(_Buffer() + pos + count, _Buffer() + pos, _Length() - count - pos) == NULL)
 	{
-		fLen -= count;
+		_SetLength(_Length() - count);
 		return *this;
 	}
-	else if(memset(fBuffer + pos, (int)c, count) == NULL)
+	else if(memset(_Buffer() + pos, (int)c, count) == NULL)
 	{
-		fLen -= count;
+		_SetLength(_Length() - count);
 	}
 
 	return *this;
@@ -809,7 +1131,7 @@ EString::Insert(char c, eint32 count, eint32 pos)
 EString&
 EString::Truncate(eint32 newLength)
 {
-	if(!(newLength < 0 || newLength >= fLen)) _Resize(newLength);
+	if(!(newLength < 0 || newLength >= _Length())) _Resize(newLength);
 
 	return *this;
 }
@@ -818,18 +1140,18 @@ EString::Truncate(eint32 newLength)
 EString&
 EString::Remove(eint32 from, eint32 length)
 {
-	if(from < 0 || from >= fLen) return *this;
+	if(from < 0 || from >= _Length()) return *this;
 
 	if(length == 0) return *this;
-	else if(length < 0) length = fLen - from;
-	else length = min_c(fLen - from, length);
+	else if(length < 0) length = _Length() - from;
+	else length = min_c(_Length() - from, length);
 
-	if(from < (fLen - 1) && length != (fLen - from))
+	if(from < (_Length() - 1) && length != (_Length() - from))
 	{
-		if(memmove(fBuffer + from, fBuffer + from + length, fLen - from - length) == NULL) return *this;
+		if(memmove(_Buffer() + from, _Buffer() + from + length, _Length() - from - length) == NULL) return *this;
 	}
 
-	_Resize(fLen - length);
+	_Resize(_Length() - length);
 
 	return *this;
 }
@@ -861,16 +1183,8 @@ EString::RemoveFirst(const char *str)
 {
 	if(str == NULL || *str == 0) return *this;
 
-	const char *s = String();
-	if(s)
-	{
-		const char *tmp = strstr(s, str);
-		if(tmp)
-		{
-			eint32 start = (eint32)(tmp - s);
-			Remove(start, (eint32)strlen(str));
-		}
-	}
+	eint32 index = FindFirst(str);
+	if(index >= 0) Remove(index, (eint32)strlen(str));
 
 	return *this;
 }
@@ -881,16 +1195,8 @@ EString::RemoveLast(const char *str)
 {
 	if(str == NULL || *str == 0) return *this;
 
-	const char *s = String();
-	if(s)
-	{
-		const char *tmp = e_strrstr(s, str);
-		if(tmp)
-		{
-			eint32 start = (eint32)(tmp - s);
-			Remove(start, (eint32)strlen(str));
-		}
-	}
+	eint32 index = FindLast(str);
+	if(index >= 0) Remove(index, (eint32)strlen(str));
 
 	return *this;
 }
@@ -901,21 +1207,7 @@ EString::RemoveAll(const char *str)
 {
 	if(str == NULL || *str == 0) return *this;
 
-	const char *s = String();
-	if(s)
-	{
-		const char *tmp;
-		while((tmp = strstr(s, str)) != NULL)
-		{
-			eint32 start = (eint32)(tmp - s);
-			Remove(start, (eint32)strlen(str));
-			s = String();
-
-			if(!s) break;
-		}
-	}
-
-	return *this;
+	return _Replace(str, (eint32)strlen(str), NULL, 0, -1, 0, false);
 }
 
 
@@ -924,20 +1216,7 @@ EString::RemoveSet(const char *setOfCharsToRemove)
 {
 	if(setOfCharsToRemove == NULL || *setOfCharsToRemove == 0) return *this;
 
-	eint32 len = (eint32)strlen(setOfCharsToRemove);
-
-	char str[2];
-	str[1] = '\0';
-
-	for(eint32 i = 0; i < len; i++)
-	{
-		str[0] = setOfCharsToRemove[i];
-		RemoveAll(str);
-
-		if(Length() == 0) break;
-	}
-
-	return *this;
+	return _ReplaceSet(setOfCharsToRemove, NULL, 0, false);
 }
 
 
@@ -967,16 +1246,8 @@ EString::IRemoveFirst(const char *str)
 {
 	if(str == NULL || *str == 0) return *this;
 
-	const char *s = String();
-	if(s)
-	{
-		const char *tmp = e_strcasestr(s, str);
-		if(tmp)
-		{
-			eint32 start = (eint32)(tmp - s);
-			Remove(start, (eint32)strlen(str));
-		}
-	}
+	eint32 index = IFindFirst(str);
+	if(index >= 0) Remove(index, (eint32)strlen(str));
 
 	return *this;
 }
@@ -987,16 +1258,8 @@ EString::IRemoveLast(const char *str)
 {
 	if(str == NULL || *str == 0) return *this;
 
-	const char *s = String();
-	if(s)
-	{
-		const char *tmp = e_strrcasestr(s, str);
-		if(tmp)
-		{
-			eint32 start = (eint32)(tmp - s);
-			Remove(start, (eint32)strlen(str));
-		}
-	}
+	eint32 index = IFindLast(str);
+	if(index >= 0) Remove(index, (eint32)strlen(str));
 
 	return *this;
 }
@@ -1007,21 +1270,7 @@ EString::IRemoveAll(const char *str)
 {
 	if(str == NULL || *str == 0) return *this;
 
-	const char *s = String();
-	if(s)
-	{
-		const char *tmp;
-		while((tmp = e_strcasestr(s, str)) != NULL)
-		{
-			eint32 start = (eint32)(tmp - s);
-			Remove(start, (eint32)strlen(str));
-			s = String();
-
-			if(!s) break;
-		}
-	}
-
-	return *this;
+	return _Replace(str, (eint32)strlen(str), NULL, 0, -1, 0, true);
 }
 
 
@@ -1030,20 +1279,7 @@ EString::IRemoveSet(const char *setOfCharsToRemove)
 {
 	if(setOfCharsToRemove == NULL || *setOfCharsToRemove == 0) return *this;
 
-	eint32 len = (eint32)strlen(setOfCharsToRemove);
-
-	char str[2];
-	str[1] = 0;
-
-	for(eint32 i = 0; i < len; i++)
-	{
-		str[0] = setOfCharsToRemove[i];
-		IRemoveAll(str);
-
-		if(Length() == 0) break;
-	}
-
-	return *this;
+	return _ReplaceSet(setOfCharsToRemove, NULL, 0, true);
 }
 
 
@@ -1252,7 +1488,7 @@ EString::FindFirst(const EString &string) const
 {
 	if(String() == NULL || string.String() == NULL) return -1;
 
-	const char *tmp = strstr(String(), string.String());
+	const char *tmp = e_memmem(_Buffer(), (size_t)_Length(), string.String(), (size_t)string.Length(), false);
 
 	if(tmp == NULL) return -1;
 
@@ -1265,7 +1501,7 @@ EString::FindFirst(const char *string) const
 {
 	if(String() == NULL || string == NULL || *string == 0) return -1;
 
-	const char *tmp = strstr(String(), string);
+	const char *tmp = e_memmem(_Buffer(), (size_t)_Length(), string, strlen(string), false);
 
 	if(tmp == NULL) return -1;
 
@@ -1278,8 +1514,8 @@ EString::FindFirst(const EString &string, eint32 fromOffset) const
 {
 	if(String() == NULL || string.String() == NULL || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strstr(string_find, string.String());
+	const char *tmp = e_memmem(_Buffer() + fromOffset, (size_t)(_Length() - fromOffset),
+				    string.String(), (size_t)string.Length(), false);
 
 	if(tmp == NULL) return -1;
 
@@ -1292,8 +1528,7 @@ EString::FindFirst(const char *string, eint32 fromOffset) const
 {
 	if(String() == NULL || string == NULL || *string == 0 || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strstr(string_find, string);
+	const char *tmp = e_memmem(_Buffer() + fromOffset, (size_t)(_Length() - fromOffset), string, strlen(string), false);
 
 	if(tmp == NULL) return -1;
 
@@ -1306,7 +1541,7 @@ EString::FindFirst(char c) const
 {
 	if(String() == NULL || c == 0) return -1;
 
-	const char *tmp = strchr(String(), c);
+	const char *tmp = (const char*)memchr(_Buffer(), c, (size_t)_Length());
 
 	if(tmp == NULL) return -1;
 
@@ -1319,8 +1554,7 @@ EString::FindFirst(char c, eint32 fromOffset) const
 {
 	if(String() == NULL || c == 0 || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strchr(string_find, c);
+	const char *tmp = (const char*)memchr(_Buffer() + fromOffset, c, (size_t)(_Length() - fromOffset));
 
 	if(tmp == NULL) return -1;
 
@@ -1333,7 +1567,7 @@ EString::FindLast(const EString &string) const
 {
 	if(String() == NULL || string.String() == NULL) return -1;
 
-	const char *tmp = e_strrstr(String(), string.String());
+	const char *tmp = e_memrmem(_Buffer(), (size_t)_Length(), string.String(), (size_t)string.Length(), false);
 
 	if(tmp == NULL) return -1;
 
@@ -1346,7 +1580,7 @@ EString::FindLast(const char *string) const
 {
 	if(String() == NULL || string == NULL || *string == 0) return -1;
 
-	const char *tmp = e_strrstr(String(), string);
+	const char *tmp = e_memrmem(_Buffer(), (size_t)_Length(), string, strlen(string), false);
 
 	if(tmp == NULL) return -1;
 
@@ -1359,17 +1593,12 @@ EString::FindLast(const EString &string, eint32 beforeOffset) const
 {
 	if(String() == NULL || string.String() == NULL || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = e_strndup(String(), beforeOffset + 1);
-	if(string_find == NULL) return -1;
-	
-	const char *tmp = e_strrstr(string_find, string.String());
+	const char *tmp = e_memrmem(_Buffer(), (size_t)beforeOffset + 1,
+				     string.String(), (size_t)string.Length(), false);
 
-	eint32 ret = -1;
-	if(tmp != NULL) ret = (eint32)(tmp - string_find);
-
-	free(string_find);
+	if(tmp == NULL) return -1;
 
-	return ret;
+	return((eint32)(tmp - String()));
 }
 
 
@@ -1378,26 +1607,20 @@ EString::FindLast(const char *string, eint32 beforeOffset) const
 {
 	if(String() == NULL || string == NULL || *string == 0 || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = e_strndup(String(), beforeOffset + 1);
-	if(string_find == NULL) return -1;
-
-	const char *tmp = e_strrstr(string_find, string);
+	const char *tmp = e_memrmem(_Buffer(), (size_t)beforeOffset + 1, string, strlen(string), false);
 
-	eint32 ret = -1;
-	if(tmp != NULL) ret = (eint32)(tmp - string_find);
-
-	free(string_find);
+	if(tmp == NULL) return -1;
 
-	return ret;
+	return((eint32)(tmp - String()));
 }
 
 
 eint32
 EString::FindLast(char c) const
 {
-	if(String() == 0 || c == 0) return -1;
+	if(String() == NULL || c == 0) return -1;
 
-	const char *tmp = strrchr(String(), c);
+	const char *tmp = e_memrchr(_Buffer(), (size_t)_Length(), c, false);
 
 	if(tmp == NULL) return -1;
 
@@ -1410,17 +1633,11 @@ EString::FindLast(char c, eint32 beforeOffset) const
 {
 	if(String() == NULL || c == 0 || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = e_strndup(String(), beforeOffset + 1);
-	if(string_find == NULL) return -1;
-	
-	const char *tmp = strrchr(string_find, c);
+	const char *tmp = e_memrchr(_Buffer(), (size_t)beforeOffset + 1, c, false);
 
-	eint32 ret = -1;
-	if(tmp != NULL) ret = (eint32)(tmp - string_find);
-
-	free(string_find);
+	if(tmp == NULL) return -1;
 
-	return ret;
+	return((eint32)(tmp - String()));
 }
 
 
@@ -1429,7 +1646,7 @@ EString::IFindFirst(const EString &string) const
 {
 	if(String() == NULL || string.String() == NULL) return -1;
 
-	const char *tmp = e_strcasestr(String(), string.String());
+	const char *tmp = e_memmem(_Buffer(), (size_t)_Length(), string.String(), (size_t)string.Length(), true);
 
 	if(tmp == NULL) return -1;
 
@@ -1442,7 +1659,7 @@ EString::IFindFirst(const char *string) const
 {
 	if(String() == NULL || string == NULL || *string == 0) return -1;
 
-	const char *tmp = e_strcasestr(String(), string);
+	const char *tmp = e_memmem(_Buffer(), (size_t)_Length(), string, strlen(string), true);
 
 	if(tmp == NULL) return -1;
 
@@ -1455,8 +1672,8 @@ EString::IFindFirst(const EString &string, eint32 fromOffset) const
 {
 	if(String() == NULL || string.String() == NULL || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = e_strcasestr(string_find, string.String());
+	const char *tmp = e_memmem(_Buffer() + fromOffset, (size_t)(_Length() - fromOffset),
+				    string.String(), (size_t)string.Length(), true);
 
 	if(tmp == NULL) return -1;
 
@@ -1469,8 +1686,7 @@ EString::IFindFirst(const char *string, eint32 fromOffset) const
 {
 	if(String() == NULL || string == NULL || *string == 0 || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = e_strcasestr(string_find, string);
+	const char *tmp = e_memmem(_Buffer() + fromOffset, (size_t)(_Length() - fromOffset), string, strlen(string), true);
 
 	if(tmp == NULL) return -1;
 
@@ -1483,7 +1699,7 @@ EString::IFindFirst(char c) const
 {
 	if(String() == NULL || c == 0) return -1;
 
-	const char *tmp = e_strcasechr(String(), c);
+	const char *tmp = e_memcasechr(_Buffer(), (size_t)_Length(), c);
 
 	if(tmp == NULL) return -1;
 
@@ -1496,8 +1712,7 @@ EString::IFindFirst(char c, eint32 fromOffset) const
 {
 	if(String() == NULL || c == 0 || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = e_strcasechr(string_find, c);
+	const char *tmp = e_memcasechr(_Buffer() + fromOffset, (size_t)(_Length() - fromOffset), c);
 
 	if(tmp == NULL) return -1;
 
@@ -1510,7 +1725,7 @@ EString::IFindLast(const EString &string) const
 {
 	if(String() == NULL || string.String() == NULL) return -1;
 
-	const char *tmp = e_strrcasestr(String(), string.String());
+	const char *tmp = e_memrmem(_Buffer(), (size_t)_Length(), string.String(), (size_t)string.Length(), true);
 
 	if(tmp == NULL) return -1;
 
@@ -1523,7 +1738,7 @@ EString::IFindLast(const char *string) const
 {
 	if(String() == NULL || string == NULL || *string == 0) return -1;
 
-	const char *tmp = e_strrcasestr(String(), string);
+	const char *tmp = e_memrmem(_Buffer(), (size_t)_Length(), string, strlen(string), true);
 
 	if(tmp == NULL) return -1;
 
@@ -1536,17 +1751,12 @@ EString::IFindLast(const EString &string, eint32 beforeOffset) const
 {
 	if(String() == NULL || string.String() == NULL || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = e_strndup(String(), beforeOffset + 1);
-	if(string_find == NULL) return -1;
-
-	const char *tmp = e_strrcasestr(string_find, string.String());
+	const char *tmp = e_memrmem(_Buffer(), (size_t)beforeOffset + 1,
+				     string.String(), (size_t)string.Length(), true);
 
-	eint32 ret = -1;
-	if(tmp != NULL) ret = (eint32)(tmp - string_find);
-
-	free(string_find);
+	if(tmp == NULL) return -1;
 
-	return ret;
+	return((eint32)(tmp - String()));
 }
 
 
@@ -1555,17 +1765,11 @@ EString::IFindLast(const char *string, eint32 beforeOffset) const
 {
 	if(String() == NULL || string == NULL || *string == 0 || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = e_strndup(String(), beforeOffset + 1);
-	if(string_find == NULL) return -1;
-
-	const char *tmp = e_strrcasestr(string_find, string);
+	const char *tmp = e_memrmem(_Buffer(), (size_t)beforeOffset + 1, string, strlen(string), true);
 
-	eint32 ret = -1;
-	if(tmp != NULL) ret = (eint32)(tmp - string_find);
-
-	free(string_find);
+	if(tmp == NULL) return -1;
 
-	return ret;
+	return((eint32)(tmp - String()));
 }
 
 
@@ -1574,7 +1778,7 @@ EString::IFindLast(char c) const
 {
 	if(String() == NULL || c == 0) return -1;
 
-	const char *tmp = e_strrcasechr(String(), c);
+	const char *tmp = e_memrchr(_Buffer(), (size_t)_Length(), c, true);
 
 	if(tmp == NULL) return -1;
 
@@ -1587,63 +1791,202 @@ EString::IFindLast(char c, eint32 beforeOffset) const
 {
 	if(String() == NULL || c == 0 || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = e_strndup(String(), beforeOffset + 1);
-	if(string_find == NULL) return -1;
-	
-	const char *tmp = e_strrcasechr(string_find, c);
-
-	eint32 ret = -1;
-	if(tmp != NULL) ret = (eint32)(tmp - string_find);
+	const char *tmp = e_memrchr(_Buffer(), (size_t)beforeOffset + 1, c, true);
 
-	free(string_find);
+	if(tmp == NULL) return -1;
 
-	return ret;
+	return((eint32)(tmp - String()));
 }
 
 
+// _Replace(): replace at most "maxCount" (-1 means all) of "replaceThis" from "fromOffset",
+//	the result is built with one pass instead of shifting the rest for every replacement.
 EString&
-EString::ReplaceFirst(char replaceThis, char withThis)
+EString::_Replace(const char *replaceThis, eint32 replaceLen, const char *withThis, eint32 withLen,
+		  eint32 maxCount, eint32 fromOffset, bool ignoreCase)
 {
-	eint32 index = FindFirst(replaceThis);
+	if(fromOffset < 0 || fromOffset >= _Length() || replaceLen <= 0 || maxCount == 0) return *this;
 
-	if(index >= 0) fBuffer[index] = withThis;
+	const char *end = _Buffer() + _Length();
+	const char *found = e_memmem(_Buffer() + fromOffset, (size_t)(_Length() - fromOffset), replaceThis, (size_t)replaceLen, ignoreCase);
+	if(found == NULL) return *this;
+
+	if(withLen <= replaceLen)
+	{
+		// it never grows, so the result is built within the buffer
+		_InvalidateCharIndex();
+
+		char *dest = (char*)found;
+		const char *src = found;
+		eint32 count = 0;
+
+		while(found != NULL)
+		{
+			if(dest != src) memmove(dest, src, (size_t)(found - src));
+			dest += found - src;
+
+			if(withLen > 0) memcpy(dest, withThis, (size_t)withLen);
+			dest += withLen;
+			src = found + replaceLen;
+
+			if(++count == maxCount) break;
+			found = e_memmem(src, (size_t)(end - src), replaceThis, (size_t)replaceLen, ignoreCase);
+		}
+
+		if(dest != src) memmove(dest, src, (size_t)(end - src));
+		dest += end - src;
+
+		_Resize((eint32)(dest - _Buffer()));
+		return *this;
+	}
+
+	eint32 count = 0;
+	for(const char *tmp = found; tmp != NULL && count != maxCount; count++)
+		tmp = e_memmem(tmp + replaceLen, (size_t)(end - tmp - replaceLen), replaceThis, (size_t)replaceLen, ignoreCase);
+
+	eint64 length = (eint64)_Length() + (eint64)count * (eint64)(withLen - replaceLen);
+	if(length > (eint64)MAX_STRING_LENGTH) return *this;
+
+	EString result;
+	eint32 minBufferSize = MinimumBufferSize();
+	if(minBufferSize > (eint32)length) result.SetMinimumBufferSize(minBufferSize);
+	if(result._Resize((eint32)length) == false) return *this;
+
+	char *dest = result._Buffer();
+	const char *src = _Buffer();
+
+	while(count-- > 0)
+	{
+		memcpy(dest, src, (size_t)(found - src));
+		dest += found - src;
+
+		memcpy(dest, withThis, (size_t)withLen);
+		dest += withLen;
+		src = found + replaceLen;
+
+		if(count > 0) found = e_memmem(src, (size_t)(end - src), replaceThis, (size_t)replaceLen, ignoreCase);
+	}
+
+	memcpy(dest, src, (size_t)(end - src));
+
+	// take the buffer of result
+	_Steal(result);
 
 	return *this;
 }
 
 
+// _ReplaceSet(): replace every byte within "set" from "fromOffset" by "with" ("withLen" is 0 means removing)
 EString&
-EString::ReplaceLast(char replaceThis, char withThis)
+EString::_ReplaceSet(const char *set, const char *with, eint32 withLen, bool ignoreCase, eint32 fromOffset)
 {
-	eint32 index = FindLast(replaceThis);
+	if(set == NULL || *set == 0 || fromOffset < 0 || fromOffset >= _Length()) return *this;
+
+	bool inSet[256];
+	bzero(inSet, sizeof(inSet));
+
+	for(const unsigned char *tmp = (const unsigned char*)set; *tmp != 0; tmp++)
+	{
+		inSet[*tmp] = true;
+		if(!ignoreCase) continue;
+
+		unsigned char c = e_fold_case(*tmp);
+		inSet[c] = true;
+		if(c >= 'a' && c <= 'z') inSet[c & ~0x20] = true;
+	}
+
+	const unsigned char *src = (const unsigned char*)_Buffer() + fromOffset;
+	const unsigned char *end = (const unsigned char*)_Buffer() + _Length();
+	while(src < end && !inSet[*src]) src++;
+	if(src == end) return *this;
+
+	if(withLen <= 1)
+	{
+		_InvalidateCharIndex();
+
+		unsigned char *dest = (unsigned char*)src;
+		for(; src < end; src++)
+		{
+			if(!inSet[*src]) *dest++ = *src;
+			else if(withLen == 1) *dest++ = (unsigned char)*with;
+		}
+
+		if(withLen == 0) _Resize((eint32)(dest - (unsigned char*)_Buffer()));
+		return *this;
+	}
+
+	eint64 length = (eint64)_Length();
+	for(const unsigned char *tmp = src; tmp < end; tmp++) if(inSet[*tmp]) length += withLen - 1;
+	if(length > (eint64)MAX_STRING_LENGTH) return *this;
+
+	EString result;
+	eint32 minBufferSize = MinimumBufferSize();
+	if(minBufferSize > (eint32)length) result.SetMinimumBufferSize(minBufferSize);
+	if(result._Resize((eint32)length) == false) return *this;
+
+	char *dest = result._Buffer();
+	eint32 offset = (eint32)((const char*)src - _Buffer());
+	memcpy(dest, _Buffer(), (size_t)offset);
+	dest += offset;
+
+	for(; src < end; src++)
+	{
+		if(!inSet[*src])
+		{
+			*dest++ = (char)*src;
+			continue;
+		}
+
+		memcpy(dest, with, (size_t)withLen);
+		dest += withLen;
+	}
 
-	if(index >= 0) fBuffer[index] = withThis;
+	_Steal(result);
 
 	return *this;
 }
 
 
 EString&
-EString::ReplaceAll(char replaceThis, char withThis, eint32 fromOffset)
+EString::ReplaceFirst(char replaceThis, char withThis)
 {
-	if(fromOffset < 0 || fromOffset >= fLen) return *this;
+	eint32 index = FindFirst(replaceThis);
 
-	while(fromOffset < fLen)
+	if(index >= 0)
 	{
-		eint32 index = FindFirst(replaceThis, fromOffset);
+		_InvalidateCharIndex();
+		_Buffer()[index] = withThis;
+	}
 
-		if(index >= 0)
-		{
-			fBuffer[index] = withThis;
-			fromOffset = index + 1;
-		}
-		else break;
+	return *this;
+}
+
+
+EString&
+EString::ReplaceLast(char replaceThis, char withThis)
+{
+	eint32 index = FindLast(replaceThis);
+
+	if(index >= 0)
+	{
+		_InvalidateCharIndex();
+		_Buffer()[index] = withThis;
 	}
 
 	return *this;
 }
 
 
+EString&
+EString::ReplaceAll(char replaceThis, char withThis, eint32 fromOffset)
+{
+	if(fromOffset < 0 || fromOffset >= _Length()) return *this;
+
+	char set[2] = {replaceThis, 0};
+	return _ReplaceSet(set, &withThis, 1, false, fromOffset);
+}
+
+
 EString&
 EString::ReplaceFirst(const char *replaceThis, const char *withThis)
 {
@@ -1681,59 +2024,22 @@ EString::ReplaceLast(const char *replaceThis, const char *withThis)
 EString&
 EString::ReplaceAll(const char *replaceThis, const char *withThis, eint32 fromOffset)
 {
-	if(fromOffset < 0 || fromOffset >= fLen) return *this;
+	if(fromOffset < 0 || fromOffset >= _Length()) return *this;
 	if(replaceThis == NULL || *replaceThis == 0 || withThis == NULL || *withThis == 0) return *this;
 
-	eint32 strLenReplace = (eint32)strlen(replaceThis);
-	eint32 strLenWith = (eint32)strlen(withThis);
-
-	while(fromOffset < fLen)
-	{
-		eint32 index = FindFirst(replaceThis, fromOffset);
-
-		if(index >= 0)
-		{
-			Remove(index, strLenReplace);
-			Insert(withThis, index);
-			fromOffset = index + strLenWith;
-		}
-		else break;
-	}
-
-	return *this;
+	return _Replace(replaceThis, (eint32)strlen(replaceThis), withThis, (eint32)strlen(withThis), -1, fromOffset, false);
 }
 
 
 EString&
 EString::Replace(const char *replaceThis, const char *withThis, eint32 maxReplaceCount, eint32 fromOffset)
 {
-	if(fromOffset < 0 || fromOffset >= fLen) return *this;
+	if(fromOffset < 0 || fromOffset >= _Length()) return *this;
 	if(replaceThis == NULL || *replaceThis == 0 || withThis == NULL || *withThis == 0) return *this;
 
 	if(maxReplaceCount == 0) return *this;
-	if(maxReplaceCount < 0) return ReplaceAll(replaceThis, withThis, fromOffset);
-
-	int count = 0;
-	eint32 strLenReplace = (eint32)strlen(replaceThis);
-	eint32 strLenWith = (eint32)strlen(withThis);
-
-	while(true)
-	{
-		eint32 index = FindFirst(replaceThis, fromOffset);
-
-		if(index >= 0)
-		{
-			Remove(index, strLenReplace);
-			Insert(withThis, index);
-			fromOffset = index + strLenWith;
-			count++;
-		}
-		else break;
-
-		if(count >= maxReplaceCount) break;
-	}
 
-	return *this;
+	return _Replace(replaceThis, (eint32)strlen(replaceThis), withThis, (eint32)strlen(withThis), maxReplaceCount, fromOffset, false);
 }
 
 
@@ -1742,7 +2048,11 @@ EString::IReplaceFirst(char replaceThis, char withThis)
 {
 	eint32 index = IFindFirst(replaceThis);
 
-	if(index >= 0) fBuffer[index] = withThis;
+	if(index >= 0)
+	{
+		_InvalidateCharIndex();
+		_Buffer()[index] = withThis;
+	}
 
 	return *this;
 }
@@ -1753,7 +2063,11 @@ EString::IReplaceLast(char replaceThis, char withThis)
 {
 	eint32 index = IFindLast(replaceThis);
 
-	if(index >= 0) fBuffer[index] = withThis;
+	if(index >= 0)
+	{
+		_InvalidateCharIndex();
+		_Buffer()[index] = withThis;
+	}
 
 	return *this;
 }
@@ -1762,21 +2076,10 @@ EString::IReplaceLast(char replaceThis, char withThis)
 EString&
 EString::IReplaceAll(char replaceThis, char withThis, eint32 fromOffset)
 {
-	if(fromOffset < 0 || fromOffset >= fLen) return *this;
-
-	while(fromOffset < fLen)
-	{
-		eint32 index = IFindFirst(replaceThis, fromOffset);
-
-		if(index >= 0)
-		{
-			fBuffer[index] = withThis;
-			fromOffset = index + 1;
-		}
-		else break;
-	}
+	if(fromOffset < 0 || fromOffset >= _Length()) return *this;
 
-	return *this;
+	char set[2] = {replaceThis, 0};
+	return _ReplaceSet(set, &withThis, 1, true, fromOffset);
 }
 
 
@@ -1817,59 +2120,22 @@ EString::IReplaceLast(const char *replaceThis, const char *withThis)
 EString&
 EString::IReplaceAll(const char *replaceThis, const char *withThis, eint32 fromOffset)
 {
-	if(fromOffset < 0 || fromOffset >= fLen) return *this;
+	if(fromOffset < 0 || fromOffset >= _Length()) return *this;
 	if(replaceThis == NULL || *replaceThis == 0 || withThis == NULL || *withThis == 0) return *this;
 
-	eint32 strLenReplace = (eint32)strlen(replaceThis);
-	eint32 strLenWith = (eint32)strlen(withThis);
-
-	while(fromOffset < fLen)
-	{
-		eint32 index = IFindFirst(replaceThis, fromOffset);
-
-		if(index >= 0)
-		{
-			Remove(index, strLenReplace);
-			Insert(withThis, index);
-			fromOffset = index + strLenWith;
-		}
-		else break;
-	}
-
-	return *this;
+	return _Replace(replaceThis, (eint32)strlen(replaceThis), withThis, (eint32)strlen(withThis), -1, fromOffset, true);
 }
 
 
 EString&
 EString::IReplace(const char *replaceThis, const char *withThis, eint32 maxReplaceCount, eint32 fromOffset)
 {
-	if(fromOffset < 0 || fromOffset >= fLen) return *this;
+	if(fromOffset < 0 || fromOffset >= _Length()) return *this;
 	if(replaceThis == NULL || *replaceThis == 0 || withThis == NULL || *withThis == 0) return *this;
 
 	if(maxReplaceCount == 0) return *this;
-	if(maxReplaceCount < 0) return IReplaceAll(replaceThis, withThis, fromOffset);
-
-	int count = 0;
-	eint32 strLenReplace = (eint32)strlen(replaceThis);
-	eint32 strLenWith = (eint32)strlen(withThis);
-
-	while(true)
-	{
-		eint32 index = IFindFirst(replaceThis, fromOffset);
-
-		if(index >= 0)
-		{
-			Remove(index, strLenReplace);
-			Insert(withThis, index);
-			fromOffset = index + strLenWith;
-			count++;
-		}
-		else break;
-
-		if(count >= maxReplaceCount) break;
-	}
 
-	return *this;
+	return _Replace(replaceThis, (eint32)strlen(replaceThis), withThis, (eint32)strlen(withThis), maxReplaceCount, fromOffset, true);
 }
 
 
@@ -1878,30 +2144,7 @@ EString::ReplaceSet(const char *set_to_replace, char with)
 {
 	if(set_to_replace == NULL || *set_to_replace == 0 || with == 0) return *this;
 
-	eint32 length = (eint32)strlen(set_to_replace);
-	eint32 offset = 0;
-
-	while(true)
-	{
-		eint32 index = -1;
-		eint32 i;
-
-		for(i = 0; i < length; i++)
-		{
-			index = FindFirst(set_to_replace[i], offset);
-			if(index >= 0) break;
-		}
-
-		if(index >= 0)
-		{
-			Remove(index, 1);
-			Insert(with, 1, index);
-			offset = index + 1;
-		}
-		else break;
-	}
-
-	return *this;
+	return _ReplaceSet(set_to_replace, &with, 1, false);
 }
 
 
@@ -1910,31 +2153,7 @@ EString::ReplaceSet(const char *set_to_replace, const char *with)
 {
 	if(set_to_replace == NULL || *set_to_replace == 0 || with == NULL || *with == 0) return *this;
 
-	eint32 length = (eint32)strlen(set_to_replace);
-	eint32 strLenWith = (eint32)strlen(with);
-	eint32 offset = 0;
-
-	while(true)
-	{
-		eint32 index = -1;
-		eint32 i;
-
-		for(i = 0; i < length; i++)
-		{
-			index = FindFirst(set_to_replace[i], offset);
-			if(index >= 0) break;
-		}
-
-		if(index >= 0)
-		{
-			Remove(index, 1);
-			Insert(with, index);
-			offset = index + strLenWith;
-		}
-		else break;
-	}
-
-	return *this;
+	return _ReplaceSet(set_to_replace, with, (eint32)strlen(with), false);
 }
 
 
@@ -1944,30 +2163,7 @@ EString::IReplaceSet(const char *set_to_replace, char with)
 {
 	if(set_to_replace == NULL || *set_to_replace == 0 || with == 0) return *this;
 
-	eint32 length = (eint32)strlen(set_to_replace);
-	eint32 offset = 0;
-
-	while(true)
-	{
-		eint32 index = -1;
-		eint32 i;
-
-		for(i = 0; i < length; i++)
-		{
-			index = IFindFirst(set_to_replace[i], offset);
-			if(index >= 0) break;
-		}
-
-		if(index >= 0)
-		{
-			Remove(index, 1);
-			Insert(with, 1, index);
-			offset = index + 1;
-		}
-		else break;
-	}
-
-	return *this;
+	return _ReplaceSet(set_to_replace, &with, 1, true);
 }
 
 
@@ -1976,53 +2172,30 @@ EString::IReplaceSet(const char *set_to_replace, const char *with)
 {
 	if(set_to_replace == NULL || *set_to_replace == 0 || with == NULL || *with == 0) return *this;
 
-	eint32 length = (eint32)strlen(set_to_replace);
-	eint32 strLenWith = (eint32)strlen(with);
-	eint32 offset = 0;
-
-	while(true)
-	{
-		eint32 index = -1;
-		eint32 i;
-
-		for(i = 0; i < length; i++)
-		{
-			index = IFindFirst(set_to_replace[i], offset);
-			if(index >= 0) break;
-		}
-
-		if(index >= 0)
-		{
-			Remove(index, 1);
-			Insert(with, index);
-			offset = index + strLenWith;
-		}
-		else break;
-	}
-
-	return *this;
+	return _ReplaceSet(set_to_replace, with, (eint32)strlen(with), true);
 }
 
 
 char
 EString::operator[](eint32 index) const
 {
-	return fBuffer[index];
+	return _Buffer()[index];
 }
 
 
 char
 EString::ByteAt(eint32 index) const
 {
-	if(!fBuffer || index < 0 || index >= Length()) return 0;
-	return fBuffer[index];
+	if(!_Buffer() || index < 0 || index >= Length()) return 0;
+	return _Buffer()[index];
 }
 
 
 EString&
 EString::ToLower()
 {
-	for(eint32 i = 0; i < fLen; i++) fBuffer[i] = tolower(fBuffer[i]);
+	_InvalidateCharIndex();
+	for(eint32 i = 0; i < _Length(); i++) _Buffer()[i] = tolower(_Buffer()[i]);
 
 	return *this;
 }
@@ -2031,7 +2204,8 @@ EString::ToLower()
 EString&
 EString::ToUpper()
 {
-	for(eint32 i = 0; i < fLen; i++) fBuffer[i] = toupper(fBuffer[i]);
+	_InvalidateCharIndex();
+	for(eint32 i = 0; i < _Length(); i++) _Buffer()[i] = toupper(_Buffer()[i]);
 
 	return *this;
 }
@@ -2114,7 +2288,7 @@ EString::Capitalize()
 {
 	ToLower();
 
-	if(Length() > 0) fBuffer[0] = toupper(fBuffer[0]);
+	if(Length() > 0) _Buffer()[0] = toupper(_Buffer()[0]);
 
 	return *this;
 }
@@ -2128,16 +2302,16 @@ EString::CapitalizeEachWord()
 	eint32 length = Length();
 	if(length > 0)
 	{
-		if(fBuffer[0] != ' ') fBuffer[0] = toupper(fBuffer[0]);
+		if(_Buffer()[0] != ' ') _Buffer()[0] = toupper(_Buffer()[0]);
 
-		char *src = fBuffer;
+		char *src = _Buffer();
 		
 		while(true)
 		{
 			char *tmp = strchr(src, ' ');
 
 			if(!tmp) break;
-			if(tmp - fBuffer >= length - 1) break;
+			if(tmp - _Buffer() >= length - 1) break;
 
 			tmp++;
 			if(*tmp != ' ')
@@ -2487,56 +2661,56 @@ EString::operator<<(char c)
 EString&
 EString::operator<<(eint8 value)
 {
-	return AppendFormat("%I8i", value);
+	return AppendInt(value);
 }
 
 
 EString&
 EString::operator<<(euint8 value)
 {
-	return AppendFormat("%I8u", value);
+	return AppendUInt(value);
 }
 
 
 EString&
 EString::operator<<(eint16 value)
 {
-	return AppendFormat("%I16i", value);
+	return AppendInt(value);
 }
 
 
 EString&
 EString::operator<<(euint16 value)
 {
-	return AppendFormat("%I16u", value);
+	return AppendUInt(value);
 }
 
 
 EString&
 EString::operator<<(eint32 value)
 {
-	return AppendFormat("%I32i", value);
+	return AppendInt(value);
 }
 
 
 EString&
 EString::operator<<(euint32 value)
 {
-	return AppendFormat("%I32u", value);
+	return AppendUInt(value);
 }
 
 
 EString&
 EString::operator<<(eint64 value)
 {
-	return AppendFormat("%I64i", value);
+	return AppendInt(value);
 }
 
 
 EString&
 EString::operator<<(euint64 value)
 {
-	return AppendFormat("%I64u", value);
+	return AppendUInt(value);
 }
 
 
@@ -2611,6 +2785,33 @@ EString::PrependFormat(const char *format, ...)
 }
 
 
+EString&
+EString::AppendInt(eint64 value)
+{
+	char buf[E_FORMAT_NUMBER_MAX];
+	eint32 len = e_format_int64(buf, value);
+	return Append(buf, len);
+}
+
+
+EString&
+EString::AppendUInt(euint64 value, euint8 base)
+{
+	char buf[E_FORMAT_NUMBER_MAX];
+	eint32 len = e_format_uint64(buf, value, base, false);
+	return Append(buf, len);
+}
+
+
+EString&
+EString::AppendDouble(double value)
+{
+	char buf[E_FORMAT_NUMBER_MAX];
+	eint32 len = e_format_double(buf, value);
+	return Append(buf, len);
+}
+
+
 EStringArray*
 EString::Split(const char *delimiter, euint32 max_tokens) const
 {
@@ -2664,23 +2865,6 @@ EString::Split(const char delimiter, euint32 max_tokens) const
 }
 
 
-eint32
-EString::CountChars() const
-{
-	if(fLen <= 0) return fLen;
-	return e_utf8_strlen(fBuffer);
-}
-
-
-const char*
-EString::CharAt(eint32 index, euint8 *length) const
-{
-	if(length) *length = 0;
-	if(fLen <= index) return NULL;
-	return e_utf8_at(fBuffer, index, length);
-}
-
-
 template<class TYPE_INT>
 void e_printf_int(EString &str, TYPE_INT value, euint8 _base, int precision_width, bool upper_style)
 {
@@ -2693,16 +2877,12 @@ void e_printf_int(EString &str, TYPE_INT value, euint8 _base, int precision_widt
 		return;
 	}
 
-	TYPE_INT base = (TYPE_INT)_base;
+	// the sign is up to the caller
+	euint64 uValue = (value < (TYPE_INT)0 ? (euint64)(-(value + (TYPE_INT)1)) + 1 : (euint64)value);
 
-	while(value != (TYPE_INT)0)
-	{
-		int nIndex = (int)(value % base);
-		if(nIndex < 0) nIndex = -nIndex;
-		if(nIndex >= (int)_base) break;
-		str.Prepend((char)(nIndex <= 9 ? '0' + nIndex : (upper_style ? 'A' : 'a') + nIndex - 10), 1);
-		value /= base;
-	}
+	char buf[E_FORMAT_NUMBER_MAX];
+	eint32 len = e_format_uint64(buf, uValue, _base, upper_style);
+	str.Append(buf, len);
 
 	if(!(str.Length() < 0 || precision_width < 0 || str.Length() >= precision_width)) str.Prepend('0', precision_width - str.Length());
 }
@@ -2950,16 +3130,562 @@ eint32 e_printf_double(EString &str, long double value, int precision_width, ein
 #endif // ETK_SUPPORT_LONG_DOUBLE
 
 
-extern "C" {
+static inline int e_popcount16(euint32 v)
+{
+	v = v - ((v >> 1) & 0x5555);
+	v = (v & 0x3333) + ((v >> 2) & 0x3333);
+	v = (v + (v >> 4)) & 0x0f0f;
+	return (int)((v + (v >> 8)) & 0x1f);
+}
 
-_IMPEXP_ETK char* e_strndup(const char* src, eint32 length)
+
+// e_utf8_skip_blocks():
+//	Pass the well-formed characters from "p" (the first byte of character) by blocks until "end",
+//	"max_chars" limits the count of characters passed (-1 means no limit).
+//	Return the bytes passed, and the count of characters passed is added to "nchars".
+//	The characters passed are well-formed as RFC 3629 without NUL, so they're the same whatever
+//	the checking is; the others are left to the caller.
+static inline eint32 e_utf8_skip_blocks(const unsigned char *p, const unsigned char *end, eint32 max_chars, eint32 *nchars)
 {
-	char *dest;
-	eint32 len = 0;
+	const unsigned char *start = p;
+	eint32 count = 0;
 
-	if(src == NULL || *src == 0 || length == 0) return NULL;
+#ifdef ETK_STRING_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c0 = _mm_set1_epi8((char)0xc0);
+	const __m128i c2 = _mm_set1_epi8((char)0xc2);
+	const __m128i e0 = _mm_set1_epi8((char)0xe0);
+	const __m128i ed = _mm_set1_epi8((char)0xed);
+	const __m128i f0 = _mm_set1_epi8((char)0xf0);
+	const __m128i f4 = _mm_set1_epi8((char)0xf4);
+	const __m128i f5 = _mm_set1_epi8((char)0xf5);
+	const __m128i x90 = _mm_set1_epi8((char)0x90);
+	const __m128i xa0 = _mm_set1_epi8((char)0xa0);
 
-	if(length < 0)
+	while(end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		int high = _mm_movemask_epi8(v);
+		int k = 16, n = 16;
+
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0) break;
+
+		if(high != 0)
+		{
+			// _mm_max_epu8(v, x) == v: v >= x
+			int geC0 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, c0), v));
+			int geE0 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, e0), v));
+			int geF0 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, f0), v));
+			int cont = high & ~geC0;
+
+			// every 10xxxxxx must be where the leading byte before expects
+			if(cont != (((geC0 << 1) | (geE0 << 2) | (geF0 << 3)) & 0xffff)) break;
+
+			// no C0, C1 or F5~FF, and the second bytes after E0, ED, F0 and F4 are limited
+			int geC2 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, c2), v));
+			int geF5 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, f5), v));
+			int ge90 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, x90), v));
+			int geA0 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, xa0), v));
+			int isE0 = _mm_movemask_epi8(_mm_cmpeq_epi8(v, e0));
+			int isED = _mm_movemask_epi8(_mm_cmpeq_epi8(v, ed));
+			int isF0 = _mm_movemask_epi8(_mm_cmpeq_epi8(v, f0));
+			int isF4 = _mm_movemask_epi8(_mm_cmpeq_epi8(v, f4));
+
+			if((geC0 & ~geC2) != 0 || geF5 != 0) break;
+			if((((isE0 << 1) & ~geA0) | ((isED << 1) & geA0) |
+			    ((isF0 << 1) & ~ge90) | ((isF4 << 1) & ge90)) & 0xffff) break;
+
+			// leave the character going beyond the block to the next turn
+			if(geF0 & 0x2000) k = 13;
+			else if(geE0 & 0x4000) k = 14;
+			else if(geC0 & 0x8000) k = 15;
+
+			n = e_popcount16((euint32)(~cont & ((1 << k) - 1)));
+		}
+
+		if(max_chars >= 0 && count + n > max_chars) break;
+
+		p += k;
+		count += n;
+	}
+#else
+	// ASCII only, 4 bytes at a time
+	while(end - p >= 4)
+	{
+		euint32 w;
+		memcpy(&w, p, 4);
+
+		if((w & 0x80808080) != 0 || ((w - 0x01010101) & ~w & 0x80808080) != 0) break;
+		if(max_chars >= 0 && count + 4 > max_chars) break;
+
+		p += 4;
+		count += 4;
+	}
+#endif
+
+	*nchars += count;
+	return (eint32)(p - start);
+}
+
+
+// e_utf8_decode():
+//	Decode the character at "p" like the others here, return the bytes passed, or 0 when the
+//	character goes beyond "end". "ch" is set to -1 when it's invalid or longer than 4 bytes.
+static inline eint32 e_utf8_decode(const unsigned char *p, const unsigned char *end, eint32 *ch)
+{
+	eint32 len;
+
+	if(*p < 0x80) {*ch = (eint32)(*p); return 1;} // 0xxxxxxx : ASCII
+	else if(*p < 0xc0 || *p >= 0xfe) {*ch = -1; return 1;} // 10xxxxxx or 1111111x : invalid UTF8
+	else if(*p < 0xe0) len = 2; // 110xxxxx : 2 bytes
+	else if(*p < 0xf0) len = 3; // 1110xxxx : 3 bytes
+	else if(*p < 0xf8) len = 4; // 11110xxx : 4 bytes
+	else if(*p < 0xfc) len = 5; // 111110xx : 5 bytes, it's invalid UTF8 util this wrote
+	else len = 6; // 1111110x : 6 bytes, it's invalid UTF8 util this wrote
+
+	for(eint32 i = 1; i < len; i++)
+	{
+		if(p + i >= end) return 0;
+		if(p[i] < 0x80 || p[i] >= 0xc0) {*ch = -1; return i;} // 0xxxxxxx or 11xxxxxx : invalid UTF8
+	}
+
+	if(len == 2)
+		*ch = (((eint32)p[0] & 0x1f) << 6) | ((eint32)p[1] & 0x3f);
+	else if(len == 3)
+		*ch = (((eint32)p[0] & 0x0f) << 12) | (((eint32)p[1] & 0x3f) << 6) | ((eint32)p[2] & 0x3f);
+	else if(len == 4)
+		*ch = (((eint32)p[0] & 0x07) << 18) | (((eint32)p[1] & 0x3f) << 12) |
+		      (((eint32)p[2] & 0x3f) << 6) | ((eint32)p[3] & 0x3f);
+	else
+		*ch = -1; // don't support the 5 or 6 bytes UTF-8
+
+	return len;
+}
+
+
+static inline void e_unicode_put(eunichar32 *dest, eint32 &n, eunichar32 ch)
+{
+	dest[n++] = ch;
+}
+
+
+static inline void e_unicode_put(eunichar *dest, eint32 &n, eunichar32 ch)
+{
+	if(ch > 0xffff)
+	{
+		dest[n++] = 0xd800 | ((ch - 0x10000) >> 10);
+		dest[n++] = 0xdc00 | ((ch - 0x10000) & 0x03ff);
+	}
+	else
+	{
+		dest[n++] = (eunichar)ch;
+	}
+}
+
+
+#ifdef ETK_STRING_SSE2
+static inline void e_unicode_put_ascii16(eunichar32 *dest, __m128i v)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_unpacklo_epi8(v, zero);
+	__m128i hi = _mm_unpackhi_epi8(v, zero);
+	_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi16(lo, zero));
+	_mm_storeu_si128((__m128i*)(dest + 4), _mm_unpackhi_epi16(lo, zero));
+	_mm_storeu_si128((__m128i*)(dest + 8), _mm_unpacklo_epi16(hi, zero));
+	_mm_storeu_si128((__m128i*)(dest + 12), _mm_unpackhi_epi16(hi, zero));
+}
+
+
+static inline void e_unicode_put_ascii16(eunichar *dest, __m128i v)
+{
+	const __m128i zero = _mm_setzero_si128();
+	_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi8(v, zero));
+	_mm_storeu_si128((__m128i*)(dest + 8), _mm_unpackhi_epi8(v, zero));
+}
+#endif
+
+
+// e_utf8_convert_etc(): "count" is the units of "dest", return the units written.
+template<class T>
+static eint32 e_utf8_convert_etc(const char *str, eint32 *length, T *dest, eint32 count)
+{
+	if(length == NULL) return 0;
+	if(str == NULL || dest == NULL || count <= 0 || *length == 0) {*length = 0; return 0;}
+
+	// NUL ends the string as well
+	eint32 nbytes = (*length < 0 ? (eint32)strlen(str) : *length);
+
+	// the UTF-16 needs 2 units for the character out of BMP
+	const eint32 maxUnits = (sizeof(T) == sizeof(eunichar) ? 2 : 1);
+
+	const unsigned char *p = (const unsigned char*)str;
+	const unsigned char *end = p + nbytes;
+	eint32 n = 0;
+
+	while(p < end && count - n >= maxUnits)
+	{
+#ifdef ETK_STRING_SSE2
+		// widen 16 ASCII bytes at a time
+		while(end - p >= 16 && count - n >= 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)p);
+			if(_mm_movemask_epi8(v) != 0 || _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0) break;
+
+			e_unicode_put_ascii16(dest + n, v);
+
+			p += 16;
+			n += 16;
+		}
+		if(p >= end || count - n < maxUnits) break;
+#endif
+
+		// the well-formed characters need no checking
+		eint32 nChars = 0;
+		const unsigned char *validEnd = p + e_utf8_skip_blocks(p, end, (count - n) / maxUnits, &nChars);
+		if(validEnd > p)
+		{
+			while(p < validEnd)
+			{
+				if(*p < 0x80)
+				{
+					dest[n++] = (T)(*p++);
+				}
+				else if(*p < 0xe0)
+				{
+					dest[n++] = (T)((((eunichar32)p[0] & 0x1f) << 6) | ((eunichar32)p[1] & 0x3f));
+					p += 2;
+				}
+				else if(*p < 0xf0)
+				{
+					dest[n++] = (T)((((eunichar32)p[0] & 0x0f) << 12) | (((eunichar32)p[1] & 0x3f) << 6) |
+							((eunichar32)p[2] & 0x3f));
+					p += 3;
+				}
+				else
+				{
+					e_unicode_put(dest, n, (((eunichar32)p[0] & 0x07) << 18) | (((eunichar32)p[1] & 0x3f) << 12) |
+							       (((eunichar32)p[2] & 0x3f) << 6) | ((eunichar32)p[3] & 0x3f));
+					p += 4;
+				}
+			}
+			continue;
+		}
+
+		if(*p == 0) break;
+
+		eint32 ch;
+		eint32 len = e_utf8_decode(p, end, &ch);
+		if(len == 0) break;
+
+		p += len;
+		if(ch >= 0) e_unicode_put(dest, n, (eunichar32)ch);
+	}
+
+	*length = (eint32)((const char*)p - str);
+	return n;
+}
+
+
+// e_utf8_lead_length(): the length of character by the first byte, 0 means invalid
+static inline eint8 e_utf8_lead_length(unsigned char c)
+{
+	if(c < 0x80) return 1; // 0xxxxxxx : ASCII
+	if(c < 0xc0 || c >= 0xfe) return 0; // 10xxxxxx or 1111111x : invalid UTF8
+	if(c < 0xe0) return 2; // 110xxxxx : 2 bytes
+	if(c < 0xf0) return 3; // 1110xxxx : 3 bytes
+	if(c < 0xf8) return 4; // 11110xxx : 4 bytes
+	if(c < 0xfc) return 5; // 111110xx : 5 bytes, it's invalid UTF8 util this wrote
+	return 6; // 1111110x : 6 bytes, it's invalid UTF8 util this wrote
+}
+
+
+// e_utf8_at_etc(): like e_utf8_at(), but go on scanning from "p" where "uLen" characters were passed.
+//	"p" must be where the scanning from the beginning ever stopped at, "end" is the NUL of string.
+static const char* e_utf8_at_etc(const unsigned char *p, const unsigned char *end, eint32 uLen, eint32 index, euint8 *length)
+{
+	eint8 len = 0;
+
+	while(*p && index >= uLen)
+	{
+		p += e_utf8_skip_blocks(p, end, index - uLen, &uLen);
+		if(*p == 0) break;
+
+		len = e_utf8_lead_length(*p);
+
+		for(eint8 i = len; i >= 0; i--)
+		{
+			p++;
+			if(i <= 1) break;
+			if(*p < 0x80 || *p >= 0xc0) i = len = -(len - i + 1); // 0xxxxxxx or 11xxxxxx : invalid UTF8
+		}
+
+		if(len > 0 && len <= 4) uLen++;
+	}
+
+	if(index == uLen - 1)
+	{
+		if(len < 0) {p += len; len = 0;}
+		else p -= len;
+		if(length) *length = (euint8)len;
+		return (const char*)p;
+	}
+
+	return NULL;
+}
+
+
+void
+EString::_InvalidateCharIndex()
+{
+	e_string_heap *heap = (e_string_heap*)_Heap();
+	if(heap == NULL || heap->charIndex == NULL) return;
+
+	free(heap->charIndex);
+	heap->charIndex = NULL;
+}
+
+
+// e_string_char_index_new(): scan the whole string for the index, return NULL when out of memory.
+static e_string_char_index* e_string_char_index_new(const char *buffer, eint32 length)
+{
+	eint32 alloced = 16;
+	e_string_char_index *cIndex = (e_string_char_index*)malloc(sizeof(e_string_char_index) + sizeof(eint32) * (alloced - 1));
+	if(cIndex == NULL) return NULL;
+
+	const char *nul = (const char*)memchr(buffer, 0, (size_t)length);
+	cIndex->nbytes = (nul == NULL ? length : (eint32)(nul - buffer));
+	cIndex->count = 0;
+
+	const unsigned char *str = (const unsigned char*)buffer;
+	const unsigned char *end = str + cIndex->nbytes;
+	const unsigned char *p = str;
+	eint32 uLen = 0;
+
+	while(true)
+	{
+		eint32 nextChar = cIndex->count * ETK_STRING_CHAR_INDEX_STEP;
+
+		if(uLen == nextChar)
+		{
+			if(cIndex->count == alloced)
+			{
+				e_string_char_index *newIndex = (e_string_char_index*)realloc(cIndex,
+						sizeof(e_string_char_index) + sizeof(eint32) * (alloced * 2 - 1));
+				if(newIndex == NULL)
+				{
+					free(cIndex);
+					return NULL;
+				}
+
+				cIndex = newIndex;
+				alloced *= 2;
+			}
+
+			cIndex->offsets[cIndex->count++] = (eint32)(p - str);
+			nextChar += ETK_STRING_CHAR_INDEX_STEP;
+		}
+
+		if(p >= end) break;
+
+		// stop at every checkpoint
+		p += e_utf8_skip_blocks(p, end, nextChar - uLen, &uLen);
+		if(p >= end || uLen == nextChar) continue;
+
+		eint8 len = e_utf8_lead_length(*p);
+
+		for(eint8 i = len; i >= 0; i--)
+		{
+			p++;
+			if(i <= 1) break;
+			if(*p < 0x80 || *p >= 0xc0) i = len = 0; // 0xxxxxxx or 11xxxxxx : invalid UTF8
+		}
+
+		if(len > 0 && len <= 4) uLen++;
+	}
+
+	cIndex->nchars = uLen;
+
+	return cIndex;
+}
+
+
+// _CharIndex(): the index of the long string, it's built and published at once when there's none.
+//	Return NULL when out of memory or the atomic operations aren't available.
+void*
+EString::_CharIndex() const
+{
+#ifdef etk_string_cas_ptr
+	// the long string is always on the heap
+	e_string_heap *heap = (e_string_heap*)_Heap();
+	if(heap == NULL) return NULL;
+
+	e_string_char_index *cIndex = (e_string_char_index*)etk_string_load_ptr(&heap->charIndex);
+	if(cIndex != NULL) return cIndex;
+
+	if((cIndex = e_string_char_index_new(_Buffer(), _Length())) == NULL) return NULL;
+
+	// another thread might have published its own one meanwhile
+	if(!etk_string_cas_ptr(&heap->charIndex, (void*)NULL, (void*)cIndex))
+	{
+		free(cIndex);
+		cIndex = (e_string_char_index*)etk_string_load_ptr(&heap->charIndex);
+	}
+
+	return cIndex;
+#else
+	return NULL;
+#endif
+}
+
+
+eint32
+EString::CountChars() const
+{
+	if(_Length() <= 0) return _Length();
+	if(_Length() <= ETK_STRING_CHAR_INDEX_MIN) return e_utf8_strlen(_Buffer());
+
+	e_string_char_index *cIndex = (e_string_char_index*)_CharIndex();
+	if(cIndex == NULL) return e_utf8_strlen(_Buffer());
+
+	return cIndex->nchars;
+}
+
+
+const char*
+EString::CharAt(eint32 index, euint8 *length) const
+{
+	if(length) *length = 0;
+	if(index < 0 || _Length() <= index) return NULL;
+	if(_Length() <= ETK_STRING_CHAR_INDEX_MIN) return e_utf8_at(_Buffer(), index, length);
+
+	e_string_char_index *cIndex = (e_string_char_index*)_CharIndex();
+	if(cIndex == NULL) return e_utf8_at(_Buffer(), index, length);
+
+	if(index >= cIndex->nchars) return NULL;
+
+	// scan less than ETK_STRING_CHAR_INDEX_STEP characters from the checkpoint
+	eint32 k = index / ETK_STRING_CHAR_INDEX_STEP;
+	return e_utf8_at_etc((const unsigned char*)_Buffer() + cIndex->offsets[k],
+			     (const unsigned char*)_Buffer() + cIndex->nbytes, k * ETK_STRING_CHAR_INDEX_STEP, index, length);
+}
+
+
+EUtf8Iterator::EUtf8Iterator(const char *str, eint32 nbytes)
+{
+	_SetTo(str, nbytes);
+}
+
+
+EUtf8Iterator::EUtf8Iterator(const EString &str)
+{
+	_SetTo(str.String(), str.Length());
+}
+
+
+void
+EUtf8Iterator::_SetTo(const char *str, eint32 nbytes)
+{
+	if(str == NULL) nbytes = 0;
+	else if(nbytes < 0) nbytes = (eint32)strlen(str);
+	else if(nbytes > 0)
+	{
+		const char *nul = (const char*)memchr(str, 0, (size_t)nbytes);
+		if(nul != NULL) nbytes = (eint32)(nul - str);
+	}
+
+	fString = (const unsigned char*)str;
+	fEnd = fString + nbytes;
+
+	Rewind();
+}
+
+
+void
+EUtf8Iterator::Rewind()
+{
+	fIndex = 0;
+	_Next(fString);
+}
+
+
+void
+EUtf8Iterator::SeekToEnd()
+{
+	fIndex = e_utf8_strlen_etc((const char*)fString, (eint32)(fEnd - fString));
+	fChar = fEnd;
+	fLength = 0;
+}
+
+
+// _Next(): find the first character from "from", it goes as e_utf8_at() does
+bool
+EUtf8Iterator::_Next(const unsigned char *from)
+{
+	const unsigned char *p = from;
+
+	while(p < fEnd)
+	{
+		eint8 len = e_utf8_lead_length(*p);
+		eint8 i = 1;
+
+		const unsigned char *q = p + 1;
+		for(; i < len && q < fEnd && (*q & 0xc0) == 0x80; i++) q++;
+
+		if(i == len && len <= 4)
+		{
+			fChar = p;
+			fLength = (euint8)len;
+			return true;
+		}
+
+		p = q;
+	}
+
+	fChar = fEnd;
+	fLength = 0;
+
+	return false;
+}
+
+
+// _Prev(): the bytes after the first byte of character are all 10xxxxxx,
+//	so the previous character is found by the nearest byte not 10xxxxxx.
+bool
+EUtf8Iterator::_Prev()
+{
+	const unsigned char *p = fChar;
+
+	while(p > fString)
+	{
+		const unsigned char *q = p - 1;
+		while(q > fString && (*q & 0xc0) == 0x80) q--;
+
+		eint8 len = e_utf8_lead_length(*q);
+		if(len > 0 && len <= 4 && p - q >= len)
+		{
+			fChar = q;
+			fLength = (euint8)len;
+			fIndex--;
+			return true;
+		}
+
+		p = q;
+	}
+
+	return false;
+}
+
+
+extern "C" {
+
+_IMPEXP_ETK char* e_strndup(const char* src, eint32 length)
+{
+	char *dest;
+	eint32 len = 0;
+
+	if(src == NULL || *src == 0 || length == 0) return NULL;
+
+	if(length < 0)
 		len = (eint32)strlen(src);
 	else
 		len = min_c(length, (eint32)strlen(src));
@@ -3472,105 +4198,558 @@ _IMPEXP_ETK char* e_strdup_vprintf(const char *format, va_list ap)
 								aStr.Insert('.', 1, digits);
 						}
 
-						if(show_positive) aStr.Prepend(negative ? '-' : '+', 1);
-						else if(negative) aStr.Prepend('-', 1);
+						if(show_positive) aStr.Prepend(negative ? '-' : '+', 1);
+						else if(negative) aStr.Prepend('-', 1);
+
+						if(aStr.Length() < field_width)
+						{
+							if(!left_align)
+							{
+								char cStr = zero_padded && !has_precision_width ? '0' : ' ';
+								eint32 cOffset = (cStr == '0' && (show_positive || negative) ? 1 : 0);
+								eint32 cCount = field_width - aStr.Length();
+								if(cOffset != 0) cCount--;
+								aStr.Insert(cStr, cCount, cOffset);
+							}
+							else
+							{
+								aStr.Append(' ', field_width - aStr.Length());
+							}
+						}
+						str.Remove(offset, curOffset - offset + 1);
+						str.Insert(aStr, offset);
+						curOffset = offset + max_c(aStr.Length(), 0);
+						doBreak = true;
+					}
+					break;
+
+				case 'c':
+				case 's':
+					{
+						EString aStr;
+						if(str[curOffset] == 's')
+						{
+							char *string = va_arg(args, char*);
+							aStr = (string ? string : "(null)");
+						}
+						else
+						{
+							aStr = (char)va_arg(args, int);
+						}
+
+						if(has_precision_width && aStr.Length() > max_c(precision_width, 0))
+						{
+							aStr.Remove(precision_width, -1);
+						}
+						if(aStr.Length() < field_width)
+						{
+							if(!left_align)
+								aStr.Prepend(' ', field_width - aStr.Length());
+							else
+								aStr.Append(' ', field_width - aStr.Length());
+						}
+						str.Remove(offset, curOffset - offset + 1);
+						str.Insert(aStr, offset);
+						curOffset = offset + max_c(aStr.Length(), 0);
+						doBreak = true;
+					}
+					break;
+
+				case '%':
+					if(curOffset == offset + 1)
+					{
+						str.Remove(curOffset, 1);
+						doBreak = true;
+						break;
+					}
+
+				default:
+					str.Remove(offset, curOffset - offset);
+					curOffset = offset;
+					doBreak = true;
+					break;
+			}
+
+			if(doBreak) break;
+			else if(curOffset >= 0) curOffset++;
+		}
+
+		offset = curOffset;
+	}
+
+	va_end(args);
+
+	return (str.Length() > 0 ? e_strdup(str.String()) : NULL);
+}
+
+
+_IMPEXP_ETK char* e_strdup_printf(const char *format, ...)
+{
+	va_list args;
+	char *buffer = NULL;
+
+	if(!format) return NULL;
+
+	va_start(args, format);
+
+	buffer = e_strdup_vprintf(format, args);
+
+	va_end(args);
+
+	return buffer;
+}
+
+
+static const char e_digit_pairs[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+
+_IMPEXP_ETK eint32 e_format_uint64(char *buf, euint64 value, euint8 base, bool upper_style)
+{
+	char tmp[E_FORMAT_NUMBER_MAX];
+	char *p = tmp + sizeof(tmp);
+
+	if(buf == NULL) return 0;
+	if(!(base == 8 || base == 10 || base == 16)) {*buf = 0; return 0;}
+
+	if(base == 10)
+	{
+		// two digits a time
+		while(value >= 100)
+		{
+			euint32 n = (euint32)(value % 100);
+			value /= 100;
+			p -= 2;
+			memcpy(p, e_digit_pairs + n * 2, 2);
+		}
+
+		if(value >= 10)
+		{
+			p -= 2;
+			memcpy(p, e_digit_pairs + (euint32)value * 2, 2);
+		}
+		else
+		{
+			*--p = (char)('0' + (euint32)value);
+		}
+	}
+	else
+	{
+		const char *digits = (upper_style ? "0123456789ABCDEF" : "0123456789abcdef");
+		do {
+			*--p = digits[(euint32)(value % base)];
+			value /= base;
+		} while(value != 0);
+	}
+
+	eint32 len = (eint32)(tmp + sizeof(tmp) - p);
+	memcpy(buf, p, (size_t)len);
+	buf[len] = 0;
+
+	return len;
+}
+
+
+_IMPEXP_ETK eint32 e_format_int64(char *buf, eint64 value)
+{
+	if(buf == NULL) return 0;
+	if(value >= 0) return e_format_uint64(buf, (euint64)value, 10, false);
+
+	*buf = '-';
+	return 1 + e_format_uint64(buf + 1, (euint64)(-(value + 1)) + 1, 10, false);
+}
+
+
+// the decimal point of snprintf() depends on the locale
+static eint32 e_format_fix_decimal_point(char *buf, eint32 len)
+{
+	char *p = buf;
+
+	if(*p == '-') p++;
+	while(*p >= '0' && *p <= '9') p++;
+	if(*p == 0 || *p == 'e' || *p == '.') return len;
+
+	char *q = p;
+	while(*q != 0 && !(*q >= '0' && *q <= '9')) q++;
+
+	*p++ = '.';
+	if(q != p) memmove(p, q, strlen(q) + 1);
+
+	return (eint32)strlen(buf);
+}
+
+
+static eint32 e_format_not_finite(char *buf, double value)
+{
+#if defined(HAVE_ISFINITE) && defined(HAVE_ISNAN)
+	if(isfinite(value) == 0)
+	{
+		strcpy(buf, isnan(value) ? "nan" : (value < 0 ? "-inf" : "inf"));
+		return (eint32)strlen(buf);
+	}
+#endif
+
+	return -1;
+}
+
+
+// Grisu3 of Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers":
+// the shortest digits reading back as the same value and the closest of them, computed with 64-bit
+// integers only. It gives up for about 0.5% of the values, they go to snprintf() then.
+typedef struct e_diy_fp {
+	euint64 f;
+	eint32 e;
+} e_diy_fp;
+
+// 10^k for k = -348, -340, ..., 340, the significands are normalized and rounded to nearest
+static const struct {
+	euint64 f;
+	eint16 e;
+	eint16 k;
+} e_cached_powers[87] = {
+	{E_INT64_CONSTANT(0xfa8fd5a0081c0288), -1220, -348},
+	{E_INT64_CONSTANT(0xbaaee17fa23ebf76), -1193, -340},
+	{E_INT64_CONSTANT(0x8b16fb203055ac76), -1166, -332},
+	{E_INT64_CONSTANT(0xcf42894a5dce35ea), -1140, -324},
+	{E_INT64_CONSTANT(0x9a6bb0aa55653b2d), -1113, -316},
+	{E_INT64_CONSTANT(0xe61acf033d1a45df), -1087, -308},
+	{E_INT64_CONSTANT(0xab70fe17c79ac6ca), -1060, -300},
+	{E_INT64_CONSTANT(0xff77b1fcbebcdc4f), -1034, -292},
+	{E_INT64_CONSTANT(0xbe5691ef416bd60c), -1007, -284},
+	{E_INT64_CONSTANT(0x8dd01fad907ffc3c), -980, -276},
+	{E_INT64_CONSTANT(0xd3515c2831559a83), -954, -268},
+	{E_INT64_CONSTANT(0x9d71ac8fada6c9b5), -927, -260},
+	{E_INT64_CONSTANT(0xea9c227723ee8bcb), -901, -252},
+	{E_INT64_CONSTANT(0xaecc49914078536d), -874, -244},
+	{E_INT64_CONSTANT(0x823c12795db6ce57), -847, -236},
+	{E_INT64_CONSTANT(0xc21094364dfb5637), -821, -228},
+	{E_INT64_CONSTANT(0x9096ea6f3848984f), -794, -220},
+	{E_INT64_CONSTANT(0xd77485cb25823ac7), -768, -212},
+	{E_INT64_CONSTANT(0xa086cfcd97bf97f4), -741, -204},
+	{E_INT64_CONSTANT(0xef340a98172aace5), -715, -196},
+	{E_INT64_CONSTANT(0xb23867fb2a35b28e), -688, -188},
+	{E_INT64_CONSTANT(0x84c8d4dfd2c63f3b), -661, -180},
+	{E_INT64_CONSTANT(0xc5dd44271ad3cdba), -635, -172},
+	{E_INT64_CONSTANT(0x936b9fcebb25c996), -608, -164},
+	{E_INT64_CONSTANT(0xdbac6c247d62a584), -582, -156},
+	{E_INT64_CONSTANT(0xa3ab66580d5fdaf6), -555, -148},
+	{E_INT64_CONSTANT(0xf3e2f893dec3f126), -529, -140},
+	{E_INT64_CONSTANT(0xb5b5ada8aaff80b8), -502, -132},
+	{E_INT64_CONSTANT(0x87625f056c7c4a8b), -475, -124},
+	{E_INT64_CONSTANT(0xc9bcff6034c13053), -449, -116},
+	{E_INT64_CONSTANT(0x964e858c91ba2655), -422, -108},
+	{E_INT64_CONSTANT(0xdff9772470297ebd), -396, -100},
+	{E_INT64_CONSTANT(0xa6dfbd9fb8e5b88f), -369, -92},
+	{E_INT64_CONSTANT(0xf8a95fcf88747d94), -343, -84},
+	{E_INT64_CONSTANT(0xb94470938fa89bcf), -316, -76},
+	{E_INT64_CONSTANT(0x8a08f0f8bf0f156b), -289, -68},
+	{E_INT64_CONSTANT(0xcdb02555653131b6), -263, -60},
+	{E_INT64_CONSTANT(0x993fe2c6d07b7fac), -236, -52},
+	{E_INT64_CONSTANT(0xe45c10c42a2b3b06), -210, -44},
+	{E_INT64_CONSTANT(0xaa242499697392d3), -183, -36},
+	{E_INT64_CONSTANT(0xfd87b5f28300ca0e), -157, -28},
+	{E_INT64_CONSTANT(0xbce5086492111aeb), -130, -20},
+	{E_INT64_CONSTANT(0x8cbccc096f5088cc), -103, -12},
+	{E_INT64_CONSTANT(0xd1b71758e219652c), -77, -4},
+	{E_INT64_CONSTANT(0x9c40000000000000), -50, 4},
+	{E_INT64_CONSTANT(0xe8d4a51000000000), -24, 12},
+	{E_INT64_CONSTANT(0xad78ebc5ac620000), 3, 20},
+	{E_INT64_CONSTANT(0x813f3978f8940984), 30, 28},
+	{E_INT64_CONSTANT(0xc097ce7bc90715b3), 56, 36},
+	{E_INT64_CONSTANT(0x8f7e32ce7bea5c70), 83, 44},
+	{E_INT64_CONSTANT(0xd5d238a4abe98068), 109, 52},
+	{E_INT64_CONSTANT(0x9f4f2726179a2245), 136, 60},
+	{E_INT64_CONSTANT(0xed63a231d4c4fb27), 162, 68},
+	{E_INT64_CONSTANT(0xb0de65388cc8ada8), 189, 76},
+	{E_INT64_CONSTANT(0x83c7088e1aab65db), 216, 84},
+	{E_INT64_CONSTANT(0xc45d1df942711d9a), 242, 92},
+	{E_INT64_CONSTANT(0x924d692ca61be758), 269, 100},
+	{E_INT64_CONSTANT(0xda01ee641a708dea), 295, 108},
+	{E_INT64_CONSTANT(0xa26da3999aef774a), 322, 116},
+	{E_INT64_CONSTANT(0xf209787bb47d6b85), 348, 124},
+	{E_INT64_CONSTANT(0xb454e4a179dd1877), 375, 132},
+	{E_INT64_CONSTANT(0x865b86925b9bc5c2), 402, 140},
+	{E_INT64_CONSTANT(0xc83553c5c8965d3d), 428, 148},
+	{E_INT64_CONSTANT(0x952ab45cfa97a0b3), 455, 156},
+	{E_INT64_CONSTANT(0xde469fbd99a05fe3), 481, 164},
+	{E_INT64_CONSTANT(0xa59bc234db398c25), 508, 172},
+	{E_INT64_CONSTANT(0xf6c69a72a3989f5c), 534, 180},
+	{E_INT64_CONSTANT(0xb7dcbf5354e9bece), 561, 188},
+	{E_INT64_CONSTANT(0x88fcf317f22241e2), 588, 196},
+	{E_INT64_CONSTANT(0xcc20ce9bd35c78a5), 614, 204},
+	{E_INT64_CONSTANT(0x98165af37b2153df), 641, 212},
+	{E_INT64_CONSTANT(0xe2a0b5dc971f303a), 667, 220},
+	{E_INT64_CONSTANT(0xa8d9d1535ce3b396), 694, 228},
+	{E_INT64_CONSTANT(0xfb9b7cd9a4a7443c), 720, 236},
+	{E_INT64_CONSTANT(0xbb764c4ca7a44410), 747, 244},
+	{E_INT64_CONSTANT(0x8bab8eefb6409c1a), 774, 252},
+	{E_INT64_CONSTANT(0xd01fef10a657842c), 800, 260},
+	{E_INT64_CONSTANT(0x9b10a4e5e9913129), 827, 268},
+	{E_INT64_CONSTANT(0xe7109bfba19c0c9d), 853, 276},
+	{E_INT64_CONSTANT(0xac2820d9623bf429), 880, 284},
+	{E_INT64_CONSTANT(0x80444b5e7aa7cf85), 907, 292},
+	{E_INT64_CONSTANT(0xbf21e44003acdd2d), 933, 300},
+	{E_INT64_CONSTANT(0x8e679c2f5e44ff8f), 960, 308},
+	{E_INT64_CONSTANT(0xd433179d9c8cb841), 986, 316},
+	{E_INT64_CONSTANT(0x9e19db92b4e31ba9), 1013, 324},
+	{E_INT64_CONSTANT(0xeb96bf6ebadf77d9), 1039, 332},
+	{E_INT64_CONSTANT(0xaf87023b9bf0ee6b), 1066, 340},
+};
+
+
+static inline e_diy_fp e_diy_fp_normalize(euint64 f, eint32 e)
+{
+	e_diy_fp v;
+	v.f = f;
+	v.e = e;
+	while((v.f & ((euint64)1 << 63)) == 0) {v.f <<= 1; v.e--;}
+	return v;
+}
+
+
+// e_diy_fp_multiply(): the upper 64 bits of the product, rounded
+static inline e_diy_fp e_diy_fp_multiply(e_diy_fp a, e_diy_fp b)
+{
+	euint64 aHi = a.f >> 32, aLo = a.f & 0xffffffff;
+	euint64 bHi = b.f >> 32, bLo = b.f & 0xffffffff;
+	euint64 hiLo = aHi * bLo, loHi = aLo * bHi;
+	euint64 tmp = ((aLo * bLo) >> 32) + (hiLo & 0xffffffff) + (loHi & 0xffffffff) + ((euint64)1 << 31);
+
+	e_diy_fp r;
+	r.f = aHi * bHi + (hiLo >> 32) + (loHi >> 32) + (tmp >> 32);
+	r.e = a.e + b.e + 64;
+	return r;
+}
+
+
+// e_grisu_round_weed(): move the last digit closer to the value, fail when it's unsure
+static bool e_grisu_round_weed(char *digits, eint32 nDigits, euint64 distanceTooHighW, euint64 unsafeInterval,
+			       euint64 rest, euint64 tenKappa, euint64 unit)
+{
+	euint64 smallDistance = distanceTooHighW - unit;
+	euint64 bigDistance = distanceTooHighW + unit;
+
+	while(rest < smallDistance && unsafeInterval - rest >= tenKappa &&
+	      (rest + tenKappa < smallDistance || smallDistance - rest >= rest + tenKappa - smallDistance))
+	{
+		digits[nDigits - 1]--;
+		rest += tenKappa;
+	}
+
+	if(rest < bigDistance && unsafeInterval - rest >= tenKappa &&
+	   (rest + tenKappa < bigDistance || bigDistance - rest > rest + tenKappa - bigDistance)) return false;
+
+	return(2 * unit <= rest && rest <= unsafeInterval - 4 * unit);
+}
+
+
+// e_grisu_digit_gen(): generate the digits of "high" until they fall into (low, high),
+//	the exponent of all three is within [-60, -32].
+static bool e_grisu_digit_gen(e_diy_fp low, e_diy_fp w, e_diy_fp high, char *digits, eint32 *nDigits, eint32 *kappa)
+{
+	euint64 unit = 1;
+	euint64 tooHigh = high.f + unit;
+	euint64 unsafeInterval = tooHigh - (low.f - unit);
+	eint32 shift = -w.e;
+	euint64 one = (euint64)1 << shift;
+	euint32 integrals = (euint32)(tooHigh >> shift);
+	euint64 fractionals = tooHigh & (one - 1);
+
+	euint32 divisor = 1000000000;
+	*kappa = 10;
+	while(*kappa > 0 && divisor > integrals) {divisor /= 10; (*kappa)--;}
+
+	*nDigits = 0;
+
+	while(*kappa > 0)
+	{
+		digits[(*nDigits)++] = (char)('0' + integrals / divisor);
+		integrals %= divisor;
+		(*kappa)--;
+
+		euint64 rest = ((euint64)integrals << shift) + fractionals;
+		if(rest < unsafeInterval)
+			return e_grisu_round_weed(digits, *nDigits, tooHigh - w.f, unsafeInterval,
+						  rest, (euint64)divisor << shift, unit);
+
+		divisor /= 10;
+	}
+
+	while(true)
+	{
+		fractionals *= 10;
+		unit *= 10;
+		unsafeInterval *= 10;
+
+		digits[(*nDigits)++] = (char)('0' + (eint32)(fractionals >> shift));
+		fractionals &= one - 1;
+		(*kappa)--;
+
+		if(fractionals < unsafeInterval)
+			return e_grisu_round_weed(digits, *nDigits, (tooHigh - w.f) * unit, unsafeInterval,
+						  fractionals, one, unit);
+	}
+}
+
+
+// e_format_grisu(): the value is f * 2^e (f > 0), its neighbours are half an ulp away, or a quarter
+//	below when "lowerCloser". Print as "%.*g" with "precision" at least, return -1 when Grisu3 gave up.
+static eint32 e_format_grisu(char *buf, euint64 f, eint32 e, bool lowerCloser, bool negative, eint32 precision)
+{
+	e_diy_fp w = e_diy_fp_normalize(f, e);
+	e_diy_fp high = e_diy_fp_normalize((f << 1) + 1, e - 1);
+	e_diy_fp low;
+	low.f = (lowerCloser ? (f << 2) - 1 : (f << 1) - 1);
+	low.e = (lowerCloser ? e - 2 : e - 1);
+	low.f <<= low.e - high.e;
+	low.e = high.e;
+
+	// the cached power brings the exponent into [-60, -32]
+	eint32 k = (eint32)ceil((-60 - (w.e + 64) + 63) * 0.30102999566398114);
+	eint32 index = (348 + k - 1) / 8 + 1;
 
-						if(aStr.Length() < field_width)
-						{
-							if(!left_align)
-							{
-								char cStr = zero_padded && !has_precision_width ? '0' : ' ';
-								eint32 cOffset = (cStr == '0' && (show_positive || negative) ? 1 : 0);
-								eint32 cCount = field_width - aStr.Length();
-								if(cOffset != 0) cCount--;
-								aStr.Insert(cStr, cCount, cOffset);
-							}
-							else
-							{
-								aStr.Append(' ', field_width - aStr.Length());
-							}
-						}
-						str.Remove(offset, curOffset - offset + 1);
-						str.Insert(aStr, offset);
-						curOffset = offset + max_c(aStr.Length(), 0);
-						doBreak = true;
-					}
-					break;
+	e_diy_fp c;
+	c.f = e_cached_powers[index].f;
+	c.e = e_cached_powers[index].e;
 
-				case 'c':
-				case 's':
-					{
-						EString aStr;
-						if(str[curOffset] == 's')
-						{
-							char *string = va_arg(args, char*);
-							aStr = (string ? string : "(null)");
-						}
-						else
-						{
-							aStr = (char)va_arg(args, int);
-						}
+	char digits[20];
+	eint32 nDigits, kappa;
+	if(e_grisu_digit_gen(e_diy_fp_multiply(low, c), e_diy_fp_multiply(w, c),
+			     e_diy_fp_multiply(high, c), digits, &nDigits, &kappa) == false) return -1;
 
-						if(has_precision_width && aStr.Length() > max_c(precision_width, 0))
-						{
-							aStr.Remove(precision_width, -1);
-						}
-						if(aStr.Length() < field_width)
-						{
-							if(!left_align)
-								aStr.Prepend(' ', field_width - aStr.Length());
-							else
-								aStr.Append(' ', field_width - aStr.Length());
-						}
-						str.Remove(offset, curOffset - offset + 1);
-						str.Insert(aStr, offset);
-						curOffset = offset + max_c(aStr.Length(), 0);
-						doBreak = true;
-					}
-					break;
+	eint32 exp10 = kappa - e_cached_powers[index].k;
+	while(nDigits > 1 && digits[nDigits - 1] == '0') {nDigits--; exp10++;}
 
-				case '%':
-					if(curOffset == offset + 1)
-					{
-						str.Remove(curOffset, 1);
-						doBreak = true;
-						break;
-					}
+	precision = max_c(precision, nDigits);
+	eint32 x = nDigits + exp10 - 1; // the exponent of "%e"
 
-				default:
-					str.Remove(offset, curOffset - offset);
-					curOffset = offset;
-					doBreak = true;
-					break;
-			}
+	char *p = buf;
+	if(negative) *p++ = '-';
 
-			if(doBreak) break;
-			else if(curOffset >= 0) curOffset++;
+	if(x < -4 || x >= precision)
+	{
+		*p++ = digits[0];
+		if(nDigits > 1)
+		{
+			*p++ = '.';
+			memcpy(p, digits + 1, (size_t)(nDigits - 1));
+			p += nDigits - 1;
 		}
 
-		offset = curOffset;
+		*p++ = 'e';
+		*p++ = (x < 0 ? '-' : '+');
+		if(x < 0) x = -x;
+		if(x >= 100) {*p++ = (char)('0' + x / 100); x %= 100;}
+		*p++ = (char)('0' + x / 10);
+		*p++ = (char)('0' + x % 10);
+	}
+	else if(x < 0)
+	{
+		*p++ = '0';
+		*p++ = '.';
+		memset(p, '0', (size_t)(-x - 1));
+		p += -x - 1;
+		memcpy(p, digits, (size_t)nDigits);
+		p += nDigits;
+	}
+	else if(nDigits <= x + 1)
+	{
+		memcpy(p, digits, (size_t)nDigits);
+		memset(p + nDigits, '0', (size_t)(x + 1 - nDigits));
+		p += x + 1;
+	}
+	else
+	{
+		memcpy(p, digits, (size_t)(x + 1));
+		p += x + 1;
+		*p++ = '.';
+		memcpy(p, digits + x + 1, (size_t)(nDigits - x - 1));
+		p += nDigits - x - 1;
 	}
 
-	va_end(args);
+	*p = 0;
+	return (eint32)(p - buf);
+}
 
-	return (str.Length() > 0 ? e_strdup(str.String()) : NULL);
+
+_IMPEXP_ETK eint32 e_format_double(char *buf, double value)
+{
+	if(buf == NULL) return 0;
+
+	eint32 len = e_format_not_finite(buf, value);
+	if(len >= 0) return len;
+
+	euint64 bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	euint64 fraction = bits & ((E_INT64_CONSTANT(1) << 52) - 1);
+	eint32 exponent = (eint32)((bits >> 52) & 0x7ff);
+	bool negative = ((bits >> 63) != 0);
+
+	if(exponent == 0 && fraction == 0)
+	{
+		strcpy(buf, negative ? "-0" : "0");
+		return (eint32)strlen(buf);
+	}
+
+	if(exponent != 0x7ff)
+	{
+		len = e_format_grisu(buf, (exponent == 0 ? fraction : fraction | (E_INT64_CONSTANT(1) << 52)),
+				     (exponent == 0 ? 1 : exponent) - 1075, fraction == 0 && exponent > 1, negative, 15);
+		if(len >= 0) return len;
+	}
+
+	// 15 digits keep every decimal having 15 digits at most, 17 digits keep every double
+	for(int precision = 15; precision <= 17; precision++)
+	{
+		len = (eint32)snprintf(buf, E_FORMAT_NUMBER_MAX, "%.*g", precision, value);
+		if(len < 0 || len >= E_FORMAT_NUMBER_MAX) {*buf = 0; return 0;}
+		if(precision == 17 || strtod(buf, NULL) == value) break;
+	}
+
+	return e_format_fix_decimal_point(buf, len);
 }
 
 
-_IMPEXP_ETK char* e_strdup_printf(const char *format, ...)
+_IMPEXP_ETK eint32 e_format_float(char *buf, float value)
 {
-	va_list args;
-	char *buffer = NULL;
+	if(buf == NULL) return 0;
 
-	if(!format) return NULL;
+	eint32 len = e_format_not_finite(buf, value);
+	if(len >= 0) return len;
 
-	va_start(args, format);
+	euint32 bits;
+	memcpy(&bits, &value, sizeof(bits));
 
-	buffer = e_strdup_vprintf(format, args);
+	euint32 fraction = bits & ((1U << 23) - 1);
+	eint32 exponent = (eint32)((bits >> 23) & 0xff);
+	bool negative = ((bits >> 31) != 0);
 
-	va_end(args);
+	if(exponent == 0 && fraction == 0)
+	{
+		strcpy(buf, negative ? "-0" : "0");
+		return (eint32)strlen(buf);
+	}
 
-	return buffer;
+	// the neighbours of the float are given, so the digits are as short as the float needs
+	if(exponent != 0xff)
+	{
+		len = e_format_grisu(buf, (exponent == 0 ? fraction : fraction | (1U << 23)),
+				     (exponent == 0 ? 1 : exponent) - 150, fraction == 0 && exponent > 1, negative, 6);
+		if(len >= 0) return len;
+	}
+
+	// read back as EString::GetFloat() does
+	for(int precision = 6; precision <= 9; precision++)
+	{
+		len = (eint32)snprintf(buf, E_FORMAT_NUMBER_MAX, "%.*g", precision, (double)value);
+		if(len < 0 || len >= E_FORMAT_NUMBER_MAX) {*buf = 0; return 0;}
+		if(precision == 9 || (float)strtod(buf, NULL) == value) break;
+	}
+
+	return e_format_fix_decimal_point(buf, len);
 }
 
 
@@ -3590,18 +4769,59 @@ _IMPEXP_ETK eint32 e_utf8_strlen(const char *str)
 }
 
 
+_IMPEXP_ETK bool e_utf8_is_valid(const char *str, eint32 nbytes)
+{
+	if(str == NULL) return false;
+	if(nbytes < 0) nbytes = (eint32)strlen(str);
+
+	const unsigned char *p = (const unsigned char*)str;
+	const unsigned char *end = p + nbytes;
+	eint32 nchars = 0;
+
+	while(p < end)
+	{
+		p += e_utf8_skip_blocks(p, end, -1, &nchars);
+		if(p >= end) break;
+
+		eint32 ch;
+		eint32 len = e_utf8_decode(p, end, &ch);
+		if(len == 0 || ch < 0) return false;
+
+		// RFC 3629: the shortest form, no surrogates, up to U+10FFFF
+		if((len == 2 && ch < 0x80) ||
+		   (len == 3 && (ch < 0x800 || (ch >= 0xd800 && ch <= 0xdfff))) ||
+		   (len == 4 && (ch < 0x10000 || ch > 0x10ffff))) return false;
+
+		p += len;
+	}
+
+	return true;
+}
+
+
 _LOCAL eint32 _e_utf8_strlen_etc(const char *str, eint32 nbytes, bool check)
 {
 	if(str == NULL || *str == 0 || nbytes == 0) return 0;
 
-	eint32 strLen = (eint32)strlen(str);
-	if(nbytes < 0 || nbytes > strLen) nbytes = strLen;
+	if(nbytes < 0)
+	{
+		nbytes = (eint32)strlen(str);
+	}
+	else
+	{
+		const char *nul = (const char*)memchr(str, 0, (size_t)nbytes);
+		if(nul != NULL) nbytes = (eint32)(nul - str);
+	}
 
 	const unsigned char *p = (const unsigned char*)str;
+	const unsigned char *end = p + nbytes;
 	eint32 uLen = 0;
 
-	while(*p)
+	while(p < end)
 	{
+		p += e_utf8_skip_blocks(p, end, -1, &uLen);
+		if(p >= end) break;
+
 		eint8 len = 0;
 
 		if(*p < 0x80) len = 1; // 0xxxxxxx : ASCII
@@ -3626,7 +4846,7 @@ _LOCAL eint32 _e_utf8_strlen_etc(const char *str, eint32 nbytes, bool check)
 			}
 		}
 
-		if((eint32)(p - (const unsigned char*)str) > nbytes) break;
+		if(p > end) break;
 
 		if(len > 0 && len <= 4) uLen++;
 	}
@@ -3650,41 +4870,12 @@ _IMPEXP_ETK eint32 e_utf8_strlen_fast(const char *str, eint32 nbytes)
 _IMPEXP_ETK const char* e_utf8_at(const char *str, eint32 index, euint8 *length)
 {
 	if(length) *length = 0;
-	if(index < 0 || str == NULL || strlen(str) <= (size_t)index) return NULL;
-
-	const unsigned char *p = (const unsigned char*)str;
-	eint32 uLen = 0;
-	eint8 len = 0;
-
-	while(*p && index >= uLen)
-	{
-		if(*p < 0x80) len = 1; // 0xxxxxxx : ASCII
-		else if(*p < 0xc0 || *p >= 0xfe) len = 0; // 10xxxxxx or 1111111x : invalid UTF8
-		else if(*p < 0xe0) len = 2; // 110xxxxx : 2 bytes
-		else if(*p < 0xf0) len = 3; // 1110xxxx : 3 bytes
-		else if(*p < 0xf8) len = 4; // 11110xxx : 4 bytes
-		else if(*p < 0xfc) len = 5; // 111110xx : 5 bytes, it's invalid UTF8 util this wrote
-		else if(*p < 0xfe) len = 6; // 1111110x : 6 bytes, it's invalid UTF8 util this wrote
-
-		for(eint8 i = len; i >= 0; i--)
-		{
-			p++;
-			if(i <= 1) break;
-			if(*p < 0x80 || *p >= 0xc0) i = len = -(len - i + 1); // 0xxxxxxx or 11xxxxxx : invalid UTF8
-		}
+	if(index < 0 || str == NULL) return NULL;
 
-		if(len > 0 && len <= 4) uLen++;
-	}
-
-	if(index == uLen - 1)
-	{
-		if(len < 0) {p += len; len = 0;}
-		else p -= len;
-		if(length) *length = (euint8)len;
-		return (const char*)p;
-	}
+	size_t strLen = strlen(str);
+	if(strLen <= (size_t)index) return NULL;
 
-	return NULL;
+	return e_utf8_at_etc((const unsigned char*)str, (const unsigned char*)str + strLen, 0, index, length);
 }
 
 
@@ -3731,6 +4922,12 @@ _IMPEXP_ETK const char* e_utf8_next(const char *str, euint8 *length)
 }
 
 
+_IMPEXP_ETK eint32 e_utf8_convert_to_utf32_etc(const char *str, eint32 *length, eunichar32 *dest, eint32 count)
+{
+	return e_utf8_convert_etc(str, length, dest, count);
+}
+
+
 _IMPEXP_ETK eunichar* e_utf8_convert_to_unicode(const char *str, eint32 length)
 {
 	if(str == NULL || *str == 0 || length == 0) return NULL;
@@ -3741,71 +4938,8 @@ _IMPEXP_ETK eunichar* e_utf8_convert_to_unicode(const char *str, eint32 length)
 	eunichar* unicode = (eunichar*)malloc(sizeof(eunichar) * (size_t)(length + 1));
 	if(!unicode) return NULL;
 
-	const unsigned char *p = (const unsigned char*)str;
-	eunichar *tmp = unicode;
-
-	while(*p)
-	{
-		eint8 len = 0;
-
-		if(*p < 0x80) len = 1; // 0xxxxxxx : ASCII
-		else if(*p < 0xc0 || *p >= 0xfe) len = 0; // 10xxxxxx or 1111111x : invalid UTF8
-		else if(*p < 0xe0) len = 2; // 110xxxxx : 2 bytes
-		else if(*p < 0xf0) len = 3; // 1110xxxx : 3 bytes
-		else if(*p < 0xf8) len = 4; // 11110xxx : 4 bytes
-		else if(*p < 0xfc) len = 5; // 111110xx : 5 bytes, it's invalid UTF8 util this wrote
-		else if(*p < 0xfe) len = 6; // 1111110x : 6 bytes, it's invalid UTF8 util this wrote
-
-		for(eint8 i = len; i >= 0; i--)
-		{
-			p++;
-			if(i <= 1) break;
-			if(*p < 0x80 || *p >= 0xc0) i = len = 0; // 0xxxxxxx or 11xxxxxx : invalid UTF8
-		}
-
-		if((eint32)((const char*)p - str) > length) break;
-
-		if(len > 0)
-		{
-			p -= len;
-			if(len == 1)
-			{
-				*tmp = (eunichar)(*p++);
-			}
-			else if(len == 2)
-			{
-				*tmp = ((eunichar)(*p++) & 0x1f) << 6;
-				*tmp |= (eunichar)(*p++) & 0x3f;
-			}
-			else if(len == 3)
-			{
-				*tmp = ((eunichar)(*p++) & 0x0f) << 12;
-				*tmp |= ((eunichar)(*p++) & 0x3f) << 6;
-				*tmp |= (eunichar)(*p++) & 0x3f;
-			}
-			else if(len == 4)
-			{
-				eunichar32 tmp32 = ((eunichar32)(*p++) & 0x07) << 18;
-				tmp32 |= ((eunichar32)(*p++) & 0x3f) << 12;
-				tmp32 |= ((eunichar32)(*p++) & 0x3f) << 6;
-				tmp32 |= (eunichar32)(*p++) & 0x3f;
-
-				if(tmp32 > 0xffff)
-				{
-					*tmp++ = 0xd800 | ((tmp32 - 0x10000) >> 10);
-					*tmp = 0xdc00 | ((tmp32 - 0x10000) & 0x03ff);
-				}
-				else
-				{
-					*tmp = tmp32;
-				}
-			}
-			else {p += len; continue;} // don't support the 5 or 6 bytes UTF-8
-
-			tmp++;
-		}
-	}
-	*tmp = 0;
+	// no more units than bytes
+	unicode[e_utf8_convert_etc(str, &length, unicode, length + 1)] = 0;
 
 	return unicode;
 }
@@ -3821,61 +4955,7 @@ _IMPEXP_ETK eunichar32* e_utf8_convert_to_utf32(const char *str, eint32 length)
 	eunichar32* unicode = (eunichar32*)malloc(sizeof(eunichar32) * (size_t)(length + 1));
 	if(unicode == NULL) return NULL;
 
-	const unsigned char *p = (const unsigned char*)str;
-	eunichar32 *tmp = unicode;
-
-	while(*p)
-	{
-		eint8 len = 0;
-
-		if(*p < 0x80) len = 1; // 0xxxxxxx : ASCII
-		else if(*p < 0xc0 || *p >= 0xfe) len = 0; // 10xxxxxx or 1111111x : invalid UTF8
-		else if(*p < 0xe0) len = 2; // 110xxxxx : 2 bytes
-		else if(*p < 0xf0) len = 3; // 1110xxxx : 3 bytes
-		else if(*p < 0xf8) len = 4; // 11110xxx : 4 bytes
-		else if(*p < 0xfc) len = 5; // 111110xx : 5 bytes, it's invalid UTF8 util this wrote
-		else if(*p < 0xfe) len = 6; // 1111110x : 6 bytes, it's invalid UTF8 util this wrote
-
-		for(eint8 i = len; i >= 0; i--)
-		{
-			p++;
-			if(i <= 1) break;
-			if(*p < 0x80 || *p >= 0xc0) i = len = 0; // 0xxxxxxx or 11xxxxxx : invalid UTF8
-		}
-
-		if((eint32)((const char*)p - str) > length) break;
-
-		if(len > 0)
-		{
-			p -= len;
-			if(len == 1)
-			{
-				*tmp = (eunichar32)(*p++);
-			}
-			else if(len == 2)
-			{
-				*tmp = ((eunichar32)(*p++) & 0x1f) << 6;
-				*tmp |= (eunichar32)(*p++) & 0x3f;
-			}
-			else if(len == 3)
-			{
-				*tmp = ((eunichar32)(*p++) & 0x0f) << 12;
-				*tmp |= ((eunichar32)(*p++) & 0x3f) << 6;
-				*tmp |= (eunichar32)(*p++) & 0x3f;
-			}
-			else if(len == 4)
-			{
-				*tmp = ((eunichar32)(*p++) & 0x07) << 18;
-				*tmp |= ((eunichar32)(*p++) & 0x3f) << 12;
-				*tmp |= ((eunichar32)(*p++) & 0x3f) << 6;
-				*tmp |= (eunichar32)(*p++) & 0x3f;
-			}
-			else {p += len; continue;} // don't support the 5 or 6 bytes UTF-8
-
-			tmp++;
-		}
-	}
-	*tmp = 0;
+	unicode[e_utf8_convert_etc(str, &length, unicode, length)] = 0;
 
 	return unicode;
 }
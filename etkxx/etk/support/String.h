@@ -44,6 +44,19 @@ _IMPEXP_ETK char*		e_strndup(const char *src, eint32 length);
 _IMPEXP_ETK char*		e_strdup_vprintf(const char *format, va_list ap);
 _IMPEXP_ETK char*		e_strdup_printf(const char *format, ...);
 
+/*
+ * Number formatting without allocation: the text goes to "buf" of E_FORMAT_NUMBER_MAX bytes
+ * at least, terminated by NUL, return the length.
+ * "base" of e_format_uint64() must be 8, 10 or 16.
+ * e_format_double() and e_format_float() give the shortest text reading back as the same value,
+ * the decimal point is always '.'.
+ */
+#define E_FORMAT_NUMBER_MAX	32
+_IMPEXP_ETK eint32		e_format_int64(char *buf, eint64 value);
+_IMPEXP_ETK eint32		e_format_uint64(char *buf, euint64 value, euint8 base, bool upper_style);
+_IMPEXP_ETK eint32		e_format_double(char *buf, double value);
+_IMPEXP_ETK eint32		e_format_float(char *buf, float value);
+
 _IMPEXP_ETK eunichar*		e_utf8_convert_to_unicode(const char *str, eint32 length);
 _IMPEXP_ETK eunichar32*		e_utf8_convert_to_utf32(const char *str, eint32 length);
 _IMPEXP_ETK char*		e_unicode_convert_to_utf8(const eunichar *str, eint32 ulength);
@@ -51,7 +64,14 @@ _IMPEXP_ETK eunichar32*		e_unicode_convert_to_utf32(const eunichar *str, eint32
 _IMPEXP_ETK char*		e_utf32_convert_to_utf8(const eunichar32 *str, eint32 ulength);
 _IMPEXP_ETK eunichar*		e_utf32_convert_to_unicode(const eunichar32 *str, eint32 ulength);
 
+/* e_utf8_convert_to_utf32_etc(): convert without allocating, at most "count" characters are
+ * written to "dest" without the terminator. "length" is the bytes to convert (-1 means until
+ * the end of string), it's set to the bytes converted on return, so that the rest could be
+ * converted by the next call. Return the count of characters written. */
+_IMPEXP_ETK eint32		e_utf8_convert_to_utf32_etc(const char *str, eint32 *length, eunichar32 *dest, eint32 count);
+
 _IMPEXP_ETK bool		e_utf8_is_token(const char *str);
+_IMPEXP_ETK bool		e_utf8_is_valid(const char *str, eint32 nbytes); /* well-formed as RFC 3629 */
 _IMPEXP_ETK eint32		e_utf8_strlen(const char *str);
 _IMPEXP_ETK eint32		e_utf8_strlen_etc(const char *str, eint32 nbytes);
 _IMPEXP_ETK eint32		e_utf8_strlen_fast(const char *str, eint32 nbytes); /* none checking */
@@ -86,6 +106,13 @@ public:
 	EString(const char *str, eint32 maxLength);
 	~EString();
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	// moving takes the buffer of "str" without copying when it's on the heap,
+	// "str" becomes empty after that.
+	EString(EString &&str);
+	EString		&operator=(EString &&str);
+#endif
+
 	const char	*String() const;
 
 	eint32		Length() const; // ASCII
@@ -93,6 +120,12 @@ public:
 
 	char		operator[](eint32 index) const; // ASCII
 	char		ByteAt(eint32 index) const; // ASCII
+
+	// CharAt(): for the long string, the byte offsets of every 64th character are
+	//	remembered at the first call and forgotten once the string changed, so that
+	//	accessing the characters one by one or at random doesn't scan from the beginning.
+	//	The offsets are published atomically, the const string is safe to read from
+	//	several threads at once.
 	const char*	CharAt(eint32 index, euint8 *length = NULL) const; // UTF-8
 
 	EString 	&operator=(const EString &str);
@@ -127,6 +160,11 @@ public:
 	EString		&Append(char c, eint32 count);
 	EString		&AppendFormat(const char *format, ...);
 
+	// AppendInt(), AppendDouble(): see e_format_int64(), e_format_double()
+	EString		&AppendInt(eint64 value);
+	EString		&AppendUInt(euint64 value, euint8 base = 10);
+	EString		&AppendDouble(double value);
+
 	EString		&Prepend(const EString &str);
 	EString		&Prepend(const EString &str, eint32 length);
 	EString		&Prepend(const char *str);
@@ -298,20 +336,142 @@ public:
 	EStringArray	*Split(const char delimiter, euint32 max_tokens = E_MAXUINT32 - 1) const;
 
 	// SetMinimumBufferSize: It's NOT to be absolute minimum buffer size even it return "true",
-	//                       just for speed up sometimes. The "length" include the null character
+	//                       just for speed up sometimes. The "length" include the null character.
+	//                       The short string always has its inline buffer, so the size within
+	//                       it isn't remembered and MinimumBufferSize() returns 0 for it.
 	bool		SetMinimumBufferSize(eint32 length);
 	eint32		MinimumBufferSize() const;
 
 private:
-	eint32 fLen;
-	eint32 fLenReal;
-	eint32 fMinBufferSize;
-	char *fBuffer;
-
+	// The short string (up to 22 bytes) is stored in "fInline" with the null character
+	// without allocating, the last byte of "fInline" is its length then. Otherwise the
+	// last byte is a mark, the long string is "fLong.fHeap" on the heap with its length
+	// and the size of buffer, or there's no buffer at all.
+	union {
+		struct {
+			char *fHeap;
+			eint32 fLen;
+			eint32 fLenReal;
+		} fLong;
+		char fInline[24];
+	};
+
+	char *_Buffer() const;
+	void *_Heap() const;
+	eint32 _Length() const;
+	eint32 _BufferSize() const;
+	void _SetLength(eint32 length);
+	void _SetNoBuffer();
 	bool _Resize(eint32 length);
+	bool _Realloc(eint32 length_to_alloc);
+	void _FreeBuffer();
+	void _Steal(EString &from);
+
+	EString &_Replace(const char *replaceThis, eint32 replaceLen, const char *withThis, eint32 withLen,
+			  eint32 maxCount, eint32 fromOffset, bool ignoreCase);
+	EString &_ReplaceSet(const char *set, const char *with, eint32 withLen, bool ignoreCase, eint32 fromOffset = 0);
+
+	void *_CharIndex() const;
+	void _InvalidateCharIndex();
 };
 
 
+// EUtf8Iterator: walks through the UTF-8 characters of string forward or backward.
+//	The characters are exactly the ones e_utf8_at() returns, the invalid bytes are skipped.
+//	The string must not be changed or freed while iterating, for example:
+//		for(EUtf8Iterator iter(str); iter.Char() != NULL; iter.Next()) {...}
+//		EUtf8Iterator iter(str);
+//		iter.SeekToEnd();
+//		while(iter.Prev()) {...}
+class _IMPEXP_ETK EUtf8Iterator {
+public:
+	EUtf8Iterator(const char *str, eint32 nbytes = -1);
+	EUtf8Iterator(const EString &str);
+
+	// Char(): return the current character, NULL after the last one
+	const char	*Char(euint8 *length = NULL) const;
+	eint32		Offset() const; // in bytes
+	eint32		Index() const; // in characters
+
+	// Next(): move to the next character, return false when there's no more
+	bool		Next();
+	// Prev(): move to the previous character, return false and keep the position
+	//	when it's the first one
+	bool		Prev();
+
+	void		Rewind();
+	void		SeekToEnd();
+
+private:
+	const unsigned char *fString;
+	const unsigned char *fEnd;
+	const unsigned char *fChar;
+	euint8 fLength;
+	eint32 fIndex;
+
+	void _SetTo(const char *str, eint32 nbytes);
+	bool _Next(const unsigned char *from);
+	bool _Prev();
+};
+
+
+inline const char*
+EUtf8Iterator::Char(euint8 *length) const
+{
+	if(length) *length = fLength;
+	return (fChar < fEnd ? (const char*)fChar : NULL);
+}
+
+
+inline eint32
+EUtf8Iterator::Offset() const
+{
+	return (eint32)(fChar - fString);
+}
+
+
+inline eint32
+EUtf8Iterator::Index() const
+{
+	return fIndex;
+}
+
+
+inline bool
+EUtf8Iterator::Next()
+{
+	if(fChar >= fEnd) return false;
+
+	// ASCII goes without calling
+	const unsigned char *p = fChar + fLength;
+	if(p < fEnd && *p < 0x80)
+	{
+		fChar = p;
+		fLength = 1;
+		fIndex++;
+		return true;
+	}
+
+	fIndex++;
+	return _Next(p);
+}
+
+
+inline bool
+EUtf8Iterator::Prev()
+{
+	if(fChar > fString && *(fChar - 1) < 0x80)
+	{
+		fChar--;
+		fLength = 1;
+		fIndex--;
+		return true;
+	}
+
+	return _Prev();
+}
+
+
 #endif /* __cplusplus */
 
 #endif /* __ETK_STRING_H__ */
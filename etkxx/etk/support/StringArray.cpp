@@ -27,50 +27,143 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <stdlib.h>
+#include <string.h>
+
+#include <etk/kernel/Debug.h>
+
 #include "StringArray.h"
 
 
 typedef struct __string_node__ {
-	EString *str;
+	EString str;
 	void *data;
 
 	__string_node__()
+		: data(NULL)
 	{
-		str = new EString();
-		data = NULL;
 	}
+} __string_node__;
+
+
+// the hash index is used when there are at least ETK_STRING_ARRAY_INDEX_MIN items
+#define ETK_STRING_ARRAY_INDEX_MIN	8
+
+typedef struct __string_slot__ {
+	euint32 hash;
+	eint32 index; // -1 means empty
+} __string_slot__;
+
+// The index is built at once by the first finding and published atomically, so the const array
+// could be searched by several threads; only the changing methods append to it or free it.
+typedef struct __string_index__ {
+	eint32 count; // the items indexed
+	eint32 capacity; // power of 2
+	__string_slot__ *slots;
+	__string_slot__ * volatile islots; // for IFindString(), NULL until it's called
+} __string_index__;
 
-	~__string_node__()
+#if defined(_MSC_VER)
+#include <windows.h>
+#define etk_string_array_cas_ptr(ptr, oldValue, newValue)	\
+	(InterlockedCompareExchangePointer((PVOID volatile*)(ptr), (PVOID)(newValue), (PVOID)(oldValue)) == (PVOID)(oldValue))
+#define etk_string_array_load_ptr(ptr)			InterlockedCompareExchangePointer((PVOID volatile*)(ptr), NULL, NULL)
+#elif defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+#define etk_string_array_cas_ptr(ptr, oldValue, newValue)	__sync_bool_compare_and_swap(ptr, oldValue, newValue)
+#define etk_string_array_load_ptr(ptr)			__atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#elif defined(__GNUC__)
+#define etk_string_array_cas_ptr(ptr, oldValue, newValue)	__sync_bool_compare_and_swap(ptr, oldValue, newValue)
+#define etk_string_array_load_ptr(ptr)			__sync_val_compare_and_swap(ptr, NULL, NULL)
+#endif
+
+
+static inline euint32 etk_string_hash(const char *str, bool ignoreCase)
+{
+	// FNV-1a
+	euint32 hash = 2166136261U;
+
+	if(str == NULL) return hash;
+
+	for(const unsigned char *p = (const unsigned char*)str; *p != 0; p++)
 	{
-		if(str) delete str;
+		unsigned char c = *p;
+		if(ignoreCase && c >= 'A' && c <= 'Z') c |= 0x20;
+		hash = (hash ^ c) * 16777619U;
+	}
+
+	return hash;
+}
+
+
+static inline void etk_string_slot_add(__string_slot__ *slots, eint32 capacity, euint32 hash, eint32 index)
+{
+	eint32 mask = capacity - 1;
+	eint32 i = (eint32)(hash & (euint32)mask);
+
+	while(slots[i].index >= 0) i = (i + 1) & mask;
+
+	slots[i].hash = hash;
+	slots[i].index = index;
+}
+
+
+// etk_string_slots_new(): the slots of the first "count" items, return NULL when out of memory.
+static __string_slot__* etk_string_slots_new(const EList *list, eint32 count, eint32 capacity, bool ignoreCase)
+{
+	__string_slot__ *slots = (__string_slot__*)malloc(sizeof(__string_slot__) * (size_t)capacity);
+	if(slots == NULL) return NULL;
+
+	memset(slots, 0xff, sizeof(__string_slot__) * (size_t)capacity);
+
+	for(eint32 i = 0; i < count; i++)
+	{
+		const char *str = ((const __string_node__*)list->ItemAt(i))->str.String();
+		etk_string_slot_add(slots, capacity, etk_string_hash(str, ignoreCase), i);
 	}
-} __string_node__;
+
+	return slots;
+}
+
+
+static void etk_string_index_free(__string_index__ *sIndex)
+{
+	if(sIndex == NULL) return;
+
+	if(sIndex->slots) free(sIndex->slots);
+	if(sIndex->islots) free(sIndex->islots);
+	free(sIndex);
+}
 
 
 EStringArray::EStringArray()
+	: fIndex(NULL)
 {
 }
 
 
 EStringArray::EStringArray(const char *string, void *attach_data)
+	: fIndex(NULL)
 {
 	AddItem(string, attach_data);
 }
 
 
 EStringArray::EStringArray(const EString &string, void *attach_data)
+	: fIndex(NULL)
 {
 	AddItem(string, attach_data);
 }
 
 
 EStringArray::EStringArray(const char **array)
+	: fIndex(NULL)
 {
 	operator=(array);
 }
 
 
 EStringArray::EStringArray(const EStringArray &array)
+	: fIndex(NULL)
 {
 	operator=(array);
 }
@@ -82,6 +175,110 @@ EStringArray::~EStringArray()
 }
 
 
+void
+EStringArray::_InvalidateIndex()
+{
+	etk_string_index_free((__string_index__*)fIndex);
+	fIndex = NULL;
+}
+
+
+// _IndexItem(): the item appended is added to the index when there's one
+void
+EStringArray::_IndexItem(eint32 index)
+{
+	__string_index__ *sIndex = (__string_index__*)fIndex;
+	if(sIndex == NULL) return;
+
+	if(index != sIndex->count || (index + 1) * 2 > sIndex->capacity)
+	{
+		// rebuilt by the next finding
+		_InvalidateIndex();
+		return;
+	}
+
+	const __string_node__ *node = (const __string_node__*)list.ItemAt(index);
+	etk_string_slot_add(sIndex->slots, sIndex->capacity, etk_string_hash(node->str.String(), false), index);
+	if(sIndex->islots) etk_string_slot_add(sIndex->islots, sIndex->capacity, etk_string_hash(node->str.String(), true), index);
+	sIndex->count++;
+}
+
+
+// _FindByIndex(): return -2 when there's no index
+eint32
+EStringArray::_FindByIndex(const char *string, eint32 startIndex, bool invert, bool ignoreCase) const
+{
+	eint32 count = list.CountItems();
+	if(count < ETK_STRING_ARRAY_INDEX_MIN) return -2;
+
+#ifdef etk_string_array_cas_ptr
+	__string_index__ *sIndex = (__string_index__*)etk_string_array_load_ptr(&fIndex);
+	if(sIndex == NULL)
+	{
+		if((sIndex = (__string_index__*)malloc(sizeof(__string_index__))) == NULL) return -2;
+
+		eint32 capacity = 16;
+		while(capacity < count * 2 && capacity < (E_MAXINT32 >> 1)) capacity <<= 1;
+
+		sIndex->count = count;
+		sIndex->capacity = capacity;
+		sIndex->islots = NULL;
+		if((sIndex->slots = etk_string_slots_new(&list, count, capacity, false)) == NULL)
+		{
+			free(sIndex);
+			return -2;
+		}
+
+		// another thread might have published its own one meanwhile
+		if(!etk_string_array_cas_ptr(&((EStringArray*)this)->fIndex, (void*)NULL, (void*)sIndex))
+		{
+			etk_string_index_free(sIndex);
+			sIndex = (__string_index__*)etk_string_array_load_ptr(&fIndex);
+		}
+	}
+
+	const __string_slot__ *slots = sIndex->slots;
+
+	if(ignoreCase && (slots = (const __string_slot__*)etk_string_array_load_ptr(&sIndex->islots)) == NULL)
+	{
+		__string_slot__ *islots = etk_string_slots_new(&list, sIndex->count, sIndex->capacity, true);
+		if(islots == NULL) return -2;
+
+		if(!etk_string_array_cas_ptr(&sIndex->islots, (__string_slot__*)NULL, islots))
+		{
+			free(islots);
+			islots = (__string_slot__*)etk_string_array_load_ptr(&sIndex->islots);
+		}
+
+		slots = islots;
+	}
+
+	if(string != NULL && *string == 0) string = NULL;
+
+	euint32 hash = etk_string_hash(string, ignoreCase);
+	eint32 mask = sIndex->capacity - 1;
+	eint32 found = -1;
+
+	for(eint32 i = (eint32)(hash & (euint32)mask); slots[i].index >= 0; i = (i + 1) & mask)
+	{
+		eint32 index = slots[i].index;
+
+		if(slots[i].hash != hash) continue;
+		if(invert ? (index > startIndex || index <= found) : (index < startIndex || (found >= 0 && index >= found))) continue;
+
+		const EString *str = &((const __string_node__*)list.ItemAt(index))->str;
+		if(string == NULL ? str->Length() > 0 : (ignoreCase ? str->ICompare(string) : str->Compare(string)) != 0) continue;
+
+		found = index;
+	}
+
+	return found;
+#else
+	return -2;
+#endif
+}
+
+
 void
 EStringArray::MakeEmpty()
 {
@@ -90,6 +287,8 @@ EStringArray::MakeEmpty()
 		for(eint32 i = 0; i < list.CountItems(); i++) delete (__string_node__*)list.ItemAt(i);
 		list.MakeEmpty();
 	}
+
+	_InvalidateIndex();
 }
 
 
@@ -178,9 +377,9 @@ bool
 EStringArray::AddItem(const char *item, void *attach_data)
 {
 	__string_node__ *data = new __string_node__;
-	if(!data || !data->str) {if(data) delete data; return false;}
+	if(!data) return false;
 
-	data->str->SetTo(item);
+	data->str.SetTo(item);
 	data->data = attach_data;
 
 	if(!list.AddItem((void*)data))
@@ -189,6 +388,8 @@ EStringArray::AddItem(const char *item, void *attach_data)
 		return false;
 	}
 
+	_IndexItem(list.CountItems() - 1);
+
 	return true;
 }
 
@@ -197,9 +398,9 @@ bool
 EStringArray::AddItem(const char *item, eint32 atIndex, void *attach_data)
 {
 	__string_node__ *data = new __string_node__;
-	if(!data || !data->str) {if(data) delete data; return false;}
+	if(!data) return false;
 
-	data->str->SetTo(item);
+	data->str.SetTo(item);
 	data->data = attach_data;
 
 	if(!list.AddItem((void*)data, atIndex))
@@ -208,6 +409,8 @@ EStringArray::AddItem(const char *item, eint32 atIndex, void *attach_data)
 		return false;
 	}
 
+	_IndexItem(atIndex);
+
 	return true;
 }
 
@@ -235,13 +438,14 @@ EStringArray::AddArray(const EStringArray &array)
 	for(eint32 i = 0; i < array.list.CountItems(); i++)
 	{
 		const __string_node__ *node = (const __string_node__*)array.list.ItemAt(i);
-		if(!node || !node->str) continue;
-		if(_array.AddItem(node->str->String(), node->data) == false) return false;
+		if(!node) continue;
+		if(_array.AddItem(node->str.String(), node->data) == false) return false;
 	}
 
 	if(list.AddList(&_array.list))
 	{
 		_array.list.MakeEmpty();
+		_InvalidateIndex();
 		return true;
 	}
 
@@ -259,13 +463,14 @@ EStringArray::AddArray(const EStringArray &array, eint32 atIndex)
 	for(eint32 i = 0; i < array.list.CountItems(); i++)
 	{
 		const __string_node__ *node = (const __string_node__*)array.list.ItemAt(i);
-		if(!node || !node->str) continue;
-		if(_array.AddItem(node->str->String(), node->data) == false) return false;
+		if(!node) continue;
+		if(_array.AddItem(node->str.String(), node->data) == false) return false;
 	}
 
 	if(list.AddList(&_array.list, atIndex))
 	{
 		_array.list.MakeEmpty();
+		_InvalidateIndex();
 		return true;
 	}
 
@@ -279,7 +484,7 @@ EStringArray::ItemAt(eint32 index, void **attach_data) const
 	const __string_node__ *node = (const __string_node__*)list.ItemAt(index);
 	if(!node) return NULL;
 	if(attach_data) *attach_data = node->data;
-	return node->str;
+	return &node->str;
 }
 
 
@@ -289,7 +494,7 @@ EStringArray::FirstItem(void **attach_data) const
 	const __string_node__ *node = (const __string_node__*)list.FirstItem();
 	if(!node) return NULL;
 	if(attach_data) *attach_data = node->data;
-	return node->str;
+	return &node->str;
 }
 
 
@@ -299,7 +504,7 @@ EStringArray::LastItem(void **attach_data) const
 	const __string_node__ *node = (const __string_node__*)list.LastItem();
 	if(!node) return NULL;
 	if(attach_data) *attach_data = node->data;
-	return node->str;
+	return &node->str;
 }
 
 
@@ -311,6 +516,7 @@ EStringArray::RemoveItem(eint32 index)
 	if(node)
 	{
 		delete node;
+		_InvalidateIndex();
 		return true;
 	}
 
@@ -338,6 +544,7 @@ EStringArray::RemoveItems(eint32 index, eint32 count)
 	{
 		for(eint32 i = 0; i < list_store.CountItems(); i++) delete (__string_node__*)list_store.ItemAt(i);
 		list_store.MakeEmpty();
+		_InvalidateIndex();
 		return true;
 	}
 
@@ -350,10 +557,11 @@ EStringArray::ReplaceItem(eint32 index, const char *string, void *attach_data)
 {
 	__string_node__ *node = (__string_node__*)list.ItemAt(index);
 
-	if(node && node->str)
+	if(node)
 	{
-		node->str->SetTo(string);
+		node->str.SetTo(string);
 		node->data = attach_data;
+		_InvalidateIndex();
 		return true;
 	}
 
@@ -366,10 +574,11 @@ EStringArray::ReplaceItem(eint32 index, const EString &string, void *attach_data
 {
 	__string_node__ *node = (__string_node__*)list.ItemAt(index);
 
-	if(node && node->str)
+	if(node)
 	{
-		node->str->SetTo(string);
+		node->str.SetTo(string);
 		node->data = attach_data;
+		_InvalidateIndex();
 		return true;
 	}
 
@@ -380,7 +589,46 @@ EStringArray::ReplaceItem(eint32 index, const EString &string, void *attach_data
 EStringArray&
 EStringArray::SortItems(int (*cmp)(const EString**, const EString**))
 {
-	list.SortItems((int (*)(const void*, const void*))cmp);
+	eint32 count = list.CountItems();
+	if(cmp == NULL || count < 2) return *this;
+
+	// bottom-up merge sort on the node pointers, the items stay where they are
+	void **items = list.Items();
+	void **tmp = (void**)malloc(sizeof(void*) * (size_t)count);
+	if(tmp == NULL)
+	{
+		ETK_WARNING("[SUPPORT]: %s --- Unable to allocate memory.", __PRETTY_FUNCTION__);
+		return *this;
+	}
+
+	void **src = items, **dst = tmp;
+	for(eint32 width = 1; width < count; width *= 2)
+	{
+		for(eint32 left = 0; left < count; left += width * 2)
+		{
+			eint32 mid = min_c(left + width, count);
+			eint32 right = min_c(left + width * 2, count);
+			eint32 i = left, j = mid, k = left;
+
+			while(i < mid && j < right)
+			{
+				const EString *a = &((__string_node__*)src[i])->str;
+				const EString *b = &((__string_node__*)src[j])->str;
+				dst[k++] = ((*cmp)(&b, &a) < 0 ? src[j++] : src[i++]);
+			}
+			while(i < mid) dst[k++] = src[i++];
+			while(j < right) dst[k++] = src[j++];
+		}
+
+		void **t = src;
+		src = dst;
+		dst = t;
+	}
+
+	if(src != items) memcpy(items, src, sizeof(void*) * (size_t)count);
+	free(tmp);
+
+	_InvalidateIndex();
 
 	return *this;
 }
@@ -389,7 +637,11 @@ EStringArray::SortItems(int (*cmp)(const EString**, const EString**))
 bool
 EStringArray::SwapItems(eint32 indexA, eint32 indexB)
 {
-	if(indexA != indexB) return list.SwapItems(indexA, indexB);
+	if(indexA != indexB)
+	{
+		if(list.SwapItems(indexA, indexB) == false) return false;
+		_InvalidateIndex();
+	}
 
 	return true;
 }
@@ -398,7 +650,11 @@ EStringArray::SwapItems(eint32 indexA, eint32 indexB)
 bool
 EStringArray::MoveItem(eint32 fromIndex, eint32 toIndex)
 {
-	if(fromIndex != toIndex) return list.MoveItem(fromIndex, toIndex);
+	if(fromIndex != toIndex)
+	{
+		if(list.MoveItem(fromIndex, toIndex) == false) return false;
+		_InvalidateIndex();
+	}
 
 	return true;
 }
@@ -409,6 +665,12 @@ EStringArray::FindString(const char *string, eint32 startIndex, bool all_equal,
 {
 	if(startIndex < 0 || startIndex >= list.CountItems()) return -1;
 
+	if(all_equal)
+	{
+		eint32 found = _FindByIndex(string, startIndex, invert, false);
+		if(found != -2) return found;
+	}
+
 	eint32 i = startIndex;
 
 	while(i >= 0 && i < list.CountItems())
@@ -454,6 +716,12 @@ EStringArray::IFindString(const char *string, eint32 startIndex, bool all_equal,
 {
 	if(startIndex < 0 || startIndex >= list.CountItems()) return -1;
 
+	if(all_equal)
+	{
+		eint32 found = _FindByIndex(string, startIndex, invert, true);
+		if(found != -2) return found;
+	}
+
 	eint32 i = startIndex;
 
 	while(i >= 0 && i < list.CountItems())
@@ -68,6 +68,7 @@ public:
 	bool		ReplaceItem(eint32 index, const char *string, void *attach_data = NULL);
 	bool		ReplaceItem(eint32 index, const EString &string, void *attach_data = NULL);
 
+	// SortItems(): stable sorting, the items compared equal keep their order
 	EStringArray&	SortItems(int (*cmp)(const EString**, const EString**));
 	bool		SwapItems(eint32 indexA, eint32 indexB);
 	bool		MoveItem(eint32 fromIndex, eint32 toIndex);
@@ -82,6 +83,9 @@ public:
 	eint32		CountItems() const;
 
 	// return value: string index if found, else return -1
+	// The exact matching (all_equal = true) goes through a hash index when there are many items,
+	// the index is built and published atomically by the first call and forgotten once the items
+	// changed except appending, the const array is safe to search from several threads at once.
 	eint32		FindString(const char *string, eint32 startIndex = 0, bool all_equal = true, bool invert = false) const;
 	eint32		FindString(const EString &string, eint32 startIndex = 0, bool all_equal = true, bool invert = false) const;
 	eint32		IFindString(const char *string, eint32 startIndex = 0, bool all_equal = true, bool invert = false) const;
@@ -89,6 +93,11 @@ public:
 
 private:
 	EList list;
+
+	void * volatile fIndex;
+	void _InvalidateIndex();
+	void _IndexItem(eint32 index);
+	eint32 _FindByIndex(const char *string, eint32 startIndex, bool invert, bool ignoreCase) const;
 };
 
 #endif /* __cplusplus */
@@ -159,6 +159,16 @@ typedef	eint8	bool;
 #  endif
 #endif /* _LOCAL */
 
+/* rvalue references of C++11, for the move constructors and assignments:
+ * ETKBuild.h defines ETK_SUPPORT_RVALUE_REFERENCES when the library was built with them.
+ * The moves are non-virtual and change no layout, so a client compiled without C++11
+ * just doesn't see them. */
+#if defined(ETK_SUPPORT_RVALUE_REFERENCES) && defined(__cplusplus)
+#  if !(__cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__) || (defined(_MSC_VER) && _MSC_VER >= 1600))
+#    undef ETK_SUPPORT_RVALUE_REFERENCES
+#  endif
+#endif /* ETK_SUPPORT_RVALUE_REFERENCES */
+
 #ifdef ETK_COMPILATION
 	#define _IMPEXP_ETK _EXPORT
 #else /* !ETK_COMPILATION */
@@ -0,0 +1,815 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2006, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: TextBuffer.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "String.h"
+#include "TextBuffer.h"
+
+// the text longer than this is divided into several pieces, so that splitting
+// a piece never scans more than these bytes
+#define ETK_TEXT_PIECE_MAX	65536
+
+// the characters are counted by the bytes which aren't 10xxxxxx
+#define ETK_TEXT_IS_TOKEN(c)	(((unsigned char)(c) & 0xc0) != 0x80)
+
+
+typedef struct e_text_piece {
+	eint32			start;		/* offset of the first byte in store */
+	eint32			length;
+	eint32			lines;		/* count of "\n" in piece */
+	eint32			chars;		/* count of UTF-8 characters in piece */
+	eint32			total_length;	/* of the subtree */
+	eint32			total_lines;	/* of the subtree */
+	eint32			total_chars;	/* of the subtree */
+	euint32			priority;
+	struct e_text_piece	*left;
+	struct e_text_piece	*right;
+} e_text_piece;
+
+
+static inline eint32 e_text_piece_length(const e_text_piece *t)
+{
+	return(t == NULL ? 0 : t->total_length);
+}
+
+
+static inline eint32 e_text_piece_lines(const e_text_piece *t)
+{
+	return(t == NULL ? 0 : t->total_lines);
+}
+
+
+static inline eint32 e_text_piece_chars(const e_text_piece *t)
+{
+	return(t == NULL ? 0 : t->total_chars);
+}
+
+
+static inline void e_text_piece_update(e_text_piece *t)
+{
+	t->total_length = e_text_piece_length(t->left) + t->length + e_text_piece_length(t->right);
+	t->total_lines = e_text_piece_lines(t->left) + t->lines + e_text_piece_lines(t->right);
+	t->total_chars = e_text_piece_chars(t->left) + t->chars + e_text_piece_chars(t->right);
+}
+
+
+static eint32 e_text_count_lines(const char *str, eint32 length)
+{
+	eint32 count = 0;
+	const char *end = str + length;
+
+	while(str < end && (str = (const char*)memchr(str, '\n', (size_t)(end - str))) != NULL) {count++; str++;}
+
+	return count;
+}
+
+
+// e_text_count_tokens8(): count the bytes which aren't 10xxxxxx in 8 bytes at once
+static inline eint32 e_text_count_tokens8(const char *str)
+{
+	euint64 w;
+	memcpy(&w, str, sizeof(w));
+
+	euint64 cont = (w & ~(w << 1)) & E_INT64_CONSTANT(0x8080808080808080);
+	return 8 - (eint32)(((cont >> 7) * E_INT64_CONSTANT(0x0101010101010101)) >> 56);
+}
+
+
+// e_text_count_chars(): count the first bytes of characters, so that the counts of
+//	two parts always sum up to the whole whatever the bytes are.
+static eint32 e_text_count_chars(const char *str, eint32 length)
+{
+	eint32 count = 0;
+	const char *end = str + length;
+
+	for(; end - str >= 8; str += 8) count += e_text_count_tokens8(str);
+	for(; str < end; str++) if(ETK_TEXT_IS_TOKEN(*str)) count++;
+
+	return count;
+}
+
+
+// e_text_char_offset(): return the offset of the "index"th character of the bytes
+static eint32 e_text_char_offset(const char *str, eint32 length, eint32 index)
+{
+	eint32 offset = 0;
+
+	for(eint32 n; length - offset >= 8 && (n = e_text_count_tokens8(str + offset)) <= index; offset += 8) index -= n;
+
+	for(; offset < length; offset++)
+	{
+		if(!ETK_TEXT_IS_TOKEN(str[offset])) continue;
+		if(index-- == 0) break;
+	}
+
+	return offset;
+}
+
+
+// e_text_piece_cut(): the length of the next piece of new text, it doesn't divide any character
+static eint32 e_text_piece_cut(const char *str, eint32 length)
+{
+	if(length <= ETK_TEXT_PIECE_MAX) return length;
+
+	eint32 n = ETK_TEXT_PIECE_MAX;
+	while(n > ETK_TEXT_PIECE_MAX - 6 && !ETK_TEXT_IS_TOKEN(str[n])) n--;
+	return(ETK_TEXT_IS_TOKEN(str[n]) ? n : ETK_TEXT_PIECE_MAX);
+}
+
+
+static e_text_piece* e_text_piece_merge(e_text_piece *l, e_text_piece *r)
+{
+	if(l == NULL) return r;
+	if(r == NULL) return l;
+
+	if(l->priority > r->priority)
+	{
+		l->right = e_text_piece_merge(l->right, r);
+		e_text_piece_update(l);
+		return l;
+	}
+
+	r->left = e_text_piece_merge(l, r->left);
+	e_text_piece_update(r);
+	return r;
+}
+
+
+// e_text_piece_split(): the bytes before "offset" go to "l", the rest go to "r",
+//	the piece across "offset" is cut into two with "spare".
+static void e_text_piece_split(e_text_piece *t, eint32 offset, e_text_piece **l, e_text_piece **r,
+			       const char *store, e_text_piece **spare)
+{
+	if(t == NULL) {*l = *r = NULL; return;}
+
+	eint32 leftLength = e_text_piece_length(t->left);
+
+	if(offset <= leftLength)
+	{
+		e_text_piece_split(t->left, offset, l, &(t->left), store, spare);
+		e_text_piece_update(t);
+		*r = t;
+	}
+	else if(offset >= leftLength + t->length)
+	{
+		e_text_piece_split(t->right, offset - leftLength - t->length, &(t->right), r, store, spare);
+		e_text_piece_update(t);
+		*l = t;
+	}
+	else
+	{
+		eint32 k = offset - leftLength;
+		e_text_piece *n = *spare;
+		*spare = n->right;
+
+		// count the line breaks and characters within the shorter part
+		eint32 lines, chars;
+		if(k <= t->length - k)
+		{
+			lines = t->lines - e_text_count_lines(store + t->start, k);
+			chars = t->chars - e_text_count_chars(store + t->start, k);
+		}
+		else
+		{
+			lines = e_text_count_lines(store + t->start + k, t->length - k);
+			chars = e_text_count_chars(store + t->start + k, t->length - k);
+		}
+
+		n->start = t->start + k;
+		n->length = t->length - k;
+		n->lines = lines;
+		n->chars = chars;
+		n->priority = t->priority;
+		n->left = NULL;
+		n->right = t->right;
+
+		t->length = k;
+		t->lines -= lines;
+		t->chars -= chars;
+		t->right = NULL;
+
+		e_text_piece_update(t);
+		e_text_piece_update(n);
+
+		*l = t;
+		*r = n;
+	}
+}
+
+
+static void e_text_piece_copy(const e_text_piece *t, const char *store, char *dest)
+{
+	while(t != NULL)
+	{
+		e_text_piece_copy(t->left, store, dest);
+		dest += e_text_piece_length(t->left);
+		if(t->length > 0) memcpy(dest, store + t->start, (size_t)t->length);
+		dest += t->length;
+		t = t->right;
+	}
+}
+
+
+ETextBuffer::ETextBuffer()
+	: fRoot(NULL), fFreeNodes(NULL), fFreeCount(0), fSeed(0x9e3779b9),
+	  fStore(NULL), fStoreLength(0), fStoreReal(0),
+	  fFlat(NULL), fFlatReal(0), fFlatValid(false),
+	  fRange(NULL), fRangeReal(0)
+{
+}
+
+
+ETextBuffer::~ETextBuffer()
+{
+	_FreeTree(fRoot);
+
+	e_text_piece *t;
+	while((t = (e_text_piece*)fFreeNodes) != NULL)
+	{
+		fFreeNodes = t->right;
+		free(t);
+	}
+
+	if(fStore) free(fStore);
+	if(fFlat) free(fFlat);
+	if(fRange) free(fRange);
+}
+
+
+void*
+ETextBuffer::_NewNode()
+{
+	e_text_piece *t = (e_text_piece*)fFreeNodes;
+
+	if(t != NULL)
+	{
+		fFreeNodes = t->right;
+		fFreeCount--;
+	}
+	else if((t = (e_text_piece*)malloc(sizeof(e_text_piece))) == NULL)
+	{
+		return NULL;
+	}
+
+	// xorshift
+	fSeed ^= fSeed << 13;
+	fSeed ^= fSeed >> 17;
+	fSeed ^= fSeed << 5;
+
+	t->priority = fSeed;
+	t->left = t->right = NULL;
+
+	return t;
+}
+
+
+void
+ETextBuffer::_FreeNode(void *node)
+{
+	e_text_piece *t = (e_text_piece*)node;
+
+	if(fFreeCount >= 64)
+	{
+		free(t);
+		return;
+	}
+
+	t->right = (e_text_piece*)fFreeNodes;
+	fFreeNodes = t;
+	fFreeCount++;
+}
+
+
+void
+ETextBuffer::_FreeTree(void *node)
+{
+	e_text_piece *t = (e_text_piece*)node;
+
+	while(t != NULL)
+	{
+		e_text_piece *right = t->right;
+		_FreeTree(t->left);
+		_FreeNode(t);
+		t = right;
+	}
+}
+
+
+bool
+ETextBuffer::_ReserveNodes(eint32 count)
+{
+	while(fFreeCount < count)
+	{
+		e_text_piece *t = (e_text_piece*)malloc(sizeof(e_text_piece));
+		if(t == NULL) return false;
+
+		t->right = (e_text_piece*)fFreeNodes;
+		fFreeNodes = t;
+		fFreeCount++;
+	}
+
+	return true;
+}
+
+
+eint32
+ETextBuffer::_Store(const char *text, eint32 length)
+{
+	if(length > E_MAXINT32 - fStoreLength) return -1;
+
+	if(fStoreLength + length > fStoreReal)
+	{
+		eint32 newReal = max_c(fStoreLength + length, (fStoreReal > E_MAXINT32 / 2 ? E_MAXINT32 : max_c(fStoreReal * 2, 4096)));
+		char *newStore = (char*)realloc(fStore, (size_t)newReal);
+		if(newStore == NULL) return -1;
+
+		fStore = newStore;
+		fStoreReal = newReal;
+	}
+
+	eint32 start = fStoreLength;
+	memcpy(fStore + start, text, (size_t)length);
+	fStoreLength += length;
+
+	return start;
+}
+
+
+eint32
+ETextBuffer::Length() const
+{
+	return e_text_piece_length((const e_text_piece*)fRoot);
+}
+
+
+eint32
+ETextBuffer::CountLines() const
+{
+	return e_text_piece_lines((const e_text_piece*)fRoot) + 1;
+}
+
+
+void
+ETextBuffer::MakeEmpty()
+{
+	_FreeTree(fRoot);
+	fRoot = NULL;
+
+	if(fStoreReal > 65536)
+	{
+		free(fStore);
+		fStore = NULL;
+		fStoreReal = 0;
+	}
+	fStoreLength = 0;
+
+	fFlatValid = false;
+}
+
+
+bool
+ETextBuffer::SetTo(const char *text, eint32 length)
+{
+	MakeEmpty();
+	return Insert(0, text, length);
+}
+
+
+bool
+ETextBuffer::Insert(eint32 offset, const char *text, eint32 length)
+{
+	if(text == NULL) return false;
+	if(length < 0) length = (eint32)strlen(text);
+	if(length == 0) return true;
+
+	eint32 oldLength = Length();
+	if(offset < 0 || offset > oldLength || length > E_MAXINT32 - oldLength) return false;
+
+	// the pieces might be a little shorter than ETK_TEXT_PIECE_MAX, see e_text_piece_cut()
+	eint32 nPieces = length / (ETK_TEXT_PIECE_MAX - 8) + 1;
+	if(_ReserveNodes(nPieces + 1) == false) return false;
+
+	bool extend = false;
+	e_text_piece *l = NULL, *r = NULL;
+	e_text_piece *spare = (e_text_piece*)_NewNode();
+
+	e_text_piece_split((e_text_piece*)fRoot, offset, &l, &r, fStore, &spare);
+	if(spare != NULL) _FreeNode(spare);
+
+	// when typing, the text is appended to the piece just added before
+	if(length < ETK_TEXT_PIECE_MAX && l != NULL)
+	{
+		e_text_piece *last = l;
+		while(last->right != NULL) last = last->right;
+		extend = (last->start + last->length == fStoreLength && last->length + length <= ETK_TEXT_PIECE_MAX);
+	}
+
+	eint32 start = _Store(text, length);
+	if(start < 0)
+	{
+		fRoot = e_text_piece_merge(l, r);
+		return false;
+	}
+
+	if(extend)
+	{
+		eint32 lines = e_text_count_lines(fStore + start, length);
+		eint32 chars = e_text_count_chars(fStore + start, length);
+		for(e_text_piece *t = l; t != NULL; t = t->right)
+		{
+			t->total_length += length;
+			t->total_lines += lines;
+			t->total_chars += chars;
+			if(t->right == NULL) {t->length += length; t->lines += lines; t->chars += chars;}
+		}
+	}
+	else for(eint32 done = 0, n = 0; done < length; done += n)
+	{
+		e_text_piece *t = (e_text_piece*)_NewNode();
+
+		t->start = start + done;
+		t->length = n = e_text_piece_cut(fStore + t->start, length - done);
+		t->lines = e_text_count_lines(fStore + t->start, t->length);
+		t->chars = e_text_count_chars(fStore + t->start, t->length);
+		e_text_piece_update(t);
+
+		l = e_text_piece_merge(l, t);
+	}
+
+	fRoot = e_text_piece_merge(l, r);
+	fFlatValid = false;
+
+	return true;
+}
+
+
+bool
+ETextBuffer::Remove(eint32 offset, eint32 length)
+{
+	eint32 oldLength = Length();
+	if(offset < 0 || offset >= oldLength || length <= 0) return(length == 0);
+	if(length > oldLength - offset) length = oldLength - offset;
+
+	if(_ReserveNodes(2) == false) return false;
+
+	e_text_piece *l = NULL, *m = NULL, *r = NULL;
+	e_text_piece *spare = (e_text_piece*)_NewNode();
+	spare->right = (e_text_piece*)_NewNode();
+
+	e_text_piece_split((e_text_piece*)fRoot, offset, &l, &r, fStore, &spare);
+	e_text_piece_split(r, length, &m, &r, fStore, &spare);
+	while(spare != NULL)
+	{
+		e_text_piece *t = spare;
+		spare = t->right;
+		_FreeNode(t);
+	}
+
+	_FreeTree(m);
+	fRoot = e_text_piece_merge(l, r);
+	fFlatValid = false;
+
+	// the removed bytes still stay in the store, copy the text when they're more than it
+	if(fStoreLength - Length() > max_c(Length(), ETK_TEXT_PIECE_MAX)) _Compact();
+
+	return true;
+}
+
+
+void
+ETextBuffer::_Compact()
+{
+	eint32 length = Length();
+	if(_ReserveNodes(length / (ETK_TEXT_PIECE_MAX - 8) + 1) == false) return;
+
+	char *store = (char*)malloc((size_t)max_c(length, 1));
+	if(store == NULL) return;
+
+	e_text_piece_copy((const e_text_piece*)fRoot, fStore, store);
+
+	_FreeTree(fRoot);
+	fRoot = NULL;
+	free(fStore);
+	fStore = store;
+	fStoreLength = length;
+	fStoreReal = max_c(length, 1);
+
+	// rebuild the pieces referring to the new store
+	e_text_piece *root = NULL;
+	for(eint32 done = 0, n = 0; done < length; done += n)
+	{
+		e_text_piece *t = (e_text_piece*)_NewNode();
+
+		t->start = done;
+		t->length = n = e_text_piece_cut(fStore + t->start, length - done);
+		t->lines = e_text_count_lines(fStore + t->start, t->length);
+		t->chars = e_text_count_chars(fStore + t->start, t->length);
+		e_text_piece_update(t);
+
+		root = e_text_piece_merge(root, t);
+	}
+	fRoot = root;
+}
+
+
+const char*
+ETextBuffer::ChunkAt(eint32 offset, eint32 *length) const
+{
+	const e_text_piece *t = (const e_text_piece*)fRoot;
+
+	if(offset < 0) t = NULL;
+
+	while(t != NULL)
+	{
+		eint32 leftLength = e_text_piece_length(t->left);
+
+		if(offset < leftLength)
+		{
+			t = t->left;
+			continue;
+		}
+
+		offset -= leftLength;
+		if(offset < t->length)
+		{
+			if(length) *length = t->length - offset;
+			return(fStore + t->start + offset);
+		}
+
+		offset -= t->length;
+		t = t->right;
+	}
+
+	if(length) *length = 0;
+	return NULL;
+}
+
+
+char
+ETextBuffer::ByteAt(eint32 offset) const
+{
+	const char *chunk = ChunkAt(offset, NULL);
+	return(chunk == NULL ? 0 : *chunk);
+}
+
+
+eint32
+ETextBuffer::CopyInto(char *dest, eint32 offset, eint32 length) const
+{
+	if(dest == NULL || length <= 0) return 0;
+
+	eint32 nCopied = 0;
+	const char *chunk;
+	eint32 chunkLength;
+
+	while(nCopied < length && (chunk = ChunkAt(offset + nCopied, &chunkLength)) != NULL)
+	{
+		chunkLength = min_c(chunkLength, length - nCopied);
+		memcpy(dest + nCopied, chunk, (size_t)chunkLength);
+		nCopied += chunkLength;
+	}
+
+	return nCopied;
+}
+
+
+eint32
+ETextBuffer::LineAt(eint32 offset) const
+{
+	if(offset < 0) return -1;
+
+	const e_text_piece *t = (const e_text_piece*)fRoot;
+	eint32 line = 0;
+
+	while(t != NULL)
+	{
+		eint32 leftLength = e_text_piece_length(t->left);
+
+		if(offset < leftLength)
+		{
+			t = t->left;
+			continue;
+		}
+
+		line += e_text_piece_lines(t->left);
+		offset -= leftLength;
+
+		if(offset < t->length) return(line + e_text_count_lines(fStore + t->start, offset));
+
+		line += t->lines;
+		offset -= t->length;
+		t = t->right;
+	}
+
+	return line;
+}
+
+
+eint32
+ETextBuffer::OffsetAt(eint32 line) const
+{
+	if(line <= 0) return(line == 0 ? 0 : -1);
+
+	const e_text_piece *t = (const e_text_piece*)fRoot;
+	eint32 offset = 0;
+
+	while(t != NULL)
+	{
+		eint32 leftLines = e_text_piece_lines(t->left);
+
+		if(line <= leftLines)
+		{
+			t = t->left;
+			continue;
+		}
+
+		line -= leftLines;
+		offset += e_text_piece_length(t->left);
+
+		if(line <= t->lines)
+		{
+			// the offset following the "line"th line break in piece
+			const char *str = fStore + t->start;
+			const char *end = str + t->length;
+			const char *found = NULL;
+			while(line-- > 0 && (found = (const char*)memchr(str, '\n', (size_t)(end - str))) != NULL) str = found + 1;
+			return(offset + (eint32)(str - (fStore + t->start)));
+		}
+
+		line -= t->lines;
+		offset += t->length;
+		t = t->right;
+	}
+
+	return -1;
+}
+
+
+const char*
+ETextBuffer::String() const
+{
+	ETextBuffer *self = (ETextBuffer*)this;
+	eint32 length = Length();
+
+	if(length <= 0) return NULL;
+	if(fFlatValid) return fFlat;
+
+	if(length + 1 > fFlatReal || fFlatReal / 4 > length + 1)
+	{
+		char *flat = (char*)realloc(fFlat, (size_t)length + 1);
+		if(flat == NULL) return NULL;
+
+		self->fFlat = flat;
+		self->fFlatReal = length + 1;
+	}
+
+	e_text_piece_copy((const e_text_piece*)fRoot, fStore, fFlat);
+	fFlat[length] = 0;
+	self->fFlatValid = true;
+
+	return fFlat;
+}
+
+
+const char*
+ETextBuffer::StringAt(eint32 offset, eint32 length) const
+{
+	ETextBuffer *self = (ETextBuffer*)this;
+
+	if(offset < 0 || offset > Length()) return NULL;
+	if(length < 0 || length > Length() - offset) length = Length() - offset;
+
+	if(length + 1 > fRangeReal || (fRangeReal > 4096 && fRangeReal / 4 > length + 1))
+	{
+		char *range = (char*)realloc(fRange, (size_t)length + 1);
+		if(range == NULL) return NULL;
+
+		self->fRange = range;
+		self->fRangeReal = length + 1;
+	}
+
+	CopyInto(fRange, offset, length);
+	fRange[length] = 0;
+
+	return fRange;
+}
+
+
+eint32
+ETextBuffer::CountChars() const
+{
+	return e_text_piece_chars((const e_text_piece*)fRoot);
+}
+
+
+eint32
+ETextBuffer::CharOffsetAt(eint32 index) const
+{
+	if(index < 0 || index > CountChars()) return -1;
+
+	const e_text_piece *t = (const e_text_piece*)fRoot;
+	eint32 offset = 0;
+
+	while(t != NULL)
+	{
+		eint32 leftChars = e_text_piece_chars(t->left);
+
+		if(index < leftChars)
+		{
+			t = t->left;
+			continue;
+		}
+
+		index -= leftChars;
+		offset += e_text_piece_length(t->left);
+
+		if(index < t->chars) return(offset + e_text_char_offset(fStore + t->start, t->length, index));
+
+		index -= t->chars;
+		offset += t->length;
+		t = t->right;
+	}
+
+	return offset;
+}
+
+
+eint32
+ETextBuffer::CharIndexAt(eint32 offset) const
+{
+	if(offset < 0) return -1;
+
+	const e_text_piece *t = (const e_text_piece*)fRoot;
+	eint32 index = 0;
+
+	while(t != NULL)
+	{
+		eint32 leftLength = e_text_piece_length(t->left);
+
+		if(offset < leftLength)
+		{
+			t = t->left;
+			continue;
+		}
+
+		index += e_text_piece_chars(t->left);
+		offset -= leftLength;
+
+		if(offset < t->length) return(index + e_text_count_chars(fStore + t->start, offset));
+
+		index += t->chars;
+		offset -= t->length;
+		t = t->right;
+	}
+
+	return index;
+}
+
+
+const char*
+ETextBuffer::CharAt(eint32 index, euint8 *length) const
+{
+	if(length) *length = 0;
+	if(index < 0 || index >= CountChars()) return NULL;
+
+	eint32 chunkLength = 0;
+	const char *chunk = ChunkAt(CharOffsetAt(index), &chunkLength);
+	if(chunk == NULL) return NULL;
+
+	if(length)
+	{
+		eint32 n = 1;
+		while(n < chunkLength && !ETK_TEXT_IS_TOKEN(chunk[n])) n++;
+		*length = (euint8)n;
+	}
+
+	return chunk;
+}
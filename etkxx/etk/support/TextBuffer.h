@@ -0,0 +1,121 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2006, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: TextBuffer.h
+ * Description: Piece table for editing the large text
+ *
+ * --------------------------------------------------------------------------*/
+
+#ifndef __ETK_TEXT_BUFFER_H__
+#define __ETK_TEXT_BUFFER_H__
+
+#include <etk/support/SupportDefs.h>
+
+#ifdef __cplusplus /* Just for C++ */
+
+// ETextBuffer:
+//	The text is kept as pieces of an append-only store, the pieces are held in a balanced
+//	tree which counts the bytes, the line breaks and the UTF-8 characters of every subtree,
+//	so that inserting, removing and mapping between offset, line and character cost
+//	O(log n) whatever the size of text.
+//	All the offsets and lengths are in bytes except the indexes of characters.
+class _IMPEXP_ETK ETextBuffer {
+public:
+	ETextBuffer();
+	~ETextBuffer();
+
+	eint32		Length() const;
+	eint32		CountLines() const; // count of "\n" plus 1
+
+	bool		SetTo(const char *text, eint32 length = -1);
+	void		MakeEmpty();
+
+	bool		Insert(eint32 offset, const char *text, eint32 length = -1);
+	bool		Remove(eint32 offset, eint32 length);
+
+	char		ByteAt(eint32 offset) const;
+	eint32		CopyInto(char *dest, eint32 offset, eint32 length) const;
+
+	// LineAt(): return the index of line which the byte at "offset" belongs to.
+	// OffsetAt(): return the offset of the first byte of "line", -1 when out of range.
+	eint32		LineAt(eint32 offset) const;
+	eint32		OffsetAt(eint32 line) const;
+
+	// ChunkAt(): return the contiguous bytes from "offset" to the end of the piece,
+	//	the text can be walked without copying like below, until the next change
+	//		for(eint32 offset = 0; (chunk = buffer.ChunkAt(offset, &len)) != NULL; offset += len) ...
+	const char	*ChunkAt(eint32 offset, eint32 *length) const;
+
+	// String(): return the whole text in a contiguous memory, NULL when it's empty.
+	//	It's copied only at the first call after the text changed.
+	const char	*String() const;
+
+	// StringAt(): return a copy of "length" bytes from "offset" terminated by NUL,
+	//	it's valid until the next call, pass -1 to "length" for the rest of text.
+	const char	*StringAt(eint32 offset, eint32 length) const;
+
+	// CountChars(),CharAt(): UTF-8 functions, work like EString's.
+	//	A character never spans two pieces as long as the text is changed at the boundaries
+	//	of characters, so the bytes CharAt() returns are contiguous.
+	// CharOffsetAt(): return the offset of the first byte of the "index"th character,
+	//	Length() when "index" is CountChars(), -1 when out of range.
+	// CharIndexAt(): return the count of characters before "offset".
+	eint32		CountChars() const;
+	const char	*CharAt(eint32 index, euint8 *length = NULL) const;
+	eint32		CharOffsetAt(eint32 index) const;
+	eint32		CharIndexAt(eint32 offset) const;
+
+private:
+	void *fRoot;
+	void *fFreeNodes;
+	eint32 fFreeCount;
+	euint32 fSeed;
+
+	char *fStore;
+	eint32 fStoreLength;
+	eint32 fStoreReal;
+
+	char *fFlat;
+	eint32 fFlatReal;
+	bool fFlatValid;
+
+	char *fRange;
+	eint32 fRangeReal;
+
+	ETextBuffer(const ETextBuffer&);
+	ETextBuffer &operator=(const ETextBuffer&);
+
+	void *_NewNode();
+	void _FreeNode(void *node);
+	void _FreeTree(void *node);
+	bool _ReserveNodes(eint32 count);
+	eint32 _Store(const char *text, eint32 length);
+	void _Compact();
+};
+
+#endif /* __cplusplus */
+
+#endif /* __ETK_TEXT_BUFFER_H__ */
+
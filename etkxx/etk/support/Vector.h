@@ -0,0 +1,473 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2006, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: Vector.h
+ * Description: Typed container storing values inline and contiguously
+ *
+ * --------------------------------------------------------------------------*/
+
+#ifndef __ETK_VECTOR_H__
+#define __ETK_VECTOR_H__
+
+#include <stdlib.h>
+#include <etk/support/SupportDefs.h>
+#include <etk/kernel/Debug.h>
+
+#ifdef __cplusplus /* Just for C++ */
+
+#include <new>
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+#include <utility>
+#endif
+
+// EVector<T, InlineCount, Subsystem>:
+//	Unlike EList holding the pointers, EVector holds the values of "T" in a contiguous memory.
+//	The first "InlineCount" items are stored inside the object itself without allocating,
+//	then it grows geometrically on the heap. "T" must be copy-constructible.
+//	The pointers returned by ItemAt()/Items() are invalid after adding or removing items.
+//	The heap memory is counted by the memory accounting as "Subsystem" (see etk/kernel/Debug.h).
+template<class T, eint32 InlineCount = 4, e_memory_subsystem Subsystem = E_MEMORY_UNTRACKED>
+class EVector {
+public:
+	EVector();
+	EVector(const EVector &v);
+	~EVector();
+
+	EVector &operator=(const EVector &v);
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	// moving steals the memory when the items are on the heap
+	EVector(EVector &&v);
+	EVector &operator=(EVector &&v);
+#endif
+
+	bool	AddItem(const T &item);
+	bool	AddItem(const T &item, eint32 atIndex);
+	bool	AddVector(const EVector &v);
+
+	bool	RemoveItem(eint32 index);
+	bool	RemoveItems(eint32 index, eint32 count);
+	void	MakeEmpty();
+
+	// Reserve(): make room for "count" items at least, return false when out of memory.
+	bool	Reserve(eint32 count);
+
+	// SwapWith(): exchange the items, it's cheap when both of them are on the heap.
+	void	SwapWith(EVector &v);
+
+	T	*ItemAt(eint32 index) const;
+	T	*FirstItem() const;
+	T	*LastItem() const;
+
+	T	&operator[](eint32 index);
+	const T	&operator[](eint32 index) const;
+
+	eint32	CountItems() const;
+	bool	IsEmpty() const;
+	eint32	Capacity() const;
+
+	// Items(): return the array, NULL when empty
+	T	*Items() const;
+
+private:
+	T *fItems;
+	eint32 fCount;
+	eint32 fCapacity;
+
+	union {
+		char fData[sizeof(T) * InlineCount];
+		double fAlignDouble;
+		eint64 fAlignInt64;
+		void *fAlignPointer;
+	} fInline;
+
+	T *_InlineItems() const;
+	bool _IsInline() const;
+	bool _Relocate(eint32 capacity);
+	void _Steal(EVector &v);
+
+	static void _Construct(T *dest, T &src);
+};
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline T*
+EVector<T, InlineCount, Subsystem>::_InlineItems() const
+{
+	return (T*)(const_cast<char*>(fInline.fData));
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline bool
+EVector<T, InlineCount, Subsystem>::_IsInline() const
+{
+	return(fItems == _InlineItems());
+}
+
+
+// _Construct(): construct "dest" from "src" which is going to be destructed
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline void
+EVector<T, InlineCount, Subsystem>::_Construct(T *dest, T &src)
+{
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	new (dest) T(std::move(src));
+#else
+	new (dest) T(src);
+#endif
+}
+
+
+// _Relocate(): move the items into a memory holding "capacity" items
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+bool
+EVector<T, InlineCount, Subsystem>::_Relocate(eint32 capacity)
+{
+	T *items;
+
+	if(capacity <= InlineCount)
+	{
+		if(_IsInline()) return true;
+		capacity = InlineCount;
+		items = _InlineItems();
+	}
+	else
+	{
+		if((items = (T*)malloc((size_t)capacity * sizeof(T))) == NULL) return false;
+		if(Subsystem != E_MEMORY_UNTRACKED) etk_memory_account_alloc(Subsystem, (size_t)capacity * sizeof(T));
+	}
+
+	for(eint32 i = 0; i < fCount; i++)
+	{
+		_Construct(items + i, fItems[i]);
+		fItems[i].~T();
+	}
+
+	if(_IsInline() == false)
+	{
+		if(Subsystem != E_MEMORY_UNTRACKED) etk_memory_account_free(Subsystem, (size_t)fCapacity * sizeof(T));
+		free(fItems);
+	}
+
+	fItems = items;
+	fCapacity = capacity;
+
+	return true;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline
+EVector<T, InlineCount, Subsystem>::EVector()
+	: fCount(0), fCapacity(InlineCount)
+{
+	fItems = _InlineItems();
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline
+EVector<T, InlineCount, Subsystem>::EVector(const EVector &v)
+	: fCount(0), fCapacity(InlineCount)
+{
+	fItems = _InlineItems();
+	AddVector(v);
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline
+EVector<T, InlineCount, Subsystem>::~EVector()
+{
+	MakeEmpty();
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline EVector<T, InlineCount, Subsystem>&
+EVector<T, InlineCount, Subsystem>::operator=(const EVector &v)
+{
+	if(this != &v)
+	{
+		MakeEmpty();
+		AddVector(v);
+	}
+	return *this;
+}
+
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline
+EVector<T, InlineCount, Subsystem>::EVector(EVector &&v)
+	: fCount(0), fCapacity(InlineCount)
+{
+	fItems = _InlineItems();
+	SwapWith(v);
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline EVector<T, InlineCount, Subsystem>&
+EVector<T, InlineCount, Subsystem>::operator=(EVector &&v)
+{
+	if(this != &v)
+	{
+		MakeEmpty();
+		SwapWith(v);
+	}
+	return *this;
+}
+#endif /* ETK_SUPPORT_RVALUE_REFERENCES */
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+bool
+EVector<T, InlineCount, Subsystem>::Reserve(eint32 count)
+{
+	if(count <= fCapacity) return true;
+	if(count > E_MAXINT32 / (eint32)sizeof(T)) return false;
+	return _Relocate(count);
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+bool
+EVector<T, InlineCount, Subsystem>::AddItem(const T &item)
+{
+	if(fCount == fCapacity)
+	{
+		// "item" might be one of the items
+		T aItem(item);
+		if(Reserve(fCapacity > E_MAXINT32 / 2 ? E_MAXINT32 : fCapacity * 2) == false) return false;
+		new (fItems + fCount) T(aItem);
+	}
+	else
+	{
+		new (fItems + fCount) T(item);
+	}
+
+	fCount++;
+	return true;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+bool
+EVector<T, InlineCount, Subsystem>::AddItem(const T &item, eint32 atIndex)
+{
+	if(atIndex < 0 || atIndex > fCount) return false;
+	if(atIndex == fCount) return AddItem(item);
+
+	T aItem(item);
+	if(AddItem(fItems[fCount - 1]) == false) return false;
+
+	for(eint32 i = fCount - 2; i > atIndex; i--) fItems[i] = fItems[i - 1];
+	fItems[atIndex] = aItem;
+
+	return true;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+bool
+EVector<T, InlineCount, Subsystem>::AddVector(const EVector &v)
+{
+	if(v.fCount <= 0) return true;
+	if(this == &v || fCount > E_MAXINT32 - v.fCount) return false;
+
+	if(fCount + v.fCount > fCapacity)
+	{
+		eint32 capacity = fCapacity;
+		while(capacity < fCount + v.fCount) capacity = (capacity > E_MAXINT32 / 2 ? E_MAXINT32 : capacity * 2);
+		if(Reserve(capacity) == false) return false;
+	}
+
+	for(eint32 i = 0; i < v.fCount; i++) new (fItems + fCount + i) T(v.fItems[i]);
+	fCount += v.fCount;
+
+	return true;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline bool
+EVector<T, InlineCount, Subsystem>::RemoveItem(eint32 index)
+{
+	return RemoveItems(index, 1);
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+bool
+EVector<T, InlineCount, Subsystem>::RemoveItems(eint32 index, eint32 count)
+{
+	if(index < 0 || index >= fCount) return false;
+
+	if(count < 0) count = fCount - index;
+	else count = min_c(fCount - index, count);
+
+	if(count == 0) return true;
+
+	for(eint32 i = index; i < fCount - count; i++) fItems[i] = fItems[i + count];
+	for(eint32 i = fCount - count; i < fCount; i++) fItems[i].~T();
+	fCount -= count;
+
+	// release the heap when most of it unused
+	if(_IsInline() == false && fCount < (fCapacity >> 2)) _Relocate(max_c(fCapacity >> 1, fCount));
+
+	return true;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+void
+EVector<T, InlineCount, Subsystem>::MakeEmpty()
+{
+	for(eint32 i = 0; i < fCount; i++) fItems[i].~T();
+	fCount = 0;
+
+	if(_IsInline() == false)
+	{
+		if(Subsystem != E_MEMORY_UNTRACKED) etk_memory_account_free(Subsystem, (size_t)fCapacity * sizeof(T));
+		free(fItems);
+		fItems = _InlineItems();
+		fCapacity = InlineCount;
+	}
+}
+
+
+// _Steal(): take the items of "v", it must be empty before calling
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+void
+EVector<T, InlineCount, Subsystem>::_Steal(EVector &v)
+{
+	if(v._IsInline())
+	{
+		for(eint32 i = 0; i < v.fCount; i++) _Construct(fItems + i, v.fItems[i]);
+		fCount = v.fCount;
+		v.MakeEmpty();
+		return;
+	}
+
+	fItems = v.fItems;
+	fCount = v.fCount;
+	fCapacity = v.fCapacity;
+
+	v.fItems = v._InlineItems();
+	v.fCount = 0;
+	v.fCapacity = InlineCount;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+void
+EVector<T, InlineCount, Subsystem>::SwapWith(EVector &v)
+{
+	if(this == &v) return;
+
+	EVector aVector;
+	aVector._Steal(*this);
+	_Steal(v);
+	v._Steal(aVector);
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline T*
+EVector<T, InlineCount, Subsystem>::ItemAt(eint32 index) const
+{
+	if(index < 0 || index >= fCount) return NULL;
+	return fItems + index;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline T*
+EVector<T, InlineCount, Subsystem>::FirstItem() const
+{
+	return(fCount > 0 ? fItems : NULL);
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline T*
+EVector<T, InlineCount, Subsystem>::LastItem() const
+{
+	return(fCount > 0 ? fItems + fCount - 1 : NULL);
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline T&
+EVector<T, InlineCount, Subsystem>::operator[](eint32 index)
+{
+	return fItems[index];
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline const T&
+EVector<T, InlineCount, Subsystem>::operator[](eint32 index) const
+{
+	return fItems[index];
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline eint32
+EVector<T, InlineCount, Subsystem>::CountItems() const
+{
+	return fCount;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline bool
+EVector<T, InlineCount, Subsystem>::IsEmpty() const
+{
+	return(fCount == 0);
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline eint32
+EVector<T, InlineCount, Subsystem>::Capacity() const
+{
+	return fCapacity;
+}
+
+
+template<class T, eint32 InlineCount, e_memory_subsystem Subsystem>
+inline T*
+EVector<T, InlineCount, Subsystem>::Items() const
+{
+	return(fCount > 0 ? fItems : NULL);
+}
+
+#endif /* __cplusplus */
+
+#endif /* __ETK_VECTOR_H__ */
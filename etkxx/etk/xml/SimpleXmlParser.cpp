@@ -28,6 +28,7 @@
  * --------------------------------------------------------------------------*/
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <etk/support/String.h>
 #include <etk/support/StringArray.h>
@@ -280,6 +281,59 @@ ESimpleXmlNode::PrintToStream() const
 }
 
 
+static struct {
+	const char *name;
+	eint32 length;
+	const char *text;
+} etk_xml_entities[] = {
+	{"&nbsp;", 6, " "},
+	{"&lt;", 4, "<"},
+	{"&gt;", 4, ">"},
+	{"&amp;", 5, "&"},
+	{"&copy;", 6, "©"},
+	{"&reg;", 5, "®"},
+	{"&quot;", 6, "\""},
+	{NULL, 0, NULL}
+};
+
+
+// decode_entities(): decode all the entities with one pass, so "&amp;lt;" becomes "&lt;"
+inline void decode_entities(EString &str)
+{
+	eint32 offset = str.FindFirst('&');
+	if(offset < 0) return;
+
+	EString result;
+	eint32 start = 0;
+
+	while(offset >= 0)
+	{
+		eint32 i;
+		for(i = 0; etk_xml_entities[i].name != NULL; i++)
+		{
+			if(strncmp(str.String() + offset, etk_xml_entities[i].name, (size_t)etk_xml_entities[i].length) == 0) break;
+		}
+
+		if(etk_xml_entities[i].name == NULL)
+		{
+			offset = str.FindFirst('&', offset + 1);
+			continue;
+		}
+
+		result.Append(str.String() + start, offset - start);
+		result.Append(etk_xml_entities[i].text);
+		start = offset + etk_xml_entities[i].length;
+		offset = str.FindFirst('&', start);
+	}
+
+	if(start == 0) return;
+
+	result.Append(str.String() + start, str.Length() - start);
+	str.MakeEmpty();
+	str.Adopt(result);
+}
+
+
 inline void remove_unwanted_characters(EString &str)
 {
 	eint32 offset = 0;
@@ -368,13 +422,7 @@ inline bool parse_simple_xml(EString *buffer, eint32 *offset, ESimpleXmlNode *no
 			EString tmp;
 			str.CopyInto(tmp, 4, str.Length() - 7);
 
-			tmp.ReplaceAll("&nbsp;", " ");
-			tmp.ReplaceAll("&lt;", "<");
-			tmp.ReplaceAll("&gt;", ">");
-			tmp.ReplaceAll("&amp;", "&");
-			tmp.ReplaceAll("&copy;", "©");
-			tmp.ReplaceAll("&reg;", "®");
-			tmp.ReplaceAll("&quot;", "\"");
+			decode_entities(tmp);
 
 			ESimpleXmlNode *aNode = new ESimpleXmlNode("comment", tmp.String());
 			if(!(aNode == NULL || node->AddNode(aNode))) delete aNode;
@@ -405,13 +453,7 @@ inline bool parse_simple_xml(EString *buffer, eint32 *offset, ESimpleXmlNode *no
 			EString attr_content;
 			array->ItemAt(i)->CopyInto(attr_content, sepIndex + 1, -1);
 			attr_content.RemoveSet("\"\'");
-			attr_content.ReplaceAll("&nbsp;", " ");
-			attr_content.ReplaceAll("&lt;", "<");
-			attr_content.ReplaceAll("&gt;", ">");
-			attr_content.ReplaceAll("&amp;", "&");
-			attr_content.ReplaceAll("&copy;", "©");
-			attr_content.ReplaceAll("&reg;", "®");
-			attr_content.ReplaceAll("&quot;", "\"");
+			decode_entities(attr_content);
 
 			aNode->AddAttribute(str.String(), attr_content.String());
 		}
@@ -429,13 +471,7 @@ inline bool parse_simple_xml(EString *buffer, eint32 *offset, ESimpleXmlNode *no
 				remove_unwanted_characters(str);
 				if(!(str.Length() <= 0 || (str.Length() == 1 && str.ByteAt(0) == ' ')))
 				{
-					str.ReplaceAll("&nbsp;", " ");
-					str.ReplaceAll("&lt;", "<");
-					str.ReplaceAll("&gt;", ">");
-					str.ReplaceAll("&amp;", "&");
-					str.ReplaceAll("&copy;", "©");
-					str.ReplaceAll("&reg;", "®");
-					str.ReplaceAll("&quot;", "\"");
+					decode_entities(str);
 
 					if(aNode->Content() == NULL && aNode->CountNodes() <= 0)
 					{
@@ -0,0 +1,279 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: arena-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include <etk/support/Arena.h>
+#include <etk/interface/Region.h>
+#include <etk/render/Render.h>
+#include <etk/app/Looper.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+#define MSG_ALLOCATE		'allc'
+#define MSG_QUIT_TEST		'quit'
+
+
+class TRender : public ERender {
+public:
+	TRender()
+		: ERender()
+	{
+		memset(fPixels, 0, sizeof(fPixels));
+	}
+
+	euint8 fPixels[64][64];
+
+private:
+	virtual e_status_t InitCheck() const
+	{
+		return E_OK;
+	}
+
+	virtual void GetFrame(eint32 *originX, eint32 *originY, euint32 *width, euint32 *height) const
+	{
+		if(originX) *originX = 0;
+		if(originY) *originY = 0;
+		if(width) *width = 64;
+		if(height) *height = 64;
+	}
+
+	virtual void GetPixel(eint32 x, eint32 y, e_rgb_color &color) const
+	{
+		color.set_to(fPixels[y][x], 0, 0, 255);
+	}
+
+	virtual void PutPixel(eint32 x, eint32 y, e_rgb_color color)
+	{
+		fPixels[y][x] = color.red;
+	}
+};
+
+
+class TLooper : public ELooper {
+public:
+	TLooper()
+		: ELooper(), fMarks(0), fReserved(0), fGrown(0), fDoneSem(NULL)
+	{
+	}
+
+	virtual void MessageReceived(EMessage *msg)
+	{
+		if(msg->what == MSG_ALLOCATE)
+		{
+			EArena *arena = ScratchArena();
+			if(arena == NULL || arena->Mark() != 0) fMarks++;
+			if(arena == NULL) return;
+
+			// the large block is kept after the first message
+			arena->Allocate(100000);
+			if(fReserved != 0 && arena->BytesReserved() != fReserved) fGrown++;
+			fReserved = arena->BytesReserved();
+		}
+		else if(msg->what == MSG_QUIT_TEST)
+		{
+			etk_release_sem(fDoneSem);
+		}
+	}
+
+	eint32 fMarks;
+	size_t fReserved;
+	eint32 fGrown;
+	void *fDoneSem;
+};
+
+
+static void check_region(const ERegion &a, const ERegion &b)
+{
+	assert(a.CountRects() == b.CountRects() && a.Frame() == b.Frame());
+	for(eint32 i = 0; i < a.CountRects(); i++) assert(a.RectAt(i) == b.RectAt(i));
+}
+
+
+static void bench_region(eint32 count)
+{
+	EArena arena;
+
+	for(eint32 k = 0; k < 2; k++)
+	{
+		e_bigtime_t t = etk_system_time();
+		for(eint32 n = 0; n < 100; n++)
+		{
+			ERegion region;
+			for(eint32 i = 0; i < count; i++)
+			{
+				float x = (float)((i * 37) % 200), y = (float)((i * 53) % 200);
+				region.Include(ERect(x, y, x + 30, y + 20), k == 0 ? NULL : &arena);
+			}
+		}
+		e_bigtime_t tInclude = etk_system_time() - t;
+
+		ETK_OUTPUT("%I32i rects, %s: Include %I64i op/s\n", count, k == 0 ? "stack buffer" : "EArena",
+			   (eint64)count * 100 * E_INT64_CONSTANT(1000000) / max_c(tInclude, E_INT64_CONSTANT(1)));
+	}
+}
+
+
+static void bench_polygon(eint32 numPts)
+{
+	TRender render;
+	EPoint *pts = (EPoint*)malloc(sizeof(EPoint) * (size_t)numPts);
+	for(eint32 i = 0; i < numPts; i++)
+	{
+		// convex, around the center
+		float a = (float)i * 6.2831853f / (float)numPts;
+		pts[i].Set(32.f + 30.f * (float)cos(a), 32.f + 30.f * (float)sin(a));
+	}
+
+	EArena arena;
+	render.FillPolygon(pts, numPts, true, E_SOLID_HIGH, &arena);
+	size_t reserved = arena.BytesReserved();
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 n = 0; n < 1000; n++) render.FillPolygon(pts, numPts, true, E_SOLID_HIGH, &arena);
+	e_bigtime_t tFill = etk_system_time() - t;
+
+	// the blocks are reused
+	assert(arena.BytesReserved() == reserved && arena.Mark() == 0);
+
+	ETK_OUTPUT("%I32i points: FillPolygon %I64i op/s, %I64u bytes of arena\n", numPts,
+		   E_INT64_CONSTANT(1000) * E_INT64_CONSTANT(1000000) / max_c(tFill, E_INT64_CONSTANT(1)),
+		   (euint64)reserved);
+
+	free(pts);
+}
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("arena-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	EArena arena(256);
+	assert(arena.Mark() == 0 && arena.BytesReserved() == 0);
+
+	char *p1 = (char*)arena.Allocate(3);
+	char *p2 = (char*)arena.Allocate(10);
+	assert(p1 != NULL && p2 != NULL && ((size_t)p1 & 15) == 0 && ((size_t)p2 & 15) == 0 && p2 > p1);
+	assert(arena.BytesReserved() == 256);
+
+	size_t mark = arena.Mark();
+	char *p3 = (char*)arena.Allocate(200);
+	char *big = (char*)arena.Allocate(10000);
+	assert(p3 != NULL && big != NULL && arena.BytesReserved() == 256 + 10000);
+	memset(big, 'x', 10000);
+
+	// the memory after "mark" is given again, without allocating blocks
+	arena.Release(mark);
+	assert(arena.Mark() == mark && arena.Allocate(200) == p3);
+	assert(arena.Allocate(10000) == big && arena.BytesReserved() == 256 + 10000);
+
+	// the large block stays after Reset()
+	arena.Reset();
+	assert(arena.Mark() == 0 && arena.BytesReserved() == 256 + 10000 && arena.Allocate(3) == p1);
+	assert(arena.Allocate(10000) == big && arena.BytesReserved() == 256 + 10000);
+	arena.Reset();
+
+	// buffer on stack first
+	char buffer[512];
+	EArena stackArena(buffer, sizeof(buffer));
+	char *p4 = (char*)stackArena.Allocate(100);
+	assert(p4 > buffer && p4 < buffer + sizeof(buffer) && stackArena.BytesReserved() == 0);
+	assert(stackArena.Allocate(1000) != NULL && stackArena.BytesReserved() > 0);
+	size_t stackReserved = stackArena.BytesReserved();
+	stackArena.Reset();
+	assert(stackArena.BytesReserved() == stackReserved && stackArena.Allocate(100) == p4);
+
+	// ERegion gives the same rectangles with or without arena
+	ERegion r1, r2;
+	for(eint32 i = 0; i < 50; i++)
+	{
+		float x = (float)((i * 37) % 100), y = (float)((i * 53) % 100);
+		assert(r1.Include(ERect(x, y, x + 30, y + 20)) == r2.Include(ERect(x, y, x + 30, y + 20), &arena));
+		assert(arena.Mark() == 0);
+	}
+	check_region(r1, r2);
+	assert(r1.Contains(ERect(10, 10, 20, 20)));
+	ERegion r3(ERect(-50, -50, 0, 0));
+	ERegion r4(r3);
+	assert(r3.Include(&r1) && r4.Include(&r1, &arena));
+	check_region(r3, r4);
+
+	// the pieces of a rectangle cut by many holes take the arena in proportion to them
+	ERegion grid;
+	for(eint32 i = 0; i < 900; i++)
+	{
+		float x = (float)(i % 30) * 20.f, y = (float)(i / 30) * 20.f;
+		assert(grid.Include(ERect(x, y, x + 9, y + 9)));
+	}
+	EArena gridArena;
+	assert(grid.Include(ERect(0, 0, 600, 600), &gridArena) && gridArena.Mark() == 0);
+	eint32 nPieces = grid.CountRects() - 900;
+	assert(nPieces > 900 && gridArena.BytesReserved() <= sizeof(ERect) * (size_t)nPieces * 32 + E_ARENA_DEFAULT_BLOCK_SIZE);
+
+	// FillPolygon gives the same pixels with or without arena
+	EPoint pts[6] = {EPoint(5, 5), EPoint(50, 8), EPoint(60, 40), EPoint(30, 60), EPoint(2, 40), EPoint(5, 5)};
+	TRender render1, render2;
+	render1.SetHighColor(200, 0, 0);
+	render2.SetHighColor(200, 0, 0);
+	render1.FillPolygon(pts, 6, true);
+	render2.FillPolygon(pts, 6, true, E_SOLID_HIGH, &arena);
+	assert(memcmp(render1.fPixels, render2.fPixels, sizeof(render1.fPixels)) == 0);
+	assert(render1.fPixels[30][30] == 200 && render1.fPixels[62][62] == 0);
+	assert(arena.Mark() == 0);
+
+	// the scratch arena of looper is released after every message
+	TLooper *looper = new TLooper();
+	looper->fDoneSem = etk_create_sem(0, NULL);
+	assert(looper->ScratchArena() == NULL);
+	looper->Lock();
+	looper->Run();
+	looper->Unlock();
+
+	for(eint32 i = 0; i < 10; i++) looper->PostMessage(MSG_ALLOCATE);
+	looper->PostMessage(MSG_QUIT_TEST);
+	etk_acquire_sem(looper->fDoneSem);
+
+	looper->Lock();
+	assert(looper->fMarks == 0 && looper->fGrown == 0);
+	etk_delete_sem(looper->fDoneSem);
+	looper->Quit();
+
+	eint32 maxCount = (argc > 1 ? atoi(argv[1]) : 200);
+	for(eint32 count = 50; count <= maxCount && count > 0; count *= 2) bench_region(count);
+
+	bench_polygon(8);
+	bench_polygon(64);
+
+	return 0;
+}
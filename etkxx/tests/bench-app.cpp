@@ -0,0 +1,192 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: bench-app.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <etk/kernel/Kernel.h>
+#include <etk/app/Message.h>
+#include <etk/app/Looper.h>
+
+#include "bench.h"
+
+
+static const char *field_names[20] = {
+	"field0", "field1", "field2", "field3", "field4", "field5", "field6", "field7", "field8", "field9",
+	"field10", "field11", "field12", "field13", "field14", "field15", "field16", "field17", "field18", "field19"
+};
+
+
+// 20 fields of several types, as a typical notice message
+static void *message_setup(void)
+{
+	EMessage *msg = new EMessage('BNCH');
+	for(eint32 i = 0; i < 20; i++)
+	{
+		switch(i % 4)
+		{
+			case 0: msg->AddInt32(field_names[i], i); break;
+			case 1: msg->AddString(field_names[i], "the value of a string field"); break;
+			case 2: msg->AddRect(field_names[i], ERect(0, 0, i, i)); break;
+			default: msg->AddFloat(field_names[i], (float)i); break;
+		}
+	}
+	return msg;
+}
+
+
+static void message_teardown(void *data)
+{
+	delete (EMessage*)data;
+}
+
+
+static void message_add_int32(void *data, eint64 iterations)
+{
+	EMessage msg('BNCH');
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		msg.AddInt32(field_names[i % 20], (eint32)i);
+		if((i & 0xff) == 0xff) msg.MakeEmpty();
+	}
+}
+
+
+static void message_find_int32(void *data, eint64 iterations)
+{
+	const EMessage *msg = (const EMessage*)data;
+	eint32 val = 0;
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		msg->FindInt32(field_names[(i % 5) * 4], &val);
+		etk_bench_sink += val;
+	}
+}
+
+
+static void message_flatten(void *data, eint64 iterations)
+{
+	const EMessage *msg = (const EMessage*)data;
+	size_t size = msg->FlattenedSize();
+	char *buffer = (char*)malloc(size);
+
+	for(eint64 i = 0; i < iterations; i++) etk_bench_sink += msg->Flatten(buffer, size);
+
+	free(buffer);
+}
+
+
+static void message_unflatten(void *data, eint64 iterations)
+{
+	const EMessage *msg = (const EMessage*)data;
+	size_t size = msg->FlattenedSize();
+	char *buffer = (char*)malloc(size);
+	msg->Flatten(buffer, size);
+
+	EMessage aMsg;
+	for(eint64 i = 0; i < iterations; i++) etk_bench_sink += aMsg.Unflatten(buffer, size);
+
+	free(buffer);
+}
+
+
+class TBenchLooper : public ELooper {
+public:
+	TBenchLooper();
+	virtual ~TBenchLooper();
+
+	virtual void MessageReceived(EMessage *msg);
+
+	void *fSem;
+};
+
+
+TBenchLooper::TBenchLooper()
+	: ELooper("etk-bench")
+{
+	fSem = etk_create_sem(0, NULL);
+}
+
+
+TBenchLooper::~TBenchLooper()
+{
+	etk_delete_sem(fSem);
+}
+
+
+void
+TBenchLooper::MessageReceived(EMessage *msg)
+{
+	if(msg->what == 'BNCH')
+		etk_release_sem(fSem);
+	else
+		ELooper::MessageReceived(msg);
+}
+
+
+static void *looper_setup(void)
+{
+	TBenchLooper *looper = new TBenchLooper();
+	looper->Lock();
+	looper->Run();
+	looper->Unlock();
+	return looper;
+}
+
+
+static void looper_teardown(void *data)
+{
+	TBenchLooper *looper = (TBenchLooper*)data;
+	looper->Lock();
+	looper->Quit();
+}
+
+
+// from PostMessage() to MessageReceived(), and the wakeup of the poster
+static void looper_post_dispatch(void *data, eint64 iterations)
+{
+	TBenchLooper *looper = (TBenchLooper*)data;
+	EMessage msg('BNCH');
+
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		looper->PostMessage(&msg);
+		etk_acquire_sem(looper->fSem);
+	}
+}
+
+
+const e_bench etk_bench_app[] = {
+	{"app.message.add_int32", NULL, message_add_int32, NULL},
+	{"app.message.find_int32", message_setup, message_find_int32, message_teardown},
+	{"app.message.flatten_20", message_setup, message_flatten, message_teardown},
+	{"app.message.unflatten_20", message_setup, message_unflatten, message_teardown},
+	{"app.looper.post_dispatch", looper_setup, looper_post_dispatch, looper_teardown},
+	{NULL, NULL, NULL, NULL}
+};
@@ -0,0 +1,123 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: bench-interface.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <etk/interface/Region.h>
+
+#include "bench.h"
+
+
+// a staircase of 64 rectangles, as the visible region of an overlapped window
+static void build_region(ERegion *region)
+{
+	for(eint32 i = 0; i < 64; i++) region->Include(ERect(i * 8, i * 4, i * 8 + 100, i * 4 + 30));
+}
+
+
+static void *region_setup(void)
+{
+	ERegion *region = new ERegion();
+	build_region(region);
+	return region;
+}
+
+
+static void region_teardown(void *data)
+{
+	delete (ERegion*)data;
+}
+
+
+static void region_include_64(void *data, eint64 iterations)
+{
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		ERegion region;
+		build_region(&region);
+		etk_bench_sink += region.CountRects();
+	}
+}
+
+
+static void region_intersect_rect(void *data, eint64 iterations)
+{
+	const ERegion *region = (const ERegion*)data;
+	ERect r(100, 50, 300, 150);
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		ERegion aRegion = *region & r;
+		etk_bench_sink += aRegion.CountRects();
+	}
+}
+
+
+static void region_intersect_region(void *data, eint64 iterations)
+{
+	const ERegion *region = (const ERegion*)data;
+	ERegion other(*region);
+	other.OffsetBy(50, 20);
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		ERegion aRegion = *region & other;
+		etk_bench_sink += aRegion.CountRects();
+	}
+}
+
+
+static void region_exclude_rect(void *data, eint64 iterations)
+{
+	const ERegion *region = (const ERegion*)data;
+	ERect r(100, 50, 300, 150);
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		ERegion aRegion(*region);
+		aRegion.Exclude(r);
+		etk_bench_sink += aRegion.CountRects();
+	}
+}
+
+
+static void region_contains(void *data, eint64 iterations)
+{
+	const ERegion *region = (const ERegion*)data;
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		EPoint pt((float)(i % 640), (float)((i / 640) % 300));
+		etk_bench_sink += region->Contains(pt);
+	}
+}
+
+
+const e_bench etk_bench_interface[] = {
+	{"interface.region.include_64", NULL, region_include_64, NULL},
+	{"interface.region.intersect_rect", region_setup, region_intersect_rect, region_teardown},
+	{"interface.region.intersect_region", region_setup, region_intersect_region, region_teardown},
+	{"interface.region.exclude_rect", region_setup, region_exclude_rect, region_teardown},
+	{"interface.region.contains", region_setup, region_contains, region_teardown},
+	{NULL, NULL, NULL, NULL}
+};
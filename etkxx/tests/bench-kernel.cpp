@@ -0,0 +1,178 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: bench-kernel.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include <etk/kernel/Kernel.h>
+
+#include "bench.h"
+
+
+typedef struct echo_data {
+	void *ping;
+	void *pong;
+	void *thread;
+} echo_data;
+
+
+static e_status_t sem_echo_thread(void *arg)
+{
+	echo_data *echo = (echo_data*)arg;
+	while(etk_acquire_sem(echo->ping) == E_OK) etk_release_sem(echo->pong);
+	return E_OK;
+}
+
+
+static e_status_t port_echo_thread(void *arg)
+{
+	echo_data *echo = (echo_data*)arg;
+	char buf[64];
+	eint32 code;
+
+	while(etk_read_port(echo->ping, &code, buf, sizeof(buf)) == E_OK && code >= 0)
+	{
+		if(etk_write_port(echo->pong, code, buf, sizeof(buf)) != E_OK) break;
+	}
+	return E_OK;
+}
+
+
+static void *start_echo(void *ping, void *pong, e_thread_func func)
+{
+	echo_data *echo = (echo_data*)malloc(sizeof(echo_data));
+	echo->ping = ping;
+	echo->pong = pong;
+	echo->thread = etk_create_thread(func, E_NORMAL_PRIORITY, echo, NULL);
+	etk_resume_thread(echo->thread);
+	return echo;
+}
+
+
+static void *sem_setup(void)
+{
+	return start_echo(etk_create_sem(0, NULL), etk_create_sem(0, NULL), sem_echo_thread);
+}
+
+
+static void sem_teardown(void *data)
+{
+	echo_data *echo = (echo_data*)data;
+
+	// the echo thread returns once "ping" closed
+	etk_close_sem(echo->ping);
+	etk_wait_for_thread(echo->thread, NULL);
+	etk_delete_thread(echo->thread);
+	etk_delete_sem(echo->ping);
+	etk_delete_sem(echo->pong);
+	free(echo);
+}
+
+
+static void sem_round_trip(void *data, eint64 iterations)
+{
+	echo_data *echo = (echo_data*)data;
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		etk_release_sem(echo->ping);
+		etk_acquire_sem(echo->pong);
+	}
+}
+
+
+static void sem_release_acquire(void *data, eint64 iterations)
+{
+	void *sem = etk_create_sem(0, NULL);
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		etk_release_sem(sem);
+		etk_acquire_sem(sem);
+	}
+	etk_delete_sem(sem);
+}
+
+
+static void *port_setup(void)
+{
+	return start_echo(etk_create_port(10, NULL), etk_create_port(10, NULL), port_echo_thread);
+}
+
+
+static void port_teardown(void *data)
+{
+	echo_data *echo = (echo_data*)data;
+
+	// the echo thread returns once it reads a negative code
+	etk_write_port(echo->ping, -1, NULL, 0);
+	etk_wait_for_thread(echo->thread, NULL);
+	etk_delete_thread(echo->thread);
+	etk_delete_port(echo->ping);
+	etk_delete_port(echo->pong);
+	free(echo);
+}
+
+
+static void port_round_trip(void *data, eint64 iterations)
+{
+	echo_data *echo = (echo_data*)data;
+	char buf[64];
+	eint32 code;
+
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		etk_write_port(echo->ping, (eint32)(i & 0x7fffffff), buf, sizeof(buf));
+		etk_read_port(echo->pong, &code, buf, sizeof(buf));
+	}
+	etk_bench_sink += code;
+}
+
+
+static void port_write_read(void *data, eint64 iterations)
+{
+	void *port = etk_create_port(10, NULL);
+	char buf[64];
+	eint32 code = 0;
+
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		etk_write_port(port, (eint32)i, buf, sizeof(buf));
+		etk_read_port(port, &code, buf, sizeof(buf));
+	}
+	etk_bench_sink += code;
+
+	etk_delete_port(port);
+}
+
+
+const e_bench etk_bench_kernel[] = {
+	{"kernel.semaphore.release_acquire", NULL, sem_release_acquire, NULL},
+	{"kernel.semaphore.round_trip", sem_setup, sem_round_trip, sem_teardown},
+	{"kernel.port.write_read_64", NULL, port_write_read, NULL},
+	{"kernel.port.round_trip_64", port_setup, port_round_trip, port_teardown},
+	{NULL, NULL, NULL, NULL}
+};
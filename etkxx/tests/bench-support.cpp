@@ -0,0 +1,146 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: bench-support.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include <etk/support/List.h>
+#include <etk/support/String.h>
+
+#include "bench.h"
+
+
+static void *list_setup(void)
+{
+	EList *list = new EList();
+	for(eint32 i = 0; i < 1024; i++) list->AddItem((void*)(long)(i + 1));
+	return list;
+}
+
+
+static void list_teardown(void *data)
+{
+	delete (EList*)data;
+}
+
+
+static void list_add_item(void *data, eint64 iterations)
+{
+	EList list;
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		list.AddItem((void*)(long)(i + 1));
+		if(list.CountItems() == 65536) list.MakeEmpty();
+	}
+	etk_bench_sink += list.CountItems();
+}
+
+
+// the list keeps 1024 items
+static void list_fifo(void *data, eint64 iterations)
+{
+	EList *list = (EList*)data;
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		list->AddItem(list->RemoveItem((eint32)0));
+	}
+	etk_bench_sink += (eint64)(long)list->FirstItem();
+}
+
+
+static void list_insert_remove_middle(void *data, eint64 iterations)
+{
+	EList *list = (EList*)data;
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		list->AddItem((void*)(long)i, 512);
+		list->RemoveItem((eint32)512);
+	}
+	etk_bench_sink += list->CountItems();
+}
+
+
+static void string_append(void *data, eint64 iterations)
+{
+	EString str;
+	for(eint64 i = 0; i < iterations; i++)
+	{
+		str.Append("0123456789", 10);
+		if(str.Length() >= 1024 * 1024) str.MakeEmpty();
+	}
+	etk_bench_sink += str.Length();
+}
+
+
+// 64 KB of text, the pattern is at the end
+static void *string_setup(void)
+{
+	EString *str = new EString();
+	for(eint32 i = 0; i < 65536; i++) str->Append((char)(rand() % 8 == 0 ? ' ' : 'a' + rand() % 26), 1);
+	str->Append("etk-bench");
+	return str;
+}
+
+
+static void string_teardown(void *data)
+{
+	delete (EString*)data;
+}
+
+
+static void string_find_first(void *data, eint64 iterations)
+{
+	const EString *str = (const EString*)data;
+	for(eint64 i = 0; i < iterations; i++) etk_bench_sink += str->FindFirst("etk-bench");
+}
+
+
+static void string_find_last(void *data, eint64 iterations)
+{
+	const EString *str = (const EString*)data;
+	for(eint64 i = 0; i < iterations; i++) etk_bench_sink += str->FindLast("etk-bench", 65536);
+}
+
+
+static void string_ifind_first(void *data, eint64 iterations)
+{
+	const EString *str = (const EString*)data;
+	for(eint64 i = 0; i < iterations; i++) etk_bench_sink += str->IFindFirst("ETK-BENCH");
+}
+
+
+const e_bench etk_bench_support[] = {
+	{"support.list.add_item", NULL, list_add_item, NULL},
+	{"support.list.fifo", list_setup, list_fifo, list_teardown},
+	{"support.list.insert_remove_middle", list_setup, list_insert_remove_middle, list_teardown},
+	{"support.string.append", NULL, string_append, NULL},
+	{"support.string.find_first_64k", string_setup, string_find_first, string_teardown},
+	{"support.string.find_last_64k", string_setup, string_find_last, string_teardown},
+	{"support.string.ifind_first_64k", string_setup, string_ifind_first, string_teardown},
+	{NULL, NULL, NULL, NULL}
+};
@@ -0,0 +1,182 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: bench.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+#include "bench.h"
+
+/*
+ * Usage: etk-bench [-l] [-t milliseconds] [-r repeats] [-o file] [pattern...]
+ *
+ * Each benchmark runs with the iterations growing until one run takes
+ * "-t" milliseconds (100 by default), then it runs "-r" times (5 by default).
+ * Only the benchmarks whose names contain one of the patterns run.
+ *
+ * The output is kept stable for tracking between releases: the lines
+ * beginning with '#' are comments, the others are the results separated
+ * by tabs, in nanoseconds per operation:
+ *
+ * 	name	iterations	median	min	max
+ *
+ * The version of the format in the first line changes when the columns change.
+ * The debugging messages of the library go to stdout as well, "-o" writes the
+ * results to "file" instead.
+ */
+
+#define ETK_BENCH_FORMAT_VERSION	1
+
+volatile eint64 etk_bench_sink = 0;
+
+static const e_bench *suites[] = {
+	etk_bench_support,
+	etk_bench_kernel,
+	etk_bench_app,
+	etk_bench_interface,
+	NULL
+};
+
+
+static e_bigtime_t run_once(const e_bench *bench, void *data, eint64 iterations)
+{
+	e_bigtime_t t = etk_system_time();
+	bench->run(data, iterations);
+	return etk_system_time() - t;
+}
+
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *((const double*)a), y = *((const double*)b);
+	return(x < y ? -1 : (x > y ? 1 : 0));
+}
+
+
+static void run_bench(FILE *out, const e_bench *bench, e_bigtime_t minTime, eint32 repeats)
+{
+	void *data = (bench->setup ? bench->setup() : NULL);
+
+	// calibrates, aims at 1.2 times of "minTime" to get over it at once
+	eint64 iterations = 1;
+	for(;;)
+	{
+		e_bigtime_t t = run_once(bench, data, iterations);
+		if(t >= minTime || iterations >= (E_INT64_CONSTANT(1) << 40)) break;
+
+		eint64 next = (t > 0 ? iterations * minTime * 12 / (t * 10) : iterations * 100);
+		iterations = min_c(max_c(next, iterations * 2), iterations * 100);
+	}
+
+	double *results = (double*)malloc(sizeof(double) * (size_t)repeats);
+	for(eint32 i = 0; i < repeats; i++)
+		results[i] = (double)run_once(bench, data, iterations) * 1000. / (double)iterations;
+	qsort(results, (size_t)repeats, sizeof(double), compare_double);
+
+	fprintf(out, "%s\t%lld\t%.2f\t%.2f\t%.2f\n", bench->name, (long long)iterations,
+		results[repeats / 2], results[0], results[repeats - 1]);
+	fflush(out);
+
+	free(results);
+	if(bench->teardown) bench->teardown(data);
+}
+
+
+static bool match(const char *name, int argc, char **argv, int first)
+{
+	if(first >= argc) return true;
+	for(int i = first; i < argc; i++) if(strstr(name, argv[i]) != NULL) return true;
+	return false;
+}
+
+
+int main(int argc, char **argv)
+{
+	e_bigtime_t minTime = E_INT64_CONSTANT(100000);
+	eint32 repeats = 5;
+	bool listOnly = false;
+	const char *outName = NULL;
+	int first = 1;
+
+	for(; first < argc && argv[first][0] == '-'; first++)
+	{
+		if(strcmp(argv[first], "-l") == 0)
+			listOnly = true;
+		else if(strcmp(argv[first], "-t") == 0 && first + 1 < argc)
+			minTime = (e_bigtime_t)atoi(argv[++first]) * E_INT64_CONSTANT(1000);
+		else if(strcmp(argv[first], "-r") == 0 && first + 1 < argc)
+			repeats = (eint32)atoi(argv[++first]);
+		else if(strcmp(argv[first], "-o") == 0 && first + 1 < argc)
+			outName = argv[++first];
+		else
+		{
+			fprintf(stderr, "Usage: %s [-l] [-t milliseconds] [-r repeats] [-o file] [pattern...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(minTime <= 0) minTime = E_INT64_CONSTANT(1000);
+	if(repeats <= 0) repeats = 1;
+
+	FILE *out = (outName ? fopen(outName, "w") : stdout);
+	if(out == NULL)
+	{
+		fprintf(stderr, "%s: unable to write \"%s\"\n", argv[0], outName);
+		return 1;
+	}
+
+	if(!listOnly)
+	{
+		fprintf(out, "# etk-bench %d\n", ETK_BENCH_FORMAT_VERSION);
+		fprintf(out, "# ETK %u.%u.%u, %lld ms per run, %d runs\n",
+			etk_major_version, etk_minor_version, etk_micro_version,
+			(long long)(minTime / 1000), (int)repeats);
+		fprintf(out, "# name\titerations\tns/op median\tns/op min\tns/op max\n");
+	}
+
+	for(eint32 k = 0; suites[k] != NULL; k++)
+	{
+		for(const e_bench *bench = suites[k]; bench->name != NULL; bench++)
+		{
+			if(match(bench->name, argc, argv, first) == false) continue;
+
+			if(listOnly)
+				fprintf(out, "%s\n", bench->name);
+			else
+				run_bench(out, bench, minTime, repeats);
+		}
+	}
+
+	if(out != stdout) fclose(out);
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: bench.h
+ *
+ * --------------------------------------------------------------------------*/
+
+#ifndef __ETK_TESTS_BENCH_H__
+#define __ETK_TESTS_BENCH_H__
+
+#include <etk/support/SupportDefs.h>
+
+// e_bench:
+// 	One microbenchmark of etk-bench, named as "kit.class.operation".
+// 	"setup" prepares the data once and could be NULL, "run" does the operation
+// 	"iterations" times, "teardown" releases what "setup" returned and could be NULL.
+typedef struct e_bench {
+	const char	*name;
+	void		*(*setup)(void);
+	void		(*run)(void *data, eint64 iterations);
+	void		(*teardown)(void *data);
+} e_bench;
+
+// The suites, each one ends with an item whose name is NULL.
+extern const e_bench etk_bench_support[];
+extern const e_bench etk_bench_kernel[];
+extern const e_bench etk_bench_app[];
+extern const e_bench etk_bench_interface[];
+
+// The results go here so that the compiler doesn't drop the operations.
+extern volatile eint64 etk_bench_sink;
+
+#endif /* __ETK_TESTS_BENCH_H__ */
@@ -0,0 +1,184 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: bufferedio-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include <etk/support/BufferedIO.h>
+#include <etk/storage/File.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+
+// counts the calls reaching the stream
+class ECountingFile : public EFile {
+public:
+	ECountingFile(const char *path, euint32 open_mode)
+		: EFile(path, open_mode), reads(0), writes(0)
+	{
+	}
+
+	virtual ssize_t ReadAt(eint64 pos, void *buffer, size_t size)
+	{
+		reads++;
+		return EFile::ReadAt(pos, buffer, size);
+	}
+
+	virtual ssize_t WriteAt(eint64 pos, const void *buffer, size_t size)
+	{
+		writes++;
+		return EFile::WriteAt(pos, buffer, size);
+	}
+
+	eint32 reads;
+	eint32 writes;
+};
+
+
+static void bench_read(const char *path, eint64 size)
+{
+	char buf[16];
+	euint32 sum = 0;
+
+	EFile f(path, E_READ_ONLY);
+	e_bigtime_t t = etk_system_time();
+	for(eint64 pos = 0; pos < size; pos += sizeof(buf))
+	{
+		f.Read(buf, sizeof(buf));
+		sum += (euint8)buf[0];
+	}
+	e_bigtime_t tRaw = etk_system_time() - t;
+
+	EBufferedIO io(new EFile(path, E_READ_ONLY), E_BUFFERED_IO_DEFAULT_BUFFER_SIZE, true);
+	t = etk_system_time();
+	for(eint64 pos = 0; pos < size; pos += sizeof(buf))
+	{
+		io.Read(buf, sizeof(buf));
+		sum += (euint8)buf[0];
+	}
+	e_bigtime_t tBuffered = etk_system_time() - t;
+
+	ETK_OUTPUT("%I64i bytes in 16-byte records: EFile %I64i MB/s, EBufferedIO %I64i MB/s (%I32u)\n", size,
+		   size / max_c(tRaw, E_INT64_CONSTANT(1)),
+		   size / max_c(tBuffered, E_INT64_CONSTANT(1)), sum);
+}
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("bufferedio-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	char path[64];
+	sprintf(path, "/tmp/etk-bufferedio-test-%ld", (long)getpid());
+
+	ECountingFile *file = new ECountingFile(path, E_CREATE_FILE | E_ERASE_FILE | E_READ_WRITE);
+	assert(file->InitCheck() == E_OK);
+
+	// small writes are coalesced
+	EBufferedIO *io = new EBufferedIO(file, 4096);
+	char record[16];
+	for(eint32 i = 0; i < 1024; i++)
+	{
+		memset(record, 'a' + i % 26, sizeof(record));
+		assert(io->Write(record, sizeof(record)) == (ssize_t)sizeof(record));
+	}
+	assert(io->Position() == 16 * 1024);
+	assert(file->writes == 3);
+	assert(io->Flush() == E_OK && file->writes == 4);
+	assert(file->Position() == 0);
+	assert(file->Seek(0, E_SEEK_END) == 16 * 1024);
+
+	// the pending data is seen before flushing
+	assert(io->WriteAt(16 * 5, "XY", 2) == 2);
+	assert(io->ReadAt(16 * 5 - 1, record, 4) == 4 && memcmp(record, "eXYf", 4) == 0);
+	assert(io->Seek(0, E_SEEK_END) == 16 * 1024);
+	assert(io->Write("tail", 4) == 4);
+	assert(io->Seek(0, E_SEEK_END) == 16 * 1024 + 4);
+
+	// sequential reads go ahead a whole buffer
+	assert(io->Seek(0, E_SEEK_SET) == 0);
+	file->reads = 0;
+	for(eint32 i = 0; i < 1024; i++)
+	{
+		assert(io->Read(record, sizeof(record)) == (ssize_t)sizeof(record));
+		assert(record[15] == 'a' + i % 26 && (i == 5 || record[0] == 'a' + i % 26));
+	}
+	assert(file->reads == 4);
+	assert(io->Read(record, sizeof(record)) == 4 && memcmp(record, "tail", 4) == 0);
+	assert(io->Read(record, sizeof(record)) == 0);
+
+	// large requests go to the stream directly
+	char *block = (char*)malloc(10000);
+	memset(block, 'Z', 10000);
+	assert(io->WriteAt(100, block, 10000) == 10000);
+	assert(io->ReadAt(0, block, 10000) == 10000);
+	assert(block[99] == 'g' && block[100] == 'Z' && block[9999] == 'Z');
+	assert(io->ReadAt(10099, record, 2) == 2 && record[0] == 'Z' && record[1] != 'Z');
+	free(block);
+
+	// writes apart from the pending data
+	assert(io->WriteAt(0, "0", 1) == 1 && io->WriteAt(3000, "1", 1) == 1 && io->WriteAt(8000, "2", 1) == 1);
+	assert(io->SetSize(8001) == E_OK && file->Seek(0, E_SEEK_END) == 8001);
+	assert(io->ReadAt(0, record, 1) == 1 && record[0] == '0');
+	assert(io->ReadAt(3000, record, 1) == 1 && record[0] == '1');
+	assert(io->ReadAt(8000, record, 2) == 1 && record[0] == '2');
+
+	// the stream is told of the data once the wrapper goes away
+	assert(io->SetBufferSize(64) == E_OK && io->BufferSize() == 64);
+	assert(io->Seek(-1, E_SEEK_END) == 8000 && io->Write("end", 3) == 3);
+	assert(file->Seek(0, E_SEEK_END) == 8001);
+	delete io;
+	assert(file->Seek(0, E_SEEK_END) == 8003);
+
+	// works with any EPositionIO
+	EMallocIO mem;
+	EBufferedIO memIO(&mem, 16);
+	assert(memIO.Write("hello, ", 7) == 7 && memIO.Write("world", 5) == 5);
+	assert(mem.BufferLength() == 0 && memIO.Flush() == E_OK);
+	assert(mem.BufferLength() == 12 && memcmp(mem.Buffer(), "hello, world", 12) == 0);
+	assert(memIO.ReadAt(7, record, 16) == 5 && memcmp(record, "world", 5) == 0);
+
+	delete file;
+
+	eint64 size = (argc > 1 ? (eint64)atoi(argv[1]) : E_INT64_CONSTANT(64)) * 1024 * 1024;
+	EFile big(path, E_ERASE_FILE | E_WRITE_ONLY);
+	char data[65536];
+	memset(data, 'z', sizeof(data));
+	for(eint64 pos = 0; pos < size; pos += sizeof(data)) big.Write(data, sizeof(data));
+	big.Unset();
+	bench_read(path, size);
+
+	unlink(path);
+
+	return 0;
+}
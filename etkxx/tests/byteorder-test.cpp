@@ -0,0 +1,280 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: byteorder-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <etk/support/ByteOrder.h>
+#include <etk/app/Message.h>
+#include <etk/render/Pixmap.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+
+typedef void (*swap_func)(void *dest, const void *src, size_t count);
+
+
+// reverses every "size" bytes one by one
+static void reference_swap(euint8 *dest, const euint8 *src, size_t count, size_t size)
+{
+	for(size_t i = 0; i < count; i++)
+		for(size_t k = 0; k < size; k++) dest[i * size + k] = src[i * size + size - 1 - k];
+}
+
+
+static void check_swap(swap_func func, size_t size)
+{
+	euint8 src[1024 + 16], dest[1024 + 16], expected[1024 + 16];
+
+	for(size_t offset = 0; offset < 8; offset++)
+	{
+		for(size_t count = 0; count * size + offset <= 1024; count += (count < 40 ? 1 : 37))
+		{
+			for(size_t i = 0; i < sizeof(src); i++) src[i] = (euint8)rand();
+			memset(dest, 0xaa, sizeof(dest));
+			memset(expected, 0xaa, sizeof(expected));
+
+			reference_swap(expected + offset, src + offset, count, size);
+
+			func(dest + offset, src + offset, count);
+			assert(memcmp(dest, expected, sizeof(dest)) == 0);
+
+			// in place
+			func(src + offset, src + offset, count);
+			assert(memcmp(src + offset, expected + offset, count * size) == 0);
+		}
+	}
+}
+
+
+// writes the fields of a flattened message in the other byte order
+static void swap_flattened(char *buffer)
+{
+	char *p = buffer;
+	euint64 recordCount;
+
+	memcpy(&recordCount, p + sizeof(size_t) + 4 + 8 + 4 * 8 + sizeof(e_address_t) + 1, sizeof(euint64));
+
+	if(sizeof(size_t) == 8) e_swap_int64_array(p, p, 1); else e_swap_int32_array(p, p, 1);
+	p += sizeof(size_t);
+	e_swap_int32_array(p, p, 1); p += 4; // what
+	e_swap_int64_array(p, p, 5); p += 5 * 8; // team, tokens, timestamps
+	if(sizeof(e_address_t) == 8) e_swap_int64_array(p, p, 1); else e_swap_int32_array(p, p, 1);
+	p += sizeof(e_address_t) + 1;
+	e_swap_int64_array(p, p, 1); p += 8;
+
+	for(euint64 i = 0; i < recordCount; i++)
+	{
+		size_t nameLen, bytes;
+		e_type_code type;
+		bool fixed_size;
+
+		memcpy(&nameLen, p, sizeof(size_t));
+		if(sizeof(size_t) == 8) e_swap_int64_array(p, p, 1); else e_swap_int32_array(p, p, 1);
+		p += sizeof(size_t) + nameLen;
+
+		memcpy(&type, p, sizeof(e_type_code));
+		e_swap_int32_array(p, p, 1); p += sizeof(e_type_code);
+
+		memcpy(&fixed_size, p, sizeof(bool)); p += sizeof(bool);
+
+		memcpy(&bytes, p, sizeof(size_t));
+		if(sizeof(size_t) == 8) e_swap_int64_array(p, p, 1); else e_swap_int32_array(p, p, 1);
+		p += sizeof(size_t);
+
+		if(fixed_size) e_swap_data(type, p, bytes, E_SWAP_ALWAYS);
+		p += bytes;
+	}
+}
+
+
+static void test_message()
+{
+	eint32 array[100];
+	for(eint32 i = 0; i < 100; i++) array[i] = i * 0x01020304;
+
+	EMessage msg('TBYO');
+	msg.AddInt16("int16", 0x1234);
+	msg.AddInt32("int32", 0x12345678);
+	msg.AddInt64("int64", E_INT64_CONSTANT(0x123456789abcdef0));
+	msg.AddFloat("float", 1.5f);
+	msg.AddDouble("double", -2.25);
+	msg.AddPoint("point", EPoint(3, 4));
+	msg.AddRect("rect", ERect(1, 2, 3, 4));
+	msg.AddString("string", "byte order");
+	msg.AddBool("bool", true);
+	msg.AddData("array", E_INT32_TYPE, array, sizeof(array));
+
+	size_t flattenedSize = msg.FlattenedSize();
+	char *buffer = (char*)malloc(flattenedSize);
+	assert(buffer != NULL && msg.Flatten(buffer, flattenedSize));
+	swap_flattened(buffer);
+
+	EMessage aMsg;
+	assert(aMsg.Unflatten(buffer, flattenedSize));
+	free(buffer);
+
+	eint16 i16 = 0;
+	eint32 i32 = 0;
+	eint64 i64 = 0;
+	float f = 0;
+	double d = 0;
+	EPoint pt;
+	ERect r;
+	const char *str = NULL;
+	bool b = false;
+	const void *data = NULL;
+	ssize_t numBytes = 0;
+
+	assert(aMsg.what == 'TBYO');
+	assert(aMsg.FindInt16("int16", &i16) && i16 == 0x1234);
+	assert(aMsg.FindInt32("int32", &i32) && i32 == 0x12345678);
+	assert(aMsg.FindInt64("int64", &i64) && i64 == E_INT64_CONSTANT(0x123456789abcdef0));
+	assert(aMsg.FindFloat("float", &f) && f == 1.5f);
+	assert(aMsg.FindDouble("double", &d) && d == -2.25);
+	assert(aMsg.FindPoint("point", &pt) && pt == EPoint(3, 4));
+	assert(aMsg.FindRect("rect", &r) && r == ERect(1, 2, 3, 4));
+	assert(aMsg.FindString("string", &str) && strcmp(str, "byte order") == 0);
+	assert(aMsg.FindBool("bool", &b) && b);
+	assert(aMsg.FindData("array", E_INT32_TYPE, &data, &numBytes) && numBytes == (ssize_t)sizeof(array));
+	assert(memcmp(data, array, sizeof(array)) == 0);
+}
+
+
+static void test_pixmap()
+{
+	const eint32 w = 7, h = 5;
+	euint8 rgb32[w * h * 4], rgb24[w * h * 3];
+
+	for(eint32 i = 0; i < w * h; i++)
+	{
+		// B-G-R-A
+		rgb32[i * 4] = (euint8)i;
+		rgb32[i * 4 + 1] = (euint8)(i + 100);
+		rgb32[i * 4 + 2] = (euint8)(i + 200);
+		rgb32[i * 4 + 3] = 0x80;
+	}
+
+	e_color_space spaces[4] = {E_RGB32, E_RGBA32, E_RGB24, E_RGB24_BIG};
+
+	for(eint32 k = 0; k < 4; k++)
+	{
+		EPixmap pixmap((euint32)w, (euint32)h, spaces[k]);
+		pixmap.SetBits(rgb32, sizeof(rgb32), 0, E_RGBA32);
+
+		for(eint32 i = 0; i < w * h; i++)
+		{
+			e_rgb_color c = pixmap.GetPixel(i % w, i / w);
+			assert(c.blue == (euint8)i && c.green == (euint8)(i + 100) && c.red == (euint8)(i + 200));
+			assert(c.alpha == (spaces[k] == E_RGBA32 ? 0x80 : 0xff));
+		}
+
+		// through the other 24-bit order, starts at the second pixel
+		EPixmap aPixmap((euint32)w, (euint32)h, spaces[k]);
+		e_color_space space = (spaces[k] == E_RGB24 ? E_RGB24_BIG : E_RGB24);
+		EPixmap tmp((euint32)w, (euint32)h, space);
+		tmp.SetBits(rgb32, sizeof(rgb32), 0, E_RGB32);
+		memcpy(rgb24, tmp.Bits(), sizeof(rgb24));
+		aPixmap.SetBits(rgb24 + 3, sizeof(rgb24) - 3, k < 2 ? 4 : 3, space);
+
+		for(eint32 i = 1; i < w * h; i++)
+		{
+			e_rgb_color c = aPixmap.GetPixel(i % w, i / w);
+			assert(c.blue == (euint8)i && c.green == (euint8)(i + 100) && c.red == (euint8)(i + 200));
+		}
+	}
+}
+
+
+static void bench_swap(const char *name, swap_func func, size_t size)
+{
+	const size_t bytes = 4 * 1024 * 1024;
+	const eint32 loops = 20;
+
+	euint8 *buffer = (euint8*)malloc(bytes);
+	for(size_t i = 0; i < bytes; i++) buffer[i] = (euint8)i;
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 k = 0; k < loops; k++)
+	{
+		// one by one as e_swap_data() and the graphics engines did
+		size_t count = bytes / size;
+		if(size == 2)
+			for(euint16 *p = (euint16*)buffer; count > 0; count--, p++) *p = E_SWAP_INT16(*p);
+		else if(size == 4)
+			for(euint32 *p = (euint32*)buffer; count > 0; count--, p++) *p = E_SWAP_INT32(*p);
+		else if(size == 8)
+			for(euint64 *p = (euint64*)buffer; count > 0; count--, p++) *p = E_SWAP_INT64(*p);
+		else
+			for(euint8 *p = buffer; count > 0; count--, p += 3) {euint8 c = p[0]; p[0] = p[2]; p[2] = c;}
+	}
+	e_bigtime_t tScalar = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 k = 0; k < loops; k++) func(buffer, buffer, bytes / size);
+	e_bigtime_t tBulk = etk_system_time() - t;
+
+	ETK_OUTPUT("%s: one by one %I64i MB/s, bulk %I64i MB/s\n", name,
+		   (eint64)bytes * loops / max_c(tScalar, E_INT64_CONSTANT(1)),
+		   (eint64)bytes * loops / max_c(tBulk, E_INT64_CONSTANT(1)));
+
+	free(buffer);
+}
+
+
+int main()
+{
+	ETK_OUTPUT("byteorder-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	srand(1);
+	check_swap(e_swap_int16_array, 2);
+	check_swap(e_swap_int32_array, 4);
+	check_swap(e_swap_int64_array, 8);
+	check_swap(e_swap_rgb24_array, 3);
+
+	euint32 v[3] = {0x11223344, 0x55667788, 0x99aabbcc};
+	assert(e_swap_data(E_UINT32_TYPE, v, sizeof(v), E_SWAP_ALWAYS) == E_OK);
+	assert(v[0] == 0x44332211 && v[2] == 0xccbbaa99);
+	assert(e_swap_data(E_UINT32_TYPE, v, 6, E_SWAP_ALWAYS) != E_OK);
+	float f = 1.5f;
+	assert(e_swap_data(E_FLOAT_TYPE, &f, sizeof(f), E_SWAP_ALWAYS) == E_OK && E_SWAP_FLOAT(f) == 1.5f);
+
+	test_message();
+	test_pixmap();
+
+	bench_swap("16-bit", e_swap_int16_array, 2);
+	bench_swap("32-bit", e_swap_int32_array, 4);
+	bench_swap("64-bit", e_swap_int64_array, 8);
+	bench_swap("RGB24", e_swap_rgb24_array, 3);
+
+	return 0;
+}
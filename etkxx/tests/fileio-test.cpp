@@ -0,0 +1,182 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: fileio-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include <etk/storage/File.h>
+#include <etk/app/Message.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+
+static EFile *file = NULL;
+static eint32 readerFailures[4];
+
+
+static e_status_t reader_thread(void *arg)
+{
+	long id = (long)arg;
+	char buf[64];
+
+	// every thread reads its own records without seeking
+	for(eint32 k = 0; k < 1000; k++)
+	{
+		eint64 record = (id + k * 4) % 1024;
+		if(file->ReadAt(record * 64, buf, 64) != 64 ||
+		   buf[0] != (char)('A' + record % 26) || buf[63] != (char)('a' + record % 26)) readerFailures[id]++;
+	}
+
+	return E_OK;
+}
+
+
+static void bench_read(const char *path, eint64 size)
+{
+	EFile f(path, E_READ_ONLY);
+	char buf[16];
+
+	e_bigtime_t t = etk_system_time();
+	for(eint64 pos = 0; pos < size; pos += sizeof(buf)) f.ReadAt(pos, buf, sizeof(buf));
+	e_bigtime_t tReadAt = etk_system_time() - t;
+
+	t = etk_system_time();
+	EMemoryIO *view = f.Map();
+	assert(view != NULL);
+	const char *data = (const char*)view->Buffer();
+	euint32 sum = 0;
+	for(eint64 pos = 0; pos < size; pos += sizeof(buf))
+	{
+		memcpy(buf, data + pos, sizeof(buf));
+		sum += (euint8)buf[0];
+	}
+	delete view;
+	e_bigtime_t tMap = etk_system_time() - t;
+
+	ETK_OUTPUT("%I64i bytes in 16-byte records: ReadAt %I64i MB/s, Map %I64i MB/s (%I32u)\n", size,
+		   size / max_c(tReadAt, E_INT64_CONSTANT(1)),
+		   size / max_c(tMap, E_INT64_CONSTANT(1)), sum);
+}
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("fileio-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	char path[64];
+	sprintf(path, "/tmp/etk-fileio-test-%ld", (long)getpid());
+
+	file = new EFile(path, E_CREATE_FILE | E_ERASE_FILE | E_READ_WRITE);
+	assert(file->InitCheck() == E_OK);
+
+	// EFile goes where EDataIO or EPositionIO is expected
+	EPositionIO *io = file;
+	char record[64];
+	for(eint32 i = 0; i < 1024; i++)
+	{
+		memset(record, 'A' + i % 26, 32);
+		memset(record + 32, 'a' + i % 26, 32);
+		assert(io->Write(record, 64) == 64);
+	}
+	assert(io->Position() == 64 * 1024);
+
+	// ReadAt()/WriteAt() keep the position
+	assert(io->Seek(10, E_SEEK_SET) == 10);
+	assert(io->ReadAt(64 * 3, record, 64) == 64 && record[0] == 'D' && record[63] == 'd');
+	assert(io->WriteAt(64 * 1024, "tail", 4) == 4);
+	assert(io->Position() == 10);
+	assert(io->ReadAt(-1, record, 1) < 0);
+
+	void *threads[4];
+	for(long i = 0; i < 4; i++)
+	{
+		threads[i] = etk_create_thread(reader_thread, E_NORMAL_PRIORITY, (void*)i, NULL);
+		assert(threads[i] != NULL);
+		etk_resume_thread(threads[i]);
+	}
+	for(eint32 i = 0; i < 4; i++)
+	{
+		e_status_t retVal;
+		etk_wait_for_thread(threads[i], &retVal);
+		etk_delete_thread(threads[i]);
+		assert(readerFailures[i] == 0);
+	}
+	assert(io->Position() == 10);
+
+	// read-only view
+	EMemoryIO *view = file->Map();
+	assert(view != NULL && view->BufferLength() == 64 * 1024 + 4);
+	assert(memcmp((const char*)view->Buffer() + 64 * 1024, "tail", 4) == 0);
+	assert(view->WriteAt(0, "x", 1) < 0);
+	delete file;
+	assert(((const char*)view->Buffer())[64 * 5] == 'F');
+	delete view;
+
+	// message loaded from the view without copying
+	EMessage msg('TEST');
+	msg.AddString("name", "fileio");
+	msg.AddInt32("value", 42);
+	size_t flattenedSize = msg.FlattenedSize();
+	char *buffer = (char*)malloc(flattenedSize);
+	assert(msg.Flatten(buffer, flattenedSize));
+
+	EFile msgFile(path, E_ERASE_FILE | E_WRITE_ONLY);
+	assert(msgFile.Write(buffer, flattenedSize) == (ssize_t)flattenedSize);
+	assert(msgFile.Map() == NULL);
+	msgFile.Unset();
+	free(buffer);
+
+	EFile msgIn(path, E_READ_ONLY);
+	view = msgIn.Map();
+	assert(view != NULL);
+	EMessage msg2;
+	const char *str = NULL;
+	eint32 value = 0;
+	assert(msg2.Unflatten((const char*)view->Buffer(), view->BufferLength()));
+	assert(msg2.what == 'TEST' && msg2.FindString("name", &str) && strcmp(str, "fileio") == 0);
+	assert(msg2.FindInt32("value", &value) && value == 42);
+	delete view;
+
+	eint64 size = (argc > 1 ? (eint64)atoi(argv[1]) : E_INT64_CONSTANT(64)) * 1024 * 1024;
+	EFile big(path, E_ERASE_FILE | E_WRITE_ONLY);
+	char block[65536];
+	memset(block, 'z', sizeof(block));
+	for(eint64 pos = 0; pos < size; pos += sizeof(block)) big.Write(block, sizeof(block));
+	big.Unset();
+	bench_read(path, size);
+
+	unlink(path);
+
+	return 0;
+}
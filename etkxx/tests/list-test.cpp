@@ -0,0 +1,187 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: list-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <etk/support/List.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+#include <utility>
+#endif
+
+
+static void check_items(const EList &list)
+{
+	// Items() is terminated by NULL
+	if(list.CountItems() > 0) assert(list.Items()[list.CountItems()] == NULL);
+	assert(list.Capacity() >= list.CountItems());
+}
+
+
+static void bench_list(eint32 count)
+{
+	EList list;
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 i = 0; i < count; i++) list.AddItem((void*)(long)(i + 1));
+	e_bigtime_t tAdd = etk_system_time() - t;
+
+	check_items(list);
+	assert(list.CountItems() == count);
+	assert(list.ItemAt(count - 1) == (void*)(long)count);
+
+	t = etk_system_time();
+	for(eint32 i = count - 1; i >= 0; i--) list.RemoveItem(i);
+	e_bigtime_t tRemove = etk_system_time() - t;
+
+	assert(list.IsEmpty());
+
+	t = etk_system_time();
+	for(eint32 i = 0; i < count; i++)
+	{
+		list.AddItem((void*)(long)(i + 1));
+		if(i & 1) list.RemoveItem((eint32)0);
+	}
+	while(list.RemoveItem((eint32)0) != NULL);
+	e_bigtime_t tQueue = etk_system_time() - t;
+
+	ETK_OUTPUT("%I32i items: AddItem %I64i op/s, RemoveItem %I64i op/s, FIFO %I64i op/s\n", count,
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tAdd, E_INT64_CONSTANT(1)),
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tRemove, E_INT64_CONSTANT(1)),
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tQueue, E_INT64_CONSTANT(1)));
+}
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("list-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	EList list;
+	for(eint32 i = 0; i < 100; i++) list.AddItem((void*)(long)(i + 1));
+	check_items(list);
+
+	list.RemoveItem((eint32)0);
+	list.AddItem((void*)(long)1000, 50);
+	assert(list.ItemAt(0) == (void*)2 && list.ItemAt(50) == (void*)1000 && list.CountItems() == 100);
+	check_items(list);
+
+	list.RemoveItems(10, 80);
+	assert(list.CountItems() == 20 && list.ItemAt(10) == (void*)91);
+	check_items(list);
+
+	// spare slots are released once most of them are unused
+	while(list.CountItems() > 2) list.RemoveItem(list.CountItems() - 1);
+	assert(list.Capacity() < 100);
+	check_items(list);
+
+	assert(list.Reserve(1000) && list.Capacity() >= 1000);
+	void **items = list.Items();
+	for(eint32 i = 0; i < 998; i++) list.AddItem(NULL);
+	assert(list.Items() == items);
+	check_items(list);
+
+	list.RemoveItems(2, -1);
+	list.ShrinkToFit();
+	assert(list.Capacity() == 2);
+	check_items(list);
+
+	EList copy(list);
+	assert(copy.CountItems() == 2 && copy.ItemAt(1) == list.ItemAt(1));
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	// moving takes the items without copying
+	void **copyItems = copy.Items();
+	EList moved(std::move(copy));
+	assert(moved.Items() == copyItems && moved.CountItems() == 2);
+	assert(copy.IsEmpty() && copy.Capacity() == 0);
+	copy = std::move(moved);
+	assert(copy.Items() == copyItems && moved.IsEmpty());
+	moved.AddItem((void*)1);
+	check_items(moved);
+	check_items(copy);
+#endif
+
+	list.MakeEmpty();
+	assert(list.IsEmpty() && list.Capacity() == 0);
+
+	// works as a FIFO queue
+	EList queue;
+	eint32 head = 0, tail = 0;
+	for(eint32 k = 0; k < 100000; k++)
+	{
+		queue.AddItem((void*)(long)(++tail));
+		if(k % 3 != 0) assert(queue.RemoveItem((eint32)0) == (void*)(long)(++head));
+		if(k % 1000 == 0) check_items(queue);
+	}
+	assert(queue.CountItems() == tail - head && queue.FirstItem() == (void*)(long)(head + 1));
+	assert(queue.Capacity() < (tail - head) * 4);
+	queue.AddItem((void*)(long)head, 0);
+	assert(queue.FirstItem() == (void*)(long)head);
+	queue.RemoveItems(0, 10);
+	assert(queue.FirstItem() == (void*)(long)(head + 10));
+	check_items(queue);
+	while(queue.RemoveItem((eint32)0) != NULL);
+	assert(queue.IsEmpty() && queue.Capacity() > 0);
+	queue.ShrinkToFit();
+	assert(queue.Capacity() == 0);
+
+	// the memory survives the list becoming empty
+	EList cycle;
+	cycle.AddItem((void*)1);
+	items = cycle.Items();
+	eint32 capacity = cycle.Capacity();
+	for(eint32 k = 0; k < 1000; k++)
+	{
+		cycle.RemoveItem((eint32)0);
+		assert(cycle.IsEmpty() && cycle.Capacity() == capacity && cycle.Items() == items);
+		cycle.AddItem((void*)(long)(k + 2));
+		assert(cycle.Items() == items && cycle.FirstItem() == (void*)(long)(k + 2));
+		check_items(cycle);
+	}
+	cycle.RemoveItems(0, -1);
+	assert(cycle.IsEmpty() && cycle.Capacity() == capacity);
+	cycle.MakeEmpty();
+	assert(cycle.Capacity() == 0);
+
+	EList minList(16);
+	for(eint32 i = 0; i < 100; i++) minList.AddItem((void*)(long)(i + 1));
+	minList.MakeEmpty();
+	minList.ShrinkToFit();
+	assert(minList.Capacity() == 16);
+
+	eint32 maxCount = (argc > 1 ? atoi(argv[1]) : 10000000);
+	for(eint32 count = 1000; count <= maxCount && count > 0; count *= 10) bench_list(count);
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2006, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: looper-io-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <etk/kernel/Kernel.h>
+#include <etk/kernel/OS.h>
+#include <etk/app/Looper.h>
+#include <etk/kernel/Debug.h>
+
+#define MSG_PIPE_READABLE	'pipr'
+#define MSG_QUIT_TEST		'quit'
+
+
+class TLooper : public ELooper {
+public:
+	TLooper();
+
+	virtual void MessageReceived(EMessage *msg);
+
+	int fPipe[2];
+	eint32 fMessages;
+	eint32 fCallbacks;
+	void *fDoneSem;
+};
+
+
+TLooper::TLooper()
+	: ELooper(), fMessages(0), fCallbacks(0), fDoneSem(NULL)
+{
+}
+
+
+void
+TLooper::MessageReceived(EMessage *msg)
+{
+	if(msg->what == MSG_PIPE_READABLE)
+	{
+		eint32 fd = -1, events = 0;
+		msg->FindInt32("etk:descriptor", &fd);
+		msg->FindInt32("etk:events", &events);
+
+		char buf[32];
+		ssize_t len = read(fd, buf, sizeof(buf));
+		fMessages++;
+
+		ETK_OUTPUT("Message: fd %d, events 0x%x, read %d bytes\n", (int)fd, (unsigned int)events, (int)len);
+	}
+	else if(msg->what == MSG_QUIT_TEST)
+	{
+		etk_release_sem(fDoneSem);
+	}
+}
+
+
+static void pipe_callback(int fd, euint32 events, void *user_data)
+{
+	TLooper *looper = (TLooper*)user_data;
+
+	char buf[32];
+	ssize_t len = read(fd, buf, sizeof(buf));
+	looper->fCallbacks++;
+
+	ETK_OUTPUT("Callback: fd %d, events 0x%x, read %d bytes, locked: %s\n",
+		   fd, (unsigned int)events, (int)len, looper->IsLockedByCurrentThread() ? "yes" : "no");
+}
+
+
+int main(int argc, char **argv)
+{
+	int pipe1[2], pipe2[2];
+	if(pipe(pipe1) != 0 || pipe(pipe2) != 0)
+	{
+		ETK_WARNING("Unable to create pipe!");
+		return 1;
+	}
+
+	TLooper *looper = new TLooper();
+	looper->fDoneSem = etk_create_sem(0, NULL);
+
+	looper->Lock();
+
+	EMessage msg(MSG_PIPE_READABLE);
+	if(looper->AddDescriptor(pipe1[0], E_DESCRIPTOR_READ, &msg) != E_OK ||
+	   looper->AddDescriptor(pipe2[0], E_DESCRIPTOR_READ, pipe_callback, looper) != E_OK)
+	{
+		ETK_WARNING("AddDescriptor() not supported on this platform.");
+		looper->Quit();
+		return 0;
+	}
+
+	looper->Run();
+	looper->Unlock();
+
+	for(eint32 i = 0; i < 10; i++)
+	{
+		if(write((i % 2 == 0) ? pipe1[1] : pipe2[1], "data", 4) != 4) break;
+		looper->PostMessage('noop');
+		e_snooze(10000);
+	}
+
+	looper->PostMessage(MSG_QUIT_TEST);
+	etk_acquire_sem(looper->fDoneSem);
+
+	looper->Lock();
+	ETK_OUTPUT("Received %d messages, %d callbacks.\n", (int)looper->fMessages, (int)looper->fCallbacks);
+	looper->RemoveDescriptor(pipe1[0]);
+	looper->RemoveDescriptor(pipe2[0]);
+	etk_delete_sem(looper->fDoneSem);
+	looper->Quit();
+
+	close(pipe1[0]); close(pipe1[1]);
+	close(pipe2[0]); close(pipe2[1]);
+
+	return 0;
+}
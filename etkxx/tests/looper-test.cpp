@@ -29,12 +29,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <assert.h>
 
 #include <etk/kernel/Kernel.h>
 #include <etk/kernel/OS.h>
 #include <etk/app/Looper.h>
 #include <etk/kernel/Debug.h>
 #include <etk/app/Messenger.h>
+#include <etk/app/AppDefs.h>
 
 
 class TLooper : public ELooper {
@@ -100,8 +103,383 @@ e_status_t testTask(void *arg)
 }
 
 
+// records what the looper did, in order
+class TRecordLooper : public ELooper {
+public:
+	TRecordLooper(const char *name = NULL);
+
+	virtual void MessageReceived(EMessage *msg);
+
+	void Record(eint32 value);
+	eint32 CountRecords();
+	eint32 RecordAt(eint32 index);
+	void ClearRecords();
+
+	e_thread_id fDispatchThread;
+	eint32 fNotices;
+
+private:
+	eint32 fRecords[64];
+	eint32 fCount;
+};
+
+
+TRecordLooper::TRecordLooper(const char *name)
+	: ELooper(name), fDispatchThread(0), fNotices(0), fCount(0)
+{
+}
+
+
+void
+TRecordLooper::MessageReceived(EMessage *msg)
+{
+	fDispatchThread = etk_get_current_thread_id();
+
+	if(msg->what == E_OBSERVER_NOTICE_CHANGE)
+	{
+		eint32 what = 0;
+		assert(msg->FindInt32(E_OBSERVE_WHAT_CHANGE, &what));
+		fNotices++;
+		Record(what);
+	}
+	else if(msg->what != 'sync')
+	{
+		Record(msg->what);
+	}
+
+	if(msg->IsSourceWaiting())
+	{
+		EMessage aMsg(E_REPLY);
+		msg->SendReply(&aMsg);
+	}
+}
+
+
+void
+TRecordLooper::Record(eint32 value)
+{
+	if(fCount < 64) fRecords[fCount++] = value;
+}
+
+
+eint32
+TRecordLooper::CountRecords()
+{
+	Lock();
+	eint32 retVal = fCount;
+	Unlock();
+	return retVal;
+}
+
+
+eint32
+TRecordLooper::RecordAt(eint32 index)
+{
+	Lock();
+	eint32 retVal = (index >= 0 && index < fCount ? fRecords[index] : -1);
+	Unlock();
+	return retVal;
+}
+
+
+void
+TRecordLooper::ClearRecords()
+{
+	Lock();
+	fCount = 0;
+	Unlock();
+}
+
+
+// waits until the pending messages of looper were handled
+static void sync_looper(ELooper *looper)
+{
+	EMessenger msgr(looper);
+	EMessage msg('sync');
+	EMessage reply;
+	assert(msgr.SendMessage(&msg, &reply) == E_OK);
+}
+
+
+// waits until the looper has "count" records at least
+static bool wait_records(TRecordLooper *looper, eint32 count, e_bigtime_t timeout = E_INT64_CONSTANT(2000000))
+{
+	e_bigtime_t endTime = etk_system_time() + timeout;
+	while(looper->CountRecords() < count)
+	{
+		if(etk_system_time() > endTime) return false;
+		e_snooze(1000);
+	}
+	return true;
+}
+
+
+static void quit_looper(ELooper *looper)
+{
+	looper->Lock();
+	looper->Quit();
+}
+
+
+static TRecordLooper *task_looper = NULL;
+static e_bigtime_t task_time[4];
+static eint32 task_rerun = 0;
+
+
+static void record_task(void *user_data)
+{
+	eint32 id = (eint32)(long)user_data;
+
+	assert(task_looper->IsLockedByCurrentThread());
+	assert(ELooper::LooperForThread(etk_get_current_thread_id()) == task_looper->Proxy());
+
+	if(id >= 10 && id < 14) task_time[id - 10] = etk_system_time();
+	task_looper->Record(id);
+}
+
+
+static void cancel_task(void *user_data)
+{
+	// the running task isn't pending any more
+	assert(task_looper->CancelTask(cancel_task, user_data) == false);
+	assert(task_looper->CancelTask(record_task, (void*)21) == true);
+	task_looper->Record(20);
+}
+
+
+static void rerun_task(void *user_data)
+{
+	task_looper->Record(30 + task_rerun);
+	if(++task_rerun < 3) assert(task_looper->RunAfter(E_INT64_CONSTANT(1000), rerun_task, user_data) == E_OK);
+}
+
+
+static void test_tasks()
+{
+	ETK_OUTPUT("\nTesting tasks...\n");
+
+	TRecordLooper *looper = task_looper = new TRecordLooper("task looper");
+	looper->Lock();
+	looper->Run();
+
+	// the idle tasks run after the pending messages, the repeated requests are merged
+	assert(looper->RunWhenIdle(record_task, (void*)1) == E_OK);
+	assert(looper->RunWhenIdle(record_task, (void*)1) == E_OK);
+	assert(looper->RunWhenIdle(record_task, (void*)2) == E_OK);
+	assert(looper->RunWhenIdle(NULL) == E_BAD_VALUE);
+	looper->PostMessage('msg1');
+	looper->PostMessage('msg2');
+	looper->Unlock();
+
+	assert(wait_records(looper, 4));
+	e_snooze(20000);
+	assert(looper->CountRecords() == 4);
+	assert(looper->RecordAt(0) == 'msg1' && looper->RecordAt(1) == 'msg2');
+	assert(looper->RecordAt(2) == 1 && looper->RecordAt(3) == 2);
+	looper->ClearRecords();
+
+	// the timed tasks run in order of time, never before the delay passed
+	e_bigtime_t startTime = etk_system_time();
+	looper->Lock();
+	assert(looper->RunAfter(E_INT64_CONSTANT(-1), record_task) == E_BAD_VALUE);
+	assert(looper->RunAfter(E_INT64_CONSTANT(60000), record_task, (void*)10) == E_OK);
+	assert(looper->RunAfter(E_INT64_CONSTANT(20000), record_task, (void*)11) == E_OK);
+	assert(looper->RunAfter(E_INT64_CONSTANT(0), record_task, (void*)12) == E_OK);
+	looper->Unlock();
+
+	assert(wait_records(looper, 3));
+	assert(looper->RecordAt(0) == 12 && looper->RecordAt(1) == 11 && looper->RecordAt(2) == 10);
+	assert(task_time[1] - startTime >= E_INT64_CONSTANT(20000));
+	assert(task_time[0] - startTime >= E_INT64_CONSTANT(60000));
+	looper->ClearRecords();
+
+	// the cancelled tasks never run
+	looper->Lock();
+	assert(looper->RunAfter(E_INT64_CONSTANT(20000), record_task, (void*)13) == E_OK);
+	assert(looper->RunWhenIdle(record_task, (void*)14) == E_OK);
+	assert(looper->CancelTask(record_task, (void*)13) == true);
+	assert(looper->CancelTask(record_task, (void*)14) == true);
+	assert(looper->CancelTask(record_task, (void*)13) == false);
+	looper->Unlock();
+
+	e_snooze(60000);
+	assert(looper->CountRecords() == 0);
+
+	// cancelling within the running task
+	looper->Lock();
+	assert(looper->RunAfter(E_INT64_CONSTANT(10000), cancel_task, (void*)20) == E_OK);
+	assert(looper->RunAfter(E_INT64_CONSTANT(30000), record_task, (void*)21) == E_OK);
+	looper->Unlock();
+
+	assert(wait_records(looper, 1));
+	e_snooze(60000);
+	assert(looper->CountRecords() == 1 && looper->RecordAt(0) == 20);
+	looper->ClearRecords();
+
+	// the task requests itself again while running
+	looper->Lock();
+	assert(looper->RunAfter(E_INT64_CONSTANT(0), rerun_task) == E_OK);
+	looper->Unlock();
+
+	assert(wait_records(looper, 3));
+	e_snooze(20000);
+	assert(looper->CountRecords() == 3 && looper->RecordAt(0) == 30 && looper->RecordAt(2) == 32);
+
+	quit_looper(looper);
+	task_looper = NULL;
+}
+
+
+static void test_thread_looper()
+{
+	ETK_OUTPUT("\nTesting LooperForThread()...\n");
+
+	TRecordLooper *looper = new TRecordLooper("thread looper");
+	looper->Lock();
+	looper->Run();
+	looper->Unlock();
+
+	sync_looper(looper);
+
+	assert(looper->Thread() != 0 && looper->fDispatchThread == looper->Thread());
+	assert(ELooper::LooperForThread(looper->Thread()) == looper);
+	assert(ELooper::LooperForThread(etk_get_current_thread_id()) == NULL);
+
+	e_thread_id tid = looper->Thread();
+	quit_looper(looper);
+	assert(ELooper::LooperForThread(tid) == NULL);
+}
+
+
+static void test_proxy()
+{
+	ETK_OUTPUT("\nTesting proxy...\n");
+
+	TRecordLooper *proxy = new TRecordLooper("proxy");
+	TRecordLooper *clients[3];
+
+	proxy->Lock();
+	for(eint32 i = 0; i < 3; i++)
+	{
+		clients[i] = new TRecordLooper("client");
+		clients[i]->Lock();
+		assert(clients[i]->ProxyBy(proxy));
+		assert(clients[i]->Proxy() == proxy);
+		clients[i]->Unlock();
+	}
+	proxy->Run();
+	proxy->Unlock();
+
+	// the messages of each client are dispatched in order by the thread of proxy
+	for(eint32 k = 0; k < 10; k++)
+	{
+		for(eint32 i = 0; i < 3; i++) clients[i]->PostMessage('m000' + k);
+		proxy->PostMessage('p000' + k);
+	}
+	for(eint32 i = 0; i < 3; i++) sync_looper(clients[i]);
+	sync_looper(proxy);
+
+	for(eint32 i = 0; i < 3; i++)
+	{
+		assert(clients[i]->CountRecords() == 10);
+		for(eint32 k = 0; k < 10; k++) assert(clients[i]->RecordAt(k) == (eint32)('m000' + k));
+		assert(clients[i]->fDispatchThread == proxy->Thread());
+		assert(clients[i]->Thread() == proxy->Thread());
+	}
+	assert(proxy->CountRecords() == 10);
+	for(eint32 k = 0; k < 10; k++) assert(proxy->RecordAt(k) == (eint32)('p000' + k));
+
+	// the tasks of the clients run by the proxy as well
+	task_looper = clients[1];
+	clients[1]->ClearRecords();
+	clients[1]->Lock();
+	assert(clients[1]->RunAfter(E_INT64_CONSTANT(0), record_task, (void*)1) == E_OK);
+	clients[1]->Unlock();
+	assert(wait_records(clients[1], 1) && clients[1]->RecordAt(0) == 1);
+	task_looper = NULL;
+
+	for(eint32 i = 0; i < 3; i++) quit_looper(clients[i]);
+	quit_looper(proxy);
+}
+
+
+static void test_observers()
+{
+	ETK_OUTPUT("\nTesting observers...\n");
+
+	TRecordLooper *subject = new TRecordLooper("subject");
+	TRecordLooper *observer = new TRecordLooper("observer");
+	TRecordLooper *observerAll = new TRecordLooper("observer all");
+
+	observer->Lock();
+	observer->Run();
+	observer->Unlock();
+
+	observerAll->Lock();
+	observerAll->Run();
+	observerAll->Unlock();
+
+	subject->Lock();
+	assert(subject->IsWatched() == false);
+	assert(subject->StartWatching(observer, 'aaaa') == E_OK);
+	assert(subject->StartWatching(observer, 'bbbb') == E_OK);
+	assert(subject->StartWatchingAll(observerAll) == E_OK);
+	assert(subject->IsWatched('aaaa') && subject->IsWatched('cccc'));
+
+	// only the observers of the code and the ones of all are noticed
+	subject->SendNotices('aaaa');
+	subject->SendNotices('cccc');
+	subject->SendNotices('bbbb');
+	subject->Unlock();
+
+	sync_looper(observer);
+	sync_looper(observerAll);
+	assert(observer->CountRecords() == 2);
+	assert(observer->RecordAt(0) == 'aaaa' && observer->RecordAt(1) == 'bbbb');
+	assert(observerAll->CountRecords() == 3);
+	assert(observerAll->RecordAt(0) == 'aaaa' && observerAll->RecordAt(1) == 'cccc' && observerAll->RecordAt(2) == 'bbbb');
+
+	observer->ClearRecords();
+	observerAll->ClearRecords();
+
+	subject->Lock();
+	assert(subject->StopWatching(observer, 'aaaa') == E_OK);
+	assert(subject->StopWatchingAll(observerAll) == E_OK);
+	assert(subject->IsWatched('bbbb') && subject->IsWatched('aaaa') == false);
+	subject->SendNotices('aaaa');
+	subject->SendNotices('bbbb');
+	subject->Unlock();
+
+	sync_looper(observer);
+	sync_looper(observerAll);
+	assert(observer->CountRecords() == 1 && observer->RecordAt(0) == 'bbbb');
+	assert(observerAll->CountRecords() == 0);
+
+	// the observers which gone are removed when noticing
+	subject->Lock();
+	assert(subject->StartWatching(observerAll, 'dddd') == E_OK);
+	subject->Unlock();
+	quit_looper(observerAll);
+
+	subject->Lock();
+	subject->SendNotices('dddd');
+	assert(subject->IsWatched('dddd') == false);
+	subject->StopWatchingAll(observer);
+	assert(subject->IsWatched() == false);
+	subject->Unlock();
+
+	quit_looper(observer);
+	quit_looper(subject);
+}
+
+
 int main(int argc, char **argv)
 {
+	test_tasks();
+	test_thread_looper();
+	test_proxy();
+	test_observers();
+
 	TLooper *looper = new TLooper();
 
 	looper->Lock();
@@ -0,0 +1,161 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: mallocio-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <etk/support/DataIO.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+
+static void check_content(EMallocIO &io, size_t length)
+{
+	assert(io.BufferLength() == length);
+
+	// the segments cover the data in order
+	size_t offset = 0;
+	for(eint32 i = 0; i < io.CountSegments(); i++)
+	{
+		size_t len = 0;
+		const unsigned char *data = (const unsigned char*)io.SegmentAt(i, &len);
+		assert(data != NULL && len > 0);
+		for(size_t k = 0; k < len; k++, offset++) assert(data[k] == (unsigned char)(offset % 251));
+	}
+	assert(offset == length);
+	assert(io.SegmentAt(io.CountSegments(), NULL) == NULL);
+
+	unsigned char buf[1000];
+	assert(io.ReadAt(length / 2 - io.Position(), buf, sizeof(buf)) == (ssize_t)min_c(sizeof(buf), length - length / 2));
+	assert(buf[0] == (unsigned char)((length / 2) % 251));
+}
+
+
+static void test_mode(bool chunked)
+{
+	EMallocIO io(chunked);
+	assert(io.IsChunked() == chunked);
+	assert(io.CountSegments() == 0 && io.Detach() == NULL);
+
+	unsigned char buf[777];
+	size_t length = 0;
+	for(eint32 i = 0; i < 1000; i++)
+	{
+		for(size_t k = 0; k < sizeof(buf); k++) buf[k] = (unsigned char)((length + k) % 251);
+		assert(io.Write(buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+		length += sizeof(buf);
+	}
+	check_content(io, length);
+	if(chunked) assert(io.CountSegments() > 1 && io.CountSegments() < 20);
+
+	// rewrite across the chunks
+	assert(io.Seek(1000, E_SEEK_SET) == 1000);
+	for(size_t k = 0; k < sizeof(buf); k++) buf[k] = (unsigned char)((1000 + k) % 251);
+	for(size_t pos = 1000; pos + sizeof(buf) < length; pos += 5000)
+	{
+		assert(io.Seek(pos, E_SEEK_SET) == (eint64)pos);
+		for(size_t k = 0; k < sizeof(buf); k++) buf[k] = (unsigned char)((pos + k) % 251);
+		assert(io.Write(buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+	}
+	check_content(io, length);
+
+	assert(io.SetSize(300000) == E_OK);
+	check_content(io, 300000);
+	assert(io.Seek(0, E_SEEK_END) == 300000);
+
+	// contiguous whatever the mode
+	const unsigned char *data = (const unsigned char*)io.Buffer();
+	for(size_t k = 0; k < 300000; k++) assert(data[k] == (unsigned char)(k % 251));
+	assert(io.CountSegments() == 1);
+	check_content(io, 300000);
+
+	size_t detachedLength = 0;
+	unsigned char *detached = (unsigned char*)io.Detach(&detachedLength);
+	assert(detached == data && detachedLength == 300000);
+	assert(io.BufferLength() == 0 && io.Position() == 0 && io.CountSegments() == 0);
+	free(detached);
+
+	// reusable after Detach()
+	assert(io.Write("abc", 3) == 3 && io.BufferLength() == 3);
+	assert(memcmp(io.Buffer(), "abc", 3) == 0);
+}
+
+
+static void bench_grow(size_t size)
+{
+	char block[4096];
+	memset(block, 'x', sizeof(block));
+
+	for(eint32 k = 0; k < 2; k++)
+	{
+		EMallocIO io(k == 1);
+
+		e_bigtime_t t = etk_system_time();
+		for(size_t pos = 0; pos < size; pos += sizeof(block)) io.Write(block, sizeof(block));
+		e_bigtime_t tWrite = etk_system_time() - t;
+
+		t = etk_system_time();
+		euint32 sum = 0;
+		for(eint32 i = 0; i < io.CountSegments(); i++)
+		{
+			size_t len = 0;
+			const char *data = (const char*)io.SegmentAt(i, &len);
+			for(size_t pos = 0; pos < len; pos += 4096) sum += (euint8)data[pos];
+		}
+		e_bigtime_t tSegments = etk_system_time() - t;
+
+		t = etk_system_time();
+		size_t length = 0;
+		void *data = io.Detach(&length);
+		e_bigtime_t tDetach = etk_system_time() - t;
+		assert(length == size);
+		free(data);
+
+		ETK_OUTPUT("%s, %I64u bytes in 4 KB writes: Write %I64i MB/s, segments %I64i us (%I32u), Detach %I64i us\n",
+			   k == 1 ? "chunked" : "contiguous", (euint64)size,
+			   (eint64)size / max_c(tWrite, E_INT64_CONSTANT(1)), tSegments, sum, tDetach);
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("mallocio-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	test_mode(false);
+	test_mode(true);
+
+	size_t size = (size_t)(argc > 1 ? atoi(argv[1]) : 100) * 1024 * 1024;
+	bench_grow(size);
+
+	return 0;
+}
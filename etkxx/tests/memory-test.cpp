@@ -0,0 +1,445 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: memory-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <etk/app/Message.h>
+#include <etk/interface/Region.h>
+#include <etk/interface/Polygon.h>
+#include <etk/render/Pixmap.h>
+#include <etk/add-ons/font/FontEngine.h>
+#include <etk/support/String.h>
+#include <etk/kernel/Kernel.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+#include <utility>
+#endif
+
+#ifdef ETK_THREAD_IMPL_POSIX
+#include <pthread.h>
+#endif
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define NUM_FIELDS	8
+#define NUM_MESSAGES	2000
+
+
+static void fill_message(EMessage *msg, eint32 seed)
+{
+	char buf[700];
+
+	for(eint32 k = 0; k < NUM_FIELDS; k++)
+	{
+		// from 0 to 600 bytes, across all the size classes and above
+		eint32 len = (seed * 37 + k * 83) % 601;
+		memset(buf, 'a' + (seed + k) % 26, (size_t)len);
+		buf[len] = 0;
+
+		char name[16];
+		sprintf(name, "field%d", (int)k);
+		assert(msg->AddString(name, buf));
+		assert(msg->AddInt32(name + 5, seed + k));
+	}
+	assert(msg->AddRect("rect", ERect(0, 0, seed, seed)));
+}
+
+
+static bool check_message(const EMessage *msg, eint32 seed)
+{
+	for(eint32 k = 0; k < NUM_FIELDS; k++)
+	{
+		char name[16];
+		sprintf(name, "field%d", (int)k);
+
+		const char *str = NULL;
+		eint32 value = 0;
+		if(msg->FindString(name, &str) == false || msg->FindInt32(name + 5, &value) == false) return false;
+
+		eint32 len = (seed * 37 + k * 83) % 601;
+		if((eint32)strlen(str) != len || value != seed + k) return false;
+		for(eint32 i = 0; i < len; i++) if(str[i] != 'a' + (seed + k) % 26) return false;
+	}
+
+	ERect r;
+	return(msg->FindRect("rect", &r) && r == ERect(0, 0, seed, seed));
+}
+
+
+// the messages are made by the producers and deleted by the main thread
+static EMessage *messages[4][NUM_MESSAGES];
+
+
+static e_status_t producer_thread(void *arg)
+{
+	eint32 index = (eint32)(long)arg;
+
+	for(eint32 i = 0; i < NUM_MESSAGES; i++)
+	{
+		EMessage *msg = new EMessage('TMSG');
+		fill_message(msg, index * NUM_MESSAGES + i);
+
+		// freed here, then on the other thread
+		if(i % 2 == 0) msg->RemoveData("field0");
+		messages[index][i] = msg;
+	}
+
+	return E_OK;
+}
+
+
+static void run_producers(eint32 count)
+{
+	void *threads[4];
+
+	for(eint32 i = 0; i < count; i++)
+	{
+		threads[i] = etk_create_thread(producer_thread, E_NORMAL_PRIORITY, (void*)(long)i, NULL);
+		assert(threads[i] != NULL);
+		etk_resume_thread(threads[i]);
+	}
+
+	for(eint32 i = 0; i < count; i++)
+	{
+		e_status_t retVal;
+		etk_wait_for_thread(threads[i], &retVal);
+		etk_delete_thread(threads[i]);
+	}
+
+	for(eint32 i = 0; i < count; i++)
+	{
+		for(eint32 k = 0; k < NUM_MESSAGES; k++)
+		{
+			EMessage *msg = messages[i][k];
+			assert(msg->HasString("field0") == (k % 2 != 0));
+			if(k % 2 == 0) msg->AddString("field0", "");
+			else assert(check_message(msg, i * NUM_MESSAGES + k));
+			delete msg;
+		}
+	}
+}
+
+
+#ifdef ETK_THREAD_IMPL_POSIX
+static void* plain_thread(void *arg)
+{
+	eint32 index = (eint32)(long)arg;
+
+	for(eint32 i = 0; i < NUM_MESSAGES / 4; i++)
+	{
+		EMessage *msg = new EMessage('TMSG');
+		fill_message(msg, index * NUM_MESSAGES + i);
+		if(!check_message(msg, index * NUM_MESSAGES + i)) return (void*)1;
+
+		// deleted here, or by the main thread after this thread exited
+		if(i % 2 == 0) delete msg;
+		else messages[index][i] = msg;
+	}
+
+	return NULL;
+}
+
+
+// the threads not created by the toolkit give their caches back when they exit as well
+static void run_plain_threads(eint32 count)
+{
+	pthread_t threads[4];
+
+	for(eint32 i = 0; i < count; i++) assert(pthread_create(&threads[i], NULL, plain_thread, (void*)(long)i) == 0);
+	for(eint32 i = 0; i < count; i++)
+	{
+		void *retVal = NULL;
+		assert(pthread_join(threads[i], &retVal) == 0 && retVal == NULL);
+	}
+
+	for(eint32 i = 0; i < count; i++)
+	{
+		for(eint32 k = 1; k < NUM_MESSAGES / 4; k += 2)
+		{
+			assert(check_message(messages[i][k], i * NUM_MESSAGES + k));
+			delete messages[i][k];
+		}
+	}
+}
+#endif
+
+
+static e_status_t bench_thread(void *arg)
+{
+	eint32 loops = (eint32)(long)arg;
+
+	for(eint32 i = 0; i < loops; i++)
+	{
+		EMessage msg('TMSG');
+		for(eint32 k = 0; k < NUM_FIELDS; k++)
+		{
+			msg.AddInt32("int32", k);
+			msg.AddPoint("point", EPoint(k, k));
+			msg.AddString("string", "small string");
+		}
+		msg.MakeEmpty();
+	}
+
+	return E_OK;
+}
+
+
+static void bench_messages(eint32 nThreads)
+{
+	const eint32 loops = 20000;
+	void *threads[8];
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 i = 0; i < nThreads; i++)
+	{
+		threads[i] = etk_create_thread(bench_thread, E_NORMAL_PRIORITY, (void*)(long)loops, NULL);
+		etk_resume_thread(threads[i]);
+	}
+	for(eint32 i = 0; i < nThreads; i++)
+	{
+		e_status_t retVal;
+		etk_wait_for_thread(threads[i], &retVal);
+		etk_delete_thread(threads[i]);
+	}
+	t = etk_system_time() - t;
+
+	ETK_OUTPUT("%I32i thread(s): %I64i messages/s, %I32i fields each\n",
+		   nThreads, (eint64)loops * nThreads * E_INT64_CONSTANT(1000000) / max_c(t, E_INT64_CONSTANT(1)),
+		   NUM_FIELDS * 3);
+}
+
+
+static eint64 live_bytes(e_memory_subsystem subsystem)
+{
+	e_memory_stat stat;
+	assert(etk_memory_accounting_get_stat(subsystem, &stat));
+	return stat.live_bytes;
+}
+
+
+static void test_accounting()
+{
+	eint64 messages = live_bytes(E_MEMORY_MESSAGES);
+	eint64 strings = live_bytes(E_MEMORY_STRINGS);
+	eint64 regions = live_bytes(E_MEMORY_REGIONS);
+	eint64 pixmaps = live_bytes(E_MEMORY_PIXMAPS);
+	eint64 fonts = live_bytes(E_MEMORY_FONTS);
+
+	EMessage *msg = new EMessage('TMSG');
+	fill_message(msg, 3);
+	assert(live_bytes(E_MEMORY_MESSAGES) > messages + 1000);
+
+	// the short strings stay inline
+	EString *str = new EString("short");
+	assert(live_bytes(E_MEMORY_STRINGS) == strings);
+	str->Append('x', 1000);
+	assert(live_bytes(E_MEMORY_STRINGS) >= strings + 1000);
+
+	ERegion *region = new ERegion();
+	for(eint32 i = 0; i < 100; i++) region->Include(ERect(i * 10, 0, i * 10 + 5, 5));
+	assert(live_bytes(E_MEMORY_REGIONS) >= regions + 100 * (eint64)sizeof(ERect));
+
+	EPixmap *pixmap = new EPixmap(ERect(0, 0, 99, 99), E_RGB32);
+	assert(live_bytes(E_MEMORY_PIXMAPS) == pixmaps + 100 * 100 * 4);
+	pixmap->ResizeTo(ERect(0, 0, 9, 9), E_RGB32);
+	assert(live_bytes(E_MEMORY_PIXMAPS) == pixmaps + 10 * 10 * 4);
+
+	// the engine and its names
+	EFontEngine *engine = new EFontEngine("family", "style");
+	assert(live_bytes(E_MEMORY_FONTS) >= fonts + (eint64)sizeof(EFontEngine) + 13);
+	delete engine;
+	assert(live_bytes(E_MEMORY_FONTS) == fonts);
+
+	e_memory_stat stat;
+	assert(etk_memory_accounting_get_stat(E_MEMORY_PIXMAPS, &stat));
+	assert(stat.peak_bytes >= 100 * 100 * 4 && stat.allocations >= 2 && stat.frees >= 1);
+
+	etk_memory_accounting_report();
+
+	delete msg;
+	delete str;
+	delete region;
+	delete pixmap;
+
+	assert(live_bytes(E_MEMORY_MESSAGES) == messages);
+	assert(live_bytes(E_MEMORY_STRINGS) == strings);
+	assert(live_bytes(E_MEMORY_REGIONS) == regions);
+	assert(live_bytes(E_MEMORY_PIXMAPS) == pixmaps);
+}
+
+
+static eint64 allocations(e_memory_subsystem subsystem)
+{
+	e_memory_stat stat;
+	assert(etk_memory_accounting_get_stat(subsystem, &stat));
+	return stat.allocations;
+}
+
+
+static void test_region_and()
+{
+	ERegion region;
+	for(eint32 i = 0; i < 50; i++) region.Include(ERect(i * 10, i * 3, i * 10 + 5, i * 3 + 20));
+
+	ERegion other;
+	for(eint32 i = 0; i < 20; i++) other.Include(ERect(i * 20 + 2, 0, i * 20 + 12, 60));
+
+	ERect r(33, 10, 250, 80);
+	ERegion aRegion(region);
+	aRegion &= r;
+	ERegion bRegion = region & r;
+	assert(bRegion.CountRects() == aRegion.CountRects() && bRegion.Frame() == aRegion.Frame());
+	for(eint32 i = 0; i < aRegion.CountRects(); i++) assert(bRegion.RectAt(i) == aRegion.RectAt(i));
+	assert((region & ERect(1000, 1000, 1010, 1010)).CountRects() == 0);
+
+	aRegion = region;
+	aRegion &= other;
+	bRegion = region & other;
+	assert(bRegion.CountRects() == aRegion.CountRects() && bRegion.Frame() == aRegion.Frame());
+	for(eint32 y = 0; y <= 170; y++)
+		for(eint32 x = 0; x <= 500; x++)
+		{
+			EPoint pt((float)x + 0.5f, (float)y + 0.5f);
+			assert(bRegion.Contains(pt) == (region.Contains(pt) && other.Contains(pt)));
+		}
+}
+
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+static void test_moves()
+{
+	EMessage msg('TMSG');
+	fill_message(&msg, 5);
+
+	ERegion region;
+	for(eint32 i = 0; i < 100; i++) region.Include(ERect(i * 10, 0, i * 10 + 5, 5));
+	ERect frame = region.Frame();
+
+	eint64 nMessages = allocations(E_MEMORY_MESSAGES);
+	eint64 nRegions = allocations(E_MEMORY_REGIONS);
+
+	// nothing allocated while moving
+	EMessage movedMsg(std::move(msg));
+	assert(msg.IsEmpty() && check_message(&movedMsg, 5));
+	msg = std::move(movedMsg);
+	assert(movedMsg.IsEmpty() && check_message(&msg, 5) && msg.what == 'TMSG');
+
+	ERegion movedRegion(std::move(region));
+	assert(region.CountRects() == 0 && region.Frame().IsValid() == false);
+	assert(movedRegion.CountRects() == 100 && movedRegion.Frame() == frame);
+	region = std::move(movedRegion);
+	assert(movedRegion.CountRects() == 0 && region.CountRects() == 100);
+
+	assert(allocations(E_MEMORY_MESSAGES) == nMessages);
+	assert(allocations(E_MEMORY_REGIONS) == nRegions);
+
+	// the moved-from objects are usable again
+	fill_message(&movedMsg, 6);
+	assert(check_message(&movedMsg, 6));
+	movedRegion.Set(frame);
+	assert(movedRegion.CountRects() == 1);
+
+	EPoint pts[3] = {EPoint(0, 0), EPoint(10, 0), EPoint(5, 8)};
+	EPolygon poly(pts, 3);
+	const EPoint *points = poly.Points();
+	EPolygon movedPoly(std::move(poly));
+	assert(movedPoly.Points() == points && movedPoly.CountPoints() == 3 && poly.CountPoints() == 0);
+	assert(movedPoly.Frame() == ERect(0, 0, 10, 8));
+}
+#endif
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("memory-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	bool accounting = etk_memory_accounting_is_enabled();
+	if(accounting) ETK_OUTPUT("with memory accounting:\n");
+
+	EMessage msg('TMSG');
+	for(eint32 i = 0; i < 50; i++)
+	{
+		fill_message(&msg, i);
+		assert(check_message(&msg, i));
+		msg.MakeEmpty();
+	}
+
+	fill_message(&msg, 7);
+	size_t flattenedSize = msg.FlattenedSize();
+	char *buffer = (char*)malloc(flattenedSize);
+	assert(buffer != NULL && msg.Flatten(buffer, flattenedSize));
+	EMessage copy;
+	assert(copy.Unflatten(buffer, flattenedSize) && check_message(&copy, 7));
+	free(buffer);
+
+	// deleted by another thread, the threads exit and their caches are taken by the next ones
+	for(eint32 round = 0; round < 3; round++) run_producers(4);
+#ifdef ETK_THREAD_IMPL_POSIX
+	for(eint32 round = 0; round < 20; round++) run_plain_threads(4);
+#endif
+
+	bench_messages(1);
+	bench_messages(2);
+	bench_messages(4);
+
+	if(accounting)
+	{
+		test_accounting();
+
+		// all the same with the counters
+		eint64 messages = live_bytes(E_MEMORY_MESSAGES);
+		run_producers(4);
+		assert(live_bytes(E_MEMORY_MESSAGES) == messages);
+	}
+
+	test_region_and();
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	test_moves();
+#endif
+
+#ifndef _WIN32
+	// the accounting is decided at start-up, so run once more with it
+	if(!accounting && getenv("ETK_MEMORY_ACCOUNTING") == NULL)
+	{
+		setenv("ETK_MEMORY_ACCOUNTING", "1", 1);
+		fflush(stdout);
+		execv(argv[0], argv);
+	}
+#endif
+
+	return 0;
+}
@@ -27,10 +27,105 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <assert.h>
+
 #include <etkxx.h>
 
+
+class ECountingIO : public EStreamIO {
+public:
+	ECountingIO(int fd = -1)
+		: EStreamIO(), fCalls(0), fLength(0), fFD(fd)
+	{
+	}
+
+	virtual ~ECountingIO()
+	{
+		Flush();
+	}
+
+	eint32 fCalls;
+	size_t fLength;
+	char fData[4096];
+	int fFD;
+
+protected:
+	virtual ssize_t DeviceWrite(const void *buffer, size_t size)
+	{
+		fCalls++;
+		if(fFD >= 0) return write(fFD, buffer, size);
+
+		memcpy(fData + fLength, buffer, min_c(size, sizeof(fData) - fLength));
+		fLength += min_c(size, sizeof(fData) - fLength);
+		return (ssize_t)size;
+	}
+};
+
+
+static void bench_stream(eint32 mode)
+{
+	const eint32 count = 1000000;
+
+	int fd = open("/dev/null", O_WRONLY);
+	assert(fd >= 0);
+
+	ECountingIO stream(fd);
+	stream.SetBuffering(mode, 65536);
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 i = 0; i < count; i++) stream << i << ends;
+	stream.Flush();
+	t = etk_system_time() - t;
+
+	close(fd);
+
+	EOut << (mode == E_STREAM_UNBUFFERED ? "unbuffered" : "fully buffered") << ": "
+	     << (eint64)count * E_INT64_CONSTANT(1000000) / max_c(t, E_INT64_CONSTANT(1)) << " op/s, "
+	     << stream.fCalls << " device writes" << endl;
+}
+
+
 int main(int argc, char **argv)
 {
+	ECountingIO stream;
+	assert(stream.BufferingMode() == E_STREAM_UNBUFFERED && stream.BufferSize() == 0);
+	stream << "a" << (eint32)-12 << ends << (euint64)E_MAXUINT64 << ends << (eint8)-128 << ends << (const void*)0x1f;
+	assert(stream.fCalls == 8 && memcmp(stream.fData, "a-12 18446744073709551615 -128 0x1f", stream.fLength) == 0);
+
+	// line buffered: one write per line
+	stream.fCalls = 0;
+	stream.fLength = 0;
+	assert(stream.SetBuffering(E_STREAM_LINE_BUFFERED, 16) == E_OK && stream.BufferSize() == 16);
+	stream << "x=" << 1 << ends << "y=" << 2 << endl;
+	assert(stream.fCalls == 1 && stream.fLength == 8);
+	stream << "abc";
+	assert(stream.fCalls == 1);
+	stream << "0123456789abcdef0123";
+	assert(stream.fCalls == 3 && stream.fLength == 31 && memcmp(stream.fData + 8, "abc0123456789abcdef0123", 23) == 0);
+
+	// fully buffered: written when full or flushed
+	stream.fCalls = 0;
+	stream.fLength = 0;
+	stream.SetBuffering(E_STREAM_FULLY_BUFFERED, 16);
+	stream << "line1" << endl << "line2" << endl;
+	assert(stream.fCalls == 0);
+	stream << "line3" << endl;
+	assert(stream.fCalls == 1 && stream.fLength == 12);
+	assert(stream.Flush() == E_OK && stream.fCalls == 2 && stream.fLength == 18);
+	assert(memcmp(stream.fData, "line1\nline2\nline3\n", 18) == 0);
+
+	// the pending data goes out when the mode changed
+	stream << "tail";
+	stream.SetBuffering(E_STREAM_UNBUFFERED);
+	assert(stream.fCalls == 3 && stream.fLength == 22 && stream.BufferSize() == 0);
+
+	bench_stream(E_STREAM_UNBUFFERED);
+	bench_stream(E_STREAM_FULLY_BUFFERED);
+
 	EOut << "Number of argument:" << ends << argc << endl;
 	EOut << "Address of \"argv\":" << ends << argv << endl;
 	for(int i = 0; i < argc; i++) EOut << "[" << i << "]:" << ends << argv[i] << endl;
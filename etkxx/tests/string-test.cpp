@@ -29,12 +29,82 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <etk/support/String.h>
 #include <etk/kernel/OS.h>
 #include <etk/kernel/Debug.h>
 
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+#include <utility>
+#endif
+
+
+static bool icase_equal(const char *a, const char *b, eint32 n)
+{
+	for(eint32 i = 0; i < n; i++) if((a[i] | 0x20) != (b[i] | 0x20)) return false;
+	return true;
+}
+
+
+static void bench_replace(eint32 size)
+{
+	EString text;
+	while(text.Length() < size) text << "Lorem ipsum dolor sit amet, &amp; consectetur adipiscing elit. ";
+
+	e_bigtime_t t = etk_system_time();
+	assert(text.FindFirst("not there") < 0 && text.IFindFirst("NOT THERE") < 0);
+	e_bigtime_t tFind = etk_system_time() - t;
+
+	t = etk_system_time();
+	assert(text.FindLast("not there") < 0 && text.IFindLast("NOT THERE") < 0);
+	e_bigtime_t tFindLast = etk_system_time() - t;
+
+	EString aStr(text);
+	t = etk_system_time();
+	aStr.ReplaceAll("&amp;", "&");
+	e_bigtime_t tShrink = etk_system_time() - t;
+
+	t = etk_system_time();
+	aStr.ReplaceAll("&", "&amp;");
+	e_bigtime_t tGrow = etk_system_time() - t;
+	assert(aStr == text);
+
+	ETK_OUTPUT("%I32i bytes: FindFirst + IFindFirst %I64i MB/s, FindLast + IFindLast %I64i MB/s, "
+		   "ReplaceAll shrinking %I64i MB/s, growing %I64i MB/s\n",
+		   text.Length(),
+		   (eint64)text.Length() * 2 / max_c(tFind, E_INT64_CONSTANT(1)),
+		   (eint64)text.Length() * 2 / max_c(tFindLast, E_INT64_CONSTANT(1)),
+		   (eint64)text.Length() / max_c(tShrink, E_INT64_CONSTANT(1)),
+		   (eint64)text.Length() / max_c(tGrow, E_INT64_CONSTANT(1)));
+}
+
+
+static void bench_format(eint32 count)
+{
+	char buf[E_FORMAT_NUMBER_MAX];
+	EString str;
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 i = 0; i < count; i++) {str.MakeEmpty(); str.AppendFormat("%I32i", E_MAXINT32 - i);}
+	e_bigtime_t tFormat = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 i = 0; i < count; i++) {str.MakeEmpty(); str.AppendInt(E_MAXINT32 - i);}
+	e_bigtime_t tInt = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 i = 0; i < count; i++) e_format_double(buf, i * 1.1);
+	e_bigtime_t tDouble = etk_system_time() - t;
+
+	ETK_OUTPUT("%I32i numbers: AppendFormat(\"%%I32i\") %I64i op/s, AppendInt %I64i op/s, e_format_double %I64i op/s\n", count,
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tFormat, E_INT64_CONSTANT(1)),
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tInt, E_INT64_CONSTANT(1)),
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tDouble, E_INT64_CONSTANT(1)));
+}
+
+
 int main()
 {
 	EString source, destination;
@@ -78,6 +148,61 @@ int main()
 
 	ETK_OUTPUT("a = \"a\"\tb = \"b\"\tc = \"c\"\n");
 	ETK_OUTPUT("a << b << c: a = %s\n", a.String());
+
+	EString grow;
+	for(eint32 i = 0; i < 1000; i++) grow << "0123456789";
+	assert(grow.Length() == 10000);
+	grow.Remove(3, 9996);
+	assert(grow == "0129");
+	grow.MakeEmpty();
+	assert(grow.String() == NULL);
+
+	// the short string up to 22 bytes is stored within the object of 24 bytes
+	assert(sizeof(EString) == 24);
+	EString shortStr("0123456789abcdefghijkl");
+	EString longStr(shortStr);
+	longStr << "m";
+	assert(shortStr.String() >= (const char*)&shortStr && shortStr.String() + 23 <= (const char*)(&shortStr + 1));
+	assert(longStr.String() < (const char*)&longStr || longStr.String() >= (const char*)(&longStr + 1));
+	assert(shortStr.Length() == 22 && longStr.Length() == 23 && longStr.Compare(shortStr, 22) == 0);
+	assert(shortStr.MinimumBufferSize() == 0 && shortStr.SetMinimumBufferSize(23) && shortStr.MinimumBufferSize() == 0);
+	EString shrunk(longStr);
+	shrunk.Truncate(3);
+	shrunk << "x";
+	assert(shrunk == "012x" && shrunk.Length() == 4);
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	EString tmpShort(shortStr), tmpLong(longStr);
+	EString movedShort(std::move(tmpShort)), movedLong(std::move(tmpLong));
+	assert(movedShort == shortStr && movedLong == longStr && tmpShort.String() == NULL && tmpLong.String() == NULL);
+	tmpShort = std::move(movedLong);
+	assert(tmpShort == longStr && movedLong.Length() == 0);
+#endif
+	assert(longStr.SetMinimumBufferSize(100) && longStr.MinimumBufferSize() == 100);
+	longStr.MakeEmpty();
+	assert(longStr.MinimumBufferSize() == 100 && longStr.String() != NULL && longStr.String()[0] == 0);
+	longStr << shortStr;
+	assert(longStr == shortStr && longStr.MinimumBufferSize() == 100);
+
+	// adopting keeps the minimum buffer size of the adopter
+	EString adopter, big;
+	assert(adopter.SetMinimumBufferSize(40));
+	for(eint32 i = 0; i < 5; i++) big << "0123456789";
+	adopter.Adopt(big);
+	assert(adopter.Length() == 50 && adopter.MinimumBufferSize() == 40 && big.Length() == 0);
+
+	// the character index goes with the buffer on the heap
+	EString utf8Str;
+	for(eint32 i = 0; i < 100; i++) utf8Str << "\xe4\xb8\xad";
+	assert(utf8Str.CountChars() == 100 && utf8Str.CharAt(80) == utf8Str.String() + 240);
+	utf8Str.Truncate(15);
+	assert(utf8Str.CountChars() == 5 && utf8Str.CharAt(4) == utf8Str.String() + 12);
+	EString part(utf8Str);
+	for(eint32 i = 0; i < 31; i++) utf8Str << part;
+	assert(utf8Str.CountChars() == 160 && utf8Str.CharAt(159) == utf8Str.String() + 477);
+
+	EString adopted;
+	adopted.Adopt(a);
+	assert(adopted == "abc" && a.Length() == 0);
 	ETK_OUTPUT("a << b << c: b = %s\n", b.String());
 	ETK_OUTPUT("a << b << c: c = %s\n", c.String());
 
@@ -85,6 +210,37 @@ int main()
 	assert(astring.FindLast("Abc", 7) == 3);
 	ETK_OUTPUT("astring(\"AbcAbcAbc\").FindLast(\"Abc\", 7) = %ld\n", astring.FindLast("Abc", 7));
 
+	astring.SetTo("aXbxAxBX");
+	assert(astring.FindFirst("xB") == 5 && astring.IFindFirst("xB") == 1 && astring.IFindFirst('X', 2) == 3);
+	assert(astring.FindLast('x') == 5 && astring.IFindLast('x') == 7 && astring.IFindLast("aX", 4) == 0);
+
+	// searching backward across the blocks, against the plain loop
+	for(eint32 len = 0; len < 70; len++)
+	{
+		EString hay;
+		for(eint32 i = 0; i < len; i++) hay << (char)("abAB"[(i * 7 + len) % 4]);
+
+		const char *needles[] = {"a", "B", "ab", "bA", "aBa", "abAB"};
+		for(eint32 k = 0; k < 6; k++)
+		{
+			eint32 nLen = (eint32)strlen(needles[k]);
+			eint32 found = -1, ifound = -1;
+			for(eint32 i = len - nLen; i >= 0 && (found < 0 || ifound < 0); i--)
+			{
+				if(found < 0 && strncmp(hay.String() + i, needles[k], (size_t)nLen) == 0) found = i;
+				if(ifound < 0 && icase_equal(hay.String() + i, needles[k], nLen)) ifound = i;
+			}
+
+			assert(hay.FindLast(needles[k]) == found && hay.IFindLast(needles[k]) == ifound);
+			if(nLen == 1) assert(hay.FindLast(needles[k][0]) == found && hay.IFindLast(needles[k][0]) == ifound);
+		}
+	}
+	assert(astring.IReplaceAll("x", "--") == "a--b--A--B--");
+	assert(astring.Replace("--", "+", 2, 3) == "a--b+A+B--");
+	assert(astring.RemoveAll("--").RemoveAll("+") == "abAB");
+	assert(astring.IReplaceSet("ab", "[]") == "[][][][]");
+	assert(astring.ReplaceSet("[", '(').RemoveSet("]") == "((((");
+
 	astring.SetTo("I am a man. You are a girl!");
 	assert(astring.Capitalize() == "I am a man. you are a girl!");
 	ETK_OUTPUT("Capitalize(\"I am a man. You are a girl!\") = %s\n", astring.String());
@@ -182,5 +338,38 @@ int main()
 	if(unicode) free(unicode);
 	if(utf8) free(utf8);
 
+	// number formatting
+	char buf[E_FORMAT_NUMBER_MAX];
+	assert(e_format_int64(buf, 0) == 1 && strcmp(buf, "0") == 0);
+	assert(e_format_int64(buf, E_MININT64) == 20 && strcmp(buf, "-9223372036854775808") == 0);
+	assert(e_format_uint64(buf, E_MAXUINT64, 10, false) == 20 && strcmp(buf, "18446744073709551615") == 0);
+	assert(e_format_uint64(buf, 0xbeef, 16, true) == 4 && strcmp(buf, "BEEF") == 0);
+	assert(e_format_uint64(buf, 8, 8, false) == 2 && strcmp(buf, "10") == 0);
+	assert(e_format_double(buf, 0.1) == 3 && strcmp(buf, "0.1") == 0);
+	assert(e_format_double(buf, 1.0 / 3) == 18 && strtod(buf, NULL) == 1.0 / 3);
+	assert(e_format_double(buf, -1e300) == 7 && strcmp(buf, "-1e+300") == 0);
+	assert(e_format_double(buf, 123456789.0) == 9 && strcmp(buf, "123456789") == 0);
+	assert(e_format_float(buf, 0.1f) == 3 && strcmp(buf, "0.1") == 0);
+	assert(e_format_float(buf, 16777216.f) == 8 && strcmp(buf, "16777216") == 0);
+	for(eint32 i = 0; i < 10000; i++)
+	{
+		double value = (double)rand() / (double)(rand() + 1) * (i % 2 ? 1e-10 : 1e10);
+		e_format_double(buf, value);
+		assert(strtod(buf, NULL) == value);
+	}
+
+	EString nStr;
+	nStr.AppendInt(-42).Append(",").AppendUInt(255, 16).Append(",").AppendDouble(2.5);
+	assert(nStr == "-42,ff,2.5");
+	nStr.MakeEmpty();
+	nStr << (eint8)-128 << " " << (euint16)65535 << " " << (eint64)-1;
+	assert(nStr == "-128 65535 -1");
+	nStr.MakeEmpty();
+	nStr.AppendFormat("%I32i|%05I32i|%x|%X|%o|%p", (eint32)-7, (eint32)42, 255, 255, 8, (void*)0x10);
+	assert(nStr == "-7|00042|ff|FF|10|0x10");
+
+	bench_replace(1024 * 1024);
+	bench_format(1000000);
+
 	return 0;
 }
@@ -0,0 +1,239 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: stringarray-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <etk/support/StringArray.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Kernel.h>
+#include <etk/kernel/Debug.h>
+
+
+static eint32 find_linear(const EStringArray &array, const char *string, eint32 startIndex, bool invert, bool ignoreCase)
+{
+	for(eint32 i = startIndex; i >= 0 && i < array.CountItems(); i += (invert ? -1 : 1))
+	{
+		const EString *str = array.ItemAt(i);
+		if(string == NULL || *string == 0)
+		{
+			if(str->Length() == 0) return i;
+		}
+		else if((ignoreCase ? str->ICompare(string) : str->Compare(string)) == 0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+static void check_find(const EStringArray &array, const char *string)
+{
+	for(eint32 i = 0; i < array.CountItems(); i += 3)
+	{
+		assert(array.FindString(string, i) == find_linear(array, string, i, false, false));
+		assert(array.FindString(string, i, true, true) == find_linear(array, string, i, true, false));
+		assert(array.IFindString(string, i) == find_linear(array, string, i, false, true));
+		assert(array.IFindString(string, i, true, true) == find_linear(array, string, i, true, true));
+	}
+}
+
+
+static int compare_length(const EString **a, const EString **b)
+{
+	return (*a)->Length() - (*b)->Length();
+}
+
+
+struct find_job {
+	const EStringArray *array;
+	bool passed;
+};
+
+
+// the const array is searched by several threads at once, each one builds the index maybe
+static e_status_t find_thread(void *arg)
+{
+	struct find_job *job = (struct find_job*)arg;
+	const EStringArray *array = job->array;
+	EString str;
+
+	job->passed = true;
+	for(eint32 i = 0; job->passed && i < array->CountItems(); i += 7)
+	{
+		str.SetTo("ITEM-");
+		str << i;
+		job->passed = (array->IFindString(str) == i && array->FindString(str) < 0 &&
+			       array->FindString(array->ItemAt(i)->String()) == i);
+	}
+
+	return E_OK;
+}
+
+
+static void test_find_threads()
+{
+	for(eint32 round = 0; round < 10; round++)
+	{
+		EStringArray array;
+		EString str;
+
+		for(eint32 i = 0; i < 5000; i++)
+		{
+			str.SetTo("item-");
+			str << i;
+			array.AddItem(str);
+		}
+
+		struct find_job jobs[4];
+		void *threads[4];
+
+		for(eint32 i = 0; i < 4; i++)
+		{
+			jobs[i].array = &array;
+			jobs[i].passed = false;
+			threads[i] = etk_create_thread(find_thread, E_NORMAL_PRIORITY, (void*)&jobs[i], NULL);
+			assert(threads[i] != NULL);
+		}
+		for(eint32 i = 0; i < 4; i++) etk_resume_thread(threads[i]);
+		for(eint32 i = 0; i < 4; i++)
+		{
+			e_status_t retVal;
+			etk_wait_for_thread(threads[i], &retVal);
+			etk_delete_thread(threads[i]);
+			assert(jobs[i].passed);
+		}
+	}
+}
+
+
+static void bench_find(eint32 count)
+{
+	EStringArray array;
+	EString str;
+
+	for(eint32 i = 0; i < count; i++)
+	{
+		str.SetTo("item-");
+		str << i;
+		array.AddItem(str);
+	}
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 i = 0; i < count; i++)
+	{
+		str.SetTo("item-");
+		str << i;
+		assert(array.FindString(str) == i);
+	}
+	e_bigtime_t tFind = etk_system_time() - t;
+
+	t = etk_system_time();
+	array.SortItems(compare_length);
+	e_bigtime_t tSort = etk_system_time() - t;
+
+	ETK_OUTPUT("%I32i items: FindString %I64i op/s, SortItems %I64i us\n", count,
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tFind, E_INT64_CONSTANT(1)), tSort);
+}
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("stringarray-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	const char *words[] = {"red", "Green", "blue", "", "RED", "green", "Blue", "red", "cyan", "magenta", NULL};
+
+	EStringArray array(words);
+	assert(array.CountItems() == 10);
+	assert(array.FindString("red") == 0 && array.FindString("red", 1) == 7);
+	assert(array.FindString("red", 9, true, true) == 7 && array.FindString("red", 6, true, true) == 0);
+	assert(array.IFindString("RED", 1) == 4 && array.IFindString("gReEn") == 1);
+	assert(array.FindString("") == 3 && array.FindString((const char*)NULL, 9, true, true) == 3);
+	assert(array.FindString("yellow") < 0 && array.IFindString("YELLOW") < 0);
+	assert(array.FindString("ee", 0, false) == 1 && array.IFindString("BLU", 3, false) == 6);
+	check_find(array, "red");
+	check_find(array, "blue");
+
+	// the index follows the changes
+	array.AddItem("yellow");
+	assert(array.FindString("yellow") == 10 && array.IFindString("Yellow") == 10);
+	array.AddItem("yellow", 0);
+	assert(array.FindString("yellow") == 0 && array.FindString("red") == 1);
+	array.RemoveItem(0);
+	array.ReplaceItem(0, "black");
+	assert(array.FindString("red") == 7 && array.FindString("black") == 0);
+	array.SwapItems(0, 7);
+	assert(array.FindString("red") == 0 && array.FindString("black") == 7);
+	array.MoveItem(0, 10);
+	assert(array.FindString("red") == 10 && array.IFindString("red") == 3);
+	array.RemoveItems(0, 5);
+	assert(array.IFindString("red") == 5 && array.FindString("RED") < 0);
+	array += words;
+	check_find(array, "red");
+	check_find(array, "Green");
+	check_find(array, "");
+
+	EStringArray copy(array);
+	assert(copy.CountItems() == array.CountItems());
+	check_find(copy, "blue");
+	copy.MakeEmpty();
+	assert(copy.FindString("red") < 0);
+
+	// stable sorting
+	array.MakeEmpty();
+	for(eint32 i = 0; i < 100; i++)
+	{
+		EString str;
+		str << (i % 7) << "-" << i;
+		array.AddItem(str.String(), (void*)(long)i);
+	}
+	assert(array.FindString("3-3") == 3);
+	array.SortItems(compare_length);
+	assert(array.FindString("3-3") == 3 && array.FindString("3-10") == 10);
+	for(eint32 i = 1; i < array.CountItems(); i++)
+	{
+		void *a = NULL, *b = NULL;
+		const EString *strA = array.ItemAt(i - 1, &a);
+		const EString *strB = array.ItemAt(i, &b);
+		assert(strA->Length() < strB->Length() || (strA->Length() == strB->Length() && (long)a < (long)b));
+	}
+	check_find(array, "6-97");
+
+	test_find_threads();
+
+	eint32 maxCount = (argc > 1 ? atoi(argv[1]) : 1000000);
+	for(eint32 count = 1000; count <= maxCount && count > 0; count *= 10) bench_find(count);
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: textbuffer-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <etk/support/String.h>
+#include <etk/support/TextBuffer.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Debug.h>
+
+
+static void check_buffer(const ETextBuffer &buffer, const EString &str)
+{
+	assert(buffer.Length() == str.Length());
+	assert(buffer.Length() == 0 ? buffer.String() == NULL : strcmp(buffer.String(), str.String()) == 0);
+
+	// walk chunk by chunk
+	const char *chunk;
+	eint32 offset = 0, length = 0;
+	while((chunk = buffer.ChunkAt(offset, &length)) != NULL)
+	{
+		assert(length > 0 && memcmp(chunk, str.String() + offset, (size_t)length) == 0);
+		offset += length;
+	}
+	assert(offset == str.Length());
+
+	eint32 line = 0;
+	for(eint32 i = 0; i <= str.Length(); i++)
+	{
+		if(i == 0 || str[i - 1] == '\n')
+		{
+			assert(buffer.OffsetAt(line) == i);
+			line++;
+		}
+		if(i % 7 == 0 || i == str.Length()) assert(buffer.LineAt(i) == line - 1);
+	}
+	assert(buffer.CountLines() == line);
+	assert(buffer.OffsetAt(line) == -1);
+
+	// characters
+	eint32 nChars = str.CountChars();
+	assert(buffer.CountChars() == nChars);
+	for(eint32 i = 0; i < nChars; i += (nChars > 1000 ? 97 : 1))
+	{
+		euint8 len = 0, bufLen = 0;
+		const char *ch = str.CharAt(i, &len);
+		eint32 charOffset = (eint32)(ch - str.String());
+
+		assert(buffer.CharOffsetAt(i) == charOffset);
+		assert(buffer.CharIndexAt(charOffset) == i);
+
+		const char *bufCh = buffer.CharAt(i, &bufLen);
+		assert(bufCh != NULL && bufLen == len && memcmp(bufCh, ch, (size_t)len) == 0);
+	}
+	assert(buffer.CharOffsetAt(nChars) == str.Length() && buffer.CharOffsetAt(nChars + 1) == -1);
+	assert(buffer.CharIndexAt(str.Length()) == nChars && buffer.CharAt(nChars) == NULL);
+
+	const char *range = buffer.StringAt(str.Length() / 3, str.Length() / 3);
+	assert(range != NULL && strlen(range) == (size_t)(str.Length() / 3) &&
+	       memcmp(range, str.String() + str.Length() / 3, (size_t)(str.Length() / 3)) == 0);
+}
+
+
+static void bench_insert(eint32 size, eint32 count)
+{
+	char *text = (char*)malloc((size_t)size + 1);
+	for(eint32 i = 0; i < size; i++) text[i] = (i % 64 == 63 ? '\n' : 'a' + i % 26);
+	text[size] = 0;
+
+	EString str(text);
+	ETextBuffer buffer;
+	buffer.SetTo(text, size);
+	free(text);
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 i = 0; i < count; i++) str.Insert("x", 1, size / 2 + i);
+	e_bigtime_t tString = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 i = 0; i < count; i++) buffer.Insert(size / 2 + i, "x", 1);
+	for(eint32 i = 0; i < count; i++) buffer.LineAt(size / 2 + i);
+	e_bigtime_t tBuffer = etk_system_time() - t;
+
+	assert(buffer.Length() == str.Length());
+	assert(buffer.LineAt(size / 2) == (size / 2) / 64);
+
+	ETK_OUTPUT("%I32i bytes: typing in the middle, EString %I64i op/s, ETextBuffer %I64i op/s\n", size,
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tString, E_INT64_CONSTANT(1)),
+		   (eint64)count * E_INT64_CONSTANT(1000000) / max_c(tBuffer, E_INT64_CONSTANT(1)));
+}
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("textbuffer-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	ETextBuffer buffer;
+	EString str;
+
+	check_buffer(buffer, str);
+	assert(buffer.LineAt(0) == 0 && buffer.ByteAt(0) == 0);
+
+	assert(buffer.SetTo("first line\nsecond line\n"));
+	str = "first line\nsecond line\n";
+	check_buffer(buffer, str);
+
+	assert(buffer.Insert(6, "\nmiddle", -1));
+	str.Insert("\nmiddle", 6);
+	check_buffer(buffer, str);
+
+	assert(buffer.Remove(0, 4));
+	str.Remove(0, 4);
+	check_buffer(buffer, str);
+	assert(buffer.ByteAt(0) == 't');
+
+	assert(buffer.Insert(buffer.Length() + 1, "x", 1) == false);
+
+	// random editing against EString
+	srand(1);
+	for(eint32 k = 0; k < 5000; k++)
+	{
+		eint32 offset = (str.Length() > 0 ? rand() % (str.Length() + 1) : 0);
+
+		if(rand() % 3 == 0 && str.Length() > 0)
+		{
+			eint32 length = rand() % 16 + 1;
+			assert(buffer.Remove(offset, length));
+			str.Remove(offset, length);
+		}
+		else
+		{
+			char text[32];
+			eint32 length = rand() % 20 + 1;
+			for(eint32 i = 0; i < length; i++) text[i] = (rand() % 5 == 0 ? '\n' : 'a' + rand() % 26);
+			assert(buffer.Insert(offset, text, length));
+			str.Insert(text, length, offset);
+		}
+
+		if(k % 100 == 0) check_buffer(buffer, str);
+	}
+	check_buffer(buffer, str);
+
+	char copy[16];
+	assert(buffer.CopyInto(copy, 3, 10) == 10 && memcmp(copy, str.String() + 3, 10) == 0);
+
+	// large text is divided into pieces
+	EString large;
+	for(eint32 i = 0; i < 20000; i++) large << "line " << i << "\n";
+	buffer.SetTo(large.String(), large.Length());
+	check_buffer(buffer, large);
+	buffer.Remove(100, large.Length() - 200);
+	large.Remove(100, large.Length() - 200);
+	check_buffer(buffer, large);
+
+	// random editing of UTF-8 text at the boundaries of characters
+	static const char *utf8Texts[] = {"a", "\xc3\xa9", "\xe4\xb8\xad\xe6\x96\x87", "\xf0\x9f\x98\x80\n", "z\n\xce\xb1"};
+	buffer.MakeEmpty();
+	str.MakeEmpty();
+	for(eint32 k = 0; k < 3000; k++)
+	{
+		eint32 index = rand() % (str.CountChars() + 1);
+		eint32 offset = buffer.CharOffsetAt(index);
+
+		if(rand() % 3 == 0 && index < str.CountChars())
+		{
+			eint32 endIndex = index + rand() % 4 + 1;
+			eint32 length = buffer.CharOffsetAt(min_c(endIndex, str.CountChars())) - offset;
+			assert(buffer.Remove(offset, length));
+			str.Remove(offset, length);
+		}
+		else
+		{
+			const char *text = utf8Texts[rand() % 5];
+			assert(buffer.Insert(offset, text, -1));
+			str.Insert(text, offset);
+		}
+
+		if(k % 100 == 0) check_buffer(buffer, str);
+	}
+	check_buffer(buffer, str);
+
+	// the large text is never divided within a character
+	large.MakeEmpty();
+	for(eint32 i = 0; i < 50000; i++) large << "\xe4\xb8\xad";
+	buffer.SetTo(large.String(), large.Length());
+	check_buffer(buffer, large);
+	buffer.Remove(3, large.Length() - 6);
+	large.Remove(3, large.Length() - 6);
+	check_buffer(buffer, large);
+
+	buffer.MakeEmpty();
+	assert(buffer.Length() == 0 && buffer.String() == NULL && buffer.CountLines() == 1);
+	assert(buffer.CountChars() == 0 && buffer.CharOffsetAt(0) == 0);
+
+	eint32 maxSize = (argc > 1 ? atoi(argv[1]) : 10000000);
+	for(eint32 size = 100000; size <= maxSize && size > 0; size *= 10) bench_insert(size, 1000);
+
+	return 0;
+}
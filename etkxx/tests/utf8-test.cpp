@@ -0,0 +1,329 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: utf8-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <etk/support/String.h>
+#include <etk/kernel/OS.h>
+#include <etk/kernel/Kernel.h>
+#include <etk/kernel/Debug.h>
+
+
+static char* make_text(eint32 size, bool cjk)
+{
+	char *text = (char*)malloc((size_t)size + 4);
+	eint32 i = 0;
+
+	while(i < size)
+	{
+		if(cjk && rand() % 10 < 8)
+		{
+			// U+4E00 ~ U+5FFF
+			text[i++] = (char)(0xe4 + rand() % 2);
+			text[i++] = (char)(0x80 + rand() % 64);
+			text[i++] = (char)(0x80 + rand() % 64);
+		}
+		else
+		{
+			text[i++] = (rand() % 8 == 0 ? ' ' : 'a' + rand() % 26);
+		}
+	}
+	text[i] = 0;
+
+	return text;
+}
+
+
+static void bench_utf8(bool cjk)
+{
+	const eint32 size = 1024 * 1024;
+	const eint32 loops = 20;
+
+	char *text = make_text(size, cjk);
+	eint32 nChars = e_utf8_strlen(text);
+	eunichar32 *utf32 = (eunichar32*)malloc(sizeof(eunichar32) * (size_t)size);
+
+	e_bigtime_t t = etk_system_time();
+	for(eint32 k = 0; k < loops; k++) assert(e_utf8_strlen(text) == nChars);
+	e_bigtime_t tCount = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 k = 0; k < loops; k++) assert(e_utf8_is_valid(text, -1));
+	e_bigtime_t tValid = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 k = 0; k < loops; k++) assert(e_utf8_at(text, nChars - 1, NULL) != NULL);
+	e_bigtime_t tAt = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 k = 0; k < loops; k++)
+	{
+		eint32 nBytes = -1;
+		assert(e_utf8_convert_to_utf32_etc(text, &nBytes, utf32, size) == nChars);
+	}
+	e_bigtime_t tConvert = etk_system_time() - t;
+
+	ETK_OUTPUT("%s: strlen %I64i MB/s, validate %I64i MB/s, at %I64i MB/s, to UTF-32 %I64i MB/s\n",
+		   cjk ? "CJK-heavy" : "ASCII-heavy",
+		   (eint64)size * loops / max_c(tCount, E_INT64_CONSTANT(1)),
+		   (eint64)size * loops / max_c(tValid, E_INT64_CONSTANT(1)),
+		   (eint64)size * loops / max_c(tAt, E_INT64_CONSTANT(1)),
+		   (eint64)size * loops / max_c(tConvert, E_INT64_CONSTANT(1)));
+
+	free(utf32);
+	free(text);
+}
+
+
+static void bench_char_at(bool cjk)
+{
+	const eint32 size = 64 * 1024;
+
+	char *text = make_text(size, cjk);
+	EString str(text);
+	eint32 nChars = str.CountChars();
+
+	// scanning from the beginning for every character
+	e_bigtime_t t = etk_system_time();
+	for(eint32 i = 0; i < nChars; i++) assert(e_utf8_at(text, i, NULL) != NULL);
+	e_bigtime_t tScan = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 i = 0; i < nChars; i++) assert(str.CharAt(i, NULL) != NULL);
+	e_bigtime_t tSequential = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(eint32 i = 0; i < nChars; i++) assert(str.CharAt((eint32)(((euint32)i * 2654435761U) % (euint32)nChars), NULL) != NULL);
+	e_bigtime_t tRandom = etk_system_time() - t;
+
+	t = etk_system_time();
+	for(EUtf8Iterator iter(str); iter.Char() != NULL; iter.Next());
+	e_bigtime_t tIterator = etk_system_time() - t;
+
+	ETK_OUTPUT("%s, %I32i characters: e_utf8_at %I64i char/s, CharAt sequential %I64i char/s, "
+		   "CharAt random %I64i char/s, EUtf8Iterator %I64i char/s\n",
+		   cjk ? "CJK-heavy" : "ASCII-heavy", nChars,
+		   (eint64)nChars * E_INT64_CONSTANT(1000000) / max_c(tScan, E_INT64_CONSTANT(1)),
+		   (eint64)nChars * E_INT64_CONSTANT(1000000) / max_c(tSequential, E_INT64_CONSTANT(1)),
+		   (eint64)nChars * E_INT64_CONSTANT(1000000) / max_c(tRandom, E_INT64_CONSTANT(1)),
+		   (eint64)nChars * E_INT64_CONSTANT(1000000) / max_c(tIterator, E_INT64_CONSTANT(1)));
+
+	free(text);
+}
+
+
+struct char_at_job {
+	const EString *str;
+	bool passed;
+};
+
+
+// the const string is read by several threads at once, each one builds the index maybe
+static e_status_t char_at_thread(void *arg)
+{
+	struct char_at_job *job = (struct char_at_job*)arg;
+	const EString *str = job->str;
+	eint32 nChars = e_utf8_strlen(str->String());
+
+	job->passed = (str->CountChars() == nChars);
+	for(eint32 i = 0; job->passed && i < nChars; i += 5)
+		job->passed = (str->CharAt(i, NULL) == e_utf8_at(str->String(), i, NULL));
+
+	return E_OK;
+}
+
+
+static void test_char_at_threads()
+{
+	srand(2);
+	char *text = make_text(20000, true);
+
+	for(eint32 round = 0; round < 10; round++)
+	{
+		EString str(text);
+		struct char_at_job jobs[4];
+		void *threads[4];
+
+		for(eint32 i = 0; i < 4; i++)
+		{
+			jobs[i].str = &str;
+			jobs[i].passed = false;
+			threads[i] = etk_create_thread(char_at_thread, E_NORMAL_PRIORITY, (void*)&jobs[i], NULL);
+			assert(threads[i] != NULL);
+		}
+		for(eint32 i = 0; i < 4; i++) etk_resume_thread(threads[i]);
+		for(eint32 i = 0; i < 4; i++)
+		{
+			e_status_t retVal;
+			etk_wait_for_thread(threads[i], &retVal);
+			etk_delete_thread(threads[i]);
+			assert(jobs[i].passed);
+		}
+	}
+
+	free(text);
+}
+
+
+int main()
+{
+	ETK_OUTPUT("utf8-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	// "a", U+00E9, U+4E2D, U+1F600
+	const char *str = "a\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80";
+	assert(e_utf8_strlen(str) == 4);
+	assert(e_utf8_is_valid(str, -1));
+	assert(e_utf8_at(str, 2, NULL) == str + 3);
+
+	eunichar32 utf32[8];
+	eint32 nBytes = -1;
+	assert(e_utf8_convert_to_utf32_etc(str, &nBytes, utf32, 8) == 4 && nBytes == 10);
+	assert(utf32[0] == 0x61 && utf32[1] == 0xe9 && utf32[2] == 0x4e2d && utf32[3] == 0x1f600);
+
+	// stop before the character cut by "length", or when "dest" is full
+	nBytes = 5;
+	assert(e_utf8_convert_to_utf32_etc(str, &nBytes, utf32, 8) == 2 && nBytes == 3);
+	nBytes = -1;
+	assert(e_utf8_convert_to_utf32_etc(str, &nBytes, utf32, 3) == 3 && nBytes == 6);
+
+	eunichar *unicode = e_utf8_convert_to_unicode(str, -1);
+	assert(unicode[3] == 0xd83d && unicode[4] == 0xde00 && unicode[5] == 0);
+	free(unicode);
+
+	// the invalid bytes are skipped
+	const char *bad = "ab\x80\xe4\xb8z0123456789abcdefghij\xff\xe4\xb8\xad";
+	assert(e_utf8_is_valid(bad, -1) == false);
+	assert(e_utf8_is_valid(bad, 2));
+	assert(e_utf8_strlen(bad) == 24);
+
+	// RFC 3629: overlong, surrogate, beyond U+10FFFF and F5~FF, alone or within the blocks
+	const char *illFormed[] = {"\xc0\xaf", "\xc1\xbf", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xed\xbf\xbf",
+				   "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xf7\xbf\xbf\xbf",
+				   "\xf8\x88\x80\x80\x80", "\xfe", "\xff"};
+	const char *wellFormed[] = {"\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80", "\xed\x9f\xbf", "\xee\x80\x80",
+				    "\xef\xbf\xbf", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf"};
+	for(eint32 pre = 0; pre < 20; pre++)
+	{
+		char buf[64];
+		memset(buf, 'a', (size_t)pre);
+
+		for(size_t i = 0; i < sizeof(illFormed) / sizeof(illFormed[0]); i++)
+		{
+			strcpy(buf + pre, illFormed[i]);
+			strcat(buf, "0123456789abcdefghij");
+			assert(e_utf8_is_valid(buf, -1) == false);
+			assert(e_utf8_strlen(buf) == pre + e_utf8_strlen(illFormed[i]) + 20);
+		}
+
+		for(size_t i = 0; i < sizeof(wellFormed) / sizeof(wellFormed[0]); i++)
+		{
+			strcpy(buf + pre, wellFormed[i]);
+			strcat(buf, "0123456789abcdefghij");
+			assert(e_utf8_is_valid(buf, -1));
+			assert(e_utf8_strlen(buf) == pre + 21);
+		}
+	}
+
+	// long text goes through the block routines
+	srand(1);
+	for(eint32 k = 0; k < 2; k++)
+	{
+		char *text = make_text(10000, k == 1);
+		eint32 nChars = 0;
+		for(const unsigned char *p = (const unsigned char*)text; *p; p++) if((*p & 0xc0) != 0x80) nChars++;
+		assert(e_utf8_strlen(text) == nChars);
+		assert(e_utf8_is_valid(text, -1));
+		const char *last = e_utf8_at(text, nChars - 1, NULL);
+		assert(last != NULL && e_utf8_strlen(last) == 1);
+		free(text);
+	}
+
+	// EString remembers where the characters are, it must give what e_utf8_at() gives
+	for(eint32 k = 0; k < 2; k++)
+	{
+		char *text = make_text(5000, k == 1);
+		EString aStr(text);
+		aStr.Append(bad);
+
+		eint32 nChars = e_utf8_strlen(aStr.String());
+		assert(aStr.CountChars() == nChars);
+
+		for(eint32 i = 0; i <= nChars; i += 7)
+		{
+			euint8 len1 = 0, len2 = 0;
+			assert(aStr.CharAt(i, &len1) == e_utf8_at(aStr.String(), i, &len2) && len1 == len2);
+		}
+		for(eint32 i = nChars; i >= 0; i -= 13) assert(aStr.CharAt(i, NULL) == e_utf8_at(aStr.String(), i, NULL));
+		assert(aStr.CharAt(nChars, NULL) == NULL);
+
+		// forgotten once changed
+		aStr.ReplaceAll('a', 'b');
+		aStr.Remove(1, 1);
+		aStr.Prepend("\xe4\xb8\xad");
+		assert(aStr.CountChars() == e_utf8_strlen(aStr.String()));
+		assert(aStr.CharAt(100, NULL) == e_utf8_at(aStr.String(), 100, NULL));
+
+		// walk forward and backward
+		EUtf8Iterator iter(aStr);
+		eint32 index = 0;
+		for(; iter.Char() != NULL; iter.Next(), index++)
+		{
+			euint8 len1 = 0, len2 = 0;
+			assert(iter.Char(&len1) == e_utf8_at(aStr.String(), index, &len2) && len1 == len2);
+			assert(iter.Index() == index && iter.Offset() == iter.Char() - aStr.String());
+		}
+		assert(index == aStr.CountChars() && iter.Offset() == aStr.Length());
+		assert(iter.Next() == false);
+
+		iter.SeekToEnd();
+		assert(iter.Index() == index);
+		while(iter.Prev()) assert(iter.Char() == aStr.CharAt(--index, NULL));
+		assert(index == 0 && iter.Offset() == 0);
+
+		free(text);
+	}
+
+	test_char_at_threads();
+
+	EUtf8Iterator iter(bad);
+	assert(iter.Next() && iter.Next() && iter.Char() == bad + 5);
+	assert(iter.Prev() && iter.Char() == bad + 1);
+
+	bench_utf8(false);
+	bench_utf8(true);
+
+	bench_char_at(false);
+	bench_char_at(true);
+
+	return 0;
+}
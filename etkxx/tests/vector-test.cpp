@@ -0,0 +1,97 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: vector-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <etk/support/Vector.h>
+#include <etk/support/String.h>
+#include <etk/interface/Region.h>
+#include <etk/kernel/Debug.h>
+
+
+int main(int argc, char **argv)
+{
+	ETK_OUTPUT("vector-test in ETK(%u.%u.%u)...\n",
+		etk_major_version, etk_minor_version, etk_micro_version);
+
+	EVector<eint32, 4> v;
+	for(eint32 i = 0; i < 4; i++) v.AddItem(i);
+	assert(v.Capacity() == 4);
+	for(eint32 i = 4; i < 100; i++) v.AddItem(i);
+	assert(v.CountItems() == 100 && v.Capacity() >= 100);
+	for(eint32 i = 0; i < 100; i++) assert(v[i] == i);
+
+	v.AddItem(1000, 10);
+	assert(v[10] == 1000 && v[11] == 10 && v.CountItems() == 101);
+	v.RemoveItem(10);
+	v.RemoveItems(50, -1);
+	assert(v.CountItems() == 50 && *v.LastItem() == 49 && v.ItemAt(50) == NULL);
+
+	v.AddItem(v[0]);
+	assert(v[50] == 0);
+
+	EVector<eint32, 4> small;
+	small.AddItem(7);
+	small.SwapWith(v);
+	assert(small.CountItems() == 51 && v.CountItems() == 1 && v[0] == 7);
+
+	EVector<eint32, 4> copy(small);
+	assert(copy.CountItems() == 51 && copy[49] == 49);
+
+	// the items with constructors/destructors
+	EVector<EString, 2> strs;
+	for(eint32 i = 0; i < 20; i++) strs.AddItem(EString() << i);
+	strs.AddItem(EString("first"), 0);
+	assert(strs[0] == "first" && strs[20] == "19");
+	strs.RemoveItems(0, 10);
+	assert(strs[0] == "9" && strs.CountItems() == 11);
+
+	EVector<EString, 2> strs2;
+	strs2 = strs;
+	strs.MakeEmpty();
+	assert(strs.IsEmpty() && strs2.CountItems() == 11 && strs2[10] == "19");
+
+#ifdef ETK_SUPPORT_RVALUE_REFERENCES
+	EVector<EString, 2> moved(std::move(strs2));
+	assert(strs2.IsEmpty() && moved.CountItems() == 11);
+#endif
+
+	// ERegion holds its rectangles in EVector
+	ERegion region(ERect(0, 0, 99, 99));
+	region.Exclude(ERect(10, 10, 20, 20));
+	assert(region.Contains(5, 5) && !region.Contains(15, 15) && region.CountRects() > 1);
+	ERegion other(region);
+	other.OffsetBy(100, 0);
+	assert(other.Contains(105, 5) && other.Frame() == ERect(100, 0, 199, 99));
+
+	ETK_OUTPUT("Passed.\n");
+
+	return 0;
+}
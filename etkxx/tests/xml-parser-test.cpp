@@ -27,6 +27,9 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <string.h>
+#include <assert.h>
+
 #include <etk/xml/SimpleXmlParser.h>
 
 const char *xml_parser_test_buf = "\
@@ -47,6 +50,15 @@ int main(int argc, char **argv)
 {
 	ESimpleXmlNode node(NULL);
 	if(etk_parse_simple_xml(xml_parser_test_buf, &node) == E_OK) node.PrintToStream();
+
+	// entities are decoded once
+	ESimpleXmlNode entities(NULL);
+	assert(etk_parse_simple_xml("<a b=\"&amp;quot;\">&lt;&amp;lt;&gt;</a>", &entities) == E_OK);
+	const char *attr_content = NULL;
+	assert(entities.NodeAt(0) != NULL && entities.NodeAt(0)->AttributeAt(0, &attr_content) != NULL);
+	assert(strcmp(attr_content, "&quot;") == 0);
+	assert(strcmp(entities.NodeAt(0)->Content(), "<&lt;>") == 0);
+
 	return 0;
 }
 